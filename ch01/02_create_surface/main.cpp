@@ -261,7 +261,7 @@ int main() {
       VulkanCore::Context::create(window, applicationName, enabledInstanceLayers, enabledInstanceExtensions);
 
   while (!glfwWindowShouldClose(window)) {
-    glfwPollEvents();
+    glfwWaitEvents();
 
     glfwSwapBuffers(window);
   }
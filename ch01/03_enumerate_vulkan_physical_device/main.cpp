@@ -264,7 +264,7 @@ int main() {
   std::println("Found {} physical devices.", physicalDevices.size());
 
   while (!glfwWindowShouldClose(window)) {
-    glfwPollEvents();
+    glfwWaitEvents();
 
     if (glfwGetKey(window, GLFW_KEY_ESCAPE)) {
       glfwSetWindowShouldClose(window, true);
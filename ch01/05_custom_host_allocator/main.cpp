@@ -0,0 +1,725 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdlib>
+#include <cstring>
+#include <expected>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <print>
+#include <ranges>
+#include <string>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include <glfw/glfw3.h>
+#include <glfw/glfw3native.h>
+
+namespace ranges = std::ranges;
+namespace views = std::ranges::views;
+
+auto getRequestedInstanceLayers() -> std::vector<std::string> {
+  return std::vector<std::string>{"VK_LAYER_KHRONOS_validation"};
+}
+
+auto getRequestedInstanceExtensions() -> std::vector<std::string> {
+  return std::vector<std::string>{
+#if defined(VK_KHR_win32_surface)
+      VK_KHR_WIN32_SURFACE_EXTENSION_NAME,
+#endif
+#if defined(VK_USE_PLATFORM_METAL_EXT)
+      VK_EXT_METAL_SURFACE_EXTENSION_NAME, VK_KHR_PORTABILITY_ENUMERATION_EXTENSION_NAME,
+#endif
+#if defined(VK_EXT_debug_utils)
+      VK_EXT_DEBUG_UTILS_EXTENSION_NAME,
+#endif
+#if defined(VK_KHR_surface)
+      VK_KHR_SURFACE_EXTENSION_NAME,
+#endif
+  };
+}
+
+namespace VulkanCore {
+
+// Every host allocation carries this header right before the pointer handed to the driver, so free and realloc can
+// find out where the block came from without a lookup.
+struct AllocationHeader {
+  uint64_t size;
+  uint16_t origin;
+  uint16_t scope;
+  uint32_t offset;
+};
+static_assert(sizeof(AllocationHeader) == 16);
+
+// Thread-local free lists of fixed size blocks. Blocks are carved out of slabs that are only handed back to the
+// system at exit, a block freed on another thread simply joins that thread's free list. The thread caches outlive
+// any single allocator, so there is one set of pools per process.
+class SizeClassPools {
+public:
+  static SizeClassPools& instance() {
+    static SizeClassPools pools;
+    return pools;
+  }
+
+  static constexpr size_t kMinBlockSize = 32;
+  static constexpr size_t kMaxBlockSize = 4096;
+  static constexpr size_t kClassCount = std::countr_zero(kMaxBlockSize) - std::countr_zero(kMinBlockSize) + 1;
+  static constexpr size_t kSlabSize = 64 * 1024;
+
+  [[nodiscard]] static constexpr std::optional<uint16_t> sizeClassFor(size_t blockSize) noexcept {
+    if (blockSize > kMaxBlockSize)
+      return std::nullopt;
+
+    const auto rounded = std::bit_ceil(std::max(blockSize, kMinBlockSize));
+    return static_cast<uint16_t>(std::countr_zero(rounded) - std::countr_zero(kMinBlockSize));
+  }
+
+  [[nodiscard]] static constexpr size_t blockSizeOf(uint16_t sizeClass) noexcept { return kMinBlockSize << sizeClass; }
+
+  void* acquire(uint16_t sizeClass, std::atomic<uint64_t>& systemAllocations) {
+    auto& cache = threadCache();
+    auto* block = cache.heads[sizeClass];
+    if (block == nullptr) {
+      refill(cache, sizeClass, systemAllocations);
+      block = cache.heads[sizeClass];
+      if (block == nullptr)
+        return nullptr;
+    }
+
+    cache.heads[sizeClass] = block->next;
+    return block;
+  }
+
+  void release(uint16_t sizeClass, void* memory) noexcept {
+    auto& cache = threadCache();
+    auto* block = static_cast<FreeBlock*>(memory);
+    block->next = cache.heads[sizeClass];
+    cache.heads[sizeClass] = block;
+  }
+
+private:
+  SizeClassPools() = default;
+
+  ~SizeClassPools() {
+    for (auto* slab : m_slabs)
+      std::free(slab);
+  }
+
+  struct FreeBlock {
+    FreeBlock* next;
+  };
+
+  struct ThreadCache {
+    std::array<FreeBlock*, kClassCount> heads{};
+  };
+
+  static ThreadCache& threadCache() noexcept {
+    thread_local ThreadCache cache;
+    return cache;
+  }
+
+  void refill(ThreadCache& cache, uint16_t sizeClass, std::atomic<uint64_t>& systemAllocations) {
+    auto* slab = static_cast<std::byte*>(std::malloc(kSlabSize));
+    if (slab == nullptr)
+      return;
+
+    systemAllocations.fetch_add(1, std::memory_order_relaxed);
+    {
+      std::lock_guard lock{m_slabsMutex};
+      m_slabs.push_back(slab);
+    }
+
+    const auto blockSize = blockSizeOf(sizeClass);
+    for (size_t offset = 0; offset + blockSize <= kSlabSize; offset += blockSize)
+      release(sizeClass, slab + offset);
+  }
+
+  std::mutex m_slabsMutex;
+  std::vector<std::byte*> m_slabs;
+};
+
+// Bump allocator used for instance scope objects: they live as long as the VkInstance, so nothing is reclaimed until
+// the arena itself goes away. Every allocation is rounded to 16 bytes, the caller takes care of larger alignments.
+class LinearArena {
+public:
+  static constexpr size_t kBlockSize = 256 * 1024;
+  static constexpr size_t kGranularity = 16;
+
+  explicit LinearArena(size_t capacity) : m_capacity{capacity} {}
+
+  LinearArena(const LinearArena&) = delete;
+  LinearArena& operator=(const LinearArena&) = delete;
+
+  ~LinearArena() {
+    for (auto* block : m_blocks)
+      std::free(block);
+  }
+
+  void* allocate(size_t size, std::atomic<uint64_t>& systemAllocations) {
+    size = (size + kGranularity - 1) & ~(kGranularity - 1);
+    if (size > kBlockSize)
+      return nullptr;
+
+    std::lock_guard lock{m_mutex};
+    if (m_current == nullptr || m_offset + size > kBlockSize) {
+      if (m_reserved + kBlockSize > m_capacity)
+        return nullptr;
+
+      m_current = static_cast<std::byte*>(std::malloc(kBlockSize));
+      if (m_current == nullptr)
+        return nullptr;
+
+      systemAllocations.fetch_add(1, std::memory_order_relaxed);
+      m_blocks.push_back(m_current);
+      m_reserved += kBlockSize;
+      m_offset = 0;
+    }
+
+    auto* memory = m_current + m_offset;
+    m_offset += size;
+    return memory;
+  }
+
+  [[nodiscard]] size_t reservedBytes() const noexcept { return m_reserved; }
+
+private:
+  std::mutex m_mutex;
+  std::vector<std::byte*> m_blocks;
+  std::byte* m_current = nullptr;
+  size_t m_offset = 0;
+  size_t m_reserved = 0;
+  size_t m_capacity;
+};
+
+struct ScopeStatistics {
+  std::atomic<uint64_t> allocations{0};
+  std::atomic<uint64_t> reallocations{0};
+  std::atomic<uint64_t> frees{0};
+  std::atomic<uint64_t> currentBytes{0};
+  std::atomic<uint64_t> peakBytes{0};
+  std::atomic<uint64_t> internalBytes{0};
+
+  void onAllocate(uint64_t size) noexcept {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    updatePeak(currentBytes.fetch_add(size, std::memory_order_relaxed) + size);
+  }
+
+  // Growing or shrinking in place and moving to a new block both count as one reallocation. Shrinking wraps the
+  // unsigned difference around, which the addition undoes.
+  void onReallocate(uint64_t oldSize, uint64_t newSize) noexcept {
+    reallocations.fetch_add(1, std::memory_order_relaxed);
+    const auto delta = newSize - oldSize;
+    updatePeak(currentBytes.fetch_add(delta, std::memory_order_relaxed) + delta);
+  }
+
+  void onFree(uint64_t size) noexcept {
+    frees.fetch_add(1, std::memory_order_relaxed);
+    currentBytes.fetch_sub(size, std::memory_order_relaxed);
+  }
+
+private:
+  void updatePeak(uint64_t current) noexcept {
+    auto peak = peakBytes.load(std::memory_order_relaxed);
+    while (current > peak && !peakBytes.compare_exchange_weak(peak, current, std::memory_order_relaxed)) {
+    }
+  }
+};
+
+constexpr std::string_view toString(VkSystemAllocationScope scope) {
+  switch (scope) {
+  case VK_SYSTEM_ALLOCATION_SCOPE_COMMAND:
+    return "command";
+  case VK_SYSTEM_ALLOCATION_SCOPE_OBJECT:
+    return "object";
+  case VK_SYSTEM_ALLOCATION_SCOPE_CACHE:
+    return "cache";
+  case VK_SYSTEM_ALLOCATION_SCOPE_DEVICE:
+    return "device";
+  case VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE:
+    return "instance";
+  default:
+    return "unknown";
+  }
+}
+
+// Host allocator installed through VkAllocationCallbacks: instance scoped allocations come from the linear arena, the
+// short lived command and object scoped ones that churn the most (and anything that does not fit the arena) from the
+// size-class pools, and blocks bigger than the largest size class straight from the system allocator.
+class HostAllocator {
+public:
+  static constexpr size_t kScopeCount = VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE + 1;
+  static constexpr size_t kDefaultArenaCapacity = 16 * 1024 * 1024;
+
+  explicit HostAllocator(size_t arenaCapacity = kDefaultArenaCapacity) : m_arena{arenaCapacity} {
+    m_callbacks = VkAllocationCallbacks{.pUserData = this,
+                                        .pfnAllocation = &HostAllocator::allocationCallback,
+                                        .pfnReallocation = &HostAllocator::reallocationCallback,
+                                        .pfnFree = &HostAllocator::freeCallback,
+                                        .pfnInternalAllocation = &HostAllocator::internalAllocationCallback,
+                                        .pfnInternalFree = &HostAllocator::internalFreeCallback};
+  }
+
+  HostAllocator(const HostAllocator&) = delete;
+  HostAllocator& operator=(const HostAllocator&) = delete;
+
+  [[nodiscard]] const VkAllocationCallbacks* callbacks() const noexcept { return &m_callbacks; }
+
+  [[nodiscard]] const ScopeStatistics& statistics(VkSystemAllocationScope scope) const noexcept {
+    return m_statistics[scope];
+  }
+
+  [[nodiscard]] uint64_t systemAllocations() const noexcept {
+    return m_systemAllocations.load(std::memory_order_relaxed);
+  }
+
+  void printStatistics() const {
+    std::println("{:>10} {:>8} {:>8} {:>8} {:>12} {:>12} {:>12}", "scope", "allocs", "reallocs", "frees", "current",
+                 "peak", "internal");
+    for (size_t scope = 0; scope < kScopeCount; ++scope) {
+      const auto& stats = m_statistics[scope];
+      std::println("{:>10} {:>8} {:>8} {:>8} {:>12} {:>12} {:>12}",
+                   toString(static_cast<VkSystemAllocationScope>(scope)), stats.allocations.load(),
+                   stats.reallocations.load(), stats.frees.load(), stats.currentBytes.load(), stats.peakBytes.load(),
+                   stats.internalBytes.load());
+    }
+
+    const auto served = ranges::fold_left(m_statistics | views::transform([](const ScopeStatistics& stats) {
+                                            return stats.allocations.load() + stats.reallocations.load();
+                                          }),
+                                          uint64_t{0}, std::plus<>{});
+    std::println("{} driver allocations served with {} system allocations, {} bytes reserved by the instance arena",
+                 served, systemAllocations(), m_arena.reservedBytes());
+  }
+
+private:
+  enum Origin : uint16_t { Pool = 0, Arena = 1, System = 2 };
+
+  static constexpr size_t kHeaderSize = sizeof(AllocationHeader);
+
+  static AllocationHeader* headerOf(void* memory) noexcept {
+    return reinterpret_cast<AllocationHeader*>(static_cast<std::byte*>(memory) - kHeaderSize);
+  }
+
+  // The user pointer is aligned and the header sits right before it; for alignments above the header size the
+  // padding in front of the header is recorded in AllocationHeader::offset.
+  static void* placeHeader(void* raw, size_t size, size_t alignment, Origin origin, VkSystemAllocationScope scope,
+                           uint16_t sizeClass) noexcept {
+    const auto base = reinterpret_cast<uintptr_t>(raw);
+    const auto user = (base + kHeaderSize + alignment - 1) & ~(uintptr_t{alignment} - 1);
+    auto* header = reinterpret_cast<AllocationHeader*>(user - kHeaderSize);
+    header->size = size;
+    header->origin = origin == Pool ? static_cast<uint16_t>(Pool | sizeClass << 2) : origin;
+    header->scope = static_cast<uint16_t>(scope);
+    header->offset = static_cast<uint32_t>(user - base);
+    return reinterpret_cast<void*>(user);
+  }
+
+  void* allocate(size_t size, size_t alignment, VkSystemAllocationScope scope) {
+    if (size == 0)
+      return nullptr;
+
+    auto* memory = allocateBlock(size, alignment, scope);
+    if (memory != nullptr)
+      m_statistics[scope].onAllocate(size);
+    return memory;
+  }
+
+  void free(void* memory) noexcept {
+    if (memory == nullptr)
+      return;
+
+    const auto* header = headerOf(memory);
+    m_statistics[header->scope].onFree(header->size);
+    releaseBlock(memory);
+  }
+
+  // Memory from the arena, the pools or the system, without touching the statistics.
+  void* allocateBlock(size_t size, size_t alignment, VkSystemAllocationScope scope) {
+    // Every backing block is at least 16 bytes aligned, so the worst case padding is alignment - kHeaderSize.
+    alignment = std::max(alignment, kHeaderSize);
+    const auto blockSize = size + kHeaderSize + alignment - kHeaderSize;
+
+    void* memory = nullptr;
+    if (scope == VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE) {
+      if (auto* raw = m_arena.allocate(blockSize, m_systemAllocations); raw != nullptr)
+        memory = placeHeader(raw, size, alignment, Arena, scope, 0);
+    }
+
+    if (memory == nullptr) {
+      if (const auto sizeClass = SizeClassPools::sizeClassFor(blockSize); sizeClass.has_value()) {
+        if (auto* raw = SizeClassPools::instance().acquire(sizeClass.value(), m_systemAllocations); raw != nullptr)
+          memory = placeHeader(raw, size, alignment, Pool, scope, sizeClass.value());
+      }
+    }
+
+    if (memory == nullptr) {
+      auto* raw = std::malloc(blockSize);
+      if (raw == nullptr)
+        return nullptr;
+
+      m_systemAllocations.fetch_add(1, std::memory_order_relaxed);
+      memory = placeHeader(raw, size, alignment, System, scope, 0);
+    }
+    return memory;
+  }
+
+  void releaseBlock(void* memory) noexcept {
+    const auto* header = headerOf(memory);
+    auto* raw = static_cast<std::byte*>(memory) - header->offset;
+    switch (header->origin & 0x3) {
+    case Pool:
+      SizeClassPools::instance().release(static_cast<uint16_t>(header->origin >> 2), raw);
+      break;
+    case System:
+      std::free(raw);
+      break;
+    default:
+      // Arena memory is released all at once together with the allocator.
+      break;
+    }
+  }
+
+  void* reallocate(void* original, size_t size, size_t alignment, VkSystemAllocationScope scope) {
+    if (original == nullptr)
+      return allocate(size, alignment, scope);
+
+    if (size == 0) {
+      free(original);
+      return nullptr;
+    }
+
+    auto* header = headerOf(original);
+    if ((header->origin & 0x3) == Pool && reinterpret_cast<uintptr_t>(original) % alignment == 0) {
+      const auto capacity =
+          SizeClassPools::blockSizeOf(static_cast<uint16_t>(header->origin >> 2)) - header->offset;
+      if (size <= capacity) {
+        m_statistics[header->scope].onReallocate(header->size, size);
+        header->size = size;
+        return original;
+      }
+    }
+
+    auto* memory = allocateBlock(size, alignment, scope);
+    if (memory == nullptr)
+      return nullptr;
+
+    std::memcpy(memory, original, std::min<size_t>(size, header->size));
+    // The bytes move over to the new scope when the driver changes it.
+    if (header->scope == scope) {
+      m_statistics[scope].onReallocate(header->size, size);
+    } else {
+      m_statistics[header->scope].currentBytes.fetch_sub(header->size, std::memory_order_relaxed);
+      m_statistics[scope].onReallocate(0, size);
+    }
+    releaseBlock(original);
+    return memory;
+  }
+
+  static VKAPI_ATTR void* VKAPI_CALL allocationCallback(void* userData, size_t size, size_t alignment,
+                                                        VkSystemAllocationScope scope) {
+    return static_cast<HostAllocator*>(userData)->allocate(size, alignment, scope);
+  }
+
+  static VKAPI_ATTR void* VKAPI_CALL reallocationCallback(void* userData, void* original, size_t size,
+                                                          size_t alignment, VkSystemAllocationScope scope) {
+    return static_cast<HostAllocator*>(userData)->reallocate(original, size, alignment, scope);
+  }
+
+  static VKAPI_ATTR void VKAPI_CALL freeCallback(void* userData, void* memory) {
+    static_cast<HostAllocator*>(userData)->free(memory);
+  }
+
+  static VKAPI_ATTR void VKAPI_CALL internalAllocationCallback(void* userData, size_t size, VkInternalAllocationType,
+                                                               VkSystemAllocationScope scope) {
+    static_cast<HostAllocator*>(userData)->m_statistics[scope].internalBytes.fetch_add(size,
+                                                                                       std::memory_order_relaxed);
+  }
+
+  static VKAPI_ATTR void VKAPI_CALL internalFreeCallback(void* userData, size_t size, VkInternalAllocationType,
+                                                         VkSystemAllocationScope scope) {
+    static_cast<HostAllocator*>(userData)->m_statistics[scope].internalBytes.fetch_sub(size,
+                                                                                       std::memory_order_relaxed);
+  }
+
+private:
+  VkAllocationCallbacks m_callbacks{};
+  LinearArena m_arena;
+  std::array<ScopeStatistics, kScopeCount> m_statistics;
+  std::atomic<uint64_t> m_systemAllocations{0};
+};
+
+std::vector<VkLayerProperties> enumerateInstanceLayerProperties() {
+  uint32_t layersCount{0};
+  vkEnumerateInstanceLayerProperties(&layersCount, nullptr);
+
+  std::vector<VkLayerProperties> layersProperties(layersCount);
+  vkEnumerateInstanceLayerProperties(&layersCount, layersProperties.data());
+
+  return layersProperties;
+}
+
+std::vector<VkExtensionProperties> enumerateExtensionsProperties() {
+  uint32_t extensionsCount{0};
+  vkEnumerateInstanceExtensionProperties(nullptr, &extensionsCount, nullptr);
+
+  std::vector<VkExtensionProperties> extensionsProperties(extensionsCount);
+  vkEnumerateInstanceExtensionProperties(nullptr, &extensionsCount, extensionsProperties.data());
+
+  return extensionsProperties;
+}
+
+std::optional<VkSurfaceKHR> createVulkanSurface(GLFWwindow* window, VkInstance vulkanInstance,
+                                                const VkAllocationCallbacks* allocator) {
+  VkSurfaceKHR surface;
+#if defined(VK_USE_PLATFORM_WIN32_KHR)
+  auto hwnd = glfwGetWin32Window(window);
+  const VkWin32SurfaceCreateInfoKHR surfaceInfo{.sType = VK_STRUCTURE_TYPE_WIN32_SURFACE_CREATE_INFO_KHR,
+                                                .hinstance = GetModuleHandleW(nullptr),
+                                                .hwnd = reinterpret_cast<HWND>(hwnd)};
+
+  const auto res = vkCreateWin32SurfaceKHR(vulkanInstance, &surfaceInfo, allocator, &surface);
+#else
+  const auto res = glfwCreateWindowSurface(vulkanInstance, window, allocator, &surface);
+#endif
+  if (res == VK_SUCCESS)
+    return surface;
+  else
+    return std::nullopt;
+}
+
+std::vector<VkPhysicalDevice> enumeratePhysicalDevices(VkInstance instance) {
+  uint32_t physicalDevicesCount{0};
+  vkEnumeratePhysicalDevices(instance, &physicalDevicesCount, nullptr);
+
+  std::vector<VkPhysicalDevice> physicalDevices(physicalDevicesCount);
+  vkEnumeratePhysicalDevices(instance, &physicalDevicesCount, physicalDevices.data());
+
+  return physicalDevices;
+}
+
+std::vector<VkQueueFamilyProperties> enumeratePhysicalDevicesQueueFamilyProperties(VkPhysicalDevice device) {
+  uint32_t physicalDeviceQueueFamilyPropertiesCount{0};
+  vkGetPhysicalDeviceQueueFamilyProperties(device, &physicalDeviceQueueFamilyPropertiesCount, nullptr);
+
+  std::vector<VkQueueFamilyProperties> queueFamiliesProperties(physicalDeviceQueueFamilyPropertiesCount);
+  vkGetPhysicalDeviceQueueFamilyProperties(device, &physicalDeviceQueueFamilyPropertiesCount,
+                                           queueFamiliesProperties.data());
+
+  return queueFamiliesProperties;
+}
+
+class PhysicalDevice {
+public:
+  PhysicalDevice(VkPhysicalDevice device, std::vector<VkExtensionProperties> extensions, VkSurfaceKHR surface)
+      : m_device{device}, m_extensions{std::move<>(extensions)}, m_surface{surface} {
+    m_queueFamilies = enumeratePhysicalDevicesQueueFamilyProperties(m_device);
+
+    std::println("Physical Device {} has {} queue families", (void*)&m_device, m_queueFamilies.size());
+  }
+
+  [[nodiscard]] inline VkPhysicalDevice getPhysicalDevice() const noexcept { return m_device; }
+
+private:
+  VkPhysicalDevice m_device;
+  std::vector<VkExtensionProperties> m_extensions;
+  std::vector<VkQueueFamilyProperties> m_queueFamilies;
+  VkSurfaceKHR m_surface;
+};
+
+class Context {
+public:
+  static std::expected<Context, std::string> create(GLFWwindow* window, std::string_view applicationName,
+                                                    std::vector<std::string> requestedInstanceLayer,
+                                                    std::vector<std::string> requestedInstanceExtensions) {
+
+    Context context{window, applicationName, std::move(requestedInstanceLayer), std::move(requestedInstanceExtensions)};
+
+    if (context.init())
+      return context;
+    else
+      return std::unexpected(std::string{"Failed to init the vulkan context"});
+  }
+
+  ~Context() {
+    if (m_vulkanInstance == VK_NULL_HANDLE)
+      return;
+
+    vkDestroySurfaceKHR(m_vulkanInstance, m_surface, m_allocator->callbacks());
+    vkDestroyInstance(m_vulkanInstance, m_allocator->callbacks());
+    m_vulkanInstance = VK_NULL_HANDLE;
+  }
+
+  Context& operator=(const Context&) = delete;
+
+  Context(const Context&) = delete;
+
+  Context(Context&& rhs) noexcept {
+    swap(rhs);
+    rhs.m_vulkanInstance = VK_NULL_HANDLE;
+    rhs.m_surface = VK_NULL_HANDLE;
+  }
+
+  Context& operator=(Context&& rhs) noexcept {
+    Context tmp{std::move(rhs)};
+    swap(tmp);
+    return *this;
+  }
+
+  std::vector<PhysicalDevice> enumeratePhysicalDevices() {
+    // clang-format off
+    auto result = VulkanCore::enumeratePhysicalDevices(m_vulkanInstance)
+      | views::transform([this](VkPhysicalDevice device) -> PhysicalDevice {
+         return PhysicalDevice{device, m_layerExtensions, m_surface};
+        })
+      | ranges::to<std::vector<PhysicalDevice>>();
+    // clang-format on
+    return result;
+  }
+
+  [[nodiscard]] const HostAllocator& getHostAllocator() const noexcept { return *m_allocator; }
+
+  // Shared so the statistics stay readable after the instance has been destroyed.
+  [[nodiscard]] std::shared_ptr<const HostAllocator> shareHostAllocator() const noexcept { return m_allocator; }
+
+private:
+  Context(GLFWwindow* window, std::string_view applicationName, std::vector<std::string> requestedInstanceLayer,
+          std::vector<std::string> requestedInstanceExtensions)
+      : m_window{window}, m_applicationName{applicationName}, m_allocator{std::make_shared<HostAllocator>()} {
+    auto allInstanceLayers = enumerateInstanceLayerProperties();
+    const auto isInstanceLayerRequired = [&requestedInstanceLayer](const VkLayerProperties& prop) {
+      auto name = std::string{prop.layerName};
+      return ranges::find(requestedInstanceLayer, name) != std::end(requestedInstanceLayer);
+    };
+    // clang-format off
+    m_layerProperties = allInstanceLayers
+      | views::filter(isInstanceLayerRequired)
+      | ranges::to<std::vector<VkLayerProperties>>();
+    // clang-format on
+
+    auto allExtensions = enumerateExtensionsProperties();
+    const auto isExtensionRequired = [&requestedInstanceExtensions](const VkExtensionProperties& prop) {
+      auto name = std::string{prop.extensionName};
+      return ranges::find(requestedInstanceExtensions, name) != std::end(requestedInstanceExtensions);
+    };
+    // clang-format off
+    m_layerExtensions = allExtensions
+      | views::filter(isExtensionRequired)
+      | ranges::to<std::vector<VkExtensionProperties>>();
+    // clang-format on
+  }
+
+  bool init() {
+    // clang-format off
+    auto layers = m_layerProperties
+      | views::transform([](const VkLayerProperties& prop) -> const char*
+        {
+          return prop.layerName;
+        })
+      | ranges::to<std::vector<const char*>>();
+
+      auto extensions = m_layerExtensions
+        | views::transform([](const VkExtensionProperties & prop) -> const char*
+          {
+            return prop.extensionName;
+          })
+        | ranges::to<std::vector<const char*>>();
+    // clang-format on
+
+    const VkApplicationInfo applicationInfo{.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO,
+                                            .pApplicationName = m_applicationName.data(),
+                                            .applicationVersion = VK_MAKE_VERSION(1, 0, 0),
+                                            .apiVersion = VK_API_VERSION_1_3};
+
+    const VkInstanceCreateInfo instanceCreateInfo{.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO,
+#if defined(VK_USE_PLATFORM_METAL_EXT)
+                                                  .flags = VK_INSTANCE_CREATE_ENUMERATE_PORTABILITY_BIT_KHR,
+#endif
+                                                  .pApplicationInfo = &applicationInfo,
+                                                  .enabledLayerCount = static_cast<uint32_t>(layers.size()),
+                                                  .ppEnabledLayerNames = layers.data(),
+                                                  .enabledExtensionCount = static_cast<uint32_t>(extensions.size()),
+                                                  .ppEnabledExtensionNames = extensions.data()};
+
+    const auto res = vkCreateInstance(&instanceCreateInfo, m_allocator->callbacks(), &m_vulkanInstance);
+    if (res != VK_SUCCESS)
+      return false;
+
+    auto surface = createVulkanSurface(m_window, m_vulkanInstance, m_allocator->callbacks());
+    if (!surface.has_value())
+      return false;
+
+    m_surface = surface.value();
+    return true;
+  }
+
+  void swap(Context& rhs) {
+    std::swap(m_window, rhs.m_window);
+    std::swap(m_applicationName, rhs.m_applicationName);
+    std::swap(m_layerProperties, rhs.m_layerProperties);
+    std::swap(m_layerExtensions, rhs.m_layerExtensions);
+    std::swap(m_allocator, rhs.m_allocator);
+    std::swap(m_vulkanInstance, rhs.m_vulkanInstance);
+    std::swap(m_surface, rhs.m_surface);
+  }
+
+private:
+  GLFWwindow* m_window = nullptr;
+  std::string m_applicationName;
+  std::vector<VkLayerProperties> m_layerProperties;
+  std::vector<VkExtensionProperties> m_layerExtensions;
+  // The callbacks hold a pointer to the allocator, it must not move together with the context.
+  std::shared_ptr<HostAllocator> m_allocator;
+  VkInstance m_vulkanInstance = VK_NULL_HANDLE;
+  VkSurfaceKHR m_surface = VK_NULL_HANDLE;
+};
+} // namespace VulkanCore
+
+int main() {
+  const std::string applicationName = "01-05 Custom host allocator";
+
+  glfwInit();
+  glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+  auto window = glfwCreateWindow(800, 600, applicationName.c_str(), nullptr, nullptr);
+  glfwMakeContextCurrent(window);
+
+  std::shared_ptr<const VulkanCore::HostAllocator> hostAllocator;
+  {
+    auto vulkanContext = VulkanCore::Context::create(window, applicationName, getRequestedInstanceLayers(),
+                                                     getRequestedInstanceExtensions());
+
+    if (!vulkanContext) {
+      std::println("Unable to create the context: {}", vulkanContext.error());
+      return EXIT_FAILURE;
+    }
+    hostAllocator = vulkanContext.value().shareHostAllocator();
+
+    auto physicalDevices = vulkanContext.value().enumeratePhysicalDevices();
+    std::println("Found {} physical devices.", physicalDevices.size());
+
+    std::println("\nHost memory after the instance creation:");
+    hostAllocator->printStatistics();
+
+    while (!glfwWindowShouldClose(window)) {
+      glfwWaitEvents();
+
+      if (glfwGetKey(window, GLFW_KEY_ESCAPE)) {
+        glfwSetWindowShouldClose(window, true);
+      }
+
+      glfwSwapBuffers(window);
+    }
+  }
+
+  // The context is gone, so the frees issued by vkDestroySurfaceKHR and vkDestroyInstance are accounted for.
+  std::println("\nHost memory at shutdown:");
+  hostAllocator->printStatistics();
+
+  glfwTerminate();
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,1072 @@
+#include <algorithm>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <expected>
+#include <functional>
+#include <iterator>
+#include <optional>
+#include <print>
+#include <random>
+#include <ranges>
+#include <span>
+#include <string>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+namespace ranges = std::ranges;
+namespace views = std::ranges::views;
+
+#define VK_CALL(vFun)                                                                                                  \
+  {                                                                                                                    \
+    const auto res = vFun;                                                                                             \
+    if (res != VK_SUCCESS) {                                                                                           \
+      std::println(#vFun " failed with error {}", static_cast<int>(res));                                              \
+      std::exit(res);                                                                                                  \
+    }                                                                                                                  \
+  }
+
+auto getRequestedInstanceLayers() -> std::vector<std::string> {
+  return std::vector<std::string>{"VK_LAYER_KHRONOS_validation"};
+}
+
+auto getRequestedInstanceExtensions() -> std::vector<std::string> {
+  return std::vector<std::string>{
+#if defined(VK_USE_PLATFORM_METAL_EXT)
+      VK_KHR_PORTABILITY_ENUMERATION_EXTENSION_NAME,
+#endif
+#if defined(VK_EXT_debug_utils)
+      VK_EXT_DEBUG_UTILS_EXTENSION_NAME,
+#endif
+  };
+}
+
+auto getRequestedDeviceExtensions() -> std::vector<std::string> {
+  return std::vector<std::string>{
+      VK_EXT_MEMORY_BUDGET_EXTENSION_NAME,
+      VK_EXT_MEMORY_PRIORITY_EXTENSION_NAME,
+  };
+}
+
+namespace VulkanCore {
+std::vector<VkLayerProperties> enumerateInstanceLayerProperties() {
+  uint32_t layersCount{0};
+  vkEnumerateInstanceLayerProperties(&layersCount, nullptr);
+
+  std::vector<VkLayerProperties> layersProperties(layersCount);
+  vkEnumerateInstanceLayerProperties(&layersCount, layersProperties.data());
+
+  return layersProperties;
+}
+
+std::vector<VkExtensionProperties> enumerateExtensionsProperties() {
+  uint32_t extensionsCount{0};
+  vkEnumerateInstanceExtensionProperties(nullptr, &extensionsCount, nullptr);
+
+  std::vector<VkExtensionProperties> extensionsProperties(extensionsCount);
+  vkEnumerateInstanceExtensionProperties(nullptr, &extensionsCount, extensionsProperties.data());
+
+  return extensionsProperties;
+}
+
+std::vector<VkExtensionProperties> enumerateDeviceExtensionsProperties(VkPhysicalDevice device) {
+  uint32_t extensionsCount{0};
+  vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionsCount, nullptr);
+
+  std::vector<VkExtensionProperties> extensionsProperties(extensionsCount);
+  vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionsCount, extensionsProperties.data());
+
+  return extensionsProperties;
+}
+
+std::vector<VkPhysicalDevice> enumeratePhysicalDevices(VkInstance instance) {
+  uint32_t physicalDevicesCount{0};
+  vkEnumeratePhysicalDevices(instance, &physicalDevicesCount, nullptr);
+
+  std::vector<VkPhysicalDevice> physicalDevices(physicalDevicesCount);
+  vkEnumeratePhysicalDevices(instance, &physicalDevicesCount, physicalDevices.data());
+
+  return physicalDevices;
+}
+
+std::vector<VkQueueFamilyProperties> enumeratePhysicalDevicesQueueFamilyProperties(VkPhysicalDevice device) {
+  uint32_t physicalDeviceQueueFamilyPropertiesCount{0};
+  vkGetPhysicalDeviceQueueFamilyProperties(device, &physicalDeviceQueueFamilyPropertiesCount, nullptr);
+
+  std::vector<VkQueueFamilyProperties> queueFamiliesProperties(physicalDeviceQueueFamilyPropertiesCount);
+  vkGetPhysicalDeviceQueueFamilyProperties(device, &physicalDeviceQueueFamilyPropertiesCount,
+                                           queueFamiliesProperties.data());
+
+  return queueFamiliesProperties;
+}
+
+struct HeapBudget {
+  VkDeviceSize size = 0;
+  VkDeviceSize budget = 0;
+  VkDeviceSize usage = 0;
+  bool isDeviceLocal = false;
+};
+
+class PhysicalDevice {
+public:
+  explicit PhysicalDevice(VkPhysicalDevice device)
+      : m_device{device}, m_extensions{enumerateDeviceExtensionsProperties(device)},
+        m_queueFamilies{enumeratePhysicalDevicesQueueFamilyProperties(device)} {
+    vkGetPhysicalDeviceProperties(m_device, &m_properties);
+    vkGetPhysicalDeviceMemoryProperties(m_device, &m_memoryProperties);
+  }
+
+  [[nodiscard]] inline VkPhysicalDevice getPhysicalDevice() const noexcept { return m_device; }
+
+  [[nodiscard]] inline const VkPhysicalDeviceProperties& getProperties() const noexcept { return m_properties; }
+
+  [[nodiscard]] inline const VkPhysicalDeviceMemoryProperties& getMemoryProperties() const noexcept {
+    return m_memoryProperties;
+  }
+
+  [[nodiscard]] bool isExtensionSupported(std::string_view name) const {
+    return ranges::any_of(m_extensions,
+                          [name](const VkExtensionProperties& prop) { return name == prop.extensionName; });
+  }
+
+  [[nodiscard]] std::optional<uint32_t> findQueueFamily(VkQueueFlags flags) const {
+    const auto it = ranges::find_if(m_queueFamilies, [flags](const VkQueueFamilyProperties& family) {
+      return (family.queueFlags & flags) == flags;
+    });
+    if (it == std::end(m_queueFamilies))
+      return std::nullopt;
+
+    return static_cast<uint32_t>(std::distance(std::begin(m_queueFamilies), it));
+  }
+
+  // Without VK_EXT_memory_budget the whole heap is reported as budget and the usage is left to the caller.
+  [[nodiscard]] std::vector<HeapBudget> queryMemoryBudget() const {
+    const auto hasMemoryBudget = isExtensionSupported(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT};
+    VkPhysicalDeviceMemoryProperties2 memoryProperties{.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2,
+                                                       .pNext = hasMemoryBudget ? &budgetProperties : nullptr};
+    vkGetPhysicalDeviceMemoryProperties2(m_device, &memoryProperties);
+
+    const auto& properties = memoryProperties.memoryProperties;
+    // clang-format off
+    return views::iota(0u, properties.memoryHeapCount)
+      | views::transform([&](uint32_t heapIndex) -> HeapBudget {
+          const auto& heap = properties.memoryHeaps[heapIndex];
+          return HeapBudget{.size = heap.size,
+                            .budget = hasMemoryBudget ? budgetProperties.heapBudget[heapIndex] : heap.size,
+                            .usage = hasMemoryBudget ? budgetProperties.heapUsage[heapIndex] : 0,
+                            .isDeviceLocal = (heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0};
+        })
+      | ranges::to<std::vector<HeapBudget>>();
+    // clang-format on
+  }
+
+private:
+  VkPhysicalDevice m_device;
+  std::vector<VkExtensionProperties> m_extensions;
+  std::vector<VkQueueFamilyProperties> m_queueFamilies;
+  VkPhysicalDeviceProperties m_properties{};
+  VkPhysicalDeviceMemoryProperties m_memoryProperties{};
+};
+
+struct BufferAllocation {
+  VkBuffer buffer = VK_NULL_HANDLE;
+  VkDeviceMemory memory = VK_NULL_HANDLE;
+  VkDeviceSize size = 0;
+  uint32_t memoryTypeIndex = 0;
+  uint32_t heapIndex = 0;
+};
+
+class Device {
+public:
+  static std::expected<Device, std::string> create(const PhysicalDevice& physicalDevice,
+                                                   std::vector<std::string> requestedDeviceExtensions) {
+    Device device{physicalDevice, std::move(requestedDeviceExtensions)};
+
+    if (device.init())
+      return device;
+    else
+      return std::unexpected(std::string{"Failed to create the vulkan device"});
+  }
+
+  ~Device() {
+    if (m_device == VK_NULL_HANDLE)
+      return;
+
+    vkDeviceWaitIdle(m_device);
+    vkDestroyFence(m_device, m_fence, nullptr);
+    vkDestroyCommandPool(m_device, m_commandPool, nullptr);
+    vkDestroyDevice(m_device, nullptr);
+    m_device = VK_NULL_HANDLE;
+  }
+
+  Device& operator=(const Device&) = delete;
+
+  Device(const Device&) = delete;
+
+  Device(Device&& rhs) noexcept {
+    swap(rhs);
+    rhs.m_device = VK_NULL_HANDLE;
+  }
+
+  Device& operator=(Device&& rhs) noexcept {
+    Device tmp{std::move(rhs)};
+    swap(tmp);
+    return *this;
+  }
+
+  [[nodiscard]] inline VkDevice getDevice() const noexcept { return m_device; }
+
+  [[nodiscard]] bool isExtensionEnabled(std::string_view name) const {
+    return ranges::find(m_enabledExtensions, name) != std::end(m_enabledExtensions);
+  }
+
+  [[nodiscard]] std::optional<uint32_t> findMemoryType(uint32_t typeBits, VkMemoryPropertyFlags required,
+                                                       VkMemoryPropertyFlags avoided = 0) const {
+    for (uint32_t index = 0; index < m_memoryProperties.memoryTypeCount; ++index) {
+      const auto flags = m_memoryProperties.memoryTypes[index].propertyFlags;
+      if ((typeBits & (1u << index)) && (flags & required) == required && (flags & avoided) == 0)
+        return index;
+    }
+    return std::nullopt;
+  }
+
+  [[nodiscard]] bool isHostVisible(uint32_t memoryTypeIndex) const noexcept {
+    return m_memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+  }
+
+  [[nodiscard]] bool isDeviceLocal(uint32_t memoryTypeIndex) const noexcept {
+    return m_memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+  }
+
+  // The heap createBuffer would allocate from, so callers can make room there before allocating.
+  [[nodiscard]] std::optional<uint32_t> findHeap(VkDeviceSize size, VkBufferUsageFlags usage,
+                                                 VkMemoryPropertyFlags required, VkMemoryPropertyFlags avoided) const {
+    const VkBufferCreateInfo bufferInfo{.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+                                        .size = size,
+                                        .usage = usage,
+                                        .sharingMode = VK_SHARING_MODE_EXCLUSIVE};
+    const VkDeviceBufferMemoryRequirements requirementsInfo{
+        .sType = VK_STRUCTURE_TYPE_DEVICE_BUFFER_MEMORY_REQUIREMENTS, .pCreateInfo = &bufferInfo};
+    VkMemoryRequirements2 requirements{.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2};
+    vkGetDeviceBufferMemoryRequirements(m_device, &requirementsInfo, &requirements);
+
+    const auto memoryTypeIndex = findMemoryType(requirements.memoryRequirements.memoryTypeBits, required, avoided);
+    if (!memoryTypeIndex.has_value())
+      return std::nullopt;
+    return m_memoryProperties.memoryTypes[memoryTypeIndex.value()].heapIndex;
+  }
+
+  // Returns std::nullopt when no memory type matches or the allocation fails, so callers can make room and retry.
+  std::optional<BufferAllocation> createBuffer(VkDeviceSize size, VkBufferUsageFlags usage,
+                                               VkMemoryPropertyFlags required, VkMemoryPropertyFlags avoided,
+                                               float priority) {
+    const VkBufferCreateInfo bufferInfo{.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+                                        .size = size,
+                                        .usage = usage,
+                                        .sharingMode = VK_SHARING_MODE_EXCLUSIVE};
+    BufferAllocation allocation{.size = size};
+    VK_CALL(vkCreateBuffer(m_device, &bufferInfo, nullptr, &allocation.buffer));
+
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements(m_device, allocation.buffer, &requirements);
+
+    const auto memoryTypeIndex = findMemoryType(requirements.memoryTypeBits, required, avoided);
+    if (!memoryTypeIndex.has_value()) {
+      vkDestroyBuffer(m_device, allocation.buffer, nullptr);
+      return std::nullopt;
+    }
+
+    const VkMemoryPriorityAllocateInfoEXT priorityInfo{.sType = VK_STRUCTURE_TYPE_MEMORY_PRIORITY_ALLOCATE_INFO_EXT,
+                                                       .priority = priority};
+    const VkMemoryAllocateInfo allocateInfo{.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+                                            .pNext = m_memoryPriority ? &priorityInfo : nullptr,
+                                            .allocationSize = requirements.size,
+                                            .memoryTypeIndex = memoryTypeIndex.value()};
+    if (vkAllocateMemory(m_device, &allocateInfo, nullptr, &allocation.memory) != VK_SUCCESS) {
+      vkDestroyBuffer(m_device, allocation.buffer, nullptr);
+      return std::nullopt;
+    }
+    VK_CALL(vkBindBufferMemory(m_device, allocation.buffer, allocation.memory, 0));
+
+    allocation.memoryTypeIndex = memoryTypeIndex.value();
+    allocation.heapIndex = m_memoryProperties.memoryTypes[allocation.memoryTypeIndex].heapIndex;
+    return allocation;
+  }
+
+  void destroyBuffer(BufferAllocation& allocation) {
+    vkDestroyBuffer(m_device, allocation.buffer, nullptr);
+    vkFreeMemory(m_device, allocation.memory, nullptr);
+    allocation = BufferAllocation{};
+  }
+
+  template <typename Recorder>
+  void immediateSubmit(Recorder&& record) {
+    VK_CALL(vkResetCommandBuffer(m_commandBuffer, 0));
+
+    const VkCommandBufferBeginInfo beginInfo{.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+                                             .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT};
+    VK_CALL(vkBeginCommandBuffer(m_commandBuffer, &beginInfo));
+    record(m_commandBuffer);
+    VK_CALL(vkEndCommandBuffer(m_commandBuffer));
+
+    const VkSubmitInfo submitInfo{.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+                                  .commandBufferCount = 1,
+                                  .pCommandBuffers = &m_commandBuffer};
+    VK_CALL(vkQueueSubmit(m_queue, 1, &submitInfo, m_fence));
+    VK_CALL(vkWaitForFences(m_device, 1, &m_fence, VK_TRUE, UINT64_MAX));
+    VK_CALL(vkResetFences(m_device, 1, &m_fence));
+  }
+
+  void copyBuffer(VkBuffer source, VkBuffer destination, VkDeviceSize size) {
+    immediateSubmit([&](VkCommandBuffer commandBuffer) {
+      const VkBufferCopy region{.size = size};
+      vkCmdCopyBuffer(commandBuffer, source, destination, 1, &region);
+    });
+  }
+
+  std::vector<std::byte> download(const BufferAllocation& allocation) {
+    std::vector<std::byte> contents(allocation.size);
+    if (isHostVisible(allocation.memoryTypeIndex)) {
+      readMapped(allocation, contents);
+      return contents;
+    }
+
+    auto staging = createBuffer(allocation.size, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 0, 0.0f);
+    if (!staging.has_value()) {
+      std::println("Unable to allocate a staging buffer of {} bytes", allocation.size);
+      std::exit(EXIT_FAILURE);
+    }
+
+    copyBuffer(allocation.buffer, staging->buffer, allocation.size);
+    readMapped(staging.value(), contents);
+    destroyBuffer(staging.value());
+    return contents;
+  }
+
+  void upload(const BufferAllocation& allocation, std::span<const std::byte> contents) {
+    if (isHostVisible(allocation.memoryTypeIndex)) {
+      writeMapped(allocation, contents);
+      return;
+    }
+
+    auto staging = createBuffer(allocation.size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 0, 0.0f);
+    if (!staging.has_value()) {
+      std::println("Unable to allocate a staging buffer of {} bytes", allocation.size);
+      std::exit(EXIT_FAILURE);
+    }
+
+    writeMapped(staging.value(), contents);
+    copyBuffer(staging->buffer, allocation.buffer, allocation.size);
+    destroyBuffer(staging.value());
+  }
+
+private:
+  Device(const PhysicalDevice& physicalDevice, std::vector<std::string> requestedDeviceExtensions)
+      : m_physicalDevice{physicalDevice.getPhysicalDevice()},
+        m_memoryProperties{physicalDevice.getMemoryProperties()} {
+    // clang-format off
+    m_enabledExtensions = requestedDeviceExtensions
+      | views::filter([&physicalDevice](const std::string& name) {
+          return physicalDevice.isExtensionSupported(name);
+        })
+      | ranges::to<std::vector<std::string>>();
+    // clang-format on
+
+    if (const auto family = physicalDevice.findQueueFamily(VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))
+      m_queueFamilyIndex = family.value();
+  }
+
+  bool init() {
+    VkPhysicalDeviceMemoryPriorityFeaturesEXT memoryPriorityFeatures{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PRIORITY_FEATURES_EXT};
+    if (isExtensionEnabled(VK_EXT_MEMORY_PRIORITY_EXTENSION_NAME)) {
+      VkPhysicalDeviceFeatures2 features{.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+                                         .pNext = &memoryPriorityFeatures};
+      vkGetPhysicalDeviceFeatures2(m_physicalDevice, &features);
+      m_memoryPriority = memoryPriorityFeatures.memoryPriority == VK_TRUE;
+    }
+
+    auto extensions = m_enabledExtensions | views::transform(std::mem_fn(&std::string::c_str)) |
+                      ranges::to<std::vector<const char*>>();
+
+    const float queuePriority = 1.0f;
+    const VkDeviceQueueCreateInfo queueInfo{.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
+                                            .queueFamilyIndex = m_queueFamilyIndex,
+                                            .queueCount = 1,
+                                            .pQueuePriorities = &queuePriority};
+
+    const VkDeviceCreateInfo deviceInfo{.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
+                                        .pNext = m_memoryPriority ? &memoryPriorityFeatures : nullptr,
+                                        .queueCreateInfoCount = 1,
+                                        .pQueueCreateInfos = &queueInfo,
+                                        .enabledExtensionCount = static_cast<uint32_t>(extensions.size()),
+                                        .ppEnabledExtensionNames = extensions.data()};
+
+    if (vkCreateDevice(m_physicalDevice, &deviceInfo, nullptr, &m_device) != VK_SUCCESS)
+      return false;
+
+    vkGetDeviceQueue(m_device, m_queueFamilyIndex, 0, &m_queue);
+
+    const VkCommandPoolCreateInfo poolInfo{.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+                                           .flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+                                           .queueFamilyIndex = m_queueFamilyIndex};
+    VK_CALL(vkCreateCommandPool(m_device, &poolInfo, nullptr, &m_commandPool));
+
+    const VkCommandBufferAllocateInfo commandBufferInfo{.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+                                                        .commandPool = m_commandPool,
+                                                        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+                                                        .commandBufferCount = 1};
+    VK_CALL(vkAllocateCommandBuffers(m_device, &commandBufferInfo, &m_commandBuffer));
+
+    const VkFenceCreateInfo fenceInfo{.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
+    VK_CALL(vkCreateFence(m_device, &fenceInfo, nullptr, &m_fence));
+
+    return true;
+  }
+
+  void readMapped(const BufferAllocation& allocation, std::span<std::byte> contents) {
+    void* data = nullptr;
+    VK_CALL(vkMapMemory(m_device, allocation.memory, 0, VK_WHOLE_SIZE, 0, &data));
+    std::memcpy(contents.data(), data, contents.size());
+    vkUnmapMemory(m_device, allocation.memory);
+  }
+
+  void writeMapped(const BufferAllocation& allocation, std::span<const std::byte> contents) {
+    void* data = nullptr;
+    VK_CALL(vkMapMemory(m_device, allocation.memory, 0, VK_WHOLE_SIZE, 0, &data));
+    std::memcpy(data, contents.data(), contents.size());
+    vkUnmapMemory(m_device, allocation.memory);
+  }
+
+  void swap(Device& rhs) {
+    std::swap(m_physicalDevice, rhs.m_physicalDevice);
+    std::swap(m_memoryProperties, rhs.m_memoryProperties);
+    std::swap(m_enabledExtensions, rhs.m_enabledExtensions);
+    std::swap(m_queueFamilyIndex, rhs.m_queueFamilyIndex);
+    std::swap(m_memoryPriority, rhs.m_memoryPriority);
+    std::swap(m_device, rhs.m_device);
+    std::swap(m_queue, rhs.m_queue);
+    std::swap(m_commandPool, rhs.m_commandPool);
+    std::swap(m_commandBuffer, rhs.m_commandBuffer);
+    std::swap(m_fence, rhs.m_fence);
+  }
+
+private:
+  VkPhysicalDevice m_physicalDevice = VK_NULL_HANDLE;
+  VkPhysicalDeviceMemoryProperties m_memoryProperties{};
+  std::vector<std::string> m_enabledExtensions;
+  uint32_t m_queueFamilyIndex = 0;
+  bool m_memoryPriority = false;
+  VkDevice m_device = VK_NULL_HANDLE;
+  VkQueue m_queue = VK_NULL_HANDLE;
+  VkCommandPool m_commandPool = VK_NULL_HANDLE;
+  VkCommandBuffer m_commandBuffer = VK_NULL_HANDLE;
+  VkFence m_fence = VK_NULL_HANDLE;
+};
+
+enum class UsageClass { RenderTarget, Geometry, Texture, Streaming };
+
+// Priorities handed to VK_EXT_memory_priority: the driver pages out the lowest priorities first when we still end up
+// over budget, so render targets that are touched every frame stay resident the longest.
+constexpr float memoryPriority(UsageClass usageClass) {
+  switch (usageClass) {
+  case UsageClass::RenderTarget:
+    return 1.0f;
+  case UsageClass::Geometry:
+    return 0.75f;
+  case UsageClass::Texture:
+    return 0.5f;
+  case UsageClass::Streaming:
+    return 0.25f;
+  }
+  return 0.5f;
+}
+
+enum class Residency { DeviceLocal, HostVisible, Evicted };
+
+using ResourceId = uint32_t;
+
+struct ResidencyStatistics {
+  uint64_t demotions = 0;
+  uint64_t evictions = 0;
+  uint64_t promotions = 0;
+  uint64_t restores = 0;
+  uint64_t framesOverBudget = 0;
+  VkDeviceSize peakDeviceLocalUsage = 0;
+};
+
+// Keeps the device local heaps under their budget: every frame the budget is queried again, the least recently used
+// resources are demoted to host visible memory (or evicted to a CPU copy when there is no separate host heap) until
+// the usage is back under the high watermark, and recently used resources are promoted back when there is room.
+class ResidencyManager {
+public:
+  static constexpr double kHighWatermark = 0.9;
+  static constexpr double kLowWatermark = 0.75;
+  static constexpr uint64_t kPromotionWindow = 2;
+  static constexpr VkBufferUsageFlags kBufferUsage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT |
+                                                     VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+                                                     VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+
+  ResidencyManager(const PhysicalDevice& physicalDevice, Device& device, VkDeviceSize fakeBudget = 0)
+      : m_physicalDevice{physicalDevice}, m_device{device}, m_fakeBudget{fakeBudget} {
+    m_heaps = m_physicalDevice.queryMemoryBudget();
+    m_heapUsage.resize(m_heaps.size(), 0);
+    m_trackedUsage.resize(m_heaps.size(), 0);
+    refreshBudget();
+  }
+
+  ResidencyManager(const ResidencyManager&) = delete;
+  ResidencyManager& operator=(const ResidencyManager&) = delete;
+
+  ~ResidencyManager() {
+    for (auto& resource : m_resources) {
+      if (resource.residency != Residency::Evicted)
+        m_device.destroyBuffer(resource.allocation);
+    }
+  }
+
+  ResourceId createBuffer(VkDeviceSize size, UsageClass usageClass, std::span<const std::byte> contents = {}) {
+    const auto id = static_cast<ResourceId>(m_resources.size());
+    m_resources.push_back(Resource{.size = size, .usageClass = usageClass, .lastUsedFrame = m_frame});
+
+    // The contents go wherever makeResident finds room, and stay on the CPU when no heap has any.
+    auto& resource = m_resources[id];
+    resource.backup.assign(std::begin(contents), std::end(contents));
+    if (!makeResident(id) && resource.backup.empty())
+      resource.backup.resize(size);
+    return id;
+  }
+
+  // Marks the resource as used by the current frame, evicted resources are brought back right away.
+  VkBuffer use(ResourceId id) {
+    auto& resource = m_resources[id];
+    resource.lastUsedFrame = m_frame;
+    if (resource.residency == Residency::Evicted) {
+      if (!makeResident(id))
+        forceDeviceLocal(id);
+      ++m_statistics.restores;
+    }
+    return resource.allocation.buffer;
+  }
+
+  void beginFrame() {
+    ++m_frame;
+    refreshBudget();
+
+    for (uint32_t heapIndex = 0; heapIndex < m_heaps.size(); ++heapIndex) {
+      if (!m_heaps[heapIndex].isDeviceLocal)
+        continue;
+
+      makeRoom(heapIndex, 0);
+      promoteRecentlyUsed(heapIndex);
+      recordUsage(heapIndex);
+    }
+  }
+
+  [[nodiscard]] std::vector<std::byte> read(ResourceId id) {
+    auto& resource = m_resources[id];
+    if (resource.residency == Residency::Evicted)
+      return resource.backup;
+    return m_device.download(resource.allocation);
+  }
+
+  [[nodiscard]] Residency residency(ResourceId id) const { return m_resources[id].residency; }
+
+  [[nodiscard]] const ResidencyStatistics& statistics() const noexcept { return m_statistics; }
+
+  [[nodiscard]] const std::vector<HeapBudget>& heaps() const noexcept { return m_heaps; }
+
+  [[nodiscard]] VkDeviceSize heapUsage(uint32_t heapIndex) const { return m_heapUsage[heapIndex]; }
+
+private:
+  struct Resource {
+    VkDeviceSize size = 0;
+    UsageClass usageClass = UsageClass::Texture;
+    uint64_t lastUsedFrame = 0;
+    Residency residency = Residency::Evicted;
+    BufferAllocation allocation;
+    std::vector<std::byte> backup;
+  };
+
+  void refreshBudget() {
+    m_heaps = m_physicalDevice.queryMemoryBudget();
+    for (uint32_t heapIndex = 0; heapIndex < m_heaps.size(); ++heapIndex) {
+      auto& heap = m_heaps[heapIndex];
+      if (m_fakeBudget != 0 && heap.isDeviceLocal) {
+        heap.budget = std::min(heap.budget, m_fakeBudget);
+        m_heapUsage[heapIndex] = m_trackedUsage[heapIndex];
+      } else {
+        m_heapUsage[heapIndex] = std::max(heap.usage, m_trackedUsage[heapIndex]);
+      }
+    }
+  }
+
+  void track(const BufferAllocation& allocation, bool allocated) {
+    const auto delta = allocation.size;
+    auto& tracked = m_trackedUsage[allocation.heapIndex];
+    auto& usage = m_heapUsage[allocation.heapIndex];
+    tracked = allocated ? tracked + delta : tracked - delta;
+    usage = allocated ? usage + delta : usage - std::min(usage, delta);
+    if (allocated)
+      recordUsage(allocation.heapIndex);
+  }
+
+  // Sampled on every allocation as well as every frame, so a spike in between still shows up in the statistics.
+  void recordUsage(uint32_t heapIndex) {
+    if (!m_heaps[heapIndex].isDeviceLocal)
+      return;
+
+    m_statistics.peakDeviceLocalUsage = std::max(m_statistics.peakDeviceLocalUsage, m_heapUsage[heapIndex]);
+    if (m_heapUsage[heapIndex] > m_heaps[heapIndex].budget && m_lastFrameOverBudget != m_frame) {
+      ++m_statistics.framesOverBudget;
+      m_lastFrameOverBudget = m_frame;
+    }
+  }
+
+  // Demotes from the LRU end until size more bytes fit under the high watermark, false when not enough can move.
+  bool makeRoom(uint32_t heapIndex, VkDeviceSize size) {
+    const auto highWatermark = static_cast<VkDeviceSize>(m_heaps[heapIndex].budget * kHighWatermark);
+    if (size > highWatermark)
+      return false;
+
+    while (m_heapUsage[heapIndex] + size > highWatermark) {
+      const auto victim = leastRecentlyUsed(heapIndex);
+      if (!victim.has_value())
+        return false;
+      demote(victim.value());
+    }
+    return true;
+  }
+
+  [[nodiscard]] std::optional<ResourceId> leastRecentlyUsed(uint32_t heapIndex) const {
+    std::optional<ResourceId> victim;
+    for (ResourceId id = 0; id < m_resources.size(); ++id) {
+      const auto& resource = m_resources[id];
+      if (resource.residency != Residency::DeviceLocal || resource.allocation.heapIndex != heapIndex)
+        continue;
+      // Anything the current frame already touched has to stay where it is.
+      if (resource.lastUsedFrame >= m_frame)
+        continue;
+
+      if (!victim.has_value()) {
+        victim = id;
+        continue;
+      }
+
+      const auto& current = m_resources[victim.value()];
+      if (resource.lastUsedFrame < current.lastUsedFrame ||
+          (resource.lastUsedFrame == current.lastUsedFrame &&
+           memoryPriority(resource.usageClass) < memoryPriority(current.usageClass)))
+        victim = id;
+    }
+    return victim;
+  }
+
+  void promoteRecentlyUsed(uint32_t heapIndex) {
+    const auto lowWatermark = static_cast<VkDeviceSize>(m_heaps[heapIndex].budget * kLowWatermark);
+
+    // clang-format off
+    auto candidates = views::iota(ResourceId{0}, static_cast<ResourceId>(m_resources.size()))
+      | views::filter([this](ResourceId id) {
+          const auto& resource = m_resources[id];
+          return resource.residency == Residency::HostVisible && resource.lastUsedFrame + kPromotionWindow >= m_frame;
+        })
+      | ranges::to<std::vector<ResourceId>>();
+    // clang-format on
+    ranges::sort(candidates, ranges::greater{}, [this](ResourceId id) { return m_resources[id].lastUsedFrame; });
+
+    for (const auto id : candidates) {
+      if (m_heapUsage[heapIndex] + m_resources[id].size > lowWatermark)
+        break;
+
+      auto& resource = m_resources[id];
+      auto allocation = allocateDeviceLocal(resource);
+      if (!allocation.has_value() || allocation->heapIndex != heapIndex) {
+        if (allocation.has_value())
+          m_device.destroyBuffer(allocation.value());
+        continue;
+      }
+
+      m_device.copyBuffer(resource.allocation.buffer, allocation->buffer, resource.size);
+      track(resource.allocation, false);
+      m_device.destroyBuffer(resource.allocation);
+      resource.allocation = allocation.value();
+      resource.residency = Residency::DeviceLocal;
+      track(resource.allocation, true);
+      ++m_statistics.promotions;
+    }
+  }
+
+  // Demotion needs a host visible memory type living on another heap, otherwise moving the buffer would not release
+  // anything from the heap that is over budget and the contents are parked on the CPU instead.
+  void demote(ResourceId id) {
+    auto& resource = m_resources[id];
+    const auto fromHeap = resource.allocation.heapIndex;
+
+    auto hostAllocation = allocateHostVisible(resource);
+    if (hostAllocation.has_value() && hostAllocation->heapIndex != fromHeap) {
+      m_device.copyBuffer(resource.allocation.buffer, hostAllocation->buffer, resource.size);
+      track(resource.allocation, false);
+      m_device.destroyBuffer(resource.allocation);
+      resource.allocation = hostAllocation.value();
+      resource.residency = Residency::HostVisible;
+      track(resource.allocation, true);
+      ++m_statistics.demotions;
+      return;
+    }
+
+    if (hostAllocation.has_value())
+      m_device.destroyBuffer(hostAllocation.value());
+
+    resource.backup = m_device.download(resource.allocation);
+    track(resource.allocation, false);
+    m_device.destroyBuffer(resource.allocation);
+    resource.residency = Residency::Evicted;
+    ++m_statistics.evictions;
+  }
+
+  std::optional<BufferAllocation> allocateDeviceLocal(const Resource& resource) {
+    return m_device.createBuffer(resource.size, kBufferUsage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0,
+                                 memoryPriority(resource.usageClass));
+  }
+
+  std::optional<BufferAllocation> allocateHostVisible(const Resource& resource) {
+    return m_device.createBuffer(resource.size, kBufferUsage, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+                                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, memoryPriority(resource.usageClass));
+  }
+
+  [[nodiscard]] std::optional<uint32_t> deviceLocalHeap(const Resource& resource) const {
+    return m_device.findHeap(resource.size, kBufferUsage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0);
+  }
+
+  // Places the resource on the device local heap it belongs to when it fits under the high watermark there, after
+  // making room from the LRU end, or in host visible memory on another heap. False when neither has room.
+  bool makeResident(ResourceId id) {
+    auto& resource = m_resources[id];
+    const auto heapIndex = deviceLocalHeap(resource);
+    if (heapIndex.has_value() && makeRoom(heapIndex.value(), resource.size)) {
+      auto allocation = allocateDeviceLocal(resource);
+      if (allocation.has_value()) {
+        place(id, allocation.value(), Residency::DeviceLocal);
+        return true;
+      }
+    }
+
+    auto hostAllocation = allocateHostVisible(resource);
+    if (hostAllocation.has_value() && hostAllocation->heapIndex != heapIndex) {
+      place(id, hostAllocation.value(), Residency::HostVisible);
+      return true;
+    }
+
+    if (hostAllocation.has_value())
+      m_device.destroyBuffer(hostAllocation.value());
+    return false;
+  }
+
+  // The current frame needs the resource and nothing else can move: go over the budget, which the statistics record,
+  // and only give up when the allocation itself keeps failing with nothing left to demote.
+  void forceDeviceLocal(ResourceId id) {
+    auto& resource = m_resources[id];
+    const auto heapIndex = deviceLocalHeap(resource);
+    auto allocation = allocateDeviceLocal(resource);
+    while (!allocation.has_value()) {
+      const auto victim = heapIndex.has_value() ? leastRecentlyUsed(heapIndex.value()) : std::nullopt;
+      if (!victim.has_value()) {
+        std::println("Unable to make room for a buffer of {} bytes", resource.size);
+        std::exit(EXIT_FAILURE);
+      }
+      demote(victim.value());
+      allocation = allocateDeviceLocal(resource);
+    }
+    place(id, allocation.value(), Residency::DeviceLocal);
+  }
+
+  void place(ResourceId id, const BufferAllocation& allocation, Residency residency) {
+    auto& resource = m_resources[id];
+    resource.allocation = allocation;
+    resource.residency = residency;
+    track(resource.allocation, true);
+
+    if (!resource.backup.empty()) {
+      m_device.upload(resource.allocation, resource.backup);
+      resource.backup = {};
+    }
+  }
+
+private:
+  const PhysicalDevice& m_physicalDevice;
+  Device& m_device;
+  VkDeviceSize m_fakeBudget;
+  uint64_t m_frame = 0;
+  std::optional<uint64_t> m_lastFrameOverBudget;
+  std::vector<HeapBudget> m_heaps;
+  std::vector<VkDeviceSize> m_heapUsage;
+  std::vector<VkDeviceSize> m_trackedUsage;
+  std::vector<Resource> m_resources;
+  ResidencyStatistics m_statistics;
+};
+
+class Context {
+public:
+  static std::expected<Context, std::string> create(std::string_view applicationName,
+                                                    std::vector<std::string> requestedInstanceLayer,
+                                                    std::vector<std::string> requestedInstanceExtensions) {
+
+    Context context{applicationName, std::move(requestedInstanceLayer), std::move(requestedInstanceExtensions)};
+
+    if (context.init())
+      return context;
+    else
+      return std::unexpected(std::string{"Failed to init the vulkan context"});
+  }
+
+  ~Context() {
+    if (m_vulkanInstance == VK_NULL_HANDLE)
+      return;
+
+    vkDestroyInstance(m_vulkanInstance, nullptr);
+    m_vulkanInstance = VK_NULL_HANDLE;
+  }
+
+  Context& operator=(const Context&) = delete;
+
+  Context(const Context&) = delete;
+
+  Context(Context&& rhs) noexcept {
+    swap(rhs);
+    rhs.m_vulkanInstance = VK_NULL_HANDLE;
+  }
+
+  Context& operator=(Context&& rhs) noexcept {
+    Context tmp{std::move(rhs)};
+    swap(tmp);
+    return *this;
+  }
+
+  std::vector<PhysicalDevice> enumeratePhysicalDevices() {
+    // clang-format off
+    auto result = VulkanCore::enumeratePhysicalDevices(m_vulkanInstance)
+      | views::transform([](VkPhysicalDevice device) -> PhysicalDevice {
+         return PhysicalDevice{device};
+        })
+      | ranges::to<std::vector<PhysicalDevice>>();
+    // clang-format on
+    return result;
+  }
+
+private:
+  Context(std::string_view applicationName, std::vector<std::string> requestedInstanceLayer,
+          std::vector<std::string> requestedInstanceExtensions)
+      : m_applicationName{applicationName} {
+    auto allInstanceLayers = enumerateInstanceLayerProperties();
+    const auto isInstanceLayerRequired = [&requestedInstanceLayer](const VkLayerProperties& prop) {
+      auto name = std::string{prop.layerName};
+      return ranges::find(requestedInstanceLayer, name) != std::end(requestedInstanceLayer);
+    };
+    // clang-format off
+    m_layerProperties = allInstanceLayers
+      | views::filter(isInstanceLayerRequired)
+      | ranges::to<std::vector<VkLayerProperties>>();
+    // clang-format on
+
+    auto allExtensions = enumerateExtensionsProperties();
+    const auto isExtensionRequired = [&requestedInstanceExtensions](const VkExtensionProperties& prop) {
+      auto name = std::string{prop.extensionName};
+      return ranges::find(requestedInstanceExtensions, name) != std::end(requestedInstanceExtensions);
+    };
+    // clang-format off
+    m_layerExtensions = allExtensions
+      | views::filter(isExtensionRequired)
+      | ranges::to<std::vector<VkExtensionProperties>>();
+    // clang-format on
+  }
+
+  bool init() {
+    // clang-format off
+    auto layers = m_layerProperties
+      | views::transform([](const VkLayerProperties& prop) -> const char*
+        {
+          return prop.layerName;
+        })
+      | ranges::to<std::vector<const char*>>();
+
+      auto extensions = m_layerExtensions
+        | views::transform([](const VkExtensionProperties & prop) -> const char*
+          {
+            return prop.extensionName;
+          })
+        | ranges::to<std::vector<const char*>>();
+    // clang-format on
+
+    const VkApplicationInfo applicationInfo{.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO,
+                                            .pApplicationName = m_applicationName.data(),
+                                            .applicationVersion = VK_MAKE_VERSION(1, 0, 0),
+                                            .apiVersion = VK_API_VERSION_1_3};
+
+    const VkInstanceCreateInfo instanceCreateInfo{.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO,
+#if defined(VK_USE_PLATFORM_METAL_EXT)
+                                                  .flags = VK_INSTANCE_CREATE_ENUMERATE_PORTABILITY_BIT_KHR,
+#endif
+                                                  .pApplicationInfo = &applicationInfo,
+                                                  .enabledLayerCount = static_cast<uint32_t>(layers.size()),
+                                                  .ppEnabledLayerNames = layers.data(),
+                                                  .enabledExtensionCount = static_cast<uint32_t>(extensions.size()),
+                                                  .ppEnabledExtensionNames = extensions.data()};
+
+    const auto res = vkCreateInstance(&instanceCreateInfo, nullptr, &m_vulkanInstance);
+    return res == VK_SUCCESS;
+  }
+
+  void swap(Context& rhs) {
+    std::swap(m_applicationName, rhs.m_applicationName);
+    std::swap(m_layerProperties, rhs.m_layerProperties);
+    std::swap(m_layerExtensions, rhs.m_layerExtensions);
+    std::swap(m_vulkanInstance, rhs.m_vulkanInstance);
+  }
+
+private:
+  std::string m_applicationName;
+  std::vector<VkLayerProperties> m_layerProperties;
+  std::vector<VkExtensionProperties> m_layerExtensions;
+  VkInstance m_vulkanInstance = VK_NULL_HANDLE;
+};
+} // namespace VulkanCore
+
+struct StressOptions {
+  // Defaults to half of what the resources take, "--fake-budget-mb 0" runs against the real budget instead.
+  std::optional<VkDeviceSize> fakeBudget;
+  uint32_t frames = 600;
+  uint32_t resources = 64;
+  VkDeviceSize resourceSize = 4 * 1024 * 1024;
+  uint32_t workingSet = 8;
+};
+
+StressOptions parseOptions(std::span<char*> arguments) {
+  const auto toNumber = [](std::string_view text) {
+    uint64_t value = 0;
+    std::from_chars(text.data(), text.data() + text.size(), value);
+    return value;
+  };
+
+  StressOptions options;
+  for (size_t index = 1; index + 1 < arguments.size(); index += 2) {
+    const std::string_view name{arguments[index]};
+    const auto value = toNumber(arguments[index + 1]);
+    if (name == "--fake-budget-mb")
+      options.fakeBudget = value * 1024 * 1024;
+    else if (name == "--frames")
+      options.frames = static_cast<uint32_t>(value);
+    else if (name == "--resources")
+      options.resources = static_cast<uint32_t>(value);
+    else if (name == "--resource-size-mb")
+      options.resourceSize = value * 1024 * 1024;
+    else if (name == "--working-set")
+      options.workingSet = static_cast<uint32_t>(value);
+  }
+  if (!options.fakeBudget.has_value())
+    options.fakeBudget = options.resources * options.resourceSize / 2;
+  return options;
+}
+
+std::vector<std::byte> makePattern(VulkanCore::ResourceId id, VkDeviceSize size) {
+  std::vector<std::byte> contents(size);
+  for (VkDeviceSize offset = 0; offset + sizeof(uint32_t) <= size; offset += sizeof(uint32_t)) {
+    const auto value = static_cast<uint32_t>(id * 0x9E3779B1u + offset);
+    std::memcpy(contents.data() + offset, &value, sizeof(value));
+  }
+  return contents;
+}
+
+// By default the heap is faked down to half of what the resources need, so even lavapipe with its huge heap is
+// oversubscribed: the manager has to keep the usage under the faked budget, actually move resources out of the way
+// and the contents have to survive the trips.
+int main(int argc, char* argv[]) {
+  const std::string applicationName = "01-06 Memory budget";
+  const auto options = parseOptions(std::span{argv, static_cast<size_t>(argc)});
+  if (options.resources == 0) {
+    std::println("--resources needs at least one resource");
+    return EXIT_FAILURE;
+  }
+
+  auto vulkanContext =
+      VulkanCore::Context::create(applicationName, getRequestedInstanceLayers(), getRequestedInstanceExtensions());
+
+  if (!vulkanContext) {
+    std::println("Unable to create the context: {}", vulkanContext.error());
+    return EXIT_FAILURE;
+  }
+
+  auto physicalDevices = vulkanContext.value().enumeratePhysicalDevices();
+  if (physicalDevices.empty()) {
+    std::println("No physical devices found");
+    return EXIT_FAILURE;
+  }
+
+  const auto& physicalDevice = physicalDevices.front();
+  std::println("Using {}, VK_EXT_memory_budget {}, VK_EXT_memory_priority {}",
+               physicalDevice.getProperties().deviceName,
+               physicalDevice.isExtensionSupported(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME),
+               physicalDevice.isExtensionSupported(VK_EXT_MEMORY_PRIORITY_EXTENSION_NAME));
+
+  auto device = VulkanCore::Device::create(physicalDevice, getRequestedDeviceExtensions());
+  if (!device) {
+    std::println("Unable to create the device: {}", device.error());
+    return EXIT_FAILURE;
+  }
+
+  VulkanCore::ResidencyManager residency{physicalDevice, device.value(), options.fakeBudget.value()};
+
+  std::vector<VulkanCore::ResourceId> resources;
+  for (uint32_t index = 0; index < options.resources; ++index) {
+    const auto usageClass = static_cast<VulkanCore::UsageClass>(index % 4);
+    const auto id = static_cast<VulkanCore::ResourceId>(index);
+    resources.push_back(
+        residency.createBuffer(options.resourceSize, usageClass, makePattern(id, options.resourceSize)));
+  }
+
+  // The working set slides through the resources, with an occasional random access to something long cold.
+  std::mt19937 random{42};
+  std::uniform_int_distribution<uint32_t> anyResource{0, options.resources - 1};
+  for (uint32_t frame = 0; frame < options.frames; ++frame) {
+    residency.beginFrame();
+
+    const auto windowStart = (frame / 16) * 3;
+    for (uint32_t offset = 0; offset < options.workingSet; ++offset)
+      residency.use(resources[(windowStart + offset) % options.resources]);
+    if (frame % 8 == 0)
+      residency.use(resources[anyResource(random)]);
+
+    if (frame % 100 == 0) {
+      for (const auto [heapIndex, heap] : views::enumerate(residency.heaps())) {
+        if (heap.isDeviceLocal)
+          std::println("frame {:4} heap {}: usage {:6} MB budget {:6} MB", frame, heapIndex,
+                       residency.heapUsage(static_cast<uint32_t>(heapIndex)) >> 20, heap.budget >> 20);
+      }
+    }
+  }
+
+  uint32_t corrupted = 0;
+  for (const auto id : resources) {
+    if (residency.read(id) != makePattern(id, options.resourceSize))
+      ++corrupted;
+  }
+
+  const auto& statistics = residency.statistics();
+  std::println("demotions {} evictions {} promotions {} restores {}", statistics.demotions, statistics.evictions,
+               statistics.promotions, statistics.restores);
+  std::println("peak device local usage {} MB, {} frames over budget, {} corrupted resources",
+               statistics.peakDeviceLocalUsage >> 20, statistics.framesOverBudget, corrupted);
+
+  // A faked budget the run never had to evict for would not have tested anything.
+  const auto evicted = options.fakeBudget.value() == 0 || statistics.demotions + statistics.evictions > 0;
+  if (!evicted)
+    std::println("Nothing was demoted or evicted under a budget of {} MB", options.fakeBudget.value() >> 20);
+
+  return corrupted == 0 && statistics.framesOverBudget == 0 && evicted ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,1040 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <expected>
+#include <format>
+#include <functional>
+#include <future>
+#include <iterator>
+#include <mutex>
+#include <optional>
+#include <print>
+#include <ranges>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#if !defined(_WIN32)
+#include <unistd.h>
+#endif
+
+namespace ranges = std::ranges;
+namespace views = std::ranges::views;
+
+#define VK_CALL(vFun)                                                                                                  \
+  {                                                                                                                    \
+    const auto res = vFun;                                                                                             \
+    if (res != VK_SUCCESS) {                                                                                           \
+      std::println(#vFun " failed with error {}", static_cast<int>(res));                                              \
+      std::exit(res);                                                                                                  \
+    }                                                                                                                  \
+  }
+
+auto getRequestedInstanceLayers() -> std::vector<std::string> {
+  return std::vector<std::string>{"VK_LAYER_KHRONOS_validation"};
+}
+
+auto getRequestedInstanceExtensions() -> std::vector<std::string> {
+  return std::vector<std::string>{
+#if defined(VK_USE_PLATFORM_METAL_EXT)
+      VK_KHR_PORTABILITY_ENUMERATION_EXTENSION_NAME,
+#endif
+#if defined(VK_EXT_debug_utils)
+      VK_EXT_DEBUG_UTILS_EXTENSION_NAME,
+#endif
+  };
+}
+
+auto getRequestedDeviceExtensions() -> std::vector<std::string> {
+  return std::vector<std::string>{
+      VK_KHR_EXTERNAL_MEMORY_FD_EXTENSION_NAME,
+  };
+}
+
+namespace VulkanCore {
+std::vector<VkLayerProperties> enumerateInstanceLayerProperties() {
+  uint32_t layersCount{0};
+  vkEnumerateInstanceLayerProperties(&layersCount, nullptr);
+
+  std::vector<VkLayerProperties> layersProperties(layersCount);
+  vkEnumerateInstanceLayerProperties(&layersCount, layersProperties.data());
+
+  return layersProperties;
+}
+
+std::vector<VkExtensionProperties> enumerateExtensionsProperties() {
+  uint32_t extensionsCount{0};
+  vkEnumerateInstanceExtensionProperties(nullptr, &extensionsCount, nullptr);
+
+  std::vector<VkExtensionProperties> extensionsProperties(extensionsCount);
+  vkEnumerateInstanceExtensionProperties(nullptr, &extensionsCount, extensionsProperties.data());
+
+  return extensionsProperties;
+}
+
+std::vector<VkExtensionProperties> enumerateDeviceExtensionsProperties(VkPhysicalDevice device) {
+  uint32_t extensionsCount{0};
+  vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionsCount, nullptr);
+
+  std::vector<VkExtensionProperties> extensionsProperties(extensionsCount);
+  vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionsCount, extensionsProperties.data());
+
+  return extensionsProperties;
+}
+
+std::vector<VkPhysicalDevice> enumeratePhysicalDevices(VkInstance instance) {
+  uint32_t physicalDevicesCount{0};
+  vkEnumeratePhysicalDevices(instance, &physicalDevicesCount, nullptr);
+
+  std::vector<VkPhysicalDevice> physicalDevices(physicalDevicesCount);
+  vkEnumeratePhysicalDevices(instance, &physicalDevicesCount, physicalDevices.data());
+
+  return physicalDevices;
+}
+
+std::vector<VkQueueFamilyProperties> enumeratePhysicalDevicesQueueFamilyProperties(VkPhysicalDevice device) {
+  uint32_t physicalDeviceQueueFamilyPropertiesCount{0};
+  vkGetPhysicalDeviceQueueFamilyProperties(device, &physicalDeviceQueueFamilyPropertiesCount, nullptr);
+
+  std::vector<VkQueueFamilyProperties> queueFamiliesProperties(physicalDeviceQueueFamilyPropertiesCount);
+  vkGetPhysicalDeviceQueueFamilyProperties(device, &physicalDeviceQueueFamilyPropertiesCount,
+                                           queueFamiliesProperties.data());
+
+  return queueFamiliesProperties;
+}
+
+class PhysicalDevice {
+public:
+  explicit PhysicalDevice(VkPhysicalDevice device)
+      : m_device{device}, m_extensions{enumerateDeviceExtensionsProperties(device)},
+        m_queueFamilies{enumeratePhysicalDevicesQueueFamilyProperties(device)} {
+    vkGetPhysicalDeviceProperties(m_device, &m_properties);
+    vkGetPhysicalDeviceMemoryProperties(m_device, &m_memoryProperties);
+  }
+
+  [[nodiscard]] inline VkPhysicalDevice getPhysicalDevice() const noexcept { return m_device; }
+
+  [[nodiscard]] inline const VkPhysicalDeviceProperties& getProperties() const noexcept { return m_properties; }
+
+  [[nodiscard]] inline const VkPhysicalDeviceMemoryProperties& getMemoryProperties() const noexcept {
+    return m_memoryProperties;
+  }
+
+  [[nodiscard]] bool isExtensionSupported(std::string_view name) const {
+    return ranges::any_of(m_extensions,
+                          [name](const VkExtensionProperties& prop) { return name == prop.extensionName; });
+  }
+
+  [[nodiscard]] std::optional<uint32_t> findQueueFamily(VkQueueFlags flags) const {
+    const auto it = ranges::find_if(m_queueFamilies, [flags](const VkQueueFamilyProperties& family) {
+      return (family.queueFlags & flags) == flags;
+    });
+    if (it == std::end(m_queueFamilies))
+      return std::nullopt;
+
+    return static_cast<uint32_t>(std::distance(std::begin(m_queueFamilies), it));
+  }
+
+  // Memory exported by this device can only be imported by a consumer running on a device with the same UUIDs.
+  [[nodiscard]] VkPhysicalDeviceIDProperties queryIdProperties() const {
+    VkPhysicalDeviceIDProperties idProperties{.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES};
+    VkPhysicalDeviceProperties2 properties{.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+                                           .pNext = &idProperties};
+    vkGetPhysicalDeviceProperties2(m_device, &properties);
+    return idProperties;
+  }
+
+private:
+  VkPhysicalDevice m_device;
+  std::vector<VkExtensionProperties> m_extensions;
+  std::vector<VkQueueFamilyProperties> m_queueFamilies;
+  VkPhysicalDeviceProperties m_properties{};
+  VkPhysicalDeviceMemoryProperties m_memoryProperties{};
+};
+
+struct ImageAllocation {
+  VkImage image = VK_NULL_HANDLE;
+  VkDeviceMemory memory = VK_NULL_HANDLE;
+  VkExtent2D extent{};
+  VkFormat format = VK_FORMAT_UNDEFINED;
+};
+
+void imageBarrier(VkCommandBuffer commandBuffer, VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout,
+                  VkPipelineStageFlags2 srcStage, VkAccessFlags2 srcAccess, VkPipelineStageFlags2 dstStage,
+                  VkAccessFlags2 dstAccess) {
+  const VkImageMemoryBarrier2 barrier{.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+                                      .srcStageMask = srcStage,
+                                      .srcAccessMask = srcAccess,
+                                      .dstStageMask = dstStage,
+                                      .dstAccessMask = dstAccess,
+                                      .oldLayout = oldLayout,
+                                      .newLayout = newLayout,
+                                      .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                                      .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                                      .image = image,
+                                      .subresourceRange = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                                                           .levelCount = 1,
+                                                           .layerCount = 1}};
+  const VkDependencyInfo dependency{.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+                                    .imageMemoryBarrierCount = 1,
+                                    .pImageMemoryBarriers = &barrier};
+  vkCmdPipelineBarrier2(commandBuffer, &dependency);
+}
+
+void bufferBarrier(VkCommandBuffer commandBuffer, VkBuffer buffer, VkPipelineStageFlags2 srcStage,
+                   VkAccessFlags2 srcAccess, VkPipelineStageFlags2 dstStage, VkAccessFlags2 dstAccess) {
+  const VkBufferMemoryBarrier2 barrier{.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2,
+                                       .srcStageMask = srcStage,
+                                       .srcAccessMask = srcAccess,
+                                       .dstStageMask = dstStage,
+                                       .dstAccessMask = dstAccess,
+                                       .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                                       .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                                       .buffer = buffer,
+                                       .size = VK_WHOLE_SIZE};
+  const VkDependencyInfo dependency{.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+                                    .bufferMemoryBarrierCount = 1,
+                                    .pBufferMemoryBarriers = &barrier};
+  vkCmdPipelineBarrier2(commandBuffer, &dependency);
+}
+
+// Logical device with a single graphics and compute queue. Every submission signals the next value of a timeline
+// semaphore, which is the only thing the readback worker needs to know when a copy has landed.
+class Device {
+public:
+  static std::expected<Device, std::string> create(const PhysicalDevice& physicalDevice,
+                                                   std::vector<std::string> requestedDeviceExtensions) {
+    Device device{physicalDevice, std::move(requestedDeviceExtensions)};
+
+    if (device.init())
+      return device;
+    else
+      return std::unexpected(std::string{"Failed to create the vulkan device"});
+  }
+
+  ~Device() {
+    if (m_device == VK_NULL_HANDLE)
+      return;
+
+    vkDeviceWaitIdle(m_device);
+    vkDestroySemaphore(m_device, m_timeline, nullptr);
+    vkDestroyCommandPool(m_device, m_commandPool, nullptr);
+    vkDestroyDevice(m_device, nullptr);
+    m_device = VK_NULL_HANDLE;
+  }
+
+  Device& operator=(const Device&) = delete;
+
+  Device(const Device&) = delete;
+
+  Device(Device&& rhs) noexcept {
+    swap(rhs);
+    rhs.m_device = VK_NULL_HANDLE;
+  }
+
+  Device& operator=(Device&& rhs) noexcept {
+    Device tmp{std::move(rhs)};
+    swap(tmp);
+    return *this;
+  }
+
+  [[nodiscard]] inline VkDevice getDevice() const noexcept { return m_device; }
+
+  [[nodiscard]] bool isExtensionEnabled(std::string_view name) const {
+    return ranges::find(m_enabledExtensions, name) != std::end(m_enabledExtensions);
+  }
+
+  [[nodiscard]] std::optional<uint32_t> findMemoryType(uint32_t typeBits, VkMemoryPropertyFlags required) const {
+    for (uint32_t index = 0; index < m_memoryProperties.memoryTypeCount; ++index) {
+      const auto flags = m_memoryProperties.memoryTypes[index].propertyFlags;
+      if ((typeBits & (1u << index)) && (flags & required) == required)
+        return index;
+    }
+    return std::nullopt;
+  }
+
+  [[nodiscard]] VkMemoryPropertyFlags memoryTypeFlags(uint32_t memoryTypeIndex) const noexcept {
+    return m_memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags;
+  }
+
+  [[nodiscard]] PFN_vkGetMemoryFdKHR getMemoryFdFunction() const noexcept { return m_getMemoryFd; }
+
+  // The extension being enabled does not mean every buffer usage can be exported, the driver has to be asked. Handle
+  // types that need a dedicated allocation are treated as unsupported to keep the pool allocations simple.
+  [[nodiscard]] bool canExportBuffer(VkBufferUsageFlags usage) const {
+    if (m_getMemoryFd == nullptr)
+      return false;
+
+    const VkPhysicalDeviceExternalBufferInfo bufferInfo{.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTERNAL_BUFFER_INFO,
+                                                        .usage = usage,
+                                                        .handleType = VK_EXTERNAL_MEMORY_HANDLE_TYPE_OPAQUE_FD_BIT};
+    VkExternalBufferProperties properties{.sType = VK_STRUCTURE_TYPE_EXTERNAL_BUFFER_PROPERTIES};
+    vkGetPhysicalDeviceExternalBufferProperties(m_physicalDevice, &bufferInfo, &properties);
+
+    const auto features = properties.externalMemoryProperties.externalMemoryFeatures;
+    return (features & VK_EXTERNAL_MEMORY_FEATURE_EXPORTABLE_BIT) != 0 &&
+           (features & VK_EXTERNAL_MEMORY_FEATURE_DEDICATED_ONLY_BIT) == 0;
+  }
+
+  ImageAllocation createImage(VkExtent2D extent, VkFormat format, VkImageUsageFlags usage) {
+    const VkImageCreateInfo imageInfo{.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+                                      .imageType = VK_IMAGE_TYPE_2D,
+                                      .format = format,
+                                      .extent = {extent.width, extent.height, 1},
+                                      .mipLevels = 1,
+                                      .arrayLayers = 1,
+                                      .samples = VK_SAMPLE_COUNT_1_BIT,
+                                      .tiling = VK_IMAGE_TILING_OPTIMAL,
+                                      .usage = usage,
+                                      .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+                                      .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED};
+    ImageAllocation allocation{.extent = extent, .format = format};
+    VK_CALL(vkCreateImage(m_device, &imageInfo, nullptr, &allocation.image));
+
+    VkMemoryRequirements requirements;
+    vkGetImageMemoryRequirements(m_device, allocation.image, &requirements);
+
+    const auto memoryTypeIndex = findMemoryType(requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    if (!memoryTypeIndex.has_value()) {
+      std::println("No device local memory type for a {}x{} image", extent.width, extent.height);
+      std::exit(EXIT_FAILURE);
+    }
+
+    const VkMemoryAllocateInfo allocateInfo{.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+                                            .allocationSize = requirements.size,
+                                            .memoryTypeIndex = memoryTypeIndex.value()};
+    VK_CALL(vkAllocateMemory(m_device, &allocateInfo, nullptr, &allocation.memory));
+    VK_CALL(vkBindImageMemory(m_device, allocation.image, allocation.memory, 0));
+    return allocation;
+  }
+
+  void destroyImage(ImageAllocation& allocation) {
+    vkDestroyImage(m_device, allocation.image, nullptr);
+    vkFreeMemory(m_device, allocation.memory, nullptr);
+    allocation = ImageAllocation{};
+  }
+
+  VkCommandBuffer allocateCommandBuffer() {
+    const VkCommandBufferAllocateInfo commandBufferInfo{.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+                                                        .commandPool = m_commandPool,
+                                                        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+                                                        .commandBufferCount = 1};
+    VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+    VK_CALL(vkAllocateCommandBuffers(m_device, &commandBufferInfo, &commandBuffer));
+    return commandBuffer;
+  }
+
+  // Returns the timeline value that is signaled once the command buffer has completed.
+  uint64_t submit(VkCommandBuffer commandBuffer) {
+    const auto signalValue = ++m_timelineValue;
+
+    const VkCommandBufferSubmitInfo commandBufferInfo{.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO,
+                                                      .commandBuffer = commandBuffer};
+    const VkSemaphoreSubmitInfo signalInfo{.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+                                           .semaphore = m_timeline,
+                                           .value = signalValue,
+                                           .stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT};
+    const VkSubmitInfo2 submitInfo{.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2,
+                                   .commandBufferInfoCount = 1,
+                                   .pCommandBufferInfos = &commandBufferInfo,
+                                   .signalSemaphoreInfoCount = 1,
+                                   .pSignalSemaphoreInfos = &signalInfo};
+    VK_CALL(vkQueueSubmit2(m_queue, 1, &submitInfo, VK_NULL_HANDLE));
+    return signalValue;
+  }
+
+  // Safe to call from any thread, returns false if the value was not reached within the timeout.
+  bool waitTimeline(uint64_t value, std::chrono::nanoseconds timeout = std::chrono::nanoseconds::max()) const {
+    const VkSemaphoreWaitInfo waitInfo{.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+                                       .semaphoreCount = 1,
+                                       .pSemaphores = &m_timeline,
+                                       .pValues = &value};
+    const auto res = vkWaitSemaphores(m_device, &waitInfo, static_cast<uint64_t>(timeout.count()));
+    if (res != VK_SUCCESS && res != VK_TIMEOUT) {
+      std::println("vkWaitSemaphores failed with error {}", static_cast<int>(res));
+      std::exit(res);
+    }
+    return res == VK_SUCCESS;
+  }
+
+private:
+  Device(const PhysicalDevice& physicalDevice, std::vector<std::string> requestedDeviceExtensions)
+      : m_physicalDevice{physicalDevice.getPhysicalDevice()},
+        m_memoryProperties{physicalDevice.getMemoryProperties()} {
+    // clang-format off
+    m_enabledExtensions = requestedDeviceExtensions
+      | views::filter([&physicalDevice](const std::string& name) {
+          return physicalDevice.isExtensionSupported(name);
+        })
+      | ranges::to<std::vector<std::string>>();
+    // clang-format on
+
+    if (const auto family = physicalDevice.findQueueFamily(VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))
+      m_queueFamilyIndex = family.value();
+  }
+
+  bool init() {
+    auto extensions = m_enabledExtensions | views::transform(std::mem_fn(&std::string::c_str)) |
+                      ranges::to<std::vector<const char*>>();
+
+    VkPhysicalDeviceVulkan13Features features13{.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES,
+                                                .synchronization2 = VK_TRUE};
+    VkPhysicalDeviceVulkan12Features features12{.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
+                                                .pNext = &features13,
+                                                .timelineSemaphore = VK_TRUE};
+
+    const float queuePriority = 1.0f;
+    const VkDeviceQueueCreateInfo queueInfo{.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
+                                            .queueFamilyIndex = m_queueFamilyIndex,
+                                            .queueCount = 1,
+                                            .pQueuePriorities = &queuePriority};
+
+    const VkDeviceCreateInfo deviceInfo{.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
+                                        .pNext = &features12,
+                                        .queueCreateInfoCount = 1,
+                                        .pQueueCreateInfos = &queueInfo,
+                                        .enabledExtensionCount = static_cast<uint32_t>(extensions.size()),
+                                        .ppEnabledExtensionNames = extensions.data()};
+
+    if (vkCreateDevice(m_physicalDevice, &deviceInfo, nullptr, &m_device) != VK_SUCCESS)
+      return false;
+
+    vkGetDeviceQueue(m_device, m_queueFamilyIndex, 0, &m_queue);
+
+    const VkCommandPoolCreateInfo poolInfo{.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+                                           .flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+                                           .queueFamilyIndex = m_queueFamilyIndex};
+    VK_CALL(vkCreateCommandPool(m_device, &poolInfo, nullptr, &m_commandPool));
+
+    const VkSemaphoreTypeCreateInfo timelineInfo{.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+                                                 .semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+                                                 .initialValue = 0};
+    const VkSemaphoreCreateInfo semaphoreInfo{.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+                                              .pNext = &timelineInfo};
+    VK_CALL(vkCreateSemaphore(m_device, &semaphoreInfo, nullptr, &m_timeline));
+
+    if (isExtensionEnabled(VK_KHR_EXTERNAL_MEMORY_FD_EXTENSION_NAME))
+      m_getMemoryFd = reinterpret_cast<PFN_vkGetMemoryFdKHR>(vkGetDeviceProcAddr(m_device, "vkGetMemoryFdKHR"));
+
+    return true;
+  }
+
+  void swap(Device& rhs) {
+    std::swap(m_physicalDevice, rhs.m_physicalDevice);
+    std::swap(m_memoryProperties, rhs.m_memoryProperties);
+    std::swap(m_enabledExtensions, rhs.m_enabledExtensions);
+    std::swap(m_queueFamilyIndex, rhs.m_queueFamilyIndex);
+    std::swap(m_device, rhs.m_device);
+    std::swap(m_queue, rhs.m_queue);
+    std::swap(m_commandPool, rhs.m_commandPool);
+    std::swap(m_timeline, rhs.m_timeline);
+    std::swap(m_timelineValue, rhs.m_timelineValue);
+    std::swap(m_getMemoryFd, rhs.m_getMemoryFd);
+  }
+
+private:
+  VkPhysicalDevice m_physicalDevice = VK_NULL_HANDLE;
+  VkPhysicalDeviceMemoryProperties m_memoryProperties{};
+  std::vector<std::string> m_enabledExtensions;
+  uint32_t m_queueFamilyIndex = 0;
+  VkDevice m_device = VK_NULL_HANDLE;
+  VkQueue m_queue = VK_NULL_HANDLE;
+  VkCommandPool m_commandPool = VK_NULL_HANDLE;
+  VkSemaphore m_timeline = VK_NULL_HANDLE;
+  uint64_t m_timelineValue = 0;
+  PFN_vkGetMemoryFdKHR m_getMemoryFd = nullptr;
+};
+
+struct ReadbackBuffer {
+  VkBuffer buffer = VK_NULL_HANDLE;
+  VkDeviceMemory memory = VK_NULL_HANDLE;
+  VkDeviceSize size = 0;
+  std::byte* mapped = nullptr;
+  bool isCoherent = false;
+  int fd = -1;
+};
+
+// Fixed set of persistently mapped readback buffers. Host cached memory is preferred since the CPU reads every byte
+// of it, and when VK_KHR_external_memory_fd is enabled each buffer is exported once so another process can import
+// and map the same pages instead of receiving a copy.
+class ReadbackPool {
+public:
+  static constexpr VkBufferUsageFlags kUsage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+  ReadbackPool(Device& device, uint32_t count, VkDeviceSize size) : m_device{device} {
+    const auto exportable = m_device.canExportBuffer(kUsage);
+    for (uint32_t index = 0; index < count; ++index) {
+      m_buffers.push_back(createBuffer(size, exportable));
+      m_free.push_back(index);
+    }
+  }
+
+  ReadbackPool(const ReadbackPool&) = delete;
+  ReadbackPool& operator=(const ReadbackPool&) = delete;
+
+  ~ReadbackPool() {
+    for (auto& buffer : m_buffers) {
+#if !defined(_WIN32)
+      if (buffer.fd >= 0)
+        close(buffer.fd);
+#endif
+      vkUnmapMemory(m_device.getDevice(), buffer.memory);
+      vkDestroyBuffer(m_device.getDevice(), buffer.buffer, nullptr);
+      vkFreeMemory(m_device.getDevice(), buffer.memory, nullptr);
+    }
+  }
+
+  // Blocks until a buffer is handed back when all of them are in flight or leased.
+  uint32_t acquire() {
+    std::unique_lock lock{m_mutex};
+    m_available.wait(lock, [this] { return !m_free.empty(); });
+    const auto index = m_free.back();
+    m_free.pop_back();
+    return index;
+  }
+
+  void release(uint32_t index) {
+    {
+      std::lock_guard lock{m_mutex};
+      m_free.push_back(index);
+    }
+    m_available.notify_one();
+  }
+
+  void invalidate(uint32_t index) const {
+    const auto& buffer = m_buffers[index];
+    if (buffer.isCoherent)
+      return;
+
+    const VkMappedMemoryRange range{.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE,
+                                    .memory = buffer.memory,
+                                    .offset = 0,
+                                    .size = VK_WHOLE_SIZE};
+    VK_CALL(vkInvalidateMappedMemoryRanges(m_device.getDevice(), 1, &range));
+  }
+
+  [[nodiscard]] const ReadbackBuffer& buffer(uint32_t index) const { return m_buffers[index]; }
+
+private:
+  ReadbackBuffer createBuffer(VkDeviceSize size, bool exportable) {
+    const VkExternalMemoryBufferCreateInfo externalInfo{
+        .sType = VK_STRUCTURE_TYPE_EXTERNAL_MEMORY_BUFFER_CREATE_INFO,
+        .handleTypes = VK_EXTERNAL_MEMORY_HANDLE_TYPE_OPAQUE_FD_BIT};
+    const VkBufferCreateInfo bufferInfo{.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+                                        .pNext = exportable ? &externalInfo : nullptr,
+                                        .size = size,
+                                        .usage = kUsage,
+                                        .sharingMode = VK_SHARING_MODE_EXCLUSIVE};
+    ReadbackBuffer buffer{.size = size};
+    VK_CALL(vkCreateBuffer(m_device.getDevice(), &bufferInfo, nullptr, &buffer.buffer));
+
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements(m_device.getDevice(), buffer.buffer, &requirements);
+
+    auto memoryTypeIndex = m_device.findMemoryType(requirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                                                                    VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
+    if (!memoryTypeIndex.has_value())
+      memoryTypeIndex = m_device.findMemoryType(requirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+    if (!memoryTypeIndex.has_value()) {
+      std::println("No host visible memory type for a readback buffer of {} bytes", size);
+      std::exit(EXIT_FAILURE);
+    }
+
+    const VkExportMemoryAllocateInfo exportInfo{.sType = VK_STRUCTURE_TYPE_EXPORT_MEMORY_ALLOCATE_INFO,
+                                                .handleTypes = VK_EXTERNAL_MEMORY_HANDLE_TYPE_OPAQUE_FD_BIT};
+    const VkMemoryAllocateInfo allocateInfo{.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+                                            .pNext = exportable ? &exportInfo : nullptr,
+                                            .allocationSize = requirements.size,
+                                            .memoryTypeIndex = memoryTypeIndex.value()};
+    VK_CALL(vkAllocateMemory(m_device.getDevice(), &allocateInfo, nullptr, &buffer.memory));
+    VK_CALL(vkBindBufferMemory(m_device.getDevice(), buffer.buffer, buffer.memory, 0));
+
+    void* mapped = nullptr;
+    VK_CALL(vkMapMemory(m_device.getDevice(), buffer.memory, 0, VK_WHOLE_SIZE, 0, &mapped));
+    buffer.mapped = static_cast<std::byte*>(mapped);
+    buffer.isCoherent =
+        (m_device.memoryTypeFlags(memoryTypeIndex.value()) & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+
+    if (exportable) {
+      const VkMemoryGetFdInfoKHR fdInfo{.sType = VK_STRUCTURE_TYPE_MEMORY_GET_FD_INFO_KHR,
+                                        .memory = buffer.memory,
+                                        .handleType = VK_EXTERNAL_MEMORY_HANDLE_TYPE_OPAQUE_FD_BIT};
+      VK_CALL(m_device.getMemoryFdFunction()(m_device.getDevice(), &fdInfo, &buffer.fd));
+    }
+
+    return buffer;
+  }
+
+private:
+  Device& m_device;
+  std::vector<ReadbackBuffer> m_buffers;
+  std::vector<uint32_t> m_free;
+  std::mutex m_mutex;
+  std::condition_variable m_available;
+};
+
+// Read-only view of a completed readback. The data is read straight from the mapped buffer and the buffer goes back
+// to the pool when the lease is destroyed, so consumers should not hold on to it longer than they need to.
+class ReadbackLease {
+public:
+  ReadbackLease() = default;
+
+  ReadbackLease(ReadbackPool* pool, uint32_t index, VkDeviceSize size, uint64_t timelineValue)
+      : m_pool{pool}, m_index{index}, m_size{size}, m_timelineValue{timelineValue} {}
+
+  ReadbackLease(const ReadbackLease&) = delete;
+  ReadbackLease& operator=(const ReadbackLease&) = delete;
+
+  ReadbackLease(ReadbackLease&& rhs) noexcept { swap(rhs); }
+
+  ReadbackLease& operator=(ReadbackLease&& rhs) noexcept {
+    ReadbackLease tmp{std::move(rhs)};
+    swap(tmp);
+    return *this;
+  }
+
+  ~ReadbackLease() {
+    if (m_pool != nullptr)
+      m_pool->release(m_index);
+  }
+
+  [[nodiscard]] std::span<const std::byte> data() const {
+    return std::span<const std::byte>{m_pool->buffer(m_index).mapped, static_cast<size_t>(m_size)};
+  }
+
+  // Opaque fd of the whole backing allocation, -1 when the memory was not exported. It stays owned by the pool.
+  [[nodiscard]] int fd() const { return m_pool->buffer(m_index).fd; }
+
+  [[nodiscard]] uint64_t timelineValue() const noexcept { return m_timelineValue; }
+
+private:
+  void swap(ReadbackLease& rhs) {
+    std::swap(m_pool, rhs.m_pool);
+    std::swap(m_index, rhs.m_index);
+    std::swap(m_size, rhs.m_size);
+    std::swap(m_timelineValue, rhs.m_timelineValue);
+  }
+
+private:
+  ReadbackPool* m_pool = nullptr;
+  uint32_t m_index = 0;
+  VkDeviceSize m_size = 0;
+  uint64_t m_timelineValue = 0;
+};
+
+struct ReadbackRequest {
+  uint32_t bufferIndex = 0;
+  VkDeviceSize size = 0;
+};
+
+// Records copies into pooled readback buffers and completes them from a worker thread that waits on the device
+// timeline, so the render thread never blocks on the GPU to get its results.
+class AsyncReadback {
+public:
+  using Callback = std::function<void(const ReadbackLease&)>;
+
+  AsyncReadback(Device& device, ReadbackPool& pool)
+      : m_device{device}, m_pool{pool}, m_worker{[this](std::stop_token stop) { run(stop); }} {}
+
+  AsyncReadback(const AsyncReadback&) = delete;
+  AsyncReadback& operator=(const AsyncReadback&) = delete;
+
+  ~AsyncReadback() {
+    flush();
+    m_worker.request_stop();
+  }
+
+  // Copies the first mip of a color image, the image is left in VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL.
+  ReadbackRequest recordImageCopy(VkCommandBuffer commandBuffer, const ImageAllocation& image,
+                                  VkImageLayout currentLayout, VkPipelineStageFlags2 srcStage,
+                                  VkAccessFlags2 srcAccess, uint32_t bytesPerPixel) {
+    const auto size = VkDeviceSize{image.extent.width} * image.extent.height * bytesPerPixel;
+    const auto index = m_pool.acquire();
+    const auto& buffer = m_pool.buffer(index);
+
+    imageBarrier(commandBuffer, image.image, currentLayout, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, srcStage, srcAccess,
+                 VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_READ_BIT);
+
+    const VkBufferImageCopy region{.bufferOffset = 0,
+                                   .imageSubresource = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .layerCount = 1},
+                                   .imageExtent = {image.extent.width, image.extent.height, 1}};
+    vkCmdCopyImageToBuffer(commandBuffer, image.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, buffer.buffer, 1,
+                           &region);
+
+    bufferBarrier(commandBuffer, buffer.buffer, VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+                  VK_PIPELINE_STAGE_2_HOST_BIT, VK_ACCESS_2_HOST_READ_BIT);
+    return ReadbackRequest{.bufferIndex = index, .size = size};
+  }
+
+  // Same as recordImageCopy for compute results living in a buffer.
+  ReadbackRequest recordBufferCopy(VkCommandBuffer commandBuffer, VkBuffer source, VkDeviceSize size,
+                                   VkPipelineStageFlags2 srcStage, VkAccessFlags2 srcAccess) {
+    const auto index = m_pool.acquire();
+    const auto& buffer = m_pool.buffer(index);
+
+    bufferBarrier(commandBuffer, source, srcStage, srcAccess, VK_PIPELINE_STAGE_2_COPY_BIT,
+                  VK_ACCESS_2_TRANSFER_READ_BIT);
+
+    const VkBufferCopy region{.size = size};
+    vkCmdCopyBuffer(commandBuffer, source, buffer.buffer, 1, &region);
+
+    bufferBarrier(commandBuffer, buffer.buffer, VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+                  VK_PIPELINE_STAGE_2_HOST_BIT, VK_ACCESS_2_HOST_READ_BIT);
+    return ReadbackRequest{.bufferIndex = index, .size = size};
+  }
+
+  // timelineValue is the value signaled by the submission containing the recorded copy.
+  std::future<ReadbackLease> enqueue(ReadbackRequest request, uint64_t timelineValue) {
+    Pending pending{.request = request, .timelineValue = timelineValue};
+    auto future = pending.promise.get_future();
+    push(std::move(pending));
+    return future;
+  }
+
+  void enqueue(ReadbackRequest request, uint64_t timelineValue, Callback callback) {
+    push(Pending{.request = request, .timelineValue = timelineValue, .callback = std::move(callback)});
+  }
+
+  // Waits until every enqueued readback has been handed to its consumer.
+  void flush() {
+    std::unique_lock lock{m_mutex};
+    m_drained.wait(lock, [this] { return m_pending.empty() && !m_busy; });
+  }
+
+private:
+  struct Pending {
+    ReadbackRequest request;
+    uint64_t timelineValue = 0;
+    Callback callback;
+    std::promise<ReadbackLease> promise;
+  };
+
+  void push(Pending pending) {
+    {
+      std::lock_guard lock{m_mutex};
+      m_pending.push_back(std::move(pending));
+    }
+    m_queued.notify_one();
+  }
+
+  void run(std::stop_token stop) {
+    constexpr auto kPollTimeout = std::chrono::milliseconds{5};
+
+    while (!stop.stop_requested()) {
+      Pending pending;
+      {
+        std::unique_lock lock{m_mutex};
+        if (!m_queued.wait(lock, stop, [this] { return !m_pending.empty(); }))
+          return;
+        pending = std::move(m_pending.front());
+        m_pending.pop_front();
+        m_busy = true;
+      }
+
+      // Submissions complete in order, so waiting on the oldest request never holds back a newer one.
+      while (!m_device.waitTimeline(pending.timelineValue, kPollTimeout)) {
+        if (stop.stop_requested())
+          return;
+      }
+
+      m_pool.invalidate(pending.request.bufferIndex);
+      ReadbackLease lease{&m_pool, pending.request.bufferIndex, pending.request.size, pending.timelineValue};
+      if (pending.callback)
+        pending.callback(lease);
+      else
+        pending.promise.set_value(std::move(lease));
+
+      {
+        std::lock_guard lock{m_mutex};
+        m_busy = false;
+      }
+      m_drained.notify_all();
+    }
+  }
+
+private:
+  Device& m_device;
+  ReadbackPool& m_pool;
+  std::mutex m_mutex;
+  std::condition_variable_any m_queued;
+  std::condition_variable m_drained;
+  std::deque<Pending> m_pending;
+  bool m_busy = false;
+  std::jthread m_worker;
+};
+
+class Context {
+public:
+  static std::expected<Context, std::string> create(std::string_view applicationName,
+                                                    std::vector<std::string> requestedInstanceLayer,
+                                                    std::vector<std::string> requestedInstanceExtensions) {
+
+    Context context{applicationName, std::move(requestedInstanceLayer), std::move(requestedInstanceExtensions)};
+
+    if (context.init())
+      return context;
+    else
+      return std::unexpected(std::string{"Failed to init the vulkan context"});
+  }
+
+  ~Context() {
+    if (m_vulkanInstance == VK_NULL_HANDLE)
+      return;
+
+    vkDestroyInstance(m_vulkanInstance, nullptr);
+    m_vulkanInstance = VK_NULL_HANDLE;
+  }
+
+  Context& operator=(const Context&) = delete;
+
+  Context(const Context&) = delete;
+
+  Context(Context&& rhs) noexcept {
+    swap(rhs);
+    rhs.m_vulkanInstance = VK_NULL_HANDLE;
+  }
+
+  Context& operator=(Context&& rhs) noexcept {
+    Context tmp{std::move(rhs)};
+    swap(tmp);
+    return *this;
+  }
+
+  std::vector<PhysicalDevice> enumeratePhysicalDevices() {
+    // clang-format off
+    auto result = VulkanCore::enumeratePhysicalDevices(m_vulkanInstance)
+      | views::transform([](VkPhysicalDevice device) -> PhysicalDevice {
+         return PhysicalDevice{device};
+        })
+      | ranges::to<std::vector<PhysicalDevice>>();
+    // clang-format on
+    return result;
+  }
+
+private:
+  Context(std::string_view applicationName, std::vector<std::string> requestedInstanceLayer,
+          std::vector<std::string> requestedInstanceExtensions)
+      : m_applicationName{applicationName} {
+    auto allInstanceLayers = enumerateInstanceLayerProperties();
+    const auto isInstanceLayerRequired = [&requestedInstanceLayer](const VkLayerProperties& prop) {
+      auto name = std::string{prop.layerName};
+      return ranges::find(requestedInstanceLayer, name) != std::end(requestedInstanceLayer);
+    };
+    // clang-format off
+    m_layerProperties = allInstanceLayers
+      | views::filter(isInstanceLayerRequired)
+      | ranges::to<std::vector<VkLayerProperties>>();
+    // clang-format on
+
+    auto allExtensions = enumerateExtensionsProperties();
+    const auto isExtensionRequired = [&requestedInstanceExtensions](const VkExtensionProperties& prop) {
+      auto name = std::string{prop.extensionName};
+      return ranges::find(requestedInstanceExtensions, name) != std::end(requestedInstanceExtensions);
+    };
+    // clang-format off
+    m_layerExtensions = allExtensions
+      | views::filter(isExtensionRequired)
+      | ranges::to<std::vector<VkExtensionProperties>>();
+    // clang-format on
+  }
+
+  bool init() {
+    // clang-format off
+    auto layers = m_layerProperties
+      | views::transform([](const VkLayerProperties& prop) -> const char*
+        {
+          return prop.layerName;
+        })
+      | ranges::to<std::vector<const char*>>();
+
+      auto extensions = m_layerExtensions
+        | views::transform([](const VkExtensionProperties & prop) -> const char*
+          {
+            return prop.extensionName;
+          })
+        | ranges::to<std::vector<const char*>>();
+    // clang-format on
+
+    const VkApplicationInfo applicationInfo{.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO,
+                                            .pApplicationName = m_applicationName.data(),
+                                            .applicationVersion = VK_MAKE_VERSION(1, 0, 0),
+                                            .apiVersion = VK_API_VERSION_1_3};
+
+    const VkInstanceCreateInfo instanceCreateInfo{.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO,
+#if defined(VK_USE_PLATFORM_METAL_EXT)
+                                                  .flags = VK_INSTANCE_CREATE_ENUMERATE_PORTABILITY_BIT_KHR,
+#endif
+                                                  .pApplicationInfo = &applicationInfo,
+                                                  .enabledLayerCount = static_cast<uint32_t>(layers.size()),
+                                                  .ppEnabledLayerNames = layers.data(),
+                                                  .enabledExtensionCount = static_cast<uint32_t>(extensions.size()),
+                                                  .ppEnabledExtensionNames = extensions.data()};
+
+    const auto res = vkCreateInstance(&instanceCreateInfo, nullptr, &m_vulkanInstance);
+    return res == VK_SUCCESS;
+  }
+
+  void swap(Context& rhs) {
+    std::swap(m_applicationName, rhs.m_applicationName);
+    std::swap(m_layerProperties, rhs.m_layerProperties);
+    std::swap(m_layerExtensions, rhs.m_layerExtensions);
+    std::swap(m_vulkanInstance, rhs.m_vulkanInstance);
+  }
+
+private:
+  std::string m_applicationName;
+  std::vector<VkLayerProperties> m_layerProperties;
+  std::vector<VkExtensionProperties> m_layerExtensions;
+  VkInstance m_vulkanInstance = VK_NULL_HANDLE;
+};
+} // namespace VulkanCore
+
+uint32_t parseFrameCount(std::span<char*> arguments) {
+  uint32_t frames = 240;
+  for (size_t index = 1; index + 1 < arguments.size(); ++index) {
+    if (std::string_view{arguments[index]} == "--frames") {
+      const std::string_view value{arguments[index + 1]};
+      std::from_chars(value.data(), value.data() + value.size(), frames);
+    }
+  }
+  return frames;
+}
+
+struct FrameSlot {
+  VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+  uint64_t timelineValue = 0;
+};
+
+// Clears a 4K offscreen target to a color that encodes the frame index and reads every frame back to the CPU while
+// up to kFramesInFlight frames are being rendered. The consumer checks the color straight from the mapped memory.
+int main(int argc, char* argv[]) {
+  constexpr VkExtent2D kExtent{3840, 2160};
+  constexpr VkFormat kFormat = VK_FORMAT_R8G8B8A8_UNORM;
+  constexpr uint32_t kBytesPerPixel = 4;
+  constexpr uint32_t kFramesInFlight = 3;
+
+  const std::string applicationName = "01-07 Async readback";
+  const auto frameCount = parseFrameCount(std::span{argv, static_cast<size_t>(argc)});
+
+  auto vulkanContext =
+      VulkanCore::Context::create(applicationName, getRequestedInstanceLayers(), getRequestedInstanceExtensions());
+
+  if (!vulkanContext) {
+    std::println("Unable to create the context: {}", vulkanContext.error());
+    return EXIT_FAILURE;
+  }
+
+  auto physicalDevices = vulkanContext.value().enumeratePhysicalDevices();
+  if (physicalDevices.empty()) {
+    std::println("No physical devices found");
+    return EXIT_FAILURE;
+  }
+
+  const auto& physicalDevice = physicalDevices.front();
+  auto device = VulkanCore::Device::create(physicalDevice, getRequestedDeviceExtensions());
+  if (!device) {
+    std::println("Unable to create the device: {}", device.error());
+    return EXIT_FAILURE;
+  }
+
+  auto image = device->createImage(kExtent, kFormat,
+                                   VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT |
+                                       VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT);
+
+  VulkanCore::ReadbackPool pool{device.value(), kFramesInFlight + 2,
+                                VkDeviceSize{kExtent.width} * kExtent.height * kBytesPerPixel};
+  std::println("Using {}, readback memory is {}, external fd export {}", physicalDevice.getProperties().deviceName,
+               pool.buffer(0).isCoherent ? "coherent" : "non coherent",
+               device->getMemoryFdFunction() != nullptr ? "enabled" : "not available");
+
+  std::string deviceUuid;
+  for (const auto byte : physicalDevice.queryIdProperties().deviceUUID)
+    deviceUuid += std::format("{:02x}", byte);
+  std::println("Consumers importing the exported fds must run on the device with UUID {}", deviceUuid);
+
+  std::atomic<uint32_t> verifiedFrames{0};
+  std::atomic<uint32_t> corruptedFrames{0};
+
+  std::vector<FrameSlot> frames(kFramesInFlight);
+  for (auto& frame : frames)
+    frame.commandBuffer = device->allocateCommandBuffer();
+
+  // Records the clear for the given frame and the copy into a readback buffer, then submits it.
+  const auto renderFrame = [&](VulkanCore::AsyncReadback& readback, FrameSlot& slot, uint32_t frameIndex) {
+    device->waitTimeline(slot.timelineValue);
+
+    VK_CALL(vkResetCommandBuffer(slot.commandBuffer, 0));
+    const VkCommandBufferBeginInfo beginInfo{.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+                                             .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT};
+    VK_CALL(vkBeginCommandBuffer(slot.commandBuffer, &beginInfo));
+
+    VulkanCore::imageBarrier(slot.commandBuffer, image.image, VK_IMAGE_LAYOUT_UNDEFINED,
+                             VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_NONE,
+                             VK_PIPELINE_STAGE_2_CLEAR_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT);
+
+    const VkClearColorValue color{.float32 = {static_cast<float>(frameIndex % 256) / 255.0f, 0.0f, 1.0f, 1.0f}};
+    const VkImageSubresourceRange range{.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .levelCount = 1, .layerCount = 1};
+    vkCmdClearColorImage(slot.commandBuffer, image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &color, 1, &range);
+
+    auto request = readback.recordImageCopy(slot.commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                            VK_PIPELINE_STAGE_2_CLEAR_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+                                            kBytesPerPixel);
+
+    VK_CALL(vkEndCommandBuffer(slot.commandBuffer));
+    slot.timelineValue = device->submit(slot.commandBuffer);
+    return std::pair{request, slot.timelineValue};
+  };
+
+  // Every pixel and every channel, a copy that lands half way or with the wrong layout must not pass.
+  const auto isFrameColor = [](std::span<const std::byte> pixels, uint32_t frameIndex) {
+    const std::array<std::byte, kBytesPerPixel> expected{static_cast<std::byte>(frameIndex % 256), std::byte{0},
+                                                         std::byte{255}, std::byte{255}};
+    for (size_t offset = 0; offset + kBytesPerPixel <= pixels.size(); offset += kBytesPerPixel) {
+      if (!ranges::equal(pixels.subspan(offset, kBytesPerPixel), expected))
+        return false;
+    }
+    return pixels.size() % kBytesPerPixel == 0;
+  };
+
+  {
+    VulkanCore::AsyncReadback readback{device.value(), pool};
+
+    const auto start = std::chrono::steady_clock::now();
+    for (uint32_t frameIndex = 0; frameIndex < frameCount; ++frameIndex) {
+      auto [request, timelineValue] = renderFrame(readback, frames[frameIndex % kFramesInFlight], frameIndex);
+      readback.enqueue(request, timelineValue, [&, frameIndex](const VulkanCore::ReadbackLease& lease) {
+        if (isFrameColor(lease.data(), frameIndex))
+          ++verifiedFrames;
+        else
+          ++corruptedFrames;
+      });
+    }
+    readback.flush();
+    const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    const auto frameBytes = static_cast<double>(kExtent.width) * kExtent.height * kBytesPerPixel;
+    std::println("{} frames of {}x{} read back in {:.3f}s: {:.1f} fps, {:.2f} GB/s", frameCount, kExtent.width,
+                 kExtent.height, elapsed, frameCount / elapsed, frameCount * frameBytes / elapsed / 1e9);
+
+    // The future based path, e.g. for a one-off capture.
+    auto [request, timelineValue] = renderFrame(readback, frames[frameCount % kFramesInFlight], frameCount);
+    auto capture = readback.enqueue(request, timelineValue).get();
+    std::println("Capture at timeline value {}: first pixel {} {} {} {}, exported fd {}", capture.timelineValue(),
+                 static_cast<int>(capture.data()[0]), static_cast<int>(capture.data()[1]),
+                 static_cast<int>(capture.data()[2]), static_cast<int>(capture.data()[3]), capture.fd());
+  }
+
+  std::println("{} frames verified, {} corrupted", verifiedFrames.load(), corruptedFrames.load());
+  device->destroyImage(image);
+
+  return corruptedFrames == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
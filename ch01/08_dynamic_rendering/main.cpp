@@ -0,0 +1,1132 @@
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <expected>
+#include <functional>
+#include <iterator>
+#include <optional>
+#include <print>
+#include <ranges>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include <glfw/glfw3.h>
+#include <glfw/glfw3native.h>
+
+#include <glslang/Public/ResourceLimits.h>
+#include <glslang/Public/ShaderLang.h>
+#include <glslang/SPIRV/GlslangToSpv.h>
+
+namespace ranges = std::ranges;
+namespace views = std::ranges::views;
+
+#define VK_CALL(vFun)                                                                                                  \
+  {                                                                                                                    \
+    const auto res = vFun;                                                                                             \
+    if (res != VK_SUCCESS) {                                                                                           \
+      std::println(#vFun " failed with error {}", static_cast<int>(res));                                              \
+      std::exit(res);                                                                                                  \
+    }                                                                                                                  \
+  }
+
+auto getRequestedInstanceLayers() -> std::vector<std::string> {
+  return std::vector<std::string>{"VK_LAYER_KHRONOS_validation"};
+}
+
+// glfw knows which window system surface extension it needs on this platform, call after glfwInit.
+auto getRequestedInstanceExtensions() -> std::vector<std::string> {
+  uint32_t glfwExtensionsCount{0};
+  const auto glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionsCount);
+
+  auto extensions = std::vector<std::string>{
+#if defined(VK_USE_PLATFORM_METAL_EXT)
+      VK_KHR_PORTABILITY_ENUMERATION_EXTENSION_NAME,
+#endif
+#if defined(VK_EXT_debug_utils)
+      VK_EXT_DEBUG_UTILS_EXTENSION_NAME,
+#endif
+  };
+  for (uint32_t index = 0; index < glfwExtensionsCount; ++index)
+    extensions.emplace_back(glfwExtensions[index]);
+  return extensions;
+}
+
+auto getRequestedDeviceExtensions() -> std::vector<std::string> {
+  return std::vector<std::string>{
+      VK_KHR_SWAPCHAIN_EXTENSION_NAME,
+  };
+}
+
+namespace VulkanCore {
+std::vector<VkLayerProperties> enumerateInstanceLayerProperties() {
+  uint32_t layersCount{0};
+  vkEnumerateInstanceLayerProperties(&layersCount, nullptr);
+
+  std::vector<VkLayerProperties> layersProperties(layersCount);
+  vkEnumerateInstanceLayerProperties(&layersCount, layersProperties.data());
+
+  return layersProperties;
+}
+
+std::vector<VkExtensionProperties> enumerateExtensionsProperties() {
+  uint32_t extensionsCount{0};
+  vkEnumerateInstanceExtensionProperties(nullptr, &extensionsCount, nullptr);
+
+  std::vector<VkExtensionProperties> extensionsProperties(extensionsCount);
+  vkEnumerateInstanceExtensionProperties(nullptr, &extensionsCount, extensionsProperties.data());
+
+  return extensionsProperties;
+}
+
+std::vector<VkExtensionProperties> enumerateDeviceExtensionsProperties(VkPhysicalDevice device) {
+  uint32_t extensionsCount{0};
+  vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionsCount, nullptr);
+
+  std::vector<VkExtensionProperties> extensionsProperties(extensionsCount);
+  vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionsCount, extensionsProperties.data());
+
+  return extensionsProperties;
+}
+
+std::optional<VkSurfaceKHR> createVulkanSurface(GLFWwindow* window, VkInstance vulkanInstance) {
+  VkSurfaceKHR surface;
+#if defined(VK_USE_PLATFORM_WIN32_KHR)
+  auto hwnd = glfwGetWin32Window(window);
+  const VkWin32SurfaceCreateInfoKHR surfaceInfo{.sType = VK_STRUCTURE_TYPE_WIN32_SURFACE_CREATE_INFO_KHR,
+                                                .hinstance = GetModuleHandleW(nullptr),
+                                                .hwnd = reinterpret_cast<HWND>(hwnd)};
+
+  const auto res = vkCreateWin32SurfaceKHR(vulkanInstance, &surfaceInfo, nullptr, &surface);
+#else
+  const auto res = glfwCreateWindowSurface(vulkanInstance, window, nullptr, &surface);
+#endif
+  if (res == VK_SUCCESS)
+    return surface;
+  else
+    return std::nullopt;
+}
+
+std::vector<VkPhysicalDevice> enumeratePhysicalDevices(VkInstance instance) {
+  uint32_t physicalDevicesCount{0};
+  vkEnumeratePhysicalDevices(instance, &physicalDevicesCount, nullptr);
+
+  std::vector<VkPhysicalDevice> physicalDevices(physicalDevicesCount);
+  vkEnumeratePhysicalDevices(instance, &physicalDevicesCount, physicalDevices.data());
+
+  return physicalDevices;
+}
+
+std::vector<VkQueueFamilyProperties> enumeratePhysicalDevicesQueueFamilyProperties(VkPhysicalDevice device) {
+  uint32_t physicalDeviceQueueFamilyPropertiesCount{0};
+  vkGetPhysicalDeviceQueueFamilyProperties(device, &physicalDeviceQueueFamilyPropertiesCount, nullptr);
+
+  std::vector<VkQueueFamilyProperties> queueFamiliesProperties(physicalDeviceQueueFamilyPropertiesCount);
+  vkGetPhysicalDeviceQueueFamilyProperties(device, &physicalDeviceQueueFamilyPropertiesCount,
+                                           queueFamiliesProperties.data());
+
+  return queueFamiliesProperties;
+}
+
+std::vector<VkSurfaceFormatKHR> enumerateSurfaceFormats(VkPhysicalDevice device, VkSurfaceKHR surface) {
+  uint32_t formatsCount{0};
+  vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &formatsCount, nullptr);
+
+  std::vector<VkSurfaceFormatKHR> formats(formatsCount);
+  vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &formatsCount, formats.data());
+
+  return formats;
+}
+
+class PhysicalDevice {
+public:
+  PhysicalDevice(VkPhysicalDevice device, VkSurfaceKHR surface)
+      : m_device{device}, m_extensions{enumerateDeviceExtensionsProperties(device)},
+        m_queueFamilies{enumeratePhysicalDevicesQueueFamilyProperties(device)}, m_surface{surface} {
+    vkGetPhysicalDeviceProperties(m_device, &m_properties);
+    vkGetPhysicalDeviceMemoryProperties(m_device, &m_memoryProperties);
+  }
+
+  [[nodiscard]] inline VkPhysicalDevice getPhysicalDevice() const noexcept { return m_device; }
+
+  [[nodiscard]] inline VkSurfaceKHR getSurface() const noexcept { return m_surface; }
+
+  [[nodiscard]] inline const VkPhysicalDeviceProperties& getProperties() const noexcept { return m_properties; }
+
+  [[nodiscard]] inline const VkPhysicalDeviceMemoryProperties& getMemoryProperties() const noexcept {
+    return m_memoryProperties;
+  }
+
+  [[nodiscard]] bool isExtensionSupported(std::string_view name) const {
+    return ranges::any_of(m_extensions,
+                          [name](const VkExtensionProperties& prop) { return name == prop.extensionName; });
+  }
+
+  // A family that can both render and present to the surface, which every desktop driver exposes.
+  [[nodiscard]] std::optional<uint32_t> findGraphicsPresentQueueFamily() const {
+    for (uint32_t index = 0; index < m_queueFamilies.size(); ++index) {
+      VkBool32 presentSupport = VK_FALSE;
+      vkGetPhysicalDeviceSurfaceSupportKHR(m_device, index, m_surface, &presentSupport);
+      if ((m_queueFamilies[index].queueFlags & VK_QUEUE_GRAPHICS_BIT) && presentSupport == VK_TRUE)
+        return index;
+    }
+    return std::nullopt;
+  }
+
+private:
+  VkPhysicalDevice m_device;
+  std::vector<VkExtensionProperties> m_extensions;
+  std::vector<VkQueueFamilyProperties> m_queueFamilies;
+  VkSurfaceKHR m_surface;
+  VkPhysicalDeviceProperties m_properties{};
+  VkPhysicalDeviceMemoryProperties m_memoryProperties{};
+};
+
+void imageBarrier(VkCommandBuffer commandBuffer, VkImage image, VkImageAspectFlags aspect, VkImageLayout oldLayout,
+                  VkImageLayout newLayout, VkPipelineStageFlags2 srcStage, VkAccessFlags2 srcAccess,
+                  VkPipelineStageFlags2 dstStage, VkAccessFlags2 dstAccess) {
+  const VkImageMemoryBarrier2 barrier{.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+                                      .srcStageMask = srcStage,
+                                      .srcAccessMask = srcAccess,
+                                      .dstStageMask = dstStage,
+                                      .dstAccessMask = dstAccess,
+                                      .oldLayout = oldLayout,
+                                      .newLayout = newLayout,
+                                      .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                                      .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                                      .image = image,
+                                      .subresourceRange = {.aspectMask = aspect, .levelCount = 1, .layerCount = 1}};
+  const VkDependencyInfo dependency{.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+                                    .imageMemoryBarrierCount = 1,
+                                    .pImageMemoryBarriers = &barrier};
+  vkCmdPipelineBarrier2(commandBuffer, &dependency);
+}
+
+struct ImageAllocation {
+  VkImage image = VK_NULL_HANDLE;
+  VkImageView view = VK_NULL_HANDLE;
+  VkDeviceMemory memory = VK_NULL_HANDLE;
+  VkExtent2D extent{};
+  VkFormat format = VK_FORMAT_UNDEFINED;
+};
+
+class Device {
+public:
+  static std::expected<Device, std::string> create(const PhysicalDevice& physicalDevice,
+                                                   std::vector<std::string> requestedDeviceExtensions) {
+    Device device{physicalDevice, std::move(requestedDeviceExtensions)};
+
+    if (device.init())
+      return device;
+    else
+      return std::unexpected(std::string{"Failed to create the vulkan device"});
+  }
+
+  ~Device() {
+    if (m_device == VK_NULL_HANDLE)
+      return;
+
+    vkDeviceWaitIdle(m_device);
+    vkDestroyCommandPool(m_device, m_commandPool, nullptr);
+    vkDestroyDevice(m_device, nullptr);
+    m_device = VK_NULL_HANDLE;
+  }
+
+  Device& operator=(const Device&) = delete;
+
+  Device(const Device&) = delete;
+
+  Device(Device&& rhs) noexcept {
+    swap(rhs);
+    rhs.m_device = VK_NULL_HANDLE;
+  }
+
+  Device& operator=(Device&& rhs) noexcept {
+    Device tmp{std::move(rhs)};
+    swap(tmp);
+    return *this;
+  }
+
+  [[nodiscard]] inline VkDevice getDevice() const noexcept { return m_device; }
+
+  [[nodiscard]] inline VkPhysicalDevice getPhysicalDevice() const noexcept { return m_physicalDevice; }
+
+  [[nodiscard]] inline VkQueue getQueue() const noexcept { return m_queue; }
+
+  [[nodiscard]] std::optional<uint32_t> findMemoryType(uint32_t typeBits, VkMemoryPropertyFlags required) const {
+    for (uint32_t index = 0; index < m_memoryProperties.memoryTypeCount; ++index) {
+      const auto flags = m_memoryProperties.memoryTypes[index].propertyFlags;
+      if ((typeBits & (1u << index)) && (flags & required) == required)
+        return index;
+    }
+    return std::nullopt;
+  }
+
+  ImageAllocation createImage(VkExtent2D extent, VkFormat format, VkImageUsageFlags usage,
+                              VkImageAspectFlags aspect) {
+    const VkImageCreateInfo imageInfo{.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+                                      .imageType = VK_IMAGE_TYPE_2D,
+                                      .format = format,
+                                      .extent = {extent.width, extent.height, 1},
+                                      .mipLevels = 1,
+                                      .arrayLayers = 1,
+                                      .samples = VK_SAMPLE_COUNT_1_BIT,
+                                      .tiling = VK_IMAGE_TILING_OPTIMAL,
+                                      .usage = usage,
+                                      .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+                                      .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED};
+    ImageAllocation allocation{.extent = extent, .format = format};
+    VK_CALL(vkCreateImage(m_device, &imageInfo, nullptr, &allocation.image));
+
+    VkMemoryRequirements requirements;
+    vkGetImageMemoryRequirements(m_device, allocation.image, &requirements);
+
+    const auto memoryTypeIndex = findMemoryType(requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    const VkMemoryAllocateInfo allocateInfo{.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+                                            .allocationSize = requirements.size,
+                                            .memoryTypeIndex = memoryTypeIndex.value_or(0)};
+    VK_CALL(vkAllocateMemory(m_device, &allocateInfo, nullptr, &allocation.memory));
+    VK_CALL(vkBindImageMemory(m_device, allocation.image, allocation.memory, 0));
+
+    allocation.view = createImageView(allocation.image, format, aspect);
+    return allocation;
+  }
+
+  void destroyImage(ImageAllocation& allocation) {
+    vkDestroyImageView(m_device, allocation.view, nullptr);
+    vkDestroyImage(m_device, allocation.image, nullptr);
+    vkFreeMemory(m_device, allocation.memory, nullptr);
+    allocation = ImageAllocation{};
+  }
+
+  VkImageView createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspect) {
+    const VkImageViewCreateInfo viewInfo{.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+                                         .image = image,
+                                         .viewType = VK_IMAGE_VIEW_TYPE_2D,
+                                         .format = format,
+                                         .subresourceRange = {.aspectMask = aspect, .levelCount = 1, .layerCount = 1}};
+    VkImageView view = VK_NULL_HANDLE;
+    VK_CALL(vkCreateImageView(m_device, &viewInfo, nullptr, &view));
+    return view;
+  }
+
+  VkCommandBuffer allocateCommandBuffer() {
+    const VkCommandBufferAllocateInfo commandBufferInfo{.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+                                                        .commandPool = m_commandPool,
+                                                        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+                                                        .commandBufferCount = 1};
+    VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+    VK_CALL(vkAllocateCommandBuffers(m_device, &commandBufferInfo, &commandBuffer));
+    return commandBuffer;
+  }
+
+private:
+  Device(const PhysicalDevice& physicalDevice, std::vector<std::string> requestedDeviceExtensions)
+      : m_physicalDevice{physicalDevice.getPhysicalDevice()},
+        m_memoryProperties{physicalDevice.getMemoryProperties()} {
+    // clang-format off
+    m_enabledExtensions = requestedDeviceExtensions
+      | views::filter([&physicalDevice](const std::string& name) {
+          return physicalDevice.isExtensionSupported(name);
+        })
+      | ranges::to<std::vector<std::string>>();
+    // clang-format on
+
+    if (const auto family = physicalDevice.findGraphicsPresentQueueFamily())
+      m_queueFamilyIndex = family.value();
+  }
+
+  bool init() {
+    auto extensions = m_enabledExtensions | views::transform(std::mem_fn(&std::string::c_str)) |
+                      ranges::to<std::vector<const char*>>();
+
+    // Dynamic rendering, synchronization2 and the extended dynamic states are all core in Vulkan 1.3.
+    VkPhysicalDeviceVulkan13Features features13{.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES,
+                                                .synchronization2 = VK_TRUE,
+                                                .dynamicRendering = VK_TRUE};
+
+    const float queuePriority = 1.0f;
+    const VkDeviceQueueCreateInfo queueInfo{.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
+                                            .queueFamilyIndex = m_queueFamilyIndex,
+                                            .queueCount = 1,
+                                            .pQueuePriorities = &queuePriority};
+
+    const VkDeviceCreateInfo deviceInfo{.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
+                                        .pNext = &features13,
+                                        .queueCreateInfoCount = 1,
+                                        .pQueueCreateInfos = &queueInfo,
+                                        .enabledExtensionCount = static_cast<uint32_t>(extensions.size()),
+                                        .ppEnabledExtensionNames = extensions.data()};
+
+    if (vkCreateDevice(m_physicalDevice, &deviceInfo, nullptr, &m_device) != VK_SUCCESS)
+      return false;
+
+    vkGetDeviceQueue(m_device, m_queueFamilyIndex, 0, &m_queue);
+
+    const VkCommandPoolCreateInfo poolInfo{.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+                                           .flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+                                           .queueFamilyIndex = m_queueFamilyIndex};
+    VK_CALL(vkCreateCommandPool(m_device, &poolInfo, nullptr, &m_commandPool));
+
+    return true;
+  }
+
+  void swap(Device& rhs) {
+    std::swap(m_physicalDevice, rhs.m_physicalDevice);
+    std::swap(m_memoryProperties, rhs.m_memoryProperties);
+    std::swap(m_enabledExtensions, rhs.m_enabledExtensions);
+    std::swap(m_queueFamilyIndex, rhs.m_queueFamilyIndex);
+    std::swap(m_device, rhs.m_device);
+    std::swap(m_queue, rhs.m_queue);
+    std::swap(m_commandPool, rhs.m_commandPool);
+  }
+
+private:
+  VkPhysicalDevice m_physicalDevice = VK_NULL_HANDLE;
+  VkPhysicalDeviceMemoryProperties m_memoryProperties{};
+  std::vector<std::string> m_enabledExtensions;
+  uint32_t m_queueFamilyIndex = 0;
+  VkDevice m_device = VK_NULL_HANDLE;
+  VkQueue m_queue = VK_NULL_HANDLE;
+  VkCommandPool m_commandPool = VK_NULL_HANDLE;
+};
+
+// Swapchain images and views only: with dynamic rendering there are no framebuffers to rebuild on resize.
+class Swapchain {
+public:
+  Swapchain(Device& device, VkSurfaceKHR surface) : m_device{device}, m_surface{surface} {
+    const auto formats = enumerateSurfaceFormats(m_device.getPhysicalDevice(), m_surface);
+    const auto preferred = ranges::find_if(formats, [](const VkSurfaceFormatKHR& format) {
+      return format.format == VK_FORMAT_B8G8R8A8_SRGB && format.colorSpace == VK_COLOR_SPACE_SRGB_NONLINEAR_KHR;
+    });
+    m_surfaceFormat = preferred != std::end(formats) ? *preferred : formats.front();
+  }
+
+  Swapchain(const Swapchain&) = delete;
+  Swapchain& operator=(const Swapchain&) = delete;
+
+  ~Swapchain() {
+    destroyViews();
+    vkDestroySwapchainKHR(m_device.getDevice(), m_swapchain, nullptr);
+  }
+
+  void recreate(VkExtent2D framebufferExtent) {
+    VkSurfaceCapabilitiesKHR capabilities;
+    VK_CALL(vkGetPhysicalDeviceSurfaceCapabilitiesKHR(m_device.getPhysicalDevice(), m_surface, &capabilities));
+
+    m_extent = capabilities.currentExtent;
+    if (m_extent.width == UINT32_MAX) {
+      m_extent.width = std::clamp(framebufferExtent.width, capabilities.minImageExtent.width,
+                                  capabilities.maxImageExtent.width);
+      m_extent.height = std::clamp(framebufferExtent.height, capabilities.minImageExtent.height,
+                                   capabilities.maxImageExtent.height);
+    }
+
+    auto imageCount = capabilities.minImageCount + 1;
+    if (capabilities.maxImageCount != 0)
+      imageCount = std::min(imageCount, capabilities.maxImageCount);
+
+    const auto oldSwapchain = m_swapchain;
+    const VkSwapchainCreateInfoKHR swapchainInfo{.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR,
+                                                 .surface = m_surface,
+                                                 .minImageCount = imageCount,
+                                                 .imageFormat = m_surfaceFormat.format,
+                                                 .imageColorSpace = m_surfaceFormat.colorSpace,
+                                                 .imageExtent = m_extent,
+                                                 .imageArrayLayers = 1,
+                                                 .imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+                                                 .imageSharingMode = VK_SHARING_MODE_EXCLUSIVE,
+                                                 .preTransform = capabilities.currentTransform,
+                                                 .compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR,
+                                                 .presentMode = VK_PRESENT_MODE_FIFO_KHR,
+                                                 .clipped = VK_TRUE,
+                                                 .oldSwapchain = oldSwapchain};
+    VK_CALL(vkCreateSwapchainKHR(m_device.getDevice(), &swapchainInfo, nullptr, &m_swapchain));
+
+    destroyViews();
+    vkDestroySwapchainKHR(m_device.getDevice(), oldSwapchain, nullptr);
+
+    uint32_t swapchainImagesCount{0};
+    vkGetSwapchainImagesKHR(m_device.getDevice(), m_swapchain, &swapchainImagesCount, nullptr);
+    m_images.resize(swapchainImagesCount);
+    vkGetSwapchainImagesKHR(m_device.getDevice(), m_swapchain, &swapchainImagesCount, m_images.data());
+
+    m_views = m_images | views::transform([this](VkImage image) {
+                return m_device.createImageView(image, m_surfaceFormat.format, VK_IMAGE_ASPECT_COLOR_BIT);
+              }) |
+              ranges::to<std::vector<VkImageView>>();
+  }
+
+  [[nodiscard]] inline VkSwapchainKHR getSwapchain() const noexcept { return m_swapchain; }
+
+  [[nodiscard]] inline VkFormat getFormat() const noexcept { return m_surfaceFormat.format; }
+
+  [[nodiscard]] inline VkExtent2D getExtent() const noexcept { return m_extent; }
+
+  [[nodiscard]] inline VkImage getImage(uint32_t index) const { return m_images[index]; }
+
+  [[nodiscard]] inline VkImageView getImageView(uint32_t index) const { return m_views[index]; }
+
+  [[nodiscard]] inline uint32_t getImageCount() const noexcept { return static_cast<uint32_t>(m_images.size()); }
+
+private:
+  void destroyViews() {
+    for (auto view : m_views)
+      vkDestroyImageView(m_device.getDevice(), view, nullptr);
+    m_views.clear();
+  }
+
+private:
+  Device& m_device;
+  VkSurfaceKHR m_surface;
+  VkSurfaceFormatKHR m_surfaceFormat{};
+  VkExtent2D m_extent{};
+  VkSwapchainKHR m_swapchain = VK_NULL_HANDLE;
+  std::vector<VkImage> m_images;
+  std::vector<VkImageView> m_views;
+};
+
+class ShaderCompiler {
+public:
+  ShaderCompiler() { glslang::InitializeProcess(); }
+
+  ShaderCompiler(const ShaderCompiler&) = delete;
+  ShaderCompiler& operator=(const ShaderCompiler&) = delete;
+
+  ~ShaderCompiler() { glslang::FinalizeProcess(); }
+
+  std::expected<std::vector<uint32_t>, std::string> compile(std::string_view source,
+                                                            VkShaderStageFlagBits stage) const {
+    const auto language = toLanguage(stage);
+
+    glslang::TShader shader{language};
+    const char* sources[] = {source.data()};
+    const int lengths[] = {static_cast<int>(source.size())};
+    shader.setStringsWithLengths(sources, lengths, 1);
+    shader.setEnvInput(glslang::EShSourceGlsl, language, glslang::EShClientVulkan, 100);
+    shader.setEnvClient(glslang::EShClientVulkan, glslang::EShTargetVulkan_1_3);
+    shader.setEnvTarget(glslang::EShTargetSpv, glslang::EShTargetSpv_1_6);
+
+    const auto messages = static_cast<EShMessages>(EShMsgSpvRules | EShMsgVulkanRules);
+    if (!shader.parse(GetDefaultResources(), 460, false, messages))
+      return std::unexpected(std::string{shader.getInfoLog()});
+
+    glslang::TProgram program;
+    program.addShader(&shader);
+    if (!program.link(messages))
+      return std::unexpected(std::string{program.getInfoLog()});
+
+    std::vector<uint32_t> spirv;
+    glslang::GlslangToSpv(*program.getIntermediate(language), spirv);
+    return spirv;
+  }
+
+private:
+  static EShLanguage toLanguage(VkShaderStageFlagBits stage) {
+    switch (stage) {
+    case VK_SHADER_STAGE_VERTEX_BIT:
+      return EShLangVertex;
+    case VK_SHADER_STAGE_FRAGMENT_BIT:
+      return EShLangFragment;
+    case VK_SHADER_STAGE_COMPUTE_BIT:
+      return EShLangCompute;
+    default:
+      return EShLangVertex;
+    }
+  }
+};
+
+VkShaderModule createShaderModule(VkDevice device, std::span<const uint32_t> spirv) {
+  const VkShaderModuleCreateInfo moduleInfo{.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+                                            .codeSize = spirv.size_bytes(),
+                                            .pCode = spirv.data()};
+  VkShaderModule module = VK_NULL_HANDLE;
+  VK_CALL(vkCreateShaderModule(device, &moduleInfo, nullptr, &module));
+  return module;
+}
+
+// The only state baked into a pipeline besides the shaders: everything else is set while recording.
+struct AttachmentFormats {
+  static constexpr uint32_t kMaxColorAttachments = 4;
+
+  std::array<VkFormat, kMaxColorAttachments> colorFormats{};
+  uint32_t colorAttachmentCount = 0;
+  VkFormat depthFormat = VK_FORMAT_UNDEFINED;
+  VkFormat stencilFormat = VK_FORMAT_UNDEFINED;
+
+  bool operator==(const AttachmentFormats&) const = default;
+};
+
+struct AttachmentFormatsHash {
+  size_t operator()(const AttachmentFormats& formats) const noexcept {
+    size_t seed = formats.colorAttachmentCount;
+    const auto combine = [&seed](VkFormat format) {
+      seed ^= std::hash<uint32_t>{}(static_cast<uint32_t>(format)) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    };
+    ranges::for_each(formats.colorFormats | views::take(formats.colorAttachmentCount), combine);
+    combine(formats.depthFormat);
+    combine(formats.stencilFormat);
+    return seed;
+  }
+};
+
+constexpr std::array kDynamicStates{
+    VK_DYNAMIC_STATE_VIEWPORT_WITH_COUNT, VK_DYNAMIC_STATE_SCISSOR_WITH_COUNT, VK_DYNAMIC_STATE_CULL_MODE,
+    VK_DYNAMIC_STATE_FRONT_FACE,          VK_DYNAMIC_STATE_PRIMITIVE_TOPOLOGY, VK_DYNAMIC_STATE_DEPTH_TEST_ENABLE,
+    VK_DYNAMIC_STATE_DEPTH_WRITE_ENABLE,  VK_DYNAMIC_STATE_DEPTH_COMPARE_OP,
+};
+
+// One pipeline per set of attachment formats for a given vertex/fragment shader pair. A resize keeps the formats,
+// so it never creates a pipeline.
+class GraphicsPipelineCache {
+public:
+  GraphicsPipelineCache(Device& device, VkShaderModule vertexShader, VkShaderModule fragmentShader,
+                        VkPipelineLayout layout)
+      : m_device{device}, m_vertexShader{vertexShader}, m_fragmentShader{fragmentShader}, m_layout{layout} {
+    const VkPipelineCacheCreateInfo cacheInfo{.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO};
+    VK_CALL(vkCreatePipelineCache(m_device.getDevice(), &cacheInfo, nullptr, &m_pipelineCache));
+  }
+
+  GraphicsPipelineCache(const GraphicsPipelineCache&) = delete;
+  GraphicsPipelineCache& operator=(const GraphicsPipelineCache&) = delete;
+
+  ~GraphicsPipelineCache() {
+    for (const auto& [formats, pipeline] : m_pipelines)
+      vkDestroyPipeline(m_device.getDevice(), pipeline, nullptr);
+    vkDestroyPipelineCache(m_device.getDevice(), m_pipelineCache, nullptr);
+  }
+
+  VkPipeline get(const AttachmentFormats& formats) {
+    if (const auto it = m_pipelines.find(formats); it != std::end(m_pipelines))
+      return it->second;
+
+    const auto pipeline = create(formats);
+    m_pipelines.emplace(formats, pipeline);
+    return pipeline;
+  }
+
+  [[nodiscard]] size_t size() const noexcept { return m_pipelines.size(); }
+
+private:
+  VkPipeline create(const AttachmentFormats& formats) {
+    const std::array stages{
+        VkPipelineShaderStageCreateInfo{.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+                                        .stage = VK_SHADER_STAGE_VERTEX_BIT,
+                                        .module = m_vertexShader,
+                                        .pName = "main"},
+        VkPipelineShaderStageCreateInfo{.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+                                        .stage = VK_SHADER_STAGE_FRAGMENT_BIT,
+                                        .module = m_fragmentShader,
+                                        .pName = "main"},
+    };
+
+    const VkPipelineVertexInputStateCreateInfo vertexInput{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO};
+    const VkPipelineInputAssemblyStateCreateInfo inputAssembly{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
+        .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST};
+    const VkPipelineViewportStateCreateInfo viewport{.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO};
+    const VkPipelineRasterizationStateCreateInfo rasterization{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
+        .polygonMode = VK_POLYGON_MODE_FILL,
+        .lineWidth = 1.0f};
+    const VkPipelineMultisampleStateCreateInfo multisample{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
+        .rasterizationSamples = VK_SAMPLE_COUNT_1_BIT};
+    const VkPipelineDepthStencilStateCreateInfo depthStencil{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO};
+
+    std::array<VkPipelineColorBlendAttachmentState, AttachmentFormats::kMaxColorAttachments> blendAttachments{};
+    for (auto& attachment : blendAttachments)
+      attachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT |
+                                  VK_COLOR_COMPONENT_A_BIT;
+    const VkPipelineColorBlendStateCreateInfo colorBlend{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
+        .attachmentCount = formats.colorAttachmentCount,
+        .pAttachments = blendAttachments.data()};
+
+    const VkPipelineDynamicStateCreateInfo dynamicState{.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
+                                                        .dynamicStateCount =
+                                                            static_cast<uint32_t>(kDynamicStates.size()),
+                                                        .pDynamicStates = kDynamicStates.data()};
+
+    const VkPipelineRenderingCreateInfo renderingInfo{.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO,
+                                                      .colorAttachmentCount = formats.colorAttachmentCount,
+                                                      .pColorAttachmentFormats = formats.colorFormats.data(),
+                                                      .depthAttachmentFormat = formats.depthFormat,
+                                                      .stencilAttachmentFormat = formats.stencilFormat};
+
+    const VkGraphicsPipelineCreateInfo pipelineInfo{.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+                                                    .pNext = &renderingInfo,
+                                                    .stageCount = static_cast<uint32_t>(stages.size()),
+                                                    .pStages = stages.data(),
+                                                    .pVertexInputState = &vertexInput,
+                                                    .pInputAssemblyState = &inputAssembly,
+                                                    .pViewportState = &viewport,
+                                                    .pRasterizationState = &rasterization,
+                                                    .pMultisampleState = &multisample,
+                                                    .pDepthStencilState = &depthStencil,
+                                                    .pColorBlendState = &colorBlend,
+                                                    .pDynamicState = &dynamicState,
+                                                    .layout = m_layout,
+                                                    .renderPass = VK_NULL_HANDLE};
+
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    VK_CALL(vkCreateGraphicsPipelines(m_device.getDevice(), m_pipelineCache, 1, &pipelineInfo, nullptr, &pipeline));
+    return pipeline;
+  }
+
+private:
+  Device& m_device;
+  VkShaderModule m_vertexShader;
+  VkShaderModule m_fragmentShader;
+  VkPipelineLayout m_layout;
+  VkPipelineCache m_pipelineCache = VK_NULL_HANDLE;
+  std::unordered_map<AttachmentFormats, VkPipeline, AttachmentFormatsHash> m_pipelines;
+};
+
+class Context {
+public:
+  static std::expected<Context, std::string> create(GLFWwindow* window, std::string_view applicationName,
+                                                    std::vector<std::string> requestedInstanceLayer,
+                                                    std::vector<std::string> requestedInstanceExtensions) {
+
+    Context context{window, applicationName, std::move(requestedInstanceLayer), std::move(requestedInstanceExtensions)};
+
+    if (context.init())
+      return context;
+    else
+      return std::unexpected(std::string{"Failed to init the vulkan context"});
+  }
+
+  ~Context() {
+    if (m_vulkanInstance == VK_NULL_HANDLE)
+      return;
+
+    vkDestroySurfaceKHR(m_vulkanInstance, m_surface, nullptr);
+    vkDestroyInstance(m_vulkanInstance, nullptr);
+    m_vulkanInstance = VK_NULL_HANDLE;
+  }
+
+  Context& operator=(const Context&) = delete;
+
+  Context(const Context&) = delete;
+
+  Context(Context&& rhs) noexcept {
+    swap(rhs);
+    rhs.m_vulkanInstance = VK_NULL_HANDLE;
+    rhs.m_surface = VK_NULL_HANDLE;
+  }
+
+  Context& operator=(Context&& rhs) noexcept {
+    Context tmp{std::move(rhs)};
+    swap(tmp);
+    return *this;
+  }
+
+  std::vector<PhysicalDevice> enumeratePhysicalDevices() {
+    // clang-format off
+    auto result = VulkanCore::enumeratePhysicalDevices(m_vulkanInstance)
+      | views::transform([this](VkPhysicalDevice device) -> PhysicalDevice {
+         return PhysicalDevice{device, m_surface};
+        })
+      | ranges::to<std::vector<PhysicalDevice>>();
+    // clang-format on
+    return result;
+  }
+
+  [[nodiscard]] inline VkSurfaceKHR getSurface() const noexcept { return m_surface; }
+
+private:
+  Context(GLFWwindow* window, std::string_view applicationName, std::vector<std::string> requestedInstanceLayer,
+          std::vector<std::string> requestedInstanceExtensions)
+      : m_window{window}, m_applicationName{applicationName} {
+    auto allInstanceLayers = enumerateInstanceLayerProperties();
+    const auto isInstanceLayerRequired = [&requestedInstanceLayer](const VkLayerProperties& prop) {
+      auto name = std::string{prop.layerName};
+      return ranges::find(requestedInstanceLayer, name) != std::end(requestedInstanceLayer);
+    };
+    // clang-format off
+    m_layerProperties = allInstanceLayers
+      | views::filter(isInstanceLayerRequired)
+      | ranges::to<std::vector<VkLayerProperties>>();
+    // clang-format on
+
+    auto allExtensions = enumerateExtensionsProperties();
+    const auto isExtensionRequired = [&requestedInstanceExtensions](const VkExtensionProperties& prop) {
+      auto name = std::string{prop.extensionName};
+      return ranges::find(requestedInstanceExtensions, name) != std::end(requestedInstanceExtensions);
+    };
+    // clang-format off
+    m_layerExtensions = allExtensions
+      | views::filter(isExtensionRequired)
+      | ranges::to<std::vector<VkExtensionProperties>>();
+    // clang-format on
+  }
+
+  bool init() {
+    // clang-format off
+    auto layers = m_layerProperties
+      | views::transform([](const VkLayerProperties& prop) -> const char*
+        {
+          return prop.layerName;
+        })
+      | ranges::to<std::vector<const char*>>();
+
+      auto extensions = m_layerExtensions
+        | views::transform([](const VkExtensionProperties & prop) -> const char*
+          {
+            return prop.extensionName;
+          })
+        | ranges::to<std::vector<const char*>>();
+    // clang-format on
+
+    const VkApplicationInfo applicationInfo{.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO,
+                                            .pApplicationName = m_applicationName.data(),
+                                            .applicationVersion = VK_MAKE_VERSION(1, 0, 0),
+                                            .apiVersion = VK_API_VERSION_1_3};
+
+    const VkInstanceCreateInfo instanceCreateInfo{.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO,
+#if defined(VK_USE_PLATFORM_METAL_EXT)
+                                                  .flags = VK_INSTANCE_CREATE_ENUMERATE_PORTABILITY_BIT_KHR,
+#endif
+                                                  .pApplicationInfo = &applicationInfo,
+                                                  .enabledLayerCount = static_cast<uint32_t>(layers.size()),
+                                                  .ppEnabledLayerNames = layers.data(),
+                                                  .enabledExtensionCount = static_cast<uint32_t>(extensions.size()),
+                                                  .ppEnabledExtensionNames = extensions.data()};
+
+    const auto res = vkCreateInstance(&instanceCreateInfo, nullptr, &m_vulkanInstance);
+    if (res != VK_SUCCESS)
+      return false;
+
+    auto surface = createVulkanSurface(m_window, m_vulkanInstance);
+    if (!surface.has_value())
+      return false;
+
+    m_surface = surface.value();
+    return true;
+  }
+
+  void swap(Context& rhs) {
+    std::swap(m_window, rhs.m_window);
+    std::swap(m_applicationName, rhs.m_applicationName);
+    std::swap(m_layerProperties, rhs.m_layerProperties);
+    std::swap(m_layerExtensions, rhs.m_layerExtensions);
+    std::swap(m_vulkanInstance, rhs.m_vulkanInstance);
+    std::swap(m_surface, rhs.m_surface);
+  }
+
+private:
+  GLFWwindow* m_window = nullptr;
+  std::string m_applicationName;
+  std::vector<VkLayerProperties> m_layerProperties;
+  std::vector<VkExtensionProperties> m_layerExtensions;
+  VkInstance m_vulkanInstance = VK_NULL_HANDLE;
+  VkSurfaceKHR m_surface = VK_NULL_HANDLE;
+};
+} // namespace VulkanCore
+
+constexpr std::string_view kVertexShader = R"(
+#version 460
+
+layout(push_constant) uniform PushConstants {
+  float time;
+} pushConstants;
+
+layout(location = 0) out vec3 outColor;
+
+const vec2 positions[3] = vec2[](vec2(0.0, -0.6), vec2(0.6, 0.6), vec2(-0.6, 0.6));
+const vec3 colors[3] = vec3[](vec3(1.0, 0.0, 0.0), vec3(0.0, 1.0, 0.0), vec3(0.0, 0.0, 1.0));
+
+void main() {
+  const float s = sin(pushConstants.time);
+  const float c = cos(pushConstants.time);
+  gl_Position = vec4(mat2(c, s, -s, c) * positions[gl_VertexIndex], 0.5, 1.0);
+  outColor = colors[gl_VertexIndex];
+}
+)";
+
+constexpr std::string_view kFragmentShader = R"(
+#version 460
+
+layout(location = 0) in vec3 inColor;
+layout(location = 0) out vec4 outColor;
+
+void main() {
+  outColor = vec4(inColor, 1.0);
+}
+)";
+
+constexpr uint32_t kFramesInFlight = 2;
+constexpr VkFormat kDepthFormat = VK_FORMAT_D32_SFLOAT;
+
+struct FrameData {
+  VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+  VkSemaphore imageAvailable = VK_NULL_HANDLE;
+  VkFence inFlight = VK_NULL_HANDLE;
+};
+
+void recordFrame(VkCommandBuffer commandBuffer, const VulkanCore::Swapchain& swapchain, uint32_t imageIndex,
+                 const VulkanCore::ImageAllocation& depth, VulkanCore::GraphicsPipelineCache& pipelines,
+                 VkPipelineLayout layout, float time) {
+  const VkCommandBufferBeginInfo beginInfo{.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+                                           .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT};
+  VK_CALL(vkBeginCommandBuffer(commandBuffer, &beginInfo));
+
+  const auto image = swapchain.getImage(imageIndex);
+  VulkanCore::imageBarrier(commandBuffer, image, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_UNDEFINED,
+                           VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+                           VK_ACCESS_2_NONE, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+                           VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT);
+  VulkanCore::imageBarrier(commandBuffer, depth.image, VK_IMAGE_ASPECT_DEPTH_BIT, VK_IMAGE_LAYOUT_UNDEFINED,
+                           VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
+                           VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+                           VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                           VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+                           VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT |
+                               VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT);
+
+  const VkRenderingAttachmentInfo colorAttachment{.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
+                                                  .imageView = swapchain.getImageView(imageIndex),
+                                                  .imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                                                  .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+                                                  .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+                                                  .clearValue = {.color = {.float32 = {0.1f, 0.1f, 0.1f, 1.0f}}}};
+  const VkRenderingAttachmentInfo depthAttachment{.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
+                                                  .imageView = depth.view,
+                                                  .imageLayout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
+                                                  .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+                                                  .storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+                                                  .clearValue = {.depthStencil = {.depth = 1.0f}}};
+
+  const auto extent = swapchain.getExtent();
+  const VkRenderingInfo renderingInfo{.sType = VK_STRUCTURE_TYPE_RENDERING_INFO,
+                                      .renderArea = {.offset = {0, 0}, .extent = extent},
+                                      .layerCount = 1,
+                                      .colorAttachmentCount = 1,
+                                      .pColorAttachments = &colorAttachment,
+                                      .pDepthAttachment = &depthAttachment};
+  vkCmdBeginRendering(commandBuffer, &renderingInfo);
+
+  const VulkanCore::AttachmentFormats formats{.colorFormats = {swapchain.getFormat()},
+                                              .colorAttachmentCount = 1,
+                                              .depthFormat = depth.format};
+  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.get(formats));
+
+  const VkViewport viewport{.width = static_cast<float>(extent.width),
+                            .height = static_cast<float>(extent.height),
+                            .maxDepth = 1.0f};
+  const VkRect2D scissor{.offset = {0, 0}, .extent = extent};
+  vkCmdSetViewportWithCount(commandBuffer, 1, &viewport);
+  vkCmdSetScissorWithCount(commandBuffer, 1, &scissor);
+  vkCmdSetCullMode(commandBuffer, VK_CULL_MODE_NONE);
+  vkCmdSetFrontFace(commandBuffer, VK_FRONT_FACE_CLOCKWISE);
+  vkCmdSetPrimitiveTopology(commandBuffer, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);
+  vkCmdSetDepthTestEnable(commandBuffer, VK_TRUE);
+  vkCmdSetDepthWriteEnable(commandBuffer, VK_TRUE);
+  vkCmdSetDepthCompareOp(commandBuffer, VK_COMPARE_OP_LESS);
+
+  vkCmdPushConstants(commandBuffer, layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(time), &time);
+  vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+
+  vkCmdEndRendering(commandBuffer);
+
+  VulkanCore::imageBarrier(commandBuffer, image, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                           VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+                           VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT, VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE);
+
+  VK_CALL(vkEndCommandBuffer(commandBuffer));
+}
+
+int main() {
+  const std::string applicationName = "01-08 Dynamic rendering";
+
+  glfwInit();
+  glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+  auto window = glfwCreateWindow(800, 600, applicationName.c_str(), nullptr, nullptr);
+
+  bool framebufferResized = false;
+  glfwSetWindowUserPointer(window, &framebufferResized);
+  glfwSetFramebufferSizeCallback(window, [](GLFWwindow* window, int, int) {
+    *static_cast<bool*>(glfwGetWindowUserPointer(window)) = true;
+  });
+
+  auto vulkanContext = VulkanCore::Context::create(window, applicationName, getRequestedInstanceLayers(),
+                                                   getRequestedInstanceExtensions());
+
+  if (!vulkanContext) {
+    std::println("Unable to create the context: {}", vulkanContext.error());
+    return EXIT_FAILURE;
+  }
+
+  auto physicalDevices = vulkanContext.value().enumeratePhysicalDevices();
+  const auto physicalDevice = ranges::find_if(physicalDevices, [](const VulkanCore::PhysicalDevice& device) {
+    return device.findGraphicsPresentQueueFamily().has_value() &&
+           device.isExtensionSupported(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+  });
+  if (physicalDevice == std::end(physicalDevices)) {
+    std::println("No physical device can present to the window");
+    return EXIT_FAILURE;
+  }
+
+  auto device = VulkanCore::Device::create(*physicalDevice, getRequestedDeviceExtensions());
+  if (!device) {
+    std::println("Unable to create the device: {}", device.error());
+    return EXIT_FAILURE;
+  }
+  const auto vkDevice = device->getDevice();
+
+  VulkanCore::ShaderCompiler compiler;
+  const auto vertexSpirv = compiler.compile(kVertexShader, VK_SHADER_STAGE_VERTEX_BIT);
+  const auto fragmentSpirv = compiler.compile(kFragmentShader, VK_SHADER_STAGE_FRAGMENT_BIT);
+  if (!vertexSpirv || !fragmentSpirv) {
+    std::println("Unable to compile the shaders: {}", !vertexSpirv ? vertexSpirv.error() : fragmentSpirv.error());
+    return EXIT_FAILURE;
+  }
+  const auto vertexShader = VulkanCore::createShaderModule(vkDevice, vertexSpirv.value());
+  const auto fragmentShader = VulkanCore::createShaderModule(vkDevice, fragmentSpirv.value());
+
+  const VkPushConstantRange pushConstantRange{.stageFlags = VK_SHADER_STAGE_VERTEX_BIT, .size = sizeof(float)};
+  const VkPipelineLayoutCreateInfo layoutInfo{.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+                                              .pushConstantRangeCount = 1,
+                                              .pPushConstantRanges = &pushConstantRange};
+  VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+  VK_CALL(vkCreatePipelineLayout(vkDevice, &layoutInfo, nullptr, &pipelineLayout));
+
+  uint32_t resizeCount = 0;
+  {
+    VulkanCore::GraphicsPipelineCache pipelines{device.value(), vertexShader, fragmentShader, pipelineLayout};
+    VulkanCore::Swapchain swapchain{device.value(), vulkanContext->getSurface()};
+
+    VulkanCore::ImageAllocation depth;
+    std::vector<VkSemaphore> renderFinished;
+    const auto recreateSwapchain = [&] {
+      int width = 0, height = 0;
+      glfwGetFramebufferSize(window, &width, &height);
+      while ((width == 0 || height == 0) && !glfwWindowShouldClose(window)) {
+        glfwWaitEvents();
+        glfwGetFramebufferSize(window, &width, &height);
+      }
+      // Closed while minimized: a 0x0 swapchain is invalid and the frame loop is about to exit anyway.
+      if (glfwWindowShouldClose(window) || width == 0 || height == 0)
+        return;
+
+      vkDeviceWaitIdle(vkDevice);
+      swapchain.recreate({static_cast<uint32_t>(width), static_cast<uint32_t>(height)});
+
+      if (depth.image != VK_NULL_HANDLE)
+        device->destroyImage(depth);
+      depth = device->createImage(swapchain.getExtent(), kDepthFormat, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+                                  VK_IMAGE_ASPECT_DEPTH_BIT);
+
+      // Presentation may still hold the semaphore of an image, so there is one per swapchain image.
+      for (auto semaphore : renderFinished)
+        vkDestroySemaphore(vkDevice, semaphore, nullptr);
+      renderFinished.resize(swapchain.getImageCount());
+      const VkSemaphoreCreateInfo semaphoreInfo{.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
+      for (auto& semaphore : renderFinished)
+        VK_CALL(vkCreateSemaphore(vkDevice, &semaphoreInfo, nullptr, &semaphore));
+    };
+    recreateSwapchain();
+
+    std::array<FrameData, kFramesInFlight> frames;
+    for (auto& frame : frames) {
+      frame.commandBuffer = device->allocateCommandBuffer();
+      const VkSemaphoreCreateInfo semaphoreInfo{.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
+      VK_CALL(vkCreateSemaphore(vkDevice, &semaphoreInfo, nullptr, &frame.imageAvailable));
+      const VkFenceCreateInfo fenceInfo{.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+                                        .flags = VK_FENCE_CREATE_SIGNALED_BIT};
+      VK_CALL(vkCreateFence(vkDevice, &fenceInfo, nullptr, &frame.inFlight));
+    }
+
+    uint64_t frameIndex = 0;
+    while (!glfwWindowShouldClose(window)) {
+      glfwPollEvents();
+
+      if (glfwGetKey(window, GLFW_KEY_ESCAPE)) {
+        glfwSetWindowShouldClose(window, true);
+      }
+
+      auto& frame = frames[frameIndex % kFramesInFlight];
+      VK_CALL(vkWaitForFences(vkDevice, 1, &frame.inFlight, VK_TRUE, UINT64_MAX));
+
+      uint32_t imageIndex = 0;
+      const auto acquired = vkAcquireNextImageKHR(vkDevice, swapchain.getSwapchain(), UINT64_MAX,
+                                                  frame.imageAvailable, VK_NULL_HANDLE, &imageIndex);
+      if (acquired == VK_ERROR_OUT_OF_DATE_KHR) {
+        recreateSwapchain();
+        ++resizeCount;
+        continue;
+      }
+      if (acquired != VK_SUCCESS && acquired != VK_SUBOPTIMAL_KHR) {
+        std::println("vkAcquireNextImageKHR failed with error {}", static_cast<int>(acquired));
+        return EXIT_FAILURE;
+      }
+
+      VK_CALL(vkResetFences(vkDevice, 1, &frame.inFlight));
+      VK_CALL(vkResetCommandBuffer(frame.commandBuffer, 0));
+      recordFrame(frame.commandBuffer, swapchain, imageIndex, depth, pipelines, pipelineLayout,
+                  static_cast<float>(glfwGetTime()));
+
+      const VkSemaphoreSubmitInfo waitInfo{.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+                                           .semaphore = frame.imageAvailable,
+                                           .stageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT};
+      const VkSemaphoreSubmitInfo signalInfo{.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+                                             .semaphore = renderFinished[imageIndex],
+                                             .stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT};
+      const VkCommandBufferSubmitInfo commandBufferInfo{.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO,
+                                                        .commandBuffer = frame.commandBuffer};
+      const VkSubmitInfo2 submitInfo{.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2,
+                                     .waitSemaphoreInfoCount = 1,
+                                     .pWaitSemaphoreInfos = &waitInfo,
+                                     .commandBufferInfoCount = 1,
+                                     .pCommandBufferInfos = &commandBufferInfo,
+                                     .signalSemaphoreInfoCount = 1,
+                                     .pSignalSemaphoreInfos = &signalInfo};
+      VK_CALL(vkQueueSubmit2(device->getQueue(), 1, &submitInfo, frame.inFlight));
+
+      const auto vkSwapchain = swapchain.getSwapchain();
+      const VkPresentInfoKHR presentInfo{.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
+                                         .waitSemaphoreCount = 1,
+                                         .pWaitSemaphores = &renderFinished[imageIndex],
+                                         .swapchainCount = 1,
+                                         .pSwapchains = &vkSwapchain,
+                                         .pImageIndices = &imageIndex};
+      const auto presented = vkQueuePresentKHR(device->getQueue(), &presentInfo);
+      if (presented == VK_ERROR_OUT_OF_DATE_KHR || presented == VK_SUBOPTIMAL_KHR || framebufferResized) {
+        framebufferResized = false;
+        recreateSwapchain();
+        ++resizeCount;
+      } else if (presented != VK_SUCCESS) {
+        std::println("vkQueuePresentKHR failed with error {}", static_cast<int>(presented));
+        return EXIT_FAILURE;
+      }
+
+      ++frameIndex;
+    }
+
+    vkDeviceWaitIdle(vkDevice);
+    std::println("{} frames, {} swapchain recreations, {} pipelines created", frameIndex, resizeCount,
+                 pipelines.size());
+
+    for (auto& frame : frames) {
+      vkDestroySemaphore(vkDevice, frame.imageAvailable, nullptr);
+      vkDestroyFence(vkDevice, frame.inFlight, nullptr);
+    }
+    for (auto semaphore : renderFinished)
+      vkDestroySemaphore(vkDevice, semaphore, nullptr);
+    device->destroyImage(depth);
+  }
+
+  vkDestroyPipelineLayout(vkDevice, pipelineLayout, nullptr);
+  vkDestroyShaderModule(vkDevice, fragmentShader, nullptr);
+  vkDestroyShaderModule(vkDevice, vertexShader, nullptr);
+
+  glfwTerminate();
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,1618 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <expected>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <numeric>
+#include <optional>
+#include <print>
+#include <ranges>
+#include <shared_mutex>
+#include <span>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include <glslang/Public/ResourceLimits.h>
+#include <glslang/Public/ShaderLang.h>
+#include <glslang/SPIRV/GlslangToSpv.h>
+
+namespace ranges = std::ranges;
+namespace views = std::ranges::views;
+
+#define VK_CALL(vFun)                                                                                                  \
+  {                                                                                                                    \
+    const auto res = vFun;                                                                                             \
+    if (res != VK_SUCCESS) {                                                                                           \
+      std::println(#vFun " failed with error {}", static_cast<int>(res));                                              \
+      std::exit(res);                                                                                                  \
+    }                                                                                                                  \
+  }
+
+auto getRequestedInstanceLayers() -> std::vector<std::string> {
+  return std::vector<std::string>{"VK_LAYER_KHRONOS_validation"};
+}
+
+auto getRequestedInstanceExtensions() -> std::vector<std::string> {
+  return std::vector<std::string>{
+#if defined(VK_USE_PLATFORM_METAL_EXT)
+      VK_KHR_PORTABILITY_ENUMERATION_EXTENSION_NAME,
+#endif
+#if defined(VK_EXT_debug_utils)
+      VK_EXT_DEBUG_UTILS_EXTENSION_NAME,
+#endif
+  };
+}
+
+auto getRequestedDeviceExtensions() -> std::vector<std::string> {
+  return std::vector<std::string>{
+      VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME,
+      VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME,
+  };
+}
+
+namespace VulkanCore {
+std::vector<VkLayerProperties> enumerateInstanceLayerProperties() {
+  uint32_t layersCount{0};
+  vkEnumerateInstanceLayerProperties(&layersCount, nullptr);
+
+  std::vector<VkLayerProperties> layersProperties(layersCount);
+  vkEnumerateInstanceLayerProperties(&layersCount, layersProperties.data());
+
+  return layersProperties;
+}
+
+std::vector<VkExtensionProperties> enumerateExtensionsProperties() {
+  uint32_t extensionsCount{0};
+  vkEnumerateInstanceExtensionProperties(nullptr, &extensionsCount, nullptr);
+
+  std::vector<VkExtensionProperties> extensionsProperties(extensionsCount);
+  vkEnumerateInstanceExtensionProperties(nullptr, &extensionsCount, extensionsProperties.data());
+
+  return extensionsProperties;
+}
+
+std::vector<VkExtensionProperties> enumerateDeviceExtensionsProperties(VkPhysicalDevice device) {
+  uint32_t extensionsCount{0};
+  vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionsCount, nullptr);
+
+  std::vector<VkExtensionProperties> extensionsProperties(extensionsCount);
+  vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionsCount, extensionsProperties.data());
+
+  return extensionsProperties;
+}
+
+std::vector<VkPhysicalDevice> enumeratePhysicalDevices(VkInstance instance) {
+  uint32_t physicalDevicesCount{0};
+  vkEnumeratePhysicalDevices(instance, &physicalDevicesCount, nullptr);
+
+  std::vector<VkPhysicalDevice> physicalDevices(physicalDevicesCount);
+  vkEnumeratePhysicalDevices(instance, &physicalDevicesCount, physicalDevices.data());
+
+  return physicalDevices;
+}
+
+std::vector<VkQueueFamilyProperties> enumeratePhysicalDevicesQueueFamilyProperties(VkPhysicalDevice device) {
+  uint32_t physicalDeviceQueueFamilyPropertiesCount{0};
+  vkGetPhysicalDeviceQueueFamilyProperties(device, &physicalDeviceQueueFamilyPropertiesCount, nullptr);
+
+  std::vector<VkQueueFamilyProperties> queueFamiliesProperties(physicalDeviceQueueFamilyPropertiesCount);
+  vkGetPhysicalDeviceQueueFamilyProperties(device, &physicalDeviceQueueFamilyPropertiesCount,
+                                           queueFamiliesProperties.data());
+
+  return queueFamiliesProperties;
+}
+
+class PhysicalDevice {
+public:
+  explicit PhysicalDevice(VkPhysicalDevice device)
+      : m_device{device}, m_extensions{enumerateDeviceExtensionsProperties(device)},
+        m_queueFamilies{enumeratePhysicalDevicesQueueFamilyProperties(device)} {
+    vkGetPhysicalDeviceProperties(m_device, &m_properties);
+    vkGetPhysicalDeviceMemoryProperties(m_device, &m_memoryProperties);
+  }
+
+  [[nodiscard]] inline VkPhysicalDevice getPhysicalDevice() const noexcept { return m_device; }
+
+  [[nodiscard]] inline const VkPhysicalDeviceProperties& getProperties() const noexcept { return m_properties; }
+
+  [[nodiscard]] inline const VkPhysicalDeviceMemoryProperties& getMemoryProperties() const noexcept {
+    return m_memoryProperties;
+  }
+
+  [[nodiscard]] bool isExtensionSupported(std::string_view name) const {
+    return ranges::any_of(m_extensions,
+                          [name](const VkExtensionProperties& prop) { return name == prop.extensionName; });
+  }
+
+  [[nodiscard]] std::optional<uint32_t> findQueueFamily(VkQueueFlags flags) const {
+    const auto it = ranges::find_if(m_queueFamilies, [flags](const VkQueueFamilyProperties& family) {
+      return (family.queueFlags & flags) == flags;
+    });
+    if (it == std::end(m_queueFamilies))
+      return std::nullopt;
+
+    return static_cast<uint32_t>(std::distance(std::begin(m_queueFamilies), it));
+  }
+
+  [[nodiscard]] bool supportsGraphicsPipelineLibrary() const {
+    if (!isExtensionSupported(VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME))
+      return false;
+
+    VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT libraryFeatures{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT};
+    VkPhysicalDeviceFeatures2 features{.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+                                       .pNext = &libraryFeatures};
+    vkGetPhysicalDeviceFeatures2(m_device, &features);
+    return libraryFeatures.graphicsPipelineLibrary == VK_TRUE;
+  }
+
+  // Without fast linking, linking libraries can cost as much as a full compile and must stay off the render thread.
+  [[nodiscard]] bool supportsFastLinking() const {
+    if (!isExtensionSupported(VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME))
+      return false;
+
+    VkPhysicalDeviceGraphicsPipelineLibraryPropertiesEXT libraryProperties{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_PROPERTIES_EXT};
+    VkPhysicalDeviceProperties2 properties{.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+                                           .pNext = &libraryProperties};
+    vkGetPhysicalDeviceProperties2(m_device, &properties);
+    return libraryProperties.graphicsPipelineLibraryFastLinking == VK_TRUE;
+  }
+
+private:
+  VkPhysicalDevice m_device;
+  std::vector<VkExtensionProperties> m_extensions;
+  std::vector<VkQueueFamilyProperties> m_queueFamilies;
+  VkPhysicalDeviceProperties m_properties{};
+  VkPhysicalDeviceMemoryProperties m_memoryProperties{};
+};
+
+struct ImageAllocation {
+  VkImage image = VK_NULL_HANDLE;
+  VkImageView view = VK_NULL_HANDLE;
+  VkDeviceMemory memory = VK_NULL_HANDLE;
+  VkExtent2D extent{};
+  VkFormat format = VK_FORMAT_UNDEFINED;
+};
+
+void imageBarrier(VkCommandBuffer commandBuffer, VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout,
+                  VkPipelineStageFlags2 srcStage, VkAccessFlags2 srcAccess, VkPipelineStageFlags2 dstStage,
+                  VkAccessFlags2 dstAccess) {
+  const VkImageMemoryBarrier2 barrier{.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+                                      .srcStageMask = srcStage,
+                                      .srcAccessMask = srcAccess,
+                                      .dstStageMask = dstStage,
+                                      .dstAccessMask = dstAccess,
+                                      .oldLayout = oldLayout,
+                                      .newLayout = newLayout,
+                                      .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                                      .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                                      .image = image,
+                                      .subresourceRange = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                                                           .levelCount = 1,
+                                                           .layerCount = 1}};
+  const VkDependencyInfo dependency{.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+                                    .imageMemoryBarrierCount = 1,
+                                    .pImageMemoryBarriers = &barrier};
+  vkCmdPipelineBarrier2(commandBuffer, &dependency);
+}
+
+class Device {
+public:
+  static std::expected<Device, std::string> create(const PhysicalDevice& physicalDevice,
+                                                   std::vector<std::string> requestedDeviceExtensions,
+                                                   bool useGraphicsPipelineLibrary) {
+    Device device{physicalDevice, std::move(requestedDeviceExtensions), useGraphicsPipelineLibrary};
+
+    if (device.init())
+      return device;
+    else
+      return std::unexpected(std::string{"Failed to create the vulkan device"});
+  }
+
+  ~Device() {
+    if (m_device == VK_NULL_HANDLE)
+      return;
+
+    vkDeviceWaitIdle(m_device);
+    vkDestroySemaphore(m_device, m_timeline, nullptr);
+    vkDestroyCommandPool(m_device, m_commandPool, nullptr);
+    vkDestroyDevice(m_device, nullptr);
+    m_device = VK_NULL_HANDLE;
+  }
+
+  Device& operator=(const Device&) = delete;
+
+  Device(const Device&) = delete;
+
+  Device(Device&& rhs) noexcept {
+    swap(rhs);
+    rhs.m_device = VK_NULL_HANDLE;
+  }
+
+  Device& operator=(Device&& rhs) noexcept {
+    Device tmp{std::move(rhs)};
+    swap(tmp);
+    return *this;
+  }
+
+  [[nodiscard]] inline VkDevice getDevice() const noexcept { return m_device; }
+
+  [[nodiscard]] inline bool isGraphicsPipelineLibraryEnabled() const noexcept { return m_graphicsPipelineLibrary; }
+
+  [[nodiscard]] inline bool isFastLinkingSupported() const noexcept { return m_fastLinking; }
+
+  [[nodiscard]] std::optional<uint32_t> findMemoryType(uint32_t typeBits, VkMemoryPropertyFlags required) const {
+    for (uint32_t index = 0; index < m_memoryProperties.memoryTypeCount; ++index) {
+      const auto flags = m_memoryProperties.memoryTypes[index].propertyFlags;
+      if ((typeBits & (1u << index)) && (flags & required) == required)
+        return index;
+    }
+    return std::nullopt;
+  }
+
+  ImageAllocation createImage(VkExtent2D extent, VkFormat format, VkImageUsageFlags usage) {
+    const VkImageCreateInfo imageInfo{.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+                                      .imageType = VK_IMAGE_TYPE_2D,
+                                      .format = format,
+                                      .extent = {extent.width, extent.height, 1},
+                                      .mipLevels = 1,
+                                      .arrayLayers = 1,
+                                      .samples = VK_SAMPLE_COUNT_1_BIT,
+                                      .tiling = VK_IMAGE_TILING_OPTIMAL,
+                                      .usage = usage,
+                                      .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+                                      .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED};
+    ImageAllocation allocation{.extent = extent, .format = format};
+    VK_CALL(vkCreateImage(m_device, &imageInfo, nullptr, &allocation.image));
+
+    VkMemoryRequirements requirements;
+    vkGetImageMemoryRequirements(m_device, allocation.image, &requirements);
+
+    const auto memoryTypeIndex = findMemoryType(requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    const VkMemoryAllocateInfo allocateInfo{.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+                                            .allocationSize = requirements.size,
+                                            .memoryTypeIndex = memoryTypeIndex.value_or(0)};
+    VK_CALL(vkAllocateMemory(m_device, &allocateInfo, nullptr, &allocation.memory));
+    VK_CALL(vkBindImageMemory(m_device, allocation.image, allocation.memory, 0));
+
+    const VkImageViewCreateInfo viewInfo{.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+                                         .image = allocation.image,
+                                         .viewType = VK_IMAGE_VIEW_TYPE_2D,
+                                         .format = format,
+                                         .subresourceRange = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                                                              .levelCount = 1,
+                                                              .layerCount = 1}};
+    VK_CALL(vkCreateImageView(m_device, &viewInfo, nullptr, &allocation.view));
+    return allocation;
+  }
+
+  void destroyImage(ImageAllocation& allocation) {
+    vkDestroyImageView(m_device, allocation.view, nullptr);
+    vkDestroyImage(m_device, allocation.image, nullptr);
+    vkFreeMemory(m_device, allocation.memory, nullptr);
+    allocation = ImageAllocation{};
+  }
+
+  VkCommandBuffer allocateCommandBuffer() {
+    const VkCommandBufferAllocateInfo commandBufferInfo{.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+                                                        .commandPool = m_commandPool,
+                                                        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+                                                        .commandBufferCount = 1};
+    VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+    VK_CALL(vkAllocateCommandBuffers(m_device, &commandBufferInfo, &commandBuffer));
+    return commandBuffer;
+  }
+
+  // Returns the timeline value that is signaled once the command buffer has completed.
+  uint64_t submit(VkCommandBuffer commandBuffer) {
+    const auto signalValue = ++m_timelineValue;
+
+    const VkCommandBufferSubmitInfo commandBufferInfo{.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO,
+                                                      .commandBuffer = commandBuffer};
+    const VkSemaphoreSubmitInfo signalInfo{.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+                                           .semaphore = m_timeline,
+                                           .value = signalValue,
+                                           .stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT};
+    const VkSubmitInfo2 submitInfo{.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2,
+                                   .commandBufferInfoCount = 1,
+                                   .pCommandBufferInfos = &commandBufferInfo,
+                                   .signalSemaphoreInfoCount = 1,
+                                   .pSignalSemaphoreInfos = &signalInfo};
+    VK_CALL(vkQueueSubmit2(m_queue, 1, &submitInfo, VK_NULL_HANDLE));
+    return signalValue;
+  }
+
+  void waitTimeline(uint64_t value) const {
+    const VkSemaphoreWaitInfo waitInfo{.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+                                       .semaphoreCount = 1,
+                                       .pSemaphores = &m_timeline,
+                                       .pValues = &value};
+    VK_CALL(vkWaitSemaphores(m_device, &waitInfo, UINT64_MAX));
+  }
+
+private:
+  Device(const PhysicalDevice& physicalDevice, std::vector<std::string> requestedDeviceExtensions,
+         bool useGraphicsPipelineLibrary)
+      : m_physicalDevice{physicalDevice.getPhysicalDevice()},
+        m_memoryProperties{physicalDevice.getMemoryProperties()} {
+    m_graphicsPipelineLibrary = useGraphicsPipelineLibrary && physicalDevice.supportsGraphicsPipelineLibrary();
+    m_fastLinking = m_graphicsPipelineLibrary && physicalDevice.supportsFastLinking();
+
+    const auto isLibraryExtension = [](const std::string& name) {
+      return name == VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME || name == VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME;
+    };
+    // clang-format off
+    m_enabledExtensions = requestedDeviceExtensions
+      | views::filter([&](const std::string& name) {
+          return physicalDevice.isExtensionSupported(name) && (m_graphicsPipelineLibrary || !isLibraryExtension(name));
+        })
+      | ranges::to<std::vector<std::string>>();
+    // clang-format on
+
+    if (const auto family = physicalDevice.findQueueFamily(VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))
+      m_queueFamilyIndex = family.value();
+  }
+
+  bool init() {
+    auto extensions = m_enabledExtensions | views::transform(std::mem_fn(&std::string::c_str)) |
+                      ranges::to<std::vector<const char*>>();
+
+    // pipelineCreationCacheControl is what allows probing the cache with
+    // VK_PIPELINE_CREATE_FAIL_ON_PIPELINE_COMPILE_REQUIRED_BIT.
+    VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT libraryFeatures{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT,
+        .graphicsPipelineLibrary = VK_TRUE};
+    VkPhysicalDeviceVulkan13Features features13{.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES,
+                                                .pNext = m_graphicsPipelineLibrary ? &libraryFeatures : nullptr,
+                                                .pipelineCreationCacheControl = VK_TRUE,
+                                                .synchronization2 = VK_TRUE,
+                                                .dynamicRendering = VK_TRUE};
+    VkPhysicalDeviceVulkan12Features features12{.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
+                                                .pNext = &features13,
+                                                .timelineSemaphore = VK_TRUE};
+
+    const float queuePriority = 1.0f;
+    const VkDeviceQueueCreateInfo queueInfo{.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
+                                            .queueFamilyIndex = m_queueFamilyIndex,
+                                            .queueCount = 1,
+                                            .pQueuePriorities = &queuePriority};
+
+    const VkDeviceCreateInfo deviceInfo{.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
+                                        .pNext = &features12,
+                                        .queueCreateInfoCount = 1,
+                                        .pQueueCreateInfos = &queueInfo,
+                                        .enabledExtensionCount = static_cast<uint32_t>(extensions.size()),
+                                        .ppEnabledExtensionNames = extensions.data()};
+
+    if (vkCreateDevice(m_physicalDevice, &deviceInfo, nullptr, &m_device) != VK_SUCCESS)
+      return false;
+
+    vkGetDeviceQueue(m_device, m_queueFamilyIndex, 0, &m_queue);
+
+    const VkCommandPoolCreateInfo poolInfo{.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+                                           .flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+                                           .queueFamilyIndex = m_queueFamilyIndex};
+    VK_CALL(vkCreateCommandPool(m_device, &poolInfo, nullptr, &m_commandPool));
+
+    const VkSemaphoreTypeCreateInfo timelineInfo{.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+                                                 .semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+                                                 .initialValue = 0};
+    const VkSemaphoreCreateInfo semaphoreInfo{.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+                                              .pNext = &timelineInfo};
+    VK_CALL(vkCreateSemaphore(m_device, &semaphoreInfo, nullptr, &m_timeline));
+
+    return true;
+  }
+
+  void swap(Device& rhs) {
+    std::swap(m_physicalDevice, rhs.m_physicalDevice);
+    std::swap(m_memoryProperties, rhs.m_memoryProperties);
+    std::swap(m_enabledExtensions, rhs.m_enabledExtensions);
+    std::swap(m_graphicsPipelineLibrary, rhs.m_graphicsPipelineLibrary);
+    std::swap(m_fastLinking, rhs.m_fastLinking);
+    std::swap(m_queueFamilyIndex, rhs.m_queueFamilyIndex);
+    std::swap(m_device, rhs.m_device);
+    std::swap(m_queue, rhs.m_queue);
+    std::swap(m_commandPool, rhs.m_commandPool);
+    std::swap(m_timeline, rhs.m_timeline);
+    std::swap(m_timelineValue, rhs.m_timelineValue);
+  }
+
+private:
+  VkPhysicalDevice m_physicalDevice = VK_NULL_HANDLE;
+  VkPhysicalDeviceMemoryProperties m_memoryProperties{};
+  std::vector<std::string> m_enabledExtensions;
+  bool m_graphicsPipelineLibrary = false;
+  bool m_fastLinking = false;
+  uint32_t m_queueFamilyIndex = 0;
+  VkDevice m_device = VK_NULL_HANDLE;
+  VkQueue m_queue = VK_NULL_HANDLE;
+  VkCommandPool m_commandPool = VK_NULL_HANDLE;
+  VkSemaphore m_timeline = VK_NULL_HANDLE;
+  uint64_t m_timelineValue = 0;
+};
+
+class ShaderCompiler {
+public:
+  ShaderCompiler() { glslang::InitializeProcess(); }
+
+  ShaderCompiler(const ShaderCompiler&) = delete;
+  ShaderCompiler& operator=(const ShaderCompiler&) = delete;
+
+  ~ShaderCompiler() { glslang::FinalizeProcess(); }
+
+  std::expected<std::vector<uint32_t>, std::string> compile(std::string_view source,
+                                                            VkShaderStageFlagBits stage) const {
+    const auto language = toLanguage(stage);
+
+    glslang::TShader shader{language};
+    const char* sources[] = {source.data()};
+    const int lengths[] = {static_cast<int>(source.size())};
+    shader.setStringsWithLengths(sources, lengths, 1);
+    shader.setEnvInput(glslang::EShSourceGlsl, language, glslang::EShClientVulkan, 100);
+    shader.setEnvClient(glslang::EShClientVulkan, glslang::EShTargetVulkan_1_3);
+    shader.setEnvTarget(glslang::EShTargetSpv, glslang::EShTargetSpv_1_6);
+
+    const auto messages = static_cast<EShMessages>(EShMsgSpvRules | EShMsgVulkanRules);
+    if (!shader.parse(GetDefaultResources(), 460, false, messages))
+      return std::unexpected(std::string{shader.getInfoLog()});
+
+    glslang::TProgram program;
+    program.addShader(&shader);
+    if (!program.link(messages))
+      return std::unexpected(std::string{program.getInfoLog()});
+
+    std::vector<uint32_t> spirv;
+    glslang::GlslangToSpv(*program.getIntermediate(language), spirv);
+    return spirv;
+  }
+
+private:
+  static EShLanguage toLanguage(VkShaderStageFlagBits stage) {
+    switch (stage) {
+    case VK_SHADER_STAGE_VERTEX_BIT:
+      return EShLangVertex;
+    case VK_SHADER_STAGE_FRAGMENT_BIT:
+      return EShLangFragment;
+    case VK_SHADER_STAGE_COMPUTE_BIT:
+      return EShLangCompute;
+    default:
+      return EShLangVertex;
+    }
+  }
+};
+
+VkShaderModule createShaderModule(VkDevice device, std::span<const uint32_t> spirv) {
+  const VkShaderModuleCreateInfo moduleInfo{.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+                                            .codeSize = spirv.size_bytes(),
+                                            .pCode = spirv.data()};
+  VkShaderModule module = VK_NULL_HANDLE;
+  VK_CALL(vkCreateShaderModule(device, &moduleInfo, nullptr, &module));
+  return module;
+}
+
+// FNV-1a over the bytes of every field. Fields are added one by one so that struct padding never reaches the hash.
+class StateHasher {
+public:
+  template <typename T>
+    requires std::is_trivially_copyable_v<T>
+  void add(const T& value) noexcept {
+    for (const auto byte : std::as_bytes(std::span{&value, 1})) {
+      m_hash ^= static_cast<uint64_t>(byte);
+      m_hash *= 0x100000001b3ull;
+    }
+  }
+
+  [[nodiscard]] uint64_t value() const noexcept { return m_hash; }
+
+private:
+  uint64_t m_hash = 0xcbf29ce484222325ull;
+};
+
+template <typename State>
+struct StateHash {
+  size_t operator()(const State& state) const noexcept {
+    StateHasher hasher;
+    state.hash(hasher);
+    return static_cast<size_t>(hasher.value());
+  }
+};
+
+// Specialization constants with the ids 0 to count - 1.
+struct SpecializationConstants {
+  static constexpr uint32_t kMaxConstants = 4;
+
+  std::array<uint32_t, kMaxConstants> values{};
+  uint32_t count = 0;
+
+  bool operator==(const SpecializationConstants& rhs) const {
+    return count == rhs.count && ranges::equal(values | views::take(count), rhs.values | views::take(count));
+  }
+
+  void hash(StateHasher& hasher) const {
+    hasher.add(count);
+    ranges::for_each(values | views::take(count), [&hasher](uint32_t value) { hasher.add(value); });
+  }
+};
+
+struct AttachmentFormats {
+  static constexpr uint32_t kMaxColorAttachments = 4;
+
+  std::array<VkFormat, kMaxColorAttachments> colorFormats{};
+  uint32_t colorAttachmentCount = 0;
+  VkFormat depthFormat = VK_FORMAT_UNDEFINED;
+  VkFormat stencilFormat = VK_FORMAT_UNDEFINED;
+
+  bool operator==(const AttachmentFormats&) const = default;
+
+  void hash(StateHasher& hasher) const {
+    hasher.add(colorAttachmentCount);
+    ranges::for_each(colorFormats | views::take(colorAttachmentCount),
+                     [&hasher](VkFormat format) { hasher.add(format); });
+    hasher.add(depthFormat);
+    hasher.add(stencilFormat);
+  }
+};
+
+// Applied to every color attachment.
+struct BlendState {
+  VkBool32 enable = VK_FALSE;
+  VkBlendFactor srcFactor = VK_BLEND_FACTOR_ONE;
+  VkBlendFactor dstFactor = VK_BLEND_FACTOR_ZERO;
+  VkBlendOp op = VK_BLEND_OP_ADD;
+  VkColorComponentFlags writeMask =
+      VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+
+  bool operator==(const BlendState&) const = default;
+
+  void hash(StateHasher& hasher) const {
+    hasher.add(enable);
+    hasher.add(srcFactor);
+    hasher.add(dstFactor);
+    hasher.add(op);
+    hasher.add(writeMask);
+  }
+};
+
+// The graphics state is split the way VK_EXT_graphics_pipeline_library splits a pipeline, so that each part can be
+// compiled into a library once and shared by every pipeline that uses it. Both shader parts must use the same
+// layout, as the libraries are not created with independent descriptor sets.
+struct VertexInputState {
+  VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+  bool operator==(const VertexInputState&) const = default;
+
+  void hash(StateHasher& hasher) const { hasher.add(topology); }
+};
+
+struct PreRasterizationState {
+  VkPipelineLayout layout = VK_NULL_HANDLE;
+  VkShaderModule vertexShader = VK_NULL_HANDLE;
+  SpecializationConstants constants;
+  VkPolygonMode polygonMode = VK_POLYGON_MODE_FILL;
+  VkCullModeFlags cullMode = VK_CULL_MODE_NONE;
+  VkFrontFace frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+
+  bool operator==(const PreRasterizationState&) const = default;
+
+  void hash(StateHasher& hasher) const {
+    hasher.add(layout);
+    hasher.add(vertexShader);
+    constants.hash(hasher);
+    hasher.add(polygonMode);
+    hasher.add(cullMode);
+    hasher.add(frontFace);
+  }
+};
+
+struct FragmentShaderState {
+  VkPipelineLayout layout = VK_NULL_HANDLE;
+  VkShaderModule fragmentShader = VK_NULL_HANDLE;
+  SpecializationConstants constants;
+  VkBool32 depthTestEnable = VK_FALSE;
+  VkBool32 depthWriteEnable = VK_FALSE;
+  VkCompareOp depthCompareOp = VK_COMPARE_OP_LESS;
+
+  bool operator==(const FragmentShaderState&) const = default;
+
+  void hash(StateHasher& hasher) const {
+    hasher.add(layout);
+    hasher.add(fragmentShader);
+    constants.hash(hasher);
+    hasher.add(depthTestEnable);
+    hasher.add(depthWriteEnable);
+    hasher.add(depthCompareOp);
+  }
+};
+
+struct FragmentOutputState {
+  AttachmentFormats formats;
+  BlendState blend;
+  VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+
+  bool operator==(const FragmentOutputState&) const = default;
+
+  void hash(StateHasher& hasher) const {
+    formats.hash(hasher);
+    blend.hash(hasher);
+    hasher.add(samples);
+  }
+};
+
+struct GraphicsPipelineState {
+  VertexInputState vertexInput;
+  PreRasterizationState preRasterization;
+  FragmentShaderState fragmentShader;
+  FragmentOutputState fragmentOutput;
+
+  bool operator==(const GraphicsPipelineState&) const = default;
+
+  void hash(StateHasher& hasher) const {
+    vertexInput.hash(hasher);
+    preRasterization.hash(hasher);
+    fragmentShader.hash(hasher);
+    fragmentOutput.hash(hasher);
+  }
+};
+
+struct ComputePipelineState {
+  VkPipelineLayout layout = VK_NULL_HANDLE;
+  VkShaderModule shader = VK_NULL_HANDLE;
+  SpecializationConstants constants;
+
+  bool operator==(const ComputePipelineState&) const = default;
+
+  void hash(StateHasher& hasher) const {
+    hasher.add(layout);
+    hasher.add(shader);
+    constants.hash(hasher);
+  }
+};
+
+// Points into the constants it was built from, which must outlive it.
+struct SpecializationInfo {
+  explicit SpecializationInfo(const SpecializationConstants& constants) {
+    constexpr auto kSize = static_cast<uint32_t>(sizeof(uint32_t));
+    for (uint32_t index = 0; index < constants.count; ++index)
+      entries[index] = {.constantID = index, .offset = index * kSize, .size = kSize};
+    info = {.mapEntryCount = constants.count,
+            .pMapEntries = entries.data(),
+            .dataSize = constants.count * kSize,
+            .pData = constants.values.data()};
+  }
+
+  SpecializationInfo(const SpecializationInfo&) = delete;
+  SpecializationInfo& operator=(const SpecializationInfo&) = delete;
+
+  std::array<VkSpecializationMapEntry, SpecializationConstants::kMaxConstants> entries{};
+  VkSpecializationInfo info{};
+};
+
+constexpr std::array kDynamicStates{VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+
+// Expands a state into the create info structures of a complete pipeline or of one of its libraries, so that both
+// paths describe exactly the same pipeline. Refers to the state, which must outlive it.
+class GraphicsPipelineDescription {
+public:
+  explicit GraphicsPipelineDescription(const GraphicsPipelineState& state)
+      : m_state{state}, m_vertexSpecialization{state.preRasterization.constants},
+        m_fragmentSpecialization{state.fragmentShader.constants} {
+    m_stages = {
+        VkPipelineShaderStageCreateInfo{.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+                                        .stage = VK_SHADER_STAGE_VERTEX_BIT,
+                                        .module = state.preRasterization.vertexShader,
+                                        .pName = "main",
+                                        .pSpecializationInfo = &m_vertexSpecialization.info},
+        VkPipelineShaderStageCreateInfo{.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+                                        .stage = VK_SHADER_STAGE_FRAGMENT_BIT,
+                                        .module = state.fragmentShader.fragmentShader,
+                                        .pName = "main",
+                                        .pSpecializationInfo = &m_fragmentSpecialization.info},
+    };
+
+    m_inputAssembly.topology = state.vertexInput.topology;
+
+    m_rasterization.polygonMode = state.preRasterization.polygonMode;
+    m_rasterization.cullMode = state.preRasterization.cullMode;
+    m_rasterization.frontFace = state.preRasterization.frontFace;
+
+    m_depthStencil.depthTestEnable = state.fragmentShader.depthTestEnable;
+    m_depthStencil.depthWriteEnable = state.fragmentShader.depthWriteEnable;
+    m_depthStencil.depthCompareOp = state.fragmentShader.depthCompareOp;
+
+    const auto& output = state.fragmentOutput;
+    m_multisample.rasterizationSamples = output.samples;
+    for (auto& attachment : m_blendAttachments)
+      attachment = {.blendEnable = output.blend.enable,
+                    .srcColorBlendFactor = output.blend.srcFactor,
+                    .dstColorBlendFactor = output.blend.dstFactor,
+                    .colorBlendOp = output.blend.op,
+                    .srcAlphaBlendFactor = output.blend.srcFactor,
+                    .dstAlphaBlendFactor = output.blend.dstFactor,
+                    .alphaBlendOp = output.blend.op,
+                    .colorWriteMask = output.blend.writeMask};
+    m_colorBlend.attachmentCount = output.formats.colorAttachmentCount;
+
+    m_rendering.colorAttachmentCount = output.formats.colorAttachmentCount;
+    m_rendering.pColorAttachmentFormats = output.formats.colorFormats.data();
+    m_rendering.depthAttachmentFormat = output.formats.depthFormat;
+    m_rendering.stencilAttachmentFormat = output.formats.stencilFormat;
+  }
+
+  GraphicsPipelineDescription(const GraphicsPipelineDescription&) = delete;
+  GraphicsPipelineDescription& operator=(const GraphicsPipelineDescription&) = delete;
+
+  [[nodiscard]] VkGraphicsPipelineCreateInfo pipeline(VkPipelineCreateFlags flags) const {
+    return VkGraphicsPipelineCreateInfo{.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+                                        .pNext = &m_rendering,
+                                        .flags = flags,
+                                        .stageCount = static_cast<uint32_t>(m_stages.size()),
+                                        .pStages = m_stages.data(),
+                                        .pVertexInputState = &m_vertexInput,
+                                        .pInputAssemblyState = &m_inputAssembly,
+                                        .pViewportState = &m_viewport,
+                                        .pRasterizationState = &m_rasterization,
+                                        .pMultisampleState = &m_multisample,
+                                        .pDepthStencilState = &m_depthStencil,
+                                        .pColorBlendState = &m_colorBlend,
+                                        .pDynamicState = &m_dynamicState,
+                                        .layout = m_state.preRasterization.layout};
+  }
+
+  // Only the structures that belong to the given part are referenced. The returned info points into this object and
+  // is only valid until the next call.
+  [[nodiscard]] VkGraphicsPipelineCreateInfo library(VkGraphicsPipelineLibraryFlagBitsEXT part,
+                                                     VkPipelineCreateFlags flags) {
+    m_libraryInfo = {.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_LIBRARY_CREATE_INFO_EXT,
+                     .pNext = part == VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT ? &m_rendering
+                                                                                                     : nullptr,
+                     .flags = static_cast<VkGraphicsPipelineLibraryFlagsEXT>(part)};
+
+    VkGraphicsPipelineCreateInfo createInfo{.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+                                            .pNext = &m_libraryInfo,
+                                            .flags = flags | VK_PIPELINE_CREATE_LIBRARY_BIT_KHR};
+    switch (part) {
+    case VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT:
+      createInfo.pVertexInputState = &m_vertexInput;
+      createInfo.pInputAssemblyState = &m_inputAssembly;
+      break;
+    case VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT:
+      createInfo.stageCount = 1;
+      createInfo.pStages = &m_stages[0];
+      createInfo.pViewportState = &m_viewport;
+      createInfo.pRasterizationState = &m_rasterization;
+      createInfo.pDynamicState = &m_dynamicState;
+      createInfo.layout = m_state.preRasterization.layout;
+      break;
+    case VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT:
+      createInfo.stageCount = 1;
+      createInfo.pStages = &m_stages[1];
+      createInfo.pDepthStencilState = &m_depthStencil;
+      createInfo.layout = m_state.fragmentShader.layout;
+      break;
+    case VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT:
+      createInfo.pMultisampleState = &m_multisample;
+      createInfo.pColorBlendState = &m_colorBlend;
+      break;
+    default:
+      break;
+    }
+    return createInfo;
+  }
+
+private:
+  const GraphicsPipelineState& m_state;
+  SpecializationInfo m_vertexSpecialization;
+  SpecializationInfo m_fragmentSpecialization;
+  std::array<VkPipelineShaderStageCreateInfo, 2> m_stages{};
+  VkPipelineVertexInputStateCreateInfo m_vertexInput{.sType =
+                                                         VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO};
+  VkPipelineInputAssemblyStateCreateInfo m_inputAssembly{
+      .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO};
+  VkPipelineViewportStateCreateInfo m_viewport{.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
+                                               .viewportCount = 1,
+                                               .scissorCount = 1};
+  VkPipelineRasterizationStateCreateInfo m_rasterization{
+      .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO, .lineWidth = 1.0f};
+  VkPipelineMultisampleStateCreateInfo m_multisample{.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO};
+  VkPipelineDepthStencilStateCreateInfo m_depthStencil{
+      .sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO};
+  std::array<VkPipelineColorBlendAttachmentState, AttachmentFormats::kMaxColorAttachments> m_blendAttachments{};
+  VkPipelineColorBlendStateCreateInfo m_colorBlend{.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
+                                                   .pAttachments = m_blendAttachments.data()};
+  VkPipelineDynamicStateCreateInfo m_dynamicState{.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
+                                                  .dynamicStateCount = static_cast<uint32_t>(kDynamicStates.size()),
+                                                  .pDynamicStates = kDynamicStates.data()};
+  VkPipelineRenderingCreateInfo m_rendering{.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO};
+  VkGraphicsPipelineLibraryCreateInfoEXT m_libraryInfo{};
+};
+
+struct PipelineStatistics {
+  std::atomic<uint32_t> requests{0};
+  std::atomic<uint32_t> fallbacks{0};
+  std::atomic<uint32_t> probeHits{0};
+  std::atomic<uint32_t> fastLinks{0};
+  std::atomic<uint32_t> backgroundCompiles{0};
+  std::atomic<uint32_t> libraries{0};
+};
+
+// Deduplicates pipelines by their full state and keeps compilation off the calling thread. On a miss the pipeline
+// cache is probed first. With graphics pipeline libraries a pipeline whose parts are all compiled already is linked
+// right away, otherwise the state goes to the compile threads and the caller draws with its fallback until the
+// pipeline is ready. Linked pipelines are replaced by link time optimized ones in the background.
+class PipelineManager {
+public:
+  PipelineManager(Device& device, uint32_t threadCount, uint32_t framesInFlight, std::string cachePath)
+      : m_device{device}, m_framesInFlight{framesInFlight}, m_cachePath{std::move(cachePath)} {
+    std::vector<char> cacheData;
+    if (std::ifstream file{m_cachePath, std::ios::binary}; file)
+      cacheData.assign(std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{});
+
+    // The driver checks the header and silently starts empty if the data comes from another device or driver.
+    const VkPipelineCacheCreateInfo cacheInfo{.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+                                              .initialDataSize = cacheData.size(),
+                                              .pInitialData = cacheData.data()};
+    VK_CALL(vkCreatePipelineCache(m_device.getDevice(), &cacheInfo, nullptr, &m_pipelineCache));
+
+    for (uint32_t index = 0; index < threadCount; ++index)
+      m_workers.emplace_back([this](std::stop_token stopToken) { workerLoop(stopToken); });
+  }
+
+  PipelineManager(const PipelineManager&) = delete;
+  PipelineManager& operator=(const PipelineManager&) = delete;
+
+  ~PipelineManager() {
+    for (auto& worker : m_workers)
+      worker.request_stop();
+    m_queueChanged.notify_all();
+    m_workers.clear();
+
+    const auto device = m_device.getDevice();
+    for (const auto& [state, entry] : m_graphicsPipelines)
+      vkDestroyPipeline(device, entry.pipeline, nullptr);
+    for (const auto& [state, entry] : m_computePipelines)
+      vkDestroyPipeline(device, entry.pipeline, nullptr);
+    for (const auto& retired : m_retired)
+      vkDestroyPipeline(device, retired.pipeline, nullptr);
+    destroyLibraries(m_vertexInputLibraries);
+    destroyLibraries(m_preRasterizationLibraries);
+    destroyLibraries(m_fragmentShaderLibraries);
+    destroyLibraries(m_fragmentOutputLibraries);
+
+    size_t cacheSize = 0;
+    VK_CALL(vkGetPipelineCacheData(device, m_pipelineCache, &cacheSize, nullptr));
+    std::vector<char> cacheData(cacheSize);
+    VK_CALL(vkGetPipelineCacheData(device, m_pipelineCache, &cacheSize, cacheData.data()));
+    if (std::ofstream file{m_cachePath, std::ios::binary}; file)
+      file.write(cacheData.data(), static_cast<std::streamsize>(cacheSize));
+
+    vkDestroyPipelineCache(device, m_pipelineCache, nullptr);
+  }
+
+  // Never compiles, returns the fallback until the pipeline for the state is ready.
+  VkPipeline get(const GraphicsPipelineState& state, VkPipeline fallback) {
+    return get(m_graphicsPipelines, state, fallback);
+  }
+
+  VkPipeline get(const ComputePipelineState& state, VkPipeline fallback) {
+    return get(m_computePipelines, state, fallback);
+  }
+
+  // Compiles on the calling thread if needed, meant for the fallbacks themselves and for loading screens.
+  VkPipeline getBlocking(const GraphicsPipelineState& state) {
+    {
+      std::shared_lock lock{m_pipelineMutex};
+      if (const auto it = m_graphicsPipelines.find(state); it != std::end(m_graphicsPipelines) && it->second.final)
+        return it->second.pipeline;
+    }
+
+    publish(m_graphicsPipelines, state, create(state, 0), true);
+
+    std::shared_lock lock{m_pipelineMutex};
+    return m_graphicsPipelines.at(state).pipeline;
+  }
+
+  [[nodiscard]] bool isReady(const GraphicsPipelineState& state) const {
+    std::shared_lock lock{m_pipelineMutex};
+    const auto it = m_graphicsPipelines.find(state);
+    return it != std::end(m_graphicsPipelines) && it->second.pipeline != VK_NULL_HANDLE;
+  }
+
+  // Called once per frame after waiting for the oldest frame in flight, destroys the pipelines that were replaced
+  // while that frame was recorded.
+  void nextFrame() {
+    std::unique_lock lock{m_pipelineMutex};
+    ++m_frame;
+
+    const auto expired = ranges::partition(m_retired, [this](const RetiredPipeline& retired) {
+      return retired.frame + m_framesInFlight > m_frame;
+    });
+    for (const auto& retired : expired)
+      vkDestroyPipeline(m_device.getDevice(), retired.pipeline, nullptr);
+    m_retired.erase(std::begin(expired), std::end(expired));
+  }
+
+  // Blocks until every queued compile has finished.
+  void waitIdle() {
+    std::unique_lock lock{m_queueMutex};
+    m_queueChanged.wait(lock, [this] { return m_jobs.empty() && m_activeJobs == 0; });
+  }
+
+  [[nodiscard]] size_t size() const {
+    std::shared_lock lock{m_pipelineMutex};
+    return m_graphicsPipelines.size() + m_computePipelines.size();
+  }
+
+  [[nodiscard]] inline const PipelineStatistics& statistics() const noexcept { return m_statistics; }
+
+private:
+  struct Entry {
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    // False while a quickly linked pipeline waits for its optimized replacement.
+    bool final = false;
+  };
+
+  struct RetiredPipeline {
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    uint64_t frame = 0;
+  };
+
+  using Job = std::variant<GraphicsPipelineState, ComputePipelineState>;
+  using Libraries = std::array<VkPipeline, 4>;
+
+  template <typename State>
+  using PipelineMap = std::unordered_map<State, Entry, StateHash<State>>;
+
+  template <typename State>
+  using LibraryMap = std::unordered_map<State, VkPipeline, StateHash<State>>;
+
+  template <typename State>
+  VkPipeline get(PipelineMap<State>& pipelines, const State& state, VkPipeline fallback) {
+    ++m_statistics.requests;
+    const auto readyOrFallback = [this, fallback](VkPipeline pipeline) {
+      if (pipeline != VK_NULL_HANDLE)
+        return pipeline;
+      ++m_statistics.fallbacks;
+      return fallback;
+    };
+
+    {
+      std::shared_lock lock{m_pipelineMutex};
+      if (const auto it = pipelines.find(state); it != std::end(pipelines))
+        return readyOrFallback(it->second.pipeline);
+    }
+    {
+      // Another thread may have registered the state in between the two locks.
+      std::unique_lock lock{m_pipelineMutex};
+      if (const auto [it, inserted] = pipelines.try_emplace(state); !inserted)
+        return readyOrFallback(it->second.pipeline);
+    }
+
+    // Costs a hash of the shaders and a cache lookup, cheap enough for the render thread.
+    if (const auto pipeline = create(state, VK_PIPELINE_CREATE_FAIL_ON_PIPELINE_COMPILE_REQUIRED_BIT)) {
+      ++m_statistics.probeHits;
+      publish(pipelines, state, pipeline, true);
+      return pipeline;
+    }
+
+    if constexpr (std::is_same_v<State, GraphicsPipelineState>) {
+      if (m_device.isFastLinkingSupported()) {
+        if (const auto libraries = findLibraries(state)) {
+          ++m_statistics.fastLinks;
+          const auto pipeline = link(state, libraries.value(), false);
+          publish(pipelines, state, pipeline, false);
+          enqueue(state);
+          return pipeline;
+        }
+      }
+    }
+
+    enqueue(state);
+    return readyOrFallback(VK_NULL_HANDLE);
+  }
+
+  template <typename State>
+  void publish(PipelineMap<State>& pipelines, const State& state, VkPipeline pipeline, bool final) {
+    std::unique_lock lock{m_pipelineMutex};
+    auto& entry = pipelines[state];
+    // A blocking request compiled the final pipeline first, nobody has seen this one.
+    if (entry.final) {
+      vkDestroyPipeline(m_device.getDevice(), pipeline, nullptr);
+      return;
+    }
+
+    if (entry.pipeline != VK_NULL_HANDLE)
+      m_retired.push_back({.pipeline = entry.pipeline, .frame = m_frame});
+    entry = Entry{.pipeline = pipeline, .final = final};
+  }
+
+  void enqueue(Job job) {
+    {
+      std::lock_guard lock{m_queueMutex};
+      m_jobs.push_back(std::move(job));
+    }
+    m_queueChanged.notify_all();
+  }
+
+  void workerLoop(std::stop_token stopToken) {
+    while (true) {
+      Job job;
+      {
+        std::unique_lock lock{m_queueMutex};
+        if (!m_queueChanged.wait(lock, stopToken, [this] { return !m_jobs.empty(); }))
+          return;
+
+        job = std::move(m_jobs.front());
+        m_jobs.pop_front();
+        ++m_activeJobs;
+      }
+
+      std::visit([this](const auto& state) { compile(state); }, job);
+      ++m_statistics.backgroundCompiles;
+
+      {
+        std::lock_guard lock{m_queueMutex};
+        --m_activeJobs;
+      }
+      m_queueChanged.notify_all();
+    }
+  }
+
+  void compile(const GraphicsPipelineState& state) {
+    if (!m_device.isGraphicsPipelineLibraryEnabled()) {
+      publish(m_graphicsPipelines, state, create(state, 0), true);
+      return;
+    }
+
+    // The unoptimized link replaces the fallback as early as possible, the optimized one replaces the link.
+    const auto libraries = createLibraries(state);
+    if (!isReady(state)) {
+      ++m_statistics.fastLinks;
+      publish(m_graphicsPipelines, state, link(state, libraries, false), false);
+    }
+    publish(m_graphicsPipelines, state, link(state, libraries, true), true);
+  }
+
+  void compile(const ComputePipelineState& state) { publish(m_computePipelines, state, create(state, 0), true); }
+
+  // Returns VK_NULL_HANDLE when a probe misses the cache.
+  VkPipeline create(const GraphicsPipelineState& state, VkPipelineCreateFlags flags) {
+    const GraphicsPipelineDescription description{state};
+    const auto createInfo = description.pipeline(flags);
+
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    const auto res =
+        vkCreateGraphicsPipelines(m_device.getDevice(), m_pipelineCache, 1, &createInfo, nullptr, &pipeline);
+    return checkCreation(res, pipeline);
+  }
+
+  VkPipeline create(const ComputePipelineState& state, VkPipelineCreateFlags flags) {
+    const SpecializationInfo specialization{state.constants};
+    const VkComputePipelineCreateInfo createInfo{
+        .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+        .flags = flags,
+        .stage = {.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+                  .stage = VK_SHADER_STAGE_COMPUTE_BIT,
+                  .module = state.shader,
+                  .pName = "main",
+                  .pSpecializationInfo = &specialization.info},
+        .layout = state.layout};
+
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    const auto res =
+        vkCreateComputePipelines(m_device.getDevice(), m_pipelineCache, 1, &createInfo, nullptr, &pipeline);
+    return checkCreation(res, pipeline);
+  }
+
+  static VkPipeline checkCreation(VkResult res, VkPipeline pipeline) {
+    if (res == VK_PIPELINE_COMPILE_REQUIRED)
+      return VK_NULL_HANDLE;
+
+    if (res != VK_SUCCESS) {
+      std::println("Pipeline creation failed with error {}", static_cast<int>(res));
+      std::exit(res);
+    }
+    return pipeline;
+  }
+
+  VkPipeline link(const GraphicsPipelineState& state, const Libraries& libraries, bool optimize) {
+    const VkPipelineLibraryCreateInfoKHR libraryInfo{.sType = VK_STRUCTURE_TYPE_PIPELINE_LIBRARY_CREATE_INFO_KHR,
+                                                     .libraryCount = static_cast<uint32_t>(libraries.size()),
+                                                     .pLibraries = libraries.data()};
+    const VkGraphicsPipelineCreateInfo createInfo{
+        .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+        .pNext = &libraryInfo,
+        .flags = optimize ? VkPipelineCreateFlags{VK_PIPELINE_CREATE_LINK_TIME_OPTIMIZATION_BIT_EXT} : 0u,
+        .layout = state.preRasterization.layout};
+
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    VK_CALL(vkCreateGraphicsPipelines(m_device.getDevice(), m_pipelineCache, 1, &createInfo, nullptr, &pipeline));
+    return pipeline;
+  }
+
+  std::optional<Libraries> findLibraries(const GraphicsPipelineState& state) const {
+    std::shared_lock lock{m_libraryMutex};
+    const auto vertexInput = m_vertexInputLibraries.find(state.vertexInput);
+    const auto preRasterization = m_preRasterizationLibraries.find(state.preRasterization);
+    const auto fragmentShader = m_fragmentShaderLibraries.find(state.fragmentShader);
+    const auto fragmentOutput = m_fragmentOutputLibraries.find(state.fragmentOutput);
+    if (vertexInput == std::end(m_vertexInputLibraries) ||
+        preRasterization == std::end(m_preRasterizationLibraries) ||
+        fragmentShader == std::end(m_fragmentShaderLibraries) || fragmentOutput == std::end(m_fragmentOutputLibraries))
+      return std::nullopt;
+
+    return Libraries{vertexInput->second, preRasterization->second, fragmentShader->second, fragmentOutput->second};
+  }
+
+  Libraries createLibraries(const GraphicsPipelineState& state) {
+    GraphicsPipelineDescription description{state};
+    return Libraries{
+        getOrCreateLibrary(m_vertexInputLibraries, state.vertexInput, description,
+                           VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT),
+        getOrCreateLibrary(m_preRasterizationLibraries, state.preRasterization, description,
+                           VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT),
+        getOrCreateLibrary(m_fragmentShaderLibraries, state.fragmentShader, description,
+                           VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT),
+        getOrCreateLibrary(m_fragmentOutputLibraries, state.fragmentOutput, description,
+                           VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT),
+    };
+  }
+
+  template <typename Part>
+  VkPipeline getOrCreateLibrary(LibraryMap<Part>& libraries, const Part& part,
+                                GraphicsPipelineDescription& description, VkGraphicsPipelineLibraryFlagBitsEXT flag) {
+    {
+      std::shared_lock lock{m_libraryMutex};
+      if (const auto it = libraries.find(part); it != std::end(libraries))
+        return it->second;
+    }
+
+    // Keeping the intermediate representation is what allows the optimized link later on.
+    const auto createInfo = description.library(flag, VK_PIPELINE_CREATE_RETAIN_LINK_TIME_OPTIMIZATION_INFO_BIT_EXT);
+    VkPipeline library = VK_NULL_HANDLE;
+    VK_CALL(vkCreateGraphicsPipelines(m_device.getDevice(), m_pipelineCache, 1, &createInfo, nullptr, &library));
+
+    std::unique_lock lock{m_libraryMutex};
+    const auto [it, inserted] = libraries.try_emplace(part, library);
+    // Two compile threads raced on the same part, the first one wins.
+    if (!inserted)
+      vkDestroyPipeline(m_device.getDevice(), library, nullptr);
+    else
+      ++m_statistics.libraries;
+    return it->second;
+  }
+
+  template <typename Part>
+  void destroyLibraries(const LibraryMap<Part>& libraries) {
+    for (const auto& [part, library] : libraries)
+      vkDestroyPipeline(m_device.getDevice(), library, nullptr);
+  }
+
+private:
+  Device& m_device;
+  uint32_t m_framesInFlight;
+  std::string m_cachePath;
+  VkPipelineCache m_pipelineCache = VK_NULL_HANDLE;
+  PipelineStatistics m_statistics;
+
+  mutable std::shared_mutex m_pipelineMutex;
+  PipelineMap<GraphicsPipelineState> m_graphicsPipelines;
+  PipelineMap<ComputePipelineState> m_computePipelines;
+  std::vector<RetiredPipeline> m_retired;
+  uint64_t m_frame = 0;
+
+  mutable std::shared_mutex m_libraryMutex;
+  LibraryMap<VertexInputState> m_vertexInputLibraries;
+  LibraryMap<PreRasterizationState> m_preRasterizationLibraries;
+  LibraryMap<FragmentShaderState> m_fragmentShaderLibraries;
+  LibraryMap<FragmentOutputState> m_fragmentOutputLibraries;
+
+  std::mutex m_queueMutex;
+  std::condition_variable_any m_queueChanged;
+  std::deque<Job> m_jobs;
+  uint32_t m_activeJobs = 0;
+  std::vector<std::jthread> m_workers;
+};
+
+class Context {
+public:
+  static std::expected<Context, std::string> create(std::string_view applicationName,
+                                                    std::vector<std::string> requestedInstanceLayer,
+                                                    std::vector<std::string> requestedInstanceExtensions) {
+
+    Context context{applicationName, std::move(requestedInstanceLayer), std::move(requestedInstanceExtensions)};
+
+    if (context.init())
+      return context;
+    else
+      return std::unexpected(std::string{"Failed to init the vulkan context"});
+  }
+
+  ~Context() {
+    if (m_vulkanInstance == VK_NULL_HANDLE)
+      return;
+
+    vkDestroyInstance(m_vulkanInstance, nullptr);
+    m_vulkanInstance = VK_NULL_HANDLE;
+  }
+
+  Context& operator=(const Context&) = delete;
+
+  Context(const Context&) = delete;
+
+  Context(Context&& rhs) noexcept {
+    swap(rhs);
+    rhs.m_vulkanInstance = VK_NULL_HANDLE;
+  }
+
+  Context& operator=(Context&& rhs) noexcept {
+    Context tmp{std::move(rhs)};
+    swap(tmp);
+    return *this;
+  }
+
+  std::vector<PhysicalDevice> enumeratePhysicalDevices() {
+    // clang-format off
+    auto result = VulkanCore::enumeratePhysicalDevices(m_vulkanInstance)
+      | views::transform([](VkPhysicalDevice device) -> PhysicalDevice {
+         return PhysicalDevice{device};
+        })
+      | ranges::to<std::vector<PhysicalDevice>>();
+    // clang-format on
+    return result;
+  }
+
+private:
+  Context(std::string_view applicationName, std::vector<std::string> requestedInstanceLayer,
+          std::vector<std::string> requestedInstanceExtensions)
+      : m_applicationName{applicationName} {
+    auto allInstanceLayers = enumerateInstanceLayerProperties();
+    const auto isInstanceLayerRequired = [&requestedInstanceLayer](const VkLayerProperties& prop) {
+      auto name = std::string{prop.layerName};
+      return ranges::find(requestedInstanceLayer, name) != std::end(requestedInstanceLayer);
+    };
+    // clang-format off
+    m_layerProperties = allInstanceLayers
+      | views::filter(isInstanceLayerRequired)
+      | ranges::to<std::vector<VkLayerProperties>>();
+    // clang-format on
+
+    auto allExtensions = enumerateExtensionsProperties();
+    const auto isExtensionRequired = [&requestedInstanceExtensions](const VkExtensionProperties& prop) {
+      auto name = std::string{prop.extensionName};
+      return ranges::find(requestedInstanceExtensions, name) != std::end(requestedInstanceExtensions);
+    };
+    // clang-format off
+    m_layerExtensions = allExtensions
+      | views::filter(isExtensionRequired)
+      | ranges::to<std::vector<VkExtensionProperties>>();
+    // clang-format on
+  }
+
+  bool init() {
+    // clang-format off
+    auto layers = m_layerProperties
+      | views::transform([](const VkLayerProperties& prop) -> const char*
+        {
+          return prop.layerName;
+        })
+      | ranges::to<std::vector<const char*>>();
+
+      auto extensions = m_layerExtensions
+        | views::transform([](const VkExtensionProperties & prop) -> const char*
+          {
+            return prop.extensionName;
+          })
+        | ranges::to<std::vector<const char*>>();
+    // clang-format on
+
+    const VkApplicationInfo applicationInfo{.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO,
+                                            .pApplicationName = m_applicationName.data(),
+                                            .applicationVersion = VK_MAKE_VERSION(1, 0, 0),
+                                            .apiVersion = VK_API_VERSION_1_3};
+
+    const VkInstanceCreateInfo instanceCreateInfo{.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO,
+#if defined(VK_USE_PLATFORM_METAL_EXT)
+                                                  .flags = VK_INSTANCE_CREATE_ENUMERATE_PORTABILITY_BIT_KHR,
+#endif
+                                                  .pApplicationInfo = &applicationInfo,
+                                                  .enabledLayerCount = static_cast<uint32_t>(layers.size()),
+                                                  .ppEnabledLayerNames = layers.data(),
+                                                  .enabledExtensionCount = static_cast<uint32_t>(extensions.size()),
+                                                  .ppEnabledExtensionNames = extensions.data()};
+
+    const auto res = vkCreateInstance(&instanceCreateInfo, nullptr, &m_vulkanInstance);
+    return res == VK_SUCCESS;
+  }
+
+  void swap(Context& rhs) {
+    std::swap(m_applicationName, rhs.m_applicationName);
+    std::swap(m_layerProperties, rhs.m_layerProperties);
+    std::swap(m_layerExtensions, rhs.m_layerExtensions);
+    std::swap(m_vulkanInstance, rhs.m_vulkanInstance);
+  }
+
+private:
+  std::string m_applicationName;
+  std::vector<VkLayerProperties> m_layerProperties;
+  std::vector<VkExtensionProperties> m_layerExtensions;
+  VkInstance m_vulkanInstance = VK_NULL_HANDLE;
+};
+} // namespace VulkanCore
+
+constexpr std::string_view kVertexShader = R"(
+#version 460
+
+layout(push_constant) uniform PushConstants {
+  vec2 offset;
+  float scale;
+} pushConstants;
+
+const vec2 positions[3] = vec2[](vec2(0.0, -1.0), vec2(1.0, 1.0), vec2(-1.0, 1.0));
+
+void main() {
+  gl_Position = vec4(positions[gl_VertexIndex] * pushConstants.scale + pushConstants.offset, 0.0, 1.0);
+}
+)";
+
+constexpr std::string_view kFragmentShader = R"(
+#version 460
+
+layout(constant_id = 0) const uint kVariant = 0;
+// The loop is unrolled once specialized, which makes every variant a compile worth hiding.
+layout(constant_id = 1) const uint kIterations = 1;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+  vec3 color = vec3(float(kVariant & 7u), float((kVariant >> 3) & 7u), float((kVariant >> 6) & 7u)) / 7.0;
+  for (uint index = 0; index < kIterations; ++index)
+    color = fract(color * 1.618 + sin(gl_FragCoord.xyx * 0.01 + float(index)));
+  outColor = vec4(color, 0.75);
+}
+)";
+
+uint32_t parseArgument(std::span<char*> arguments, std::string_view name, uint32_t defaultValue) {
+  for (size_t index = 1; index + 1 < arguments.size(); ++index) {
+    if (std::string_view{arguments[index]} == name) {
+      const std::string_view value{arguments[index + 1]};
+      std::from_chars(value.data(), value.data() + value.size(), defaultValue);
+    }
+  }
+  return defaultValue;
+}
+
+bool hasArgument(std::span<char*> arguments, std::string_view name) {
+  return ranges::any_of(arguments | views::drop(1), [name](const char* argument) { return argument == name; });
+}
+
+struct PushConstants {
+  float offset[2];
+  float scale;
+};
+
+// Every variant differs in its fragment shader specialization, every other one in its blend state and every fourth
+// one in its winding, so the libraries are shared between many pipelines.
+std::vector<VulkanCore::GraphicsPipelineState> makeVariants(const VulkanCore::GraphicsPipelineState& base,
+                                                            uint32_t count) {
+  // clang-format off
+  return views::iota(0u, count)
+    | views::transform([&base](uint32_t variant) {
+        auto state = base;
+        state.fragmentShader.constants = {.values = {variant, 16 + variant % 16}, .count = 2};
+        if (variant % 2 == 1)
+          state.fragmentOutput.blend = {.enable = VK_TRUE,
+                                        .srcFactor = VK_BLEND_FACTOR_SRC_ALPHA,
+                                        .dstFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA};
+        if (variant % 4 >= 2)
+          state.preRasterization.frontFace = VK_FRONT_FACE_CLOCKWISE;
+        return state;
+      })
+    | ranges::to<std::vector<VulkanCore::GraphicsPipelineState>>();
+  // clang-format on
+}
+
+// Draws kDrawsPerFrame triangles per frame, each with its own pipeline. Two variants the manager has never seen are
+// requested every frame while the rest repeat earlier ones, the way new materials stream in while moving through a
+// level. The render thread time per frame shows whether any compile leaked onto it.
+int main(int argc, char* argv[]) {
+  constexpr VkExtent2D kExtent{512, 512};
+  constexpr VkFormat kFormat = VK_FORMAT_R8G8B8A8_UNORM;
+  constexpr uint32_t kFramesInFlight = 2;
+  constexpr uint32_t kDrawsPerFrame = 16;
+  constexpr uint32_t kNewVariantsPerFrame = 2;
+
+  const auto arguments = std::span{argv, static_cast<size_t>(argc)};
+  const auto variantCount = std::max(1u, parseArgument(arguments, "--variants", 256));
+  const auto frameCount = parseArgument(arguments, "--frames", 600);
+  const auto threadCount =
+      std::max(1u, parseArgument(arguments, "--threads", std::max(1u, std::thread::hardware_concurrency() / 2)));
+  const auto useLibrary = !hasArgument(arguments, "--no-library");
+
+  const std::string applicationName = "01-09 Pipeline manager";
+
+  auto vulkanContext =
+      VulkanCore::Context::create(applicationName, getRequestedInstanceLayers(), getRequestedInstanceExtensions());
+
+  if (!vulkanContext) {
+    std::println("Unable to create the context: {}", vulkanContext.error());
+    return EXIT_FAILURE;
+  }
+
+  auto physicalDevices = vulkanContext.value().enumeratePhysicalDevices();
+  if (physicalDevices.empty()) {
+    std::println("No physical devices found");
+    return EXIT_FAILURE;
+  }
+
+  const auto& physicalDevice = physicalDevices.front();
+  auto device = VulkanCore::Device::create(physicalDevice, getRequestedDeviceExtensions(), useLibrary);
+  if (!device) {
+    std::println("Unable to create the device: {}", device.error());
+    return EXIT_FAILURE;
+  }
+  const auto vkDevice = device->getDevice();
+  std::println("Using {}, graphics pipeline libraries {}, fast linking {}, {} compile threads",
+               physicalDevice.getProperties().deviceName,
+               device->isGraphicsPipelineLibraryEnabled() ? "enabled" : "not available",
+               device->isFastLinkingSupported() ? "supported" : "not supported", threadCount);
+
+  VulkanCore::ShaderCompiler compiler;
+  const auto vertexSpirv = compiler.compile(kVertexShader, VK_SHADER_STAGE_VERTEX_BIT);
+  const auto fragmentSpirv = compiler.compile(kFragmentShader, VK_SHADER_STAGE_FRAGMENT_BIT);
+  if (!vertexSpirv || !fragmentSpirv) {
+    std::println("Unable to compile the shaders: {}", !vertexSpirv ? vertexSpirv.error() : fragmentSpirv.error());
+    return EXIT_FAILURE;
+  }
+  const auto vertexShader = VulkanCore::createShaderModule(vkDevice, vertexSpirv.value());
+  const auto fragmentShader = VulkanCore::createShaderModule(vkDevice, fragmentSpirv.value());
+
+  const VkPushConstantRange pushConstantRange{.stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+                                              .size = sizeof(PushConstants)};
+  const VkPipelineLayoutCreateInfo layoutInfo{.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+                                              .pushConstantRangeCount = 1,
+                                              .pPushConstantRanges = &pushConstantRange};
+  VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+  VK_CALL(vkCreatePipelineLayout(vkDevice, &layoutInfo, nullptr, &pipelineLayout));
+
+  auto image = device->createImage(kExtent, kFormat, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT);
+
+  const VulkanCore::GraphicsPipelineState baseState{
+      .preRasterization = {.layout = pipelineLayout, .vertexShader = vertexShader},
+      .fragmentShader = {.layout = pipelineLayout,
+                         .fragmentShader = fragmentShader,
+                         .constants = {.values = {0, 1}, .count = 2}},
+      .fragmentOutput = {.formats = {.colorFormats = {kFormat}, .colorAttachmentCount = 1}}};
+  const auto variants = makeVariants(baseState, variantCount);
+
+  uint32_t missingPipelines = 0;
+  {
+    VulkanCore::PipelineManager pipelines{device.value(), threadCount, kFramesInFlight, "01_09_pipeline_cache.bin"};
+    const auto fallback = pipelines.getBlocking(baseState);
+
+    std::vector<VkCommandBuffer> commandBuffers(kFramesInFlight);
+    std::vector<uint64_t> timelineValues(kFramesInFlight, 0);
+    for (auto& commandBuffer : commandBuffers)
+      commandBuffer = device->allocateCommandBuffer();
+
+    std::vector<double> recordTimes;
+    recordTimes.reserve(frameCount);
+    uint32_t framesWithFallback = 0;
+
+    for (uint32_t frameIndex = 0; frameIndex < frameCount; ++frameIndex) {
+      const auto slot = frameIndex % kFramesInFlight;
+      device->waitTimeline(timelineValues[slot]);
+      pipelines.nextFrame();
+
+      const auto start = std::chrono::steady_clock::now();
+      const auto commandBuffer = commandBuffers[slot];
+      VK_CALL(vkResetCommandBuffer(commandBuffer, 0));
+      const VkCommandBufferBeginInfo beginInfo{.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+                                               .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT};
+      VK_CALL(vkBeginCommandBuffer(commandBuffer, &beginInfo));
+
+      VulkanCore::imageBarrier(commandBuffer, image.image, VK_IMAGE_LAYOUT_UNDEFINED,
+                               VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                               VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+                               VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+                               VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT);
+
+      const VkRenderingAttachmentInfo colorAttachment{.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
+                                                      .imageView = image.view,
+                                                      .imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                                                      .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+                                                      .storeOp = VK_ATTACHMENT_STORE_OP_STORE};
+      const VkRenderingInfo renderingInfo{.sType = VK_STRUCTURE_TYPE_RENDERING_INFO,
+                                          .renderArea = {.offset = {0, 0}, .extent = kExtent},
+                                          .layerCount = 1,
+                                          .colorAttachmentCount = 1,
+                                          .pColorAttachments = &colorAttachment};
+      vkCmdBeginRendering(commandBuffer, &renderingInfo);
+
+      const VkViewport viewport{.width = static_cast<float>(kExtent.width),
+                                .height = static_cast<float>(kExtent.height),
+                                .maxDepth = 1.0f};
+      const VkRect2D scissor{.offset = {0, 0}, .extent = kExtent};
+      vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+      vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+      bool usedFallback = false;
+      for (uint32_t draw = 0; draw < kDrawsPerFrame; ++draw) {
+        const auto& state = variants[(frameIndex * kNewVariantsPerFrame + draw) % variantCount];
+        const auto pipeline = pipelines.get(state, fallback);
+        usedFallback |= pipeline == fallback;
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+
+        const PushConstants pushConstants{.offset = {-0.75f + 0.5f * static_cast<float>(draw % 4),
+                                                     -0.75f + 0.5f * static_cast<float>(draw / 4)},
+                                          .scale = 0.2f};
+        vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(pushConstants),
+                           &pushConstants);
+        vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+      }
+
+      vkCmdEndRendering(commandBuffer);
+      VK_CALL(vkEndCommandBuffer(commandBuffer));
+      const auto elapsed = std::chrono::steady_clock::now() - start;
+      recordTimes.push_back(std::chrono::duration<double, std::milli>(elapsed).count());
+
+      timelineValues[slot] = device->submit(commandBuffer);
+      framesWithFallback += usedFallback ? 1 : 0;
+    }
+
+    pipelines.waitIdle();
+    vkDeviceWaitIdle(vkDevice);
+
+    // Variants are requested in order, so the first ones are the ones the frames asked for.
+    const auto requestedVariants =
+        frameCount == 0 ? 0u : std::min(variantCount, (frameCount - 1) * kNewVariantsPerFrame + kDrawsPerFrame);
+    const auto isMissing = [&pipelines](const VulkanCore::GraphicsPipelineState& state) {
+      return !pipelines.isReady(state);
+    };
+    missingPipelines = static_cast<uint32_t>(ranges::count_if(variants | views::take(requestedVariants), isMissing));
+
+    ranges::sort(recordTimes);
+    const auto average = recordTimes.empty() ? 0.0 : std::reduce(std::begin(recordTimes), std::end(recordTimes)) /
+                                                          static_cast<double>(recordTimes.size());
+    const auto percentile = [&recordTimes](double fraction) {
+      if (recordTimes.empty())
+        return 0.0;
+      return recordTimes[static_cast<size_t>(fraction * static_cast<double>(recordTimes.size() - 1))];
+    };
+    std::println("{} frames recorded: average {:.3f}ms, p99 {:.3f}ms, max {:.3f}ms, {} frames drew with a fallback",
+                 frameCount, average, percentile(0.99), percentile(1.0), framesWithFallback);
+
+    const auto& statistics = pipelines.statistics();
+    std::println("{} pipeline requests for {} unique pipelines: {} fallbacks, {} cache probe hits, {} fast links, "
+                 "{} background compiles, {} libraries",
+                 statistics.requests.load(), pipelines.size(), statistics.fallbacks.load(),
+                 statistics.probeHits.load(), statistics.fastLinks.load(), statistics.backgroundCompiles.load(),
+                 statistics.libraries.load());
+  }
+
+  device->destroyImage(image);
+  vkDestroyPipelineLayout(vkDevice, pipelineLayout, nullptr);
+  vkDestroyShaderModule(vkDevice, fragmentShader, nullptr);
+  vkDestroyShaderModule(vkDevice, vertexShader, nullptr);
+
+  if (missingPipelines != 0) {
+    std::println("{} pipelines were never compiled", missingPipelines);
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,1746 @@
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <expected>
+#include <functional>
+#include <iterator>
+#include <numeric>
+#include <optional>
+#include <print>
+#include <random>
+#include <ranges>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <glslang/Public/ResourceLimits.h>
+#include <glslang/Public/ShaderLang.h>
+#include <glslang/SPIRV/GlslangToSpv.h>
+
+namespace ranges = std::ranges;
+namespace views = std::ranges::views;
+
+#define VK_CALL(vFun)                                                                                                  \
+  {                                                                                                                    \
+    const auto res = vFun;                                                                                             \
+    if (res != VK_SUCCESS) {                                                                                           \
+      std::println(#vFun " failed with error {}", static_cast<int>(res));                                              \
+      std::exit(res);                                                                                                  \
+    }                                                                                                                  \
+  }
+
+auto getRequestedInstanceLayers() -> std::vector<std::string> {
+  return std::vector<std::string>{"VK_LAYER_KHRONOS_validation"};
+}
+
+auto getRequestedInstanceExtensions() -> std::vector<std::string> {
+  return std::vector<std::string>{
+#if defined(VK_USE_PLATFORM_METAL_EXT)
+      VK_KHR_PORTABILITY_ENUMERATION_EXTENSION_NAME,
+#endif
+#if defined(VK_EXT_debug_utils)
+      VK_EXT_DEBUG_UTILS_EXTENSION_NAME,
+#endif
+  };
+}
+
+// Indirect count draws are core since Vulkan 1.2, no extension is needed.
+auto getRequestedDeviceExtensions() -> std::vector<std::string> { return std::vector<std::string>{}; }
+
+namespace VulkanCore {
+std::vector<VkLayerProperties> enumerateInstanceLayerProperties() {
+  uint32_t layersCount{0};
+  vkEnumerateInstanceLayerProperties(&layersCount, nullptr);
+
+  std::vector<VkLayerProperties> layersProperties(layersCount);
+  vkEnumerateInstanceLayerProperties(&layersCount, layersProperties.data());
+
+  return layersProperties;
+}
+
+std::vector<VkExtensionProperties> enumerateExtensionsProperties() {
+  uint32_t extensionsCount{0};
+  vkEnumerateInstanceExtensionProperties(nullptr, &extensionsCount, nullptr);
+
+  std::vector<VkExtensionProperties> extensionsProperties(extensionsCount);
+  vkEnumerateInstanceExtensionProperties(nullptr, &extensionsCount, extensionsProperties.data());
+
+  return extensionsProperties;
+}
+
+std::vector<VkExtensionProperties> enumerateDeviceExtensionsProperties(VkPhysicalDevice device) {
+  uint32_t extensionsCount{0};
+  vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionsCount, nullptr);
+
+  std::vector<VkExtensionProperties> extensionsProperties(extensionsCount);
+  vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionsCount, extensionsProperties.data());
+
+  return extensionsProperties;
+}
+
+std::vector<VkPhysicalDevice> enumeratePhysicalDevices(VkInstance instance) {
+  uint32_t physicalDevicesCount{0};
+  vkEnumeratePhysicalDevices(instance, &physicalDevicesCount, nullptr);
+
+  std::vector<VkPhysicalDevice> physicalDevices(physicalDevicesCount);
+  vkEnumeratePhysicalDevices(instance, &physicalDevicesCount, physicalDevices.data());
+
+  return physicalDevices;
+}
+
+std::vector<VkQueueFamilyProperties> enumeratePhysicalDevicesQueueFamilyProperties(VkPhysicalDevice device) {
+  uint32_t physicalDeviceQueueFamilyPropertiesCount{0};
+  vkGetPhysicalDeviceQueueFamilyProperties(device, &physicalDeviceQueueFamilyPropertiesCount, nullptr);
+
+  std::vector<VkQueueFamilyProperties> queueFamiliesProperties(physicalDeviceQueueFamilyPropertiesCount);
+  vkGetPhysicalDeviceQueueFamilyProperties(device, &physicalDeviceQueueFamilyPropertiesCount,
+                                           queueFamiliesProperties.data());
+
+  return queueFamiliesProperties;
+}
+
+class PhysicalDevice {
+public:
+  explicit PhysicalDevice(VkPhysicalDevice device)
+      : m_device{device}, m_extensions{enumerateDeviceExtensionsProperties(device)},
+        m_queueFamilies{enumeratePhysicalDevicesQueueFamilyProperties(device)} {
+    vkGetPhysicalDeviceProperties(m_device, &m_properties);
+    vkGetPhysicalDeviceMemoryProperties(m_device, &m_memoryProperties);
+  }
+
+  [[nodiscard]] inline VkPhysicalDevice getPhysicalDevice() const noexcept { return m_device; }
+
+  [[nodiscard]] inline const VkPhysicalDeviceProperties& getProperties() const noexcept { return m_properties; }
+
+  [[nodiscard]] inline const VkPhysicalDeviceMemoryProperties& getMemoryProperties() const noexcept {
+    return m_memoryProperties;
+  }
+
+  [[nodiscard]] bool isExtensionSupported(std::string_view name) const {
+    return ranges::any_of(m_extensions,
+                          [name](const VkExtensionProperties& prop) { return name == prop.extensionName; });
+  }
+
+  [[nodiscard]] std::optional<uint32_t> findQueueFamily(VkQueueFlags flags) const {
+    const auto it = ranges::find_if(m_queueFamilies, [flags](const VkQueueFamilyProperties& family) {
+      return (family.queueFlags & flags) == flags;
+    });
+    if (it == std::end(m_queueFamilies))
+      return std::nullopt;
+
+    return static_cast<uint32_t>(std::distance(std::begin(m_queueFamilies), it));
+  }
+
+private:
+  VkPhysicalDevice m_device;
+  std::vector<VkExtensionProperties> m_extensions;
+  std::vector<VkQueueFamilyProperties> m_queueFamilies;
+  VkPhysicalDeviceProperties m_properties{};
+  VkPhysicalDeviceMemoryProperties m_memoryProperties{};
+};
+
+struct BufferAllocation {
+  VkBuffer buffer = VK_NULL_HANDLE;
+  VkDeviceMemory memory = VK_NULL_HANDLE;
+  VkDeviceSize size = 0;
+  // Persistently mapped when the memory is host visible.
+  void* mapped = nullptr;
+};
+
+struct ImageAllocation {
+  VkImage image = VK_NULL_HANDLE;
+  VkImageView view = VK_NULL_HANDLE;
+  VkDeviceMemory memory = VK_NULL_HANDLE;
+  VkExtent2D extent{};
+  VkFormat format = VK_FORMAT_UNDEFINED;
+  uint32_t mipLevels = 1;
+};
+
+void imageBarrier(VkCommandBuffer commandBuffer, VkImage image, VkImageAspectFlags aspect, VkImageLayout oldLayout,
+                  VkImageLayout newLayout, VkPipelineStageFlags2 srcStage, VkAccessFlags2 srcAccess,
+                  VkPipelineStageFlags2 dstStage, VkAccessFlags2 dstAccess) {
+  const VkImageMemoryBarrier2 barrier{.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+                                      .srcStageMask = srcStage,
+                                      .srcAccessMask = srcAccess,
+                                      .dstStageMask = dstStage,
+                                      .dstAccessMask = dstAccess,
+                                      .oldLayout = oldLayout,
+                                      .newLayout = newLayout,
+                                      .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                                      .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                                      .image = image,
+                                      .subresourceRange = {.aspectMask = aspect,
+                                                           .levelCount = VK_REMAINING_MIP_LEVELS,
+                                                           .layerCount = 1}};
+  const VkDependencyInfo dependency{.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+                                    .imageMemoryBarrierCount = 1,
+                                    .pImageMemoryBarriers = &barrier};
+  vkCmdPipelineBarrier2(commandBuffer, &dependency);
+}
+
+void memoryBarrier(VkCommandBuffer commandBuffer, VkPipelineStageFlags2 srcStage, VkAccessFlags2 srcAccess,
+                   VkPipelineStageFlags2 dstStage, VkAccessFlags2 dstAccess) {
+  const VkMemoryBarrier2 barrier{.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+                                 .srcStageMask = srcStage,
+                                 .srcAccessMask = srcAccess,
+                                 .dstStageMask = dstStage,
+                                 .dstAccessMask = dstAccess};
+  const VkDependencyInfo dependency{.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+                                    .memoryBarrierCount = 1,
+                                    .pMemoryBarriers = &barrier};
+  vkCmdPipelineBarrier2(commandBuffer, &dependency);
+}
+
+// Logical device with a single graphics and compute queue and the features GPU driven rendering relies on: indirect
+// draws with a count read from a buffer, and a first instance in the indirect commands.
+class Device {
+public:
+  static std::expected<Device, std::string> create(const PhysicalDevice& physicalDevice,
+                                                   std::vector<std::string> requestedDeviceExtensions) {
+    Device device{physicalDevice, std::move(requestedDeviceExtensions)};
+
+    if (device.init())
+      return device;
+    else
+      return std::unexpected(std::string{"Failed to create the vulkan device"});
+  }
+
+  ~Device() {
+    if (m_device == VK_NULL_HANDLE)
+      return;
+
+    vkDeviceWaitIdle(m_device);
+    vkDestroyFence(m_device, m_fence, nullptr);
+    vkDestroySemaphore(m_device, m_timeline, nullptr);
+    vkDestroyCommandPool(m_device, m_commandPool, nullptr);
+    vkDestroyDevice(m_device, nullptr);
+    m_device = VK_NULL_HANDLE;
+  }
+
+  Device& operator=(const Device&) = delete;
+
+  Device(const Device&) = delete;
+
+  Device(Device&& rhs) noexcept {
+    swap(rhs);
+    rhs.m_device = VK_NULL_HANDLE;
+  }
+
+  Device& operator=(Device&& rhs) noexcept {
+    Device tmp{std::move(rhs)};
+    swap(tmp);
+    return *this;
+  }
+
+  [[nodiscard]] inline VkDevice getDevice() const noexcept { return m_device; }
+
+  [[nodiscard]] inline float getTimestampPeriod() const noexcept { return m_timestampPeriod; }
+
+  [[nodiscard]] std::optional<uint32_t> findMemoryType(uint32_t typeBits, VkMemoryPropertyFlags required) const {
+    for (uint32_t index = 0; index < m_memoryProperties.memoryTypeCount; ++index) {
+      const auto flags = m_memoryProperties.memoryTypes[index].propertyFlags;
+      if ((typeBits & (1u << index)) && (flags & required) == required)
+        return index;
+    }
+    return std::nullopt;
+  }
+
+  BufferAllocation createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties) {
+    const VkBufferCreateInfo bufferInfo{.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+                                        .size = size,
+                                        .usage = usage,
+                                        .sharingMode = VK_SHARING_MODE_EXCLUSIVE};
+    BufferAllocation allocation{.size = size};
+    VK_CALL(vkCreateBuffer(m_device, &bufferInfo, nullptr, &allocation.buffer));
+
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements(m_device, allocation.buffer, &requirements);
+
+    const auto memoryTypeIndex = findMemoryType(requirements.memoryTypeBits, properties);
+    if (!memoryTypeIndex.has_value()) {
+      std::println("No memory type for a buffer of {} bytes", size);
+      std::exit(EXIT_FAILURE);
+    }
+
+    const VkMemoryAllocateInfo allocateInfo{.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+                                            .allocationSize = requirements.size,
+                                            .memoryTypeIndex = memoryTypeIndex.value()};
+    VK_CALL(vkAllocateMemory(m_device, &allocateInfo, nullptr, &allocation.memory));
+    VK_CALL(vkBindBufferMemory(m_device, allocation.buffer, allocation.memory, 0));
+
+    if (properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+      VK_CALL(vkMapMemory(m_device, allocation.memory, 0, VK_WHOLE_SIZE, 0, &allocation.mapped));
+    return allocation;
+  }
+
+  // A device local buffer filled through a staging buffer.
+  BufferAllocation createBuffer(std::span<const std::byte> contents, VkBufferUsageFlags usage) {
+    auto allocation =
+        createBuffer(contents.size(), usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    auto staging = createBuffer(contents.size(), VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    std::memcpy(staging.mapped, contents.data(), contents.size());
+
+    immediateSubmit([&](VkCommandBuffer commandBuffer) {
+      const VkBufferCopy region{.size = contents.size()};
+      vkCmdCopyBuffer(commandBuffer, staging.buffer, allocation.buffer, 1, &region);
+    });
+    destroyBuffer(staging);
+    return allocation;
+  }
+
+  void destroyBuffer(BufferAllocation& allocation) {
+    vkDestroyBuffer(m_device, allocation.buffer, nullptr);
+    vkFreeMemory(m_device, allocation.memory, nullptr);
+    allocation = BufferAllocation{};
+  }
+
+  ImageAllocation createImage(VkExtent2D extent, VkFormat format, VkImageUsageFlags usage, VkImageAspectFlags aspect,
+                              uint32_t mipLevels = 1) {
+    const VkImageCreateInfo imageInfo{.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+                                      .imageType = VK_IMAGE_TYPE_2D,
+                                      .format = format,
+                                      .extent = {extent.width, extent.height, 1},
+                                      .mipLevels = mipLevels,
+                                      .arrayLayers = 1,
+                                      .samples = VK_SAMPLE_COUNT_1_BIT,
+                                      .tiling = VK_IMAGE_TILING_OPTIMAL,
+                                      .usage = usage,
+                                      .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+                                      .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED};
+    ImageAllocation allocation{.extent = extent, .format = format, .mipLevels = mipLevels};
+    VK_CALL(vkCreateImage(m_device, &imageInfo, nullptr, &allocation.image));
+
+    VkMemoryRequirements requirements;
+    vkGetImageMemoryRequirements(m_device, allocation.image, &requirements);
+
+    const auto memoryTypeIndex = findMemoryType(requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    const VkMemoryAllocateInfo allocateInfo{.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+                                            .allocationSize = requirements.size,
+                                            .memoryTypeIndex = memoryTypeIndex.value_or(0)};
+    VK_CALL(vkAllocateMemory(m_device, &allocateInfo, nullptr, &allocation.memory));
+    VK_CALL(vkBindImageMemory(m_device, allocation.image, allocation.memory, 0));
+
+    allocation.view = createImageView(allocation.image, format, aspect, 0, mipLevels);
+    return allocation;
+  }
+
+  VkImageView createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspect, uint32_t baseMipLevel,
+                              uint32_t levelCount) {
+    const VkImageViewCreateInfo viewInfo{.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+                                         .image = image,
+                                         .viewType = VK_IMAGE_VIEW_TYPE_2D,
+                                         .format = format,
+                                         .subresourceRange = {.aspectMask = aspect,
+                                                              .baseMipLevel = baseMipLevel,
+                                                              .levelCount = levelCount,
+                                                              .layerCount = 1}};
+    VkImageView view = VK_NULL_HANDLE;
+    VK_CALL(vkCreateImageView(m_device, &viewInfo, nullptr, &view));
+    return view;
+  }
+
+  void destroyImage(ImageAllocation& allocation) {
+    vkDestroyImageView(m_device, allocation.view, nullptr);
+    vkDestroyImage(m_device, allocation.image, nullptr);
+    vkFreeMemory(m_device, allocation.memory, nullptr);
+    allocation = ImageAllocation{};
+  }
+
+  VkCommandBuffer allocateCommandBuffer() {
+    const VkCommandBufferAllocateInfo commandBufferInfo{.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+                                                        .commandPool = m_commandPool,
+                                                        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+                                                        .commandBufferCount = 1};
+    VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+    VK_CALL(vkAllocateCommandBuffers(m_device, &commandBufferInfo, &commandBuffer));
+    return commandBuffer;
+  }
+
+  template <typename Recorder>
+  void immediateSubmit(Recorder&& record) {
+    const auto commandBuffer = allocateCommandBuffer();
+
+    const VkCommandBufferBeginInfo beginInfo{.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+                                             .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT};
+    VK_CALL(vkBeginCommandBuffer(commandBuffer, &beginInfo));
+    record(commandBuffer);
+    VK_CALL(vkEndCommandBuffer(commandBuffer));
+
+    const VkSubmitInfo submitInfo{.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+                                  .commandBufferCount = 1,
+                                  .pCommandBuffers = &commandBuffer};
+    VK_CALL(vkQueueSubmit(m_queue, 1, &submitInfo, m_fence));
+    VK_CALL(vkWaitForFences(m_device, 1, &m_fence, VK_TRUE, UINT64_MAX));
+    VK_CALL(vkResetFences(m_device, 1, &m_fence));
+    vkFreeCommandBuffers(m_device, m_commandPool, 1, &commandBuffer);
+  }
+
+  // Returns the timeline value that is signaled once the command buffer has completed.
+  uint64_t submit(VkCommandBuffer commandBuffer) {
+    const auto signalValue = ++m_timelineValue;
+
+    const VkCommandBufferSubmitInfo commandBufferInfo{.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO,
+                                                      .commandBuffer = commandBuffer};
+    const VkSemaphoreSubmitInfo signalInfo{.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+                                           .semaphore = m_timeline,
+                                           .value = signalValue,
+                                           .stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT};
+    const VkSubmitInfo2 submitInfo{.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2,
+                                   .commandBufferInfoCount = 1,
+                                   .pCommandBufferInfos = &commandBufferInfo,
+                                   .signalSemaphoreInfoCount = 1,
+                                   .pSignalSemaphoreInfos = &signalInfo};
+    VK_CALL(vkQueueSubmit2(m_queue, 1, &submitInfo, VK_NULL_HANDLE));
+    return signalValue;
+  }
+
+  void waitTimeline(uint64_t value) const {
+    const VkSemaphoreWaitInfo waitInfo{.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+                                       .semaphoreCount = 1,
+                                       .pSemaphores = &m_timeline,
+                                       .pValues = &value};
+    VK_CALL(vkWaitSemaphores(m_device, &waitInfo, UINT64_MAX));
+  }
+
+private:
+  Device(const PhysicalDevice& physicalDevice, std::vector<std::string> requestedDeviceExtensions)
+      : m_physicalDevice{physicalDevice.getPhysicalDevice()},
+        m_memoryProperties{physicalDevice.getMemoryProperties()},
+        m_timestampPeriod{physicalDevice.getProperties().limits.timestampPeriod} {
+    // clang-format off
+    m_enabledExtensions = requestedDeviceExtensions
+      | views::filter([&physicalDevice](const std::string& name) {
+          return physicalDevice.isExtensionSupported(name);
+        })
+      | ranges::to<std::vector<std::string>>();
+    // clang-format on
+
+    if (const auto family = physicalDevice.findQueueFamily(VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))
+      m_queueFamilyIndex = family.value();
+  }
+
+  bool init() {
+    auto extensions = m_enabledExtensions | views::transform(std::mem_fn(&std::string::c_str)) |
+                      ranges::to<std::vector<const char*>>();
+
+    VkPhysicalDeviceVulkan13Features features13{.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES,
+                                                .synchronization2 = VK_TRUE,
+                                                .dynamicRendering = VK_TRUE};
+    VkPhysicalDeviceVulkan12Features features12{.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
+                                                .pNext = &features13,
+                                                .drawIndirectCount = VK_TRUE,
+                                                .timelineSemaphore = VK_TRUE};
+    const VkPhysicalDeviceFeatures2 features{.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+                                             .pNext = &features12,
+                                             .features = {.multiDrawIndirect = VK_TRUE,
+                                                          .drawIndirectFirstInstance = VK_TRUE}};
+
+    const float queuePriority = 1.0f;
+    const VkDeviceQueueCreateInfo queueInfo{.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
+                                            .queueFamilyIndex = m_queueFamilyIndex,
+                                            .queueCount = 1,
+                                            .pQueuePriorities = &queuePriority};
+
+    const VkDeviceCreateInfo deviceInfo{.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
+                                        .pNext = &features,
+                                        .queueCreateInfoCount = 1,
+                                        .pQueueCreateInfos = &queueInfo,
+                                        .enabledExtensionCount = static_cast<uint32_t>(extensions.size()),
+                                        .ppEnabledExtensionNames = extensions.data()};
+
+    if (vkCreateDevice(m_physicalDevice, &deviceInfo, nullptr, &m_device) != VK_SUCCESS)
+      return false;
+
+    vkGetDeviceQueue(m_device, m_queueFamilyIndex, 0, &m_queue);
+
+    const VkCommandPoolCreateInfo poolInfo{.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+                                           .flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+                                           .queueFamilyIndex = m_queueFamilyIndex};
+    VK_CALL(vkCreateCommandPool(m_device, &poolInfo, nullptr, &m_commandPool));
+
+    const VkFenceCreateInfo fenceInfo{.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
+    VK_CALL(vkCreateFence(m_device, &fenceInfo, nullptr, &m_fence));
+
+    const VkSemaphoreTypeCreateInfo timelineInfo{.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+                                                 .semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+                                                 .initialValue = 0};
+    const VkSemaphoreCreateInfo semaphoreInfo{.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+                                              .pNext = &timelineInfo};
+    VK_CALL(vkCreateSemaphore(m_device, &semaphoreInfo, nullptr, &m_timeline));
+
+    return true;
+  }
+
+  void swap(Device& rhs) {
+    std::swap(m_physicalDevice, rhs.m_physicalDevice);
+    std::swap(m_memoryProperties, rhs.m_memoryProperties);
+    std::swap(m_timestampPeriod, rhs.m_timestampPeriod);
+    std::swap(m_enabledExtensions, rhs.m_enabledExtensions);
+    std::swap(m_queueFamilyIndex, rhs.m_queueFamilyIndex);
+    std::swap(m_device, rhs.m_device);
+    std::swap(m_queue, rhs.m_queue);
+    std::swap(m_commandPool, rhs.m_commandPool);
+    std::swap(m_fence, rhs.m_fence);
+    std::swap(m_timeline, rhs.m_timeline);
+    std::swap(m_timelineValue, rhs.m_timelineValue);
+  }
+
+private:
+  VkPhysicalDevice m_physicalDevice = VK_NULL_HANDLE;
+  VkPhysicalDeviceMemoryProperties m_memoryProperties{};
+  float m_timestampPeriod = 1.0f;
+  std::vector<std::string> m_enabledExtensions;
+  uint32_t m_queueFamilyIndex = 0;
+  VkDevice m_device = VK_NULL_HANDLE;
+  VkQueue m_queue = VK_NULL_HANDLE;
+  VkCommandPool m_commandPool = VK_NULL_HANDLE;
+  VkFence m_fence = VK_NULL_HANDLE;
+  VkSemaphore m_timeline = VK_NULL_HANDLE;
+  uint64_t m_timelineValue = 0;
+};
+
+// One binding of a descriptor set, either a buffer or an image.
+struct DescriptorWrite {
+  uint32_t binding = 0;
+  VkDescriptorType type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  VkDescriptorBufferInfo buffer{};
+  VkDescriptorImageInfo image{};
+};
+
+DescriptorWrite bufferDescriptor(uint32_t binding, VkDescriptorType type, const BufferAllocation& allocation) {
+  return DescriptorWrite{.binding = binding,
+                         .type = type,
+                         .buffer = {.buffer = allocation.buffer, .offset = 0, .range = VK_WHOLE_SIZE}};
+}
+
+DescriptorWrite imageDescriptor(uint32_t binding, VkDescriptorType type, VkImageView view, VkImageLayout layout,
+                                VkSampler sampler = VK_NULL_HANDLE) {
+  return DescriptorWrite{.binding = binding,
+                         .type = type,
+                         .image = {.sampler = sampler, .imageView = view, .imageLayout = layout}};
+}
+
+void updateDescriptorSet(VkDevice device, VkDescriptorSet set, std::span<const DescriptorWrite> writes) {
+  const auto isImage = [](VkDescriptorType type) {
+    return type == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER || type == VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE ||
+           type == VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+  };
+  // clang-format off
+  const auto descriptorWrites = writes
+    | views::transform([&](const DescriptorWrite& write) {
+        return VkWriteDescriptorSet{.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                                    .dstSet = set,
+                                    .dstBinding = write.binding,
+                                    .descriptorCount = 1,
+                                    .descriptorType = write.type,
+                                    .pImageInfo = isImage(write.type) ? &write.image : nullptr,
+                                    .pBufferInfo = isImage(write.type) ? nullptr : &write.buffer};
+      })
+    | ranges::to<std::vector<VkWriteDescriptorSet>>();
+  // clang-format on
+  vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+}
+
+// Set layouts and a pool sized for a fixed number of sets of a single layout.
+class DescriptorSetAllocator {
+public:
+  DescriptorSetAllocator(VkDevice device, std::span<const VkDescriptorSetLayoutBinding> bindings, uint32_t maxSets)
+      : m_device{device} {
+    const VkDescriptorSetLayoutCreateInfo layoutInfo{.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+                                                     .bindingCount = static_cast<uint32_t>(bindings.size()),
+                                                     .pBindings = bindings.data()};
+    VK_CALL(vkCreateDescriptorSetLayout(m_device, &layoutInfo, nullptr, &m_layout));
+
+    // clang-format off
+    const auto poolSizes = bindings
+      | views::transform([maxSets](const VkDescriptorSetLayoutBinding& binding) {
+          return VkDescriptorPoolSize{.type = binding.descriptorType,
+                                      .descriptorCount = binding.descriptorCount * maxSets};
+        })
+      | ranges::to<std::vector<VkDescriptorPoolSize>>();
+    // clang-format on
+    const VkDescriptorPoolCreateInfo poolInfo{.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+                                              .maxSets = maxSets,
+                                              .poolSizeCount = static_cast<uint32_t>(poolSizes.size()),
+                                              .pPoolSizes = poolSizes.data()};
+    VK_CALL(vkCreateDescriptorPool(m_device, &poolInfo, nullptr, &m_pool));
+  }
+
+  DescriptorSetAllocator(const DescriptorSetAllocator&) = delete;
+  DescriptorSetAllocator& operator=(const DescriptorSetAllocator&) = delete;
+
+  ~DescriptorSetAllocator() {
+    vkDestroyDescriptorPool(m_device, m_pool, nullptr);
+    vkDestroyDescriptorSetLayout(m_device, m_layout, nullptr);
+  }
+
+  [[nodiscard]] inline VkDescriptorSetLayout getLayout() const noexcept { return m_layout; }
+
+  VkDescriptorSet allocate() {
+    const VkDescriptorSetAllocateInfo allocateInfo{.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+                                                   .descriptorPool = m_pool,
+                                                   .descriptorSetCount = 1,
+                                                   .pSetLayouts = &m_layout};
+    VkDescriptorSet set = VK_NULL_HANDLE;
+    VK_CALL(vkAllocateDescriptorSets(m_device, &allocateInfo, &set));
+    return set;
+  }
+
+private:
+  VkDevice m_device;
+  VkDescriptorSetLayout m_layout = VK_NULL_HANDLE;
+  VkDescriptorPool m_pool = VK_NULL_HANDLE;
+};
+
+class ShaderCompiler {
+public:
+  ShaderCompiler() { glslang::InitializeProcess(); }
+
+  ShaderCompiler(const ShaderCompiler&) = delete;
+  ShaderCompiler& operator=(const ShaderCompiler&) = delete;
+
+  ~ShaderCompiler() { glslang::FinalizeProcess(); }
+
+  std::expected<std::vector<uint32_t>, std::string> compile(std::string_view source,
+                                                            VkShaderStageFlagBits stage) const {
+    const auto language = toLanguage(stage);
+
+    glslang::TShader shader{language};
+    const char* sources[] = {source.data()};
+    const int lengths[] = {static_cast<int>(source.size())};
+    shader.setStringsWithLengths(sources, lengths, 1);
+    shader.setEnvInput(glslang::EShSourceGlsl, language, glslang::EShClientVulkan, 100);
+    shader.setEnvClient(glslang::EShClientVulkan, glslang::EShTargetVulkan_1_3);
+    shader.setEnvTarget(glslang::EShTargetSpv, glslang::EShTargetSpv_1_6);
+
+    const auto messages = static_cast<EShMessages>(EShMsgSpvRules | EShMsgVulkanRules);
+    if (!shader.parse(GetDefaultResources(), 460, false, messages))
+      return std::unexpected(std::string{shader.getInfoLog()});
+
+    glslang::TProgram program;
+    program.addShader(&shader);
+    if (!program.link(messages))
+      return std::unexpected(std::string{program.getInfoLog()});
+
+    std::vector<uint32_t> spirv;
+    glslang::GlslangToSpv(*program.getIntermediate(language), spirv);
+    return spirv;
+  }
+
+private:
+  static EShLanguage toLanguage(VkShaderStageFlagBits stage) {
+    switch (stage) {
+    case VK_SHADER_STAGE_VERTEX_BIT:
+      return EShLangVertex;
+    case VK_SHADER_STAGE_FRAGMENT_BIT:
+      return EShLangFragment;
+    case VK_SHADER_STAGE_COMPUTE_BIT:
+      return EShLangCompute;
+    default:
+      return EShLangVertex;
+    }
+  }
+};
+
+VkShaderModule createShaderModule(VkDevice device, std::span<const uint32_t> spirv) {
+  const VkShaderModuleCreateInfo moduleInfo{.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+                                            .codeSize = spirv.size_bytes(),
+                                            .pCode = spirv.data()};
+  VkShaderModule module = VK_NULL_HANDLE;
+  VK_CALL(vkCreateShaderModule(device, &moduleInfo, nullptr, &module));
+  return module;
+}
+
+struct MeshData {
+  std::vector<glm::vec4> positions;
+  std::vector<uint32_t> indices;
+};
+
+struct Instance {
+  glm::vec3 position{0.0f};
+  float scale = 1.0f;
+  uint32_t meshIndex = 0;
+};
+
+struct GpuTimings {
+  double cullMs = 0.0;
+  double drawMs = 0.0;
+  double pyramidMs = 0.0;
+};
+
+// The std430 and std140 mirrors of the structures declared in the shaders below.
+struct GpuObject {
+  glm::vec4 positionScale;
+  uint32_t meshIndex;
+  uint32_t padding[3];
+};
+static_assert(sizeof(GpuObject) == 32);
+
+struct GpuMesh {
+  uint32_t indexCount;
+  uint32_t firstIndex;
+  int32_t vertexOffset;
+  float radius;
+};
+static_assert(sizeof(GpuMesh) == 16);
+
+struct CameraData {
+  glm::mat4 viewProjection;
+  glm::mat4 previousViewProjection;
+  std::array<glm::vec4, 6> frustumPlanes;
+  glm::vec2 pyramidSize;
+  uint32_t objectCount;
+  uint32_t occlusionEnabled;
+};
+static_assert(sizeof(CameraData) == 240);
+
+constexpr std::string_view kCullShader = R"(
+#version 460
+
+layout(local_size_x = 64) in;
+
+struct Object {
+  vec4 positionScale;
+  uint meshIndex;
+};
+
+struct Mesh {
+  uint indexCount;
+  uint firstIndex;
+  int vertexOffset;
+  float radius;
+};
+
+struct DrawCommand {
+  uint indexCount;
+  uint instanceCount;
+  uint firstIndex;
+  int vertexOffset;
+  uint firstInstance;
+};
+
+layout(set = 0, binding = 0) uniform Camera {
+  mat4 viewProjection;
+  mat4 previousViewProjection;
+  vec4 frustumPlanes[6];
+  vec2 pyramidSize;
+  uint objectCount;
+  uint occlusionEnabled;
+} camera;
+
+layout(set = 0, binding = 1) readonly buffer Objects { Object objects[]; };
+layout(set = 0, binding = 2) readonly buffer Meshes { Mesh meshes[]; };
+layout(set = 0, binding = 3) writeonly buffer DrawCommands { DrawCommand drawCommands[]; };
+layout(set = 0, binding = 4) buffer DrawCount { uint drawCount; };
+layout(set = 0, binding = 5) uniform sampler2D depthPyramid;
+
+bool isInsideFrustum(vec3 center, float radius) {
+  for (int plane = 0; plane < 6; ++plane) {
+    if (dot(camera.frustumPlanes[plane].xyz, center) + camera.frustumPlanes[plane].w < -radius)
+      return false;
+  }
+  return true;
+}
+
+// The pyramid holds the depth of the previous frame, so the bounds are projected with the previous camera.
+bool isOccluded(vec3 center, float radius) {
+  vec3 minBounds = vec3(1e30);
+  vec3 maxBounds = vec3(-1e30);
+  for (int corner = 0; corner < 8; ++corner) {
+    const vec3 offset = vec3((corner & 1) != 0 ? radius : -radius, (corner & 2) != 0 ? radius : -radius,
+                             (corner & 4) != 0 ? radius : -radius);
+    const vec4 clip = camera.previousViewProjection * vec4(center + offset, 1.0);
+    // Crosses the near plane, the bounds are meaningless.
+    if (clip.w <= 0.0)
+      return false;
+    minBounds = min(minBounds, clip.xyz / clip.w);
+    maxBounds = max(maxBounds, clip.xyz / clip.w);
+  }
+
+  const vec2 uvMin = clamp(minBounds.xy * 0.5 + 0.5, 0.0, 1.0);
+  const vec2 uvMax = clamp(maxBounds.xy * 0.5 + 0.5, 0.0, 1.0);
+  const vec2 size = (uvMax - uvMin) * camera.pyramidSize;
+  // At this level the bounds cover at most two by two texels.
+  const float level = ceil(log2(max(max(size.x, size.y), 1.0)));
+
+  const float depth = max(max(textureLod(depthPyramid, uvMin, level).r,
+                              textureLod(depthPyramid, vec2(uvMax.x, uvMin.y), level).r),
+                          max(textureLod(depthPyramid, vec2(uvMin.x, uvMax.y), level).r,
+                              textureLod(depthPyramid, uvMax, level).r));
+  return minBounds.z > depth;
+}
+
+void main() {
+  const uint index = gl_GlobalInvocationID.x;
+  if (index >= camera.objectCount)
+    return;
+
+  const Object object = objects[index];
+  const Mesh mesh = meshes[object.meshIndex];
+  const vec3 center = object.positionScale.xyz;
+  const float radius = mesh.radius * object.positionScale.w;
+
+  if (!isInsideFrustum(center, radius))
+    return;
+  if (camera.occlusionEnabled != 0 && isOccluded(center, radius))
+    return;
+
+  const uint drawIndex = atomicAdd(drawCount, 1);
+  drawCommands[drawIndex] = DrawCommand(mesh.indexCount, 1, mesh.firstIndex, mesh.vertexOffset, index);
+}
+)";
+
+constexpr std::string_view kPyramidShader = R"(
+#version 460
+
+layout(local_size_x = 8, local_size_y = 8) in;
+
+layout(set = 0, binding = 0) uniform sampler2D source;
+layout(set = 0, binding = 1, r32f) uniform writeonly image2D destination;
+
+layout(push_constant) uniform PushConstants {
+  vec2 size;
+} pushConstants;
+
+void main() {
+  const uvec2 position = gl_GlobalInvocationID.xy;
+  if (any(greaterThanEqual(position, uvec2(pushConstants.size))))
+    return;
+
+  // The farthest of the source texels, so that an object is only culled when it is behind all of them.
+  const vec4 depths = textureGather(source, (vec2(position) + 0.5) / pushConstants.size, 0);
+  imageStore(destination, ivec2(position), vec4(max(max(depths.x, depths.y), max(depths.z, depths.w))));
+}
+)";
+
+constexpr std::string_view kVertexShader = R"(
+#version 460
+
+struct Object {
+  vec4 positionScale;
+  uint meshIndex;
+};
+
+layout(set = 0, binding = 0) uniform Camera {
+  mat4 viewProjection;
+} camera;
+
+layout(set = 0, binding = 1) readonly buffer Objects { Object objects[]; };
+layout(set = 0, binding = 6) readonly buffer Vertices { vec4 positions[]; };
+
+layout(location = 0) out vec3 outWorldPosition;
+layout(location = 1) flat out uint outObject;
+
+void main() {
+  // The culling pass stores the object index as the first instance of each draw.
+  const Object object = objects[gl_InstanceIndex];
+  const vec3 worldPosition = positions[gl_VertexIndex].xyz * object.positionScale.w + object.positionScale.xyz;
+  gl_Position = camera.viewProjection * vec4(worldPosition, 1.0);
+  outWorldPosition = worldPosition;
+  outObject = gl_InstanceIndex;
+}
+)";
+
+constexpr std::string_view kFragmentShader = R"(
+#version 460
+
+layout(location = 0) in vec3 inWorldPosition;
+layout(location = 1) flat in uint inObject;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+  const vec3 normal = normalize(cross(dFdx(inWorldPosition), dFdy(inWorldPosition)));
+  const float light = 0.3 + 0.7 * abs(dot(normal, normalize(vec3(0.4, 0.8, 0.3))));
+  const uint hash = inObject * 2654435761u;
+  const vec3 color = vec3(hash & 255u, (hash >> 8) & 255u, (hash >> 16) & 255u) / 255.0;
+  outColor = vec4(color * light, 1.0);
+}
+)";
+
+// Planes of the frustum with the normals pointing inside, for a 0 to 1 depth range.
+std::array<glm::vec4, 6> extractFrustumPlanes(const glm::mat4& viewProjection) {
+  const auto row = [&viewProjection](int index) {
+    return glm::vec4{viewProjection[0][index], viewProjection[1][index], viewProjection[2][index],
+                     viewProjection[3][index]};
+  };
+  std::array planes{row(3) + row(0), row(3) - row(0), row(3) + row(1), row(3) - row(1), row(2), row(3) - row(2)};
+  for (auto& plane : planes)
+    plane /= glm::length(glm::vec3{plane});
+  return planes;
+}
+
+VkPipeline createComputePipeline(VkDevice device, VkShaderModule shader, VkPipelineLayout layout) {
+  const VkComputePipelineCreateInfo pipelineInfo{.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+                                                 .stage = {.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+                                                           .stage = VK_SHADER_STAGE_COMPUTE_BIT,
+                                                           .module = shader,
+                                                           .pName = "main"},
+                                                 .layout = layout};
+  VkPipeline pipeline = VK_NULL_HANDLE;
+  VK_CALL(vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline));
+  return pipeline;
+}
+
+// Keeps every object on the GPU and lets a compute pass decide what to draw. The pass tests each object against the
+// frustum and against a depth pyramid built from the previous frame, and appends one indexed draw per survivor.
+// vkCmdDrawIndexedIndirectCount then draws them, so the CPU cost of a frame does not depend on the object count.
+// Objects that come into view from behind an occluder show up one frame late.
+class GpuDrivenScene {
+public:
+  static constexpr VkFormat kColorFormat = VK_FORMAT_R8G8B8A8_UNORM;
+  static constexpr VkFormat kDepthFormat = VK_FORMAT_D32_SFLOAT;
+  static constexpr VkFormat kPyramidFormat = VK_FORMAT_R32_SFLOAT;
+  static constexpr uint32_t kQueriesPerFrame = 4;
+
+  GpuDrivenScene(Device& device, const ShaderCompiler& compiler, std::span<const MeshData> meshes,
+                 std::span<const Instance> instances, VkExtent2D extent, uint32_t framesInFlight)
+      : m_device{device}, m_extent{extent}, m_objectCount{static_cast<uint32_t>(instances.size())},
+        m_sceneDescriptors{device.getDevice(), kSceneBindings, framesInFlight},
+        m_pyramidDescriptors{device.getDevice(), kPyramidBindings, getPyramidLevelCount(extent)} {
+    uploadGeometry(meshes, instances);
+    createImages();
+    createPipelines(compiler);
+
+    const VkQueryPoolCreateInfo queryPoolInfo{.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+                                              .queryType = VK_QUERY_TYPE_TIMESTAMP,
+                                              .queryCount = kQueriesPerFrame * framesInFlight};
+    VK_CALL(vkCreateQueryPool(m_device.getDevice(), &queryPoolInfo, nullptr, &m_queryPool));
+
+    m_frames.resize(framesInFlight);
+    for (auto& frame : m_frames) {
+      frame.camera = m_device.createBuffer(sizeof(CameraData), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+                                           VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+      frame.visibleCount =
+          m_device.createBuffer(sizeof(uint32_t), VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+      frame.descriptorSet = m_sceneDescriptors.allocate();
+      const std::array writes{
+          bufferDescriptor(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, frame.camera),
+          bufferDescriptor(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_objects),
+          bufferDescriptor(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_meshes),
+          bufferDescriptor(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_drawCommands),
+          bufferDescriptor(4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_drawCount),
+          imageDescriptor(5, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_pyramid.view, VK_IMAGE_LAYOUT_GENERAL,
+                          m_sampler),
+          bufferDescriptor(6, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_vertices),
+      };
+      updateDescriptorSet(m_device.getDevice(), frame.descriptorSet, writes);
+    }
+  }
+
+  GpuDrivenScene(const GpuDrivenScene&) = delete;
+  GpuDrivenScene& operator=(const GpuDrivenScene&) = delete;
+
+  ~GpuDrivenScene() {
+    const auto device = m_device.getDevice();
+    vkDeviceWaitIdle(device);
+
+    for (auto& frame : m_frames) {
+      m_device.destroyBuffer(frame.camera);
+      m_device.destroyBuffer(frame.visibleCount);
+    }
+    vkDestroyQueryPool(device, m_queryPool, nullptr);
+
+    vkDestroyPipeline(device, m_cullPipeline, nullptr);
+    vkDestroyPipeline(device, m_pyramidPipeline, nullptr);
+    vkDestroyPipeline(device, m_drawPipeline, nullptr);
+    vkDestroyPipelineLayout(device, m_sceneLayout, nullptr);
+    vkDestroyPipelineLayout(device, m_pyramidLayout, nullptr);
+
+    vkDestroySampler(device, m_sampler, nullptr);
+    for (auto view : m_pyramidLevels)
+      vkDestroyImageView(device, view, nullptr);
+    m_device.destroyImage(m_pyramid);
+    m_device.destroyImage(m_depth);
+    m_device.destroyImage(m_color);
+
+    m_device.destroyBuffer(m_drawCount);
+    m_device.destroyBuffer(m_drawCommands);
+    m_device.destroyBuffer(m_meshes);
+    m_device.destroyBuffer(m_objects);
+    m_device.destroyBuffer(m_indices);
+    m_device.destroyBuffer(m_vertices);
+  }
+
+  // Culls on the GPU, draws the survivors and builds the depth pyramid the next frame culls against.
+  void recordGpuDriven(VkCommandBuffer commandBuffer, uint32_t frameSlot, const glm::mat4& viewProjection,
+                       bool occlusion) {
+    auto& frame = m_frames[frameSlot];
+    updateCamera(frame, viewProjection, occlusion);
+
+    const auto firstQuery = frameSlot * kQueriesPerFrame;
+    vkCmdResetQueryPool(commandBuffer, m_queryPool, firstQuery, kQueriesPerFrame);
+    vkCmdWriteTimestamp2(commandBuffer, VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT, m_queryPool, firstQuery);
+
+    // The previous frame read the draw buffers, copied the count and wrote the pyramid.
+    memoryBarrier(commandBuffer,
+                  VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_2_COPY_BIT |
+                      VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                  VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+                  VK_PIPELINE_STAGE_2_CLEAR_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                  VK_ACCESS_2_TRANSFER_WRITE_BIT | VK_ACCESS_2_SHADER_SAMPLED_READ_BIT);
+    vkCmdFillBuffer(commandBuffer, m_drawCount.buffer, 0, sizeof(uint32_t), 0);
+    memoryBarrier(commandBuffer, VK_PIPELINE_STAGE_2_CLEAR_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+                  VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                  VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_cullPipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_sceneLayout, 0, 1, &frame.descriptorSet,
+                            0, nullptr);
+    vkCmdDispatch(commandBuffer, (m_objectCount + 63) / 64, 1, 1);
+
+    memoryBarrier(commandBuffer, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+                  VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_2_COPY_BIT,
+                  VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_2_TRANSFER_READ_BIT);
+    vkCmdWriteTimestamp2(commandBuffer, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, m_queryPool, firstQuery + 1);
+
+    beginRendering(commandBuffer, frame);
+    vkCmdDrawIndexedIndirectCount(commandBuffer, m_drawCommands.buffer, 0, m_drawCount.buffer, 0, m_objectCount,
+                                  sizeof(VkDrawIndexedIndirectCommand));
+    vkCmdEndRendering(commandBuffer);
+    vkCmdWriteTimestamp2(commandBuffer, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, m_queryPool, firstQuery + 2);
+
+    buildPyramid(commandBuffer);
+
+    const VkBufferCopy region{.size = sizeof(uint32_t)};
+    vkCmdCopyBuffer(commandBuffer, m_drawCount.buffer, frame.visibleCount.buffer, 1, &region);
+    memoryBarrier(commandBuffer, VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+                  VK_PIPELINE_STAGE_2_HOST_BIT, VK_ACCESS_2_HOST_READ_BIT);
+    vkCmdWriteTimestamp2(commandBuffer, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, m_queryPool, firstQuery + 3);
+    frame.recorded = true;
+  }
+
+  // One vkCmdDrawIndexed per object without any culling, the baseline the GPU driven path is measured against.
+  void recordCpuDraws(VkCommandBuffer commandBuffer, uint32_t frameSlot, const glm::mat4& viewProjection) {
+    auto& frame = m_frames[frameSlot];
+    updateCamera(frame, viewProjection, false);
+
+    const auto firstQuery = frameSlot * kQueriesPerFrame;
+    vkCmdResetQueryPool(commandBuffer, m_queryPool, firstQuery, kQueriesPerFrame);
+    vkCmdWriteTimestamp2(commandBuffer, VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT, m_queryPool, firstQuery);
+    vkCmdWriteTimestamp2(commandBuffer, VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT, m_queryPool, firstQuery + 1);
+
+    beginRendering(commandBuffer, frame);
+    for (uint32_t index = 0; index < m_objectCount; ++index) {
+      const auto& mesh = m_cpuMeshes[m_cpuMeshIndices[index]];
+      vkCmdDrawIndexed(commandBuffer, mesh.indexCount, 1, mesh.firstIndex, mesh.vertexOffset, index);
+    }
+    vkCmdEndRendering(commandBuffer);
+    vkCmdWriteTimestamp2(commandBuffer, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, m_queryPool, firstQuery + 2);
+    vkCmdWriteTimestamp2(commandBuffer, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, m_queryPool, firstQuery + 3);
+
+    *static_cast<uint32_t*>(frame.visibleCount.mapped) = m_objectCount;
+    frame.recorded = true;
+  }
+
+  // Only valid once the frame last recorded in the slot has completed.
+  [[nodiscard]] std::optional<GpuTimings> readTimings(uint32_t frameSlot) const {
+    if (!m_frames[frameSlot].recorded)
+      return std::nullopt;
+
+    std::array<uint64_t, kQueriesPerFrame> timestamps{};
+    VK_CALL(vkGetQueryPoolResults(m_device.getDevice(), m_queryPool, frameSlot * kQueriesPerFrame, kQueriesPerFrame,
+                                  sizeof(timestamps), timestamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT));
+    const auto toMs = [this](uint64_t begin, uint64_t end) {
+      return static_cast<double>(end - begin) * m_device.getTimestampPeriod() / 1e6;
+    };
+    return GpuTimings{.cullMs = toMs(timestamps[0], timestamps[1]),
+                      .drawMs = toMs(timestamps[1], timestamps[2]),
+                      .pyramidMs = toMs(timestamps[2], timestamps[3])};
+  }
+
+  [[nodiscard]] uint32_t readVisibleCount(uint32_t frameSlot) const {
+    return *static_cast<const uint32_t*>(m_frames[frameSlot].visibleCount.mapped);
+  }
+
+  [[nodiscard]] inline uint32_t getObjectCount() const noexcept { return m_objectCount; }
+
+private:
+  struct Frame {
+    BufferAllocation camera;
+    BufferAllocation visibleCount;
+    VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+    bool recorded = false;
+  };
+
+  static constexpr std::array kSceneBindings{
+      VkDescriptorSetLayoutBinding{.binding = 0,
+                                   .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+                                   .descriptorCount = 1,
+                                   .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_VERTEX_BIT},
+      VkDescriptorSetLayoutBinding{.binding = 1,
+                                   .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                   .descriptorCount = 1,
+                                   .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_VERTEX_BIT},
+      VkDescriptorSetLayoutBinding{.binding = 2,
+                                   .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                   .descriptorCount = 1,
+                                   .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT},
+      VkDescriptorSetLayoutBinding{.binding = 3,
+                                   .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                   .descriptorCount = 1,
+                                   .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT},
+      VkDescriptorSetLayoutBinding{.binding = 4,
+                                   .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                   .descriptorCount = 1,
+                                   .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT},
+      VkDescriptorSetLayoutBinding{.binding = 5,
+                                   .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                   .descriptorCount = 1,
+                                   .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT},
+      VkDescriptorSetLayoutBinding{.binding = 6,
+                                   .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                   .descriptorCount = 1,
+                                   .stageFlags = VK_SHADER_STAGE_VERTEX_BIT},
+  };
+
+  static constexpr std::array kPyramidBindings{
+      VkDescriptorSetLayoutBinding{.binding = 0,
+                                   .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                   .descriptorCount = 1,
+                                   .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT},
+      VkDescriptorSetLayoutBinding{.binding = 1,
+                                   .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                   .descriptorCount = 1,
+                                   .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT},
+  };
+
+  static uint32_t getPyramidLevelCount(VkExtent2D extent) {
+    return static_cast<uint32_t>(std::bit_width(std::max(std::bit_floor(extent.width), std::bit_floor(extent.height))));
+  }
+
+  template <typename T>
+  static std::span<const std::byte> asBytes(const std::vector<T>& values) {
+    return std::as_bytes(std::span{values});
+  }
+
+  void uploadGeometry(std::span<const MeshData> meshes, std::span<const Instance> instances) {
+    std::vector<glm::vec4> positions;
+    std::vector<uint32_t> indices;
+    for (const auto& mesh : meshes) {
+      const auto radius = ranges::max(mesh.positions | views::transform([](const glm::vec4& position) {
+                                        return glm::length(glm::vec3{position});
+                                      }));
+      m_cpuMeshes.push_back(GpuMesh{.indexCount = static_cast<uint32_t>(mesh.indices.size()),
+                                    .firstIndex = static_cast<uint32_t>(indices.size()),
+                                    .vertexOffset = static_cast<int32_t>(positions.size()),
+                                    .radius = radius});
+      positions.insert(std::end(positions), std::begin(mesh.positions), std::end(mesh.positions));
+      indices.insert(std::end(indices), std::begin(mesh.indices), std::end(mesh.indices));
+    }
+
+    // clang-format off
+    const auto objects = instances
+      | views::transform([](const Instance& instance) {
+          return GpuObject{.positionScale = glm::vec4{instance.position, instance.scale},
+                           .meshIndex = instance.meshIndex};
+        })
+      | ranges::to<std::vector<GpuObject>>();
+    // clang-format on
+    m_cpuMeshIndices = instances | views::transform(&Instance::meshIndex) | ranges::to<std::vector<uint32_t>>();
+
+    m_vertices = m_device.createBuffer(asBytes(positions), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+    m_indices = m_device.createBuffer(asBytes(indices), VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+    m_objects = m_device.createBuffer(asBytes(objects), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+    m_meshes = m_device.createBuffer(asBytes(m_cpuMeshes), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+    m_drawCommands = m_device.createBuffer(
+        VkDeviceSize{m_objectCount} * sizeof(VkDrawIndexedIndirectCommand),
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    m_drawCount = m_device.createBuffer(sizeof(uint32_t),
+                                        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+                                            VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+  }
+
+  void createImages() {
+    m_color = m_device.createImage(m_extent, kColorFormat, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+                                   VK_IMAGE_ASPECT_COLOR_BIT);
+    m_depth = m_device.createImage(m_extent, kDepthFormat,
+                                   VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+                                   VK_IMAGE_ASPECT_DEPTH_BIT);
+
+    // Power of two levels, so that every texel of a level covers exactly two by two texels of the one above.
+    const VkExtent2D pyramidExtent{std::bit_floor(m_extent.width), std::bit_floor(m_extent.height)};
+    const auto levels = getPyramidLevelCount(m_extent);
+    m_pyramid = m_device.createImage(pyramidExtent, kPyramidFormat,
+                                     VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT |
+                                         VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+                                     VK_IMAGE_ASPECT_COLOR_BIT, levels);
+    for (uint32_t level = 0; level < levels; ++level)
+      m_pyramidLevels.push_back(
+          m_device.createImageView(m_pyramid.image, kPyramidFormat, VK_IMAGE_ASPECT_COLOR_BIT, level, 1));
+
+    const VkSamplerCreateInfo samplerInfo{.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+                                          .magFilter = VK_FILTER_NEAREST,
+                                          .minFilter = VK_FILTER_NEAREST,
+                                          .mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+                                          .addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+                                          .addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+                                          .addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+                                          .maxLod = VK_LOD_CLAMP_NONE};
+    VK_CALL(vkCreateSampler(m_device.getDevice(), &samplerInfo, nullptr, &m_sampler));
+
+    // The pyramid lives in the general layout. Until the first frame has rendered it holds the far plane, which
+    // occludes nothing.
+    m_device.immediateSubmit([this](VkCommandBuffer commandBuffer) {
+      imageBarrier(commandBuffer, m_pyramid.image, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_UNDEFINED,
+                   VK_IMAGE_LAYOUT_GENERAL, VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE,
+                   VK_PIPELINE_STAGE_2_CLEAR_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT);
+      const VkClearColorValue farPlane{.float32 = {1.0f, 1.0f, 1.0f, 1.0f}};
+      const VkImageSubresourceRange range{.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                                          .levelCount = VK_REMAINING_MIP_LEVELS,
+                                          .layerCount = 1};
+      vkCmdClearColorImage(commandBuffer, m_pyramid.image, VK_IMAGE_LAYOUT_GENERAL, &farPlane, 1, &range);
+    });
+
+    for (uint32_t level = 0; level < levels; ++level) {
+      const auto set = m_pyramidDescriptors.allocate();
+      const std::array writes{
+          level == 0 ? imageDescriptor(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_depth.view,
+                                       VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, m_sampler)
+                     : imageDescriptor(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_pyramidLevels[level - 1],
+                                       VK_IMAGE_LAYOUT_GENERAL, m_sampler),
+          imageDescriptor(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, m_pyramidLevels[level], VK_IMAGE_LAYOUT_GENERAL),
+      };
+      updateDescriptorSet(m_device.getDevice(), set, writes);
+      m_pyramidSets.push_back(set);
+    }
+  }
+
+  void createPipelines(const ShaderCompiler& compiler) {
+    const auto device = m_device.getDevice();
+    const auto compile = [&compiler, device](std::string_view source, VkShaderStageFlagBits stage) {
+      const auto spirv = compiler.compile(source, stage);
+      if (!spirv) {
+        std::println("Unable to compile a shader: {}", spirv.error());
+        std::exit(EXIT_FAILURE);
+      }
+      return createShaderModule(device, spirv.value());
+    };
+
+    const auto sceneSetLayout = m_sceneDescriptors.getLayout();
+    const VkPipelineLayoutCreateInfo sceneLayoutInfo{.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+                                                     .setLayoutCount = 1,
+                                                     .pSetLayouts = &sceneSetLayout};
+    VK_CALL(vkCreatePipelineLayout(device, &sceneLayoutInfo, nullptr, &m_sceneLayout));
+
+    const auto pyramidSetLayout = m_pyramidDescriptors.getLayout();
+    const VkPushConstantRange pyramidPushConstants{.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+                                                   .size = sizeof(glm::vec2)};
+    const VkPipelineLayoutCreateInfo pyramidLayoutInfo{.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+                                                       .setLayoutCount = 1,
+                                                       .pSetLayouts = &pyramidSetLayout,
+                                                       .pushConstantRangeCount = 1,
+                                                       .pPushConstantRanges = &pyramidPushConstants};
+    VK_CALL(vkCreatePipelineLayout(device, &pyramidLayoutInfo, nullptr, &m_pyramidLayout));
+
+    const auto cullShader = compile(kCullShader, VK_SHADER_STAGE_COMPUTE_BIT);
+    const auto pyramidShader = compile(kPyramidShader, VK_SHADER_STAGE_COMPUTE_BIT);
+    const auto vertexShader = compile(kVertexShader, VK_SHADER_STAGE_VERTEX_BIT);
+    const auto fragmentShader = compile(kFragmentShader, VK_SHADER_STAGE_FRAGMENT_BIT);
+
+    m_cullPipeline = createComputePipeline(device, cullShader, m_sceneLayout);
+    m_pyramidPipeline = createComputePipeline(device, pyramidShader, m_pyramidLayout);
+    m_drawPipeline = createDrawPipeline(vertexShader, fragmentShader);
+
+    for (auto shader : {cullShader, pyramidShader, vertexShader, fragmentShader})
+      vkDestroyShaderModule(device, shader, nullptr);
+  }
+
+  VkPipeline createDrawPipeline(VkShaderModule vertexShader, VkShaderModule fragmentShader) {
+    const std::array stages{
+        VkPipelineShaderStageCreateInfo{.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+                                        .stage = VK_SHADER_STAGE_VERTEX_BIT,
+                                        .module = vertexShader,
+                                        .pName = "main"},
+        VkPipelineShaderStageCreateInfo{.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+                                        .stage = VK_SHADER_STAGE_FRAGMENT_BIT,
+                                        .module = fragmentShader,
+                                        .pName = "main"},
+    };
+
+    // Vertices are pulled from a storage buffer, there is no vertex input.
+    const VkPipelineVertexInputStateCreateInfo vertexInput{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO};
+    const VkPipelineInputAssemblyStateCreateInfo inputAssembly{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
+        .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST};
+    const VkPipelineViewportStateCreateInfo viewport{.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
+                                                     .viewportCount = 1,
+                                                     .scissorCount = 1};
+    const VkPipelineRasterizationStateCreateInfo rasterization{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
+        .polygonMode = VK_POLYGON_MODE_FILL,
+        .cullMode = VK_CULL_MODE_NONE,
+        .lineWidth = 1.0f};
+    const VkPipelineMultisampleStateCreateInfo multisample{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
+        .rasterizationSamples = VK_SAMPLE_COUNT_1_BIT};
+    const VkPipelineDepthStencilStateCreateInfo depthStencil{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
+        .depthTestEnable = VK_TRUE,
+        .depthWriteEnable = VK_TRUE,
+        .depthCompareOp = VK_COMPARE_OP_LESS};
+    const VkPipelineColorBlendAttachmentState blendAttachment{
+        .colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT |
+                          VK_COLOR_COMPONENT_A_BIT};
+    const VkPipelineColorBlendStateCreateInfo colorBlend{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
+        .attachmentCount = 1,
+        .pAttachments = &blendAttachment};
+    const std::array dynamicStates{VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+    const VkPipelineDynamicStateCreateInfo dynamicState{.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
+                                                        .dynamicStateCount =
+                                                            static_cast<uint32_t>(dynamicStates.size()),
+                                                        .pDynamicStates = dynamicStates.data()};
+
+    const VkPipelineRenderingCreateInfo renderingInfo{.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO,
+                                                      .colorAttachmentCount = 1,
+                                                      .pColorAttachmentFormats = &kColorFormat,
+                                                      .depthAttachmentFormat = kDepthFormat};
+
+    const VkGraphicsPipelineCreateInfo pipelineInfo{.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+                                                    .pNext = &renderingInfo,
+                                                    .stageCount = static_cast<uint32_t>(stages.size()),
+                                                    .pStages = stages.data(),
+                                                    .pVertexInputState = &vertexInput,
+                                                    .pInputAssemblyState = &inputAssembly,
+                                                    .pViewportState = &viewport,
+                                                    .pRasterizationState = &rasterization,
+                                                    .pMultisampleState = &multisample,
+                                                    .pDepthStencilState = &depthStencil,
+                                                    .pColorBlendState = &colorBlend,
+                                                    .pDynamicState = &dynamicState,
+                                                    .layout = m_sceneLayout};
+
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    VK_CALL(vkCreateGraphicsPipelines(m_device.getDevice(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline));
+    return pipeline;
+  }
+
+  void updateCamera(Frame& frame, const glm::mat4& viewProjection, bool occlusion) {
+    const CameraData camera{.viewProjection = viewProjection,
+                            .previousViewProjection = m_previousViewProjection.value_or(viewProjection),
+                            .frustumPlanes = extractFrustumPlanes(viewProjection),
+                            .pyramidSize = glm::vec2{m_pyramid.extent.width, m_pyramid.extent.height},
+                            .objectCount = m_objectCount,
+                            .occlusionEnabled = occlusion ? 1u : 0u};
+    std::memcpy(frame.camera.mapped, &camera, sizeof(camera));
+    m_previousViewProjection = viewProjection;
+  }
+
+  void beginRendering(VkCommandBuffer commandBuffer, const Frame& frame) {
+    // The depth pyramid of the previous frame was built from the depth image.
+    imageBarrier(commandBuffer, m_depth.image, VK_IMAGE_ASPECT_DEPTH_BIT, VK_IMAGE_LAYOUT_UNDEFINED,
+                 VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_NONE,
+                 VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+                 VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT);
+    imageBarrier(commandBuffer, m_color.image, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_UNDEFINED,
+                 VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+                 VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+                 VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT);
+
+    const VkRenderingAttachmentInfo colorAttachment{.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
+                                                    .imageView = m_color.view,
+                                                    .imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                                                    .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+                                                    .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+                                                    .clearValue = {.color = {.float32 = {0.1f, 0.1f, 0.1f, 1.0f}}}};
+    const VkRenderingAttachmentInfo depthAttachment{.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
+                                                    .imageView = m_depth.view,
+                                                    .imageLayout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
+                                                    .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+                                                    .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+                                                    .clearValue = {.depthStencil = {.depth = 1.0f}}};
+    const VkRenderingInfo renderingInfo{.sType = VK_STRUCTURE_TYPE_RENDERING_INFO,
+                                        .renderArea = {.offset = {0, 0}, .extent = m_extent},
+                                        .layerCount = 1,
+                                        .colorAttachmentCount = 1,
+                                        .pColorAttachments = &colorAttachment,
+                                        .pDepthAttachment = &depthAttachment};
+    vkCmdBeginRendering(commandBuffer, &renderingInfo);
+
+    const VkViewport viewport{.width = static_cast<float>(m_extent.width),
+                              .height = static_cast<float>(m_extent.height),
+                              .maxDepth = 1.0f};
+    const VkRect2D scissor{.offset = {0, 0}, .extent = m_extent};
+    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_drawPipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_sceneLayout, 0, 1, &frame.descriptorSet,
+                            0, nullptr);
+    vkCmdBindIndexBuffer(commandBuffer, m_indices.buffer, 0, VK_INDEX_TYPE_UINT32);
+  }
+
+  void buildPyramid(VkCommandBuffer commandBuffer) {
+    imageBarrier(commandBuffer, m_depth.image, VK_IMAGE_ASPECT_DEPTH_BIT, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
+                 VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+                 VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                 VK_ACCESS_2_SHADER_SAMPLED_READ_BIT);
+    // The culling pass of this frame sampled the pyramid that is about to be overwritten.
+    memoryBarrier(commandBuffer, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_NONE,
+                  VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_NONE);
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pyramidPipeline);
+    for (uint32_t level = 0; level < m_pyramidSets.size(); ++level) {
+      const glm::vec2 size{std::max(1u, m_pyramid.extent.width >> level),
+                           std::max(1u, m_pyramid.extent.height >> level)};
+      vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pyramidLayout, 0, 1,
+                              &m_pyramidSets[level], 0, nullptr);
+      vkCmdPushConstants(commandBuffer, m_pyramidLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(size), &size);
+      vkCmdDispatch(commandBuffer, (static_cast<uint32_t>(size.x) + 7) / 8, (static_cast<uint32_t>(size.y) + 7) / 8,
+                    1);
+
+      memoryBarrier(commandBuffer, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+                    VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT);
+    }
+  }
+
+private:
+  Device& m_device;
+  VkExtent2D m_extent;
+  uint32_t m_objectCount;
+  DescriptorSetAllocator m_sceneDescriptors;
+  DescriptorSetAllocator m_pyramidDescriptors;
+
+  std::vector<GpuMesh> m_cpuMeshes;
+  std::vector<uint32_t> m_cpuMeshIndices;
+  BufferAllocation m_vertices;
+  BufferAllocation m_indices;
+  BufferAllocation m_objects;
+  BufferAllocation m_meshes;
+  BufferAllocation m_drawCommands;
+  BufferAllocation m_drawCount;
+
+  ImageAllocation m_color;
+  ImageAllocation m_depth;
+  ImageAllocation m_pyramid;
+  std::vector<VkImageView> m_pyramidLevels;
+  std::vector<VkDescriptorSet> m_pyramidSets;
+  VkSampler m_sampler = VK_NULL_HANDLE;
+
+  VkPipelineLayout m_sceneLayout = VK_NULL_HANDLE;
+  VkPipelineLayout m_pyramidLayout = VK_NULL_HANDLE;
+  VkPipeline m_cullPipeline = VK_NULL_HANDLE;
+  VkPipeline m_pyramidPipeline = VK_NULL_HANDLE;
+  VkPipeline m_drawPipeline = VK_NULL_HANDLE;
+
+  VkQueryPool m_queryPool = VK_NULL_HANDLE;
+  std::vector<Frame> m_frames;
+  std::optional<glm::mat4> m_previousViewProjection;
+};
+
+class Context {
+public:
+  static std::expected<Context, std::string> create(std::string_view applicationName,
+                                                    std::vector<std::string> requestedInstanceLayer,
+                                                    std::vector<std::string> requestedInstanceExtensions) {
+
+    Context context{applicationName, std::move(requestedInstanceLayer), std::move(requestedInstanceExtensions)};
+
+    if (context.init())
+      return context;
+    else
+      return std::unexpected(std::string{"Failed to init the vulkan context"});
+  }
+
+  ~Context() {
+    if (m_vulkanInstance == VK_NULL_HANDLE)
+      return;
+
+    vkDestroyInstance(m_vulkanInstance, nullptr);
+    m_vulkanInstance = VK_NULL_HANDLE;
+  }
+
+  Context& operator=(const Context&) = delete;
+
+  Context(const Context&) = delete;
+
+  Context(Context&& rhs) noexcept {
+    swap(rhs);
+    rhs.m_vulkanInstance = VK_NULL_HANDLE;
+  }
+
+  Context& operator=(Context&& rhs) noexcept {
+    Context tmp{std::move(rhs)};
+    swap(tmp);
+    return *this;
+  }
+
+  std::vector<PhysicalDevice> enumeratePhysicalDevices() {
+    // clang-format off
+    auto result = VulkanCore::enumeratePhysicalDevices(m_vulkanInstance)
+      | views::transform([](VkPhysicalDevice device) -> PhysicalDevice {
+         return PhysicalDevice{device};
+        })
+      | ranges::to<std::vector<PhysicalDevice>>();
+    // clang-format on
+    return result;
+  }
+
+private:
+  Context(std::string_view applicationName, std::vector<std::string> requestedInstanceLayer,
+          std::vector<std::string> requestedInstanceExtensions)
+      : m_applicationName{applicationName} {
+    auto allInstanceLayers = enumerateInstanceLayerProperties();
+    const auto isInstanceLayerRequired = [&requestedInstanceLayer](const VkLayerProperties& prop) {
+      auto name = std::string{prop.layerName};
+      return ranges::find(requestedInstanceLayer, name) != std::end(requestedInstanceLayer);
+    };
+    // clang-format off
+    m_layerProperties = allInstanceLayers
+      | views::filter(isInstanceLayerRequired)
+      | ranges::to<std::vector<VkLayerProperties>>();
+    // clang-format on
+
+    auto allExtensions = enumerateExtensionsProperties();
+    const auto isExtensionRequired = [&requestedInstanceExtensions](const VkExtensionProperties& prop) {
+      auto name = std::string{prop.extensionName};
+      return ranges::find(requestedInstanceExtensions, name) != std::end(requestedInstanceExtensions);
+    };
+    // clang-format off
+    m_layerExtensions = allExtensions
+      | views::filter(isExtensionRequired)
+      | ranges::to<std::vector<VkExtensionProperties>>();
+    // clang-format on
+  }
+
+  bool init() {
+    // clang-format off
+    auto layers = m_layerProperties
+      | views::transform([](const VkLayerProperties& prop) -> const char*
+        {
+          return prop.layerName;
+        })
+      | ranges::to<std::vector<const char*>>();
+
+      auto extensions = m_layerExtensions
+        | views::transform([](const VkExtensionProperties & prop) -> const char*
+          {
+            return prop.extensionName;
+          })
+        | ranges::to<std::vector<const char*>>();
+    // clang-format on
+
+    const VkApplicationInfo applicationInfo{.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO,
+                                            .pApplicationName = m_applicationName.data(),
+                                            .applicationVersion = VK_MAKE_VERSION(1, 0, 0),
+                                            .apiVersion = VK_API_VERSION_1_3};
+
+    const VkInstanceCreateInfo instanceCreateInfo{.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO,
+#if defined(VK_USE_PLATFORM_METAL_EXT)
+                                                  .flags = VK_INSTANCE_CREATE_ENUMERATE_PORTABILITY_BIT_KHR,
+#endif
+                                                  .pApplicationInfo = &applicationInfo,
+                                                  .enabledLayerCount = static_cast<uint32_t>(layers.size()),
+                                                  .ppEnabledLayerNames = layers.data(),
+                                                  .enabledExtensionCount = static_cast<uint32_t>(extensions.size()),
+                                                  .ppEnabledExtensionNames = extensions.data()};
+
+    const auto res = vkCreateInstance(&instanceCreateInfo, nullptr, &m_vulkanInstance);
+    return res == VK_SUCCESS;
+  }
+
+  void swap(Context& rhs) {
+    std::swap(m_applicationName, rhs.m_applicationName);
+    std::swap(m_layerProperties, rhs.m_layerProperties);
+    std::swap(m_layerExtensions, rhs.m_layerExtensions);
+    std::swap(m_vulkanInstance, rhs.m_vulkanInstance);
+  }
+
+private:
+  std::string m_applicationName;
+  std::vector<VkLayerProperties> m_layerProperties;
+  std::vector<VkExtensionProperties> m_layerExtensions;
+  VkInstance m_vulkanInstance = VK_NULL_HANDLE;
+};
+} // namespace VulkanCore
+
+uint32_t parseArgument(std::span<char*> arguments, std::string_view name, uint32_t defaultValue) {
+  for (size_t index = 1; index + 1 < arguments.size(); ++index) {
+    if (std::string_view{arguments[index]} == name) {
+      const std::string_view value{arguments[index + 1]};
+      std::from_chars(value.data(), value.data() + value.size(), defaultValue);
+    }
+  }
+  return defaultValue;
+}
+
+bool hasArgument(std::span<char*> arguments, std::string_view name) {
+  return ranges::any_of(arguments | views::drop(1), [name](const char* argument) { return argument == name; });
+}
+
+VulkanCore::MeshData makeCube() {
+  return VulkanCore::MeshData{
+      .positions = {{-0.5f, -0.5f, -0.5f, 1.0f},
+                    {0.5f, -0.5f, -0.5f, 1.0f},
+                    {0.5f, 0.5f, -0.5f, 1.0f},
+                    {-0.5f, 0.5f, -0.5f, 1.0f},
+                    {-0.5f, -0.5f, 0.5f, 1.0f},
+                    {0.5f, -0.5f, 0.5f, 1.0f},
+                    {0.5f, 0.5f, 0.5f, 1.0f},
+                    {-0.5f, 0.5f, 0.5f, 1.0f}},
+      .indices = {0, 2, 1, 0, 3, 2, 4, 5, 6, 4, 6, 7, 0, 1, 5, 0, 5, 4,
+                  3, 6, 2, 3, 7, 6, 0, 4, 7, 0, 7, 3, 1, 2, 6, 1, 6, 5}};
+}
+
+VulkanCore::MeshData makeOctahedron() {
+  return VulkanCore::MeshData{.positions = {{0.6f, 0.0f, 0.0f, 1.0f},
+                                            {-0.6f, 0.0f, 0.0f, 1.0f},
+                                            {0.0f, 0.6f, 0.0f, 1.0f},
+                                            {0.0f, -0.6f, 0.0f, 1.0f},
+                                            {0.0f, 0.0f, 0.6f, 1.0f},
+                                            {0.0f, 0.0f, -0.6f, 1.0f}},
+                              .indices = {0, 2, 4, 2, 1, 4, 1, 3, 4, 3, 0, 4, 2, 0, 5, 1, 2, 5, 3, 1, 5, 0, 3, 5}};
+}
+
+// Scatters the instances through a cube whose size grows with their number, so the density and with it the amount
+// of occlusion stays the same whatever the count.
+std::vector<VulkanCore::Instance> makeInstances(uint32_t count, float halfSize) {
+  std::mt19937 generator{42};
+  std::uniform_real_distribution<float> position{-halfSize, halfSize};
+  std::uniform_real_distribution<float> scale{0.5f, 1.5f};
+  // clang-format off
+  return views::iota(0u, count)
+    | views::transform([&](uint32_t index) {
+        return VulkanCore::Instance{.position = {position(generator), position(generator), position(generator)},
+                                    .scale = scale(generator),
+                                    .meshIndex = index % 2};
+      })
+    | ranges::to<std::vector<VulkanCore::Instance>>();
+  // clang-format on
+}
+
+double average(std::span<const double> values) {
+  if (values.empty())
+    return 0.0;
+  return std::reduce(std::begin(values), std::end(values)) / static_cast<double>(values.size());
+}
+
+// Renders a field of instances from a camera orbiting inside it, either with GPU culling and a single indirect count
+// draw or, with --cpu-draws, with one draw call per instance. Reports the CPU time to record and submit a frame, the
+// GPU time of each pass and the number of instances that survived culling.
+int main(int argc, char* argv[]) {
+  constexpr VkExtent2D kExtent{1280, 720};
+  constexpr uint32_t kFramesInFlight = 2;
+
+  const auto arguments = std::span{argv, static_cast<size_t>(argc)};
+  const auto instanceCount = std::max(1u, parseArgument(arguments, "--instances", 100000));
+  const auto frameCount = parseArgument(arguments, "--frames", 300);
+  const auto occlusion = !hasArgument(arguments, "--no-occlusion");
+  const auto cpuDraws = hasArgument(arguments, "--cpu-draws");
+
+  const std::string applicationName = "01-10 GPU driven culling";
+
+  auto vulkanContext =
+      VulkanCore::Context::create(applicationName, getRequestedInstanceLayers(), getRequestedInstanceExtensions());
+
+  if (!vulkanContext) {
+    std::println("Unable to create the context: {}", vulkanContext.error());
+    return EXIT_FAILURE;
+  }
+
+  auto physicalDevices = vulkanContext.value().enumeratePhysicalDevices();
+  if (physicalDevices.empty()) {
+    std::println("No physical devices found");
+    return EXIT_FAILURE;
+  }
+
+  const auto& physicalDevice = physicalDevices.front();
+  auto device = VulkanCore::Device::create(physicalDevice, getRequestedDeviceExtensions());
+  if (!device) {
+    std::println("Unable to create the device: {}", device.error());
+    return EXIT_FAILURE;
+  }
+  std::println("Using {}, {} instances, {}", physicalDevice.getProperties().deviceName, instanceCount,
+               cpuDraws ? "one draw per instance" : (occlusion ? "frustum and occlusion culling" : "frustum culling"));
+
+  const auto halfSize = 1.5f * std::cbrt(static_cast<float>(instanceCount));
+  const std::array meshes{makeCube(), makeOctahedron()};
+  const auto instances = makeInstances(instanceCount, halfSize);
+
+  VulkanCore::ShaderCompiler compiler;
+  VulkanCore::GpuDrivenScene scene{device.value(), compiler, meshes, instances, kExtent, kFramesInFlight};
+
+  auto projection = glm::perspective(glm::radians(60.0f),
+                                     static_cast<float>(kExtent.width) / static_cast<float>(kExtent.height), 0.1f,
+                                     4.0f * halfSize);
+  projection[1][1] *= -1.0f;
+
+  std::vector<VkCommandBuffer> commandBuffers(kFramesInFlight);
+  std::vector<uint64_t> timelineValues(kFramesInFlight, 0);
+  for (auto& commandBuffer : commandBuffers)
+    commandBuffer = device->allocateCommandBuffer();
+
+  std::vector<double> submitTimes;
+  std::vector<double> cullTimes;
+  std::vector<double> drawTimes;
+  std::vector<double> pyramidTimes;
+  std::vector<double> visibleCounts;
+
+  const auto collect = [&](uint32_t slot) {
+    const auto timings = scene.readTimings(slot);
+    if (!timings)
+      return;
+    cullTimes.push_back(timings->cullMs);
+    drawTimes.push_back(timings->drawMs);
+    pyramidTimes.push_back(timings->pyramidMs);
+    visibleCounts.push_back(static_cast<double>(scene.readVisibleCount(slot)));
+  };
+
+  for (uint32_t frameIndex = 0; frameIndex < frameCount; ++frameIndex) {
+    const auto slot = frameIndex % kFramesInFlight;
+    device->waitTimeline(timelineValues[slot]);
+    collect(slot);
+
+    const auto angle = 0.01f * static_cast<float>(frameIndex);
+    const glm::vec3 eye{0.5f * halfSize * std::cos(angle), 0.0f, 0.5f * halfSize * std::sin(angle)};
+    const auto view = glm::lookAt(eye, glm::vec3{0.0f}, glm::vec3{0.0f, 1.0f, 0.0f});
+
+    const auto start = std::chrono::steady_clock::now();
+    const auto commandBuffer = commandBuffers[slot];
+    VK_CALL(vkResetCommandBuffer(commandBuffer, 0));
+    const VkCommandBufferBeginInfo beginInfo{.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+                                             .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT};
+    VK_CALL(vkBeginCommandBuffer(commandBuffer, &beginInfo));
+    if (cpuDraws)
+      scene.recordCpuDraws(commandBuffer, slot, projection * view);
+    else
+      scene.recordGpuDriven(commandBuffer, slot, projection * view, occlusion);
+    VK_CALL(vkEndCommandBuffer(commandBuffer));
+    timelineValues[slot] = device->submit(commandBuffer);
+    submitTimes.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+  }
+
+  for (uint32_t slot = 0; slot < kFramesInFlight; ++slot) {
+    device->waitTimeline(timelineValues[slot]);
+    collect(slot);
+  }
+
+  std::println("{} frames: CPU record and submit {:.3f}ms, GPU cull {:.3f}ms, draw {:.3f}ms, pyramid {:.3f}ms",
+               frameCount, average(submitTimes), average(cullTimes), average(drawTimes), average(pyramidTimes));
+  std::println("{:.0f} of {} instances drawn per frame on average", average(visibleCounts), scene.getObjectCount());
+
+  // The camera is inside the field, something is always in view.
+  if (!visibleCounts.empty() && ranges::max(visibleCounts) == 0.0) {
+    std::println("Every instance was culled");
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,1764 @@
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <expected>
+#include <format>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <numeric>
+#include <optional>
+#include <random>
+#include <print>
+#include <ranges>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include <meshoptimizer.h>
+
+#include <glslang/Public/ResourceLimits.h>
+#include <glslang/Public/ShaderLang.h>
+#include <glslang/SPIRV/GlslangToSpv.h>
+
+namespace ranges = std::ranges;
+namespace views = std::ranges::views;
+
+#define VK_CALL(vFun)                                                                                                  \
+  {                                                                                                                    \
+    const auto res = vFun;                                                                                             \
+    if (res != VK_SUCCESS) {                                                                                           \
+      std::println(#vFun " failed with error {}", static_cast<int>(res));                                              \
+      std::exit(res);                                                                                                  \
+    }                                                                                                                  \
+  }
+
+auto getRequestedInstanceLayers() -> std::vector<std::string> {
+  return std::vector<std::string>{"VK_LAYER_KHRONOS_validation"};
+}
+
+auto getRequestedInstanceExtensions() -> std::vector<std::string> {
+  return std::vector<std::string>{
+#if defined(VK_USE_PLATFORM_METAL_EXT)
+      VK_KHR_PORTABILITY_ENUMERATION_EXTENSION_NAME,
+#endif
+#if defined(VK_EXT_debug_utils)
+      VK_EXT_DEBUG_UTILS_EXTENSION_NAME,
+#endif
+  };
+}
+
+auto getRequestedDeviceExtensions() -> std::vector<std::string> { return std::vector<std::string>{}; }
+
+namespace VulkanCore {
+std::vector<VkLayerProperties> enumerateInstanceLayerProperties() {
+  uint32_t layersCount{0};
+  vkEnumerateInstanceLayerProperties(&layersCount, nullptr);
+
+  std::vector<VkLayerProperties> layersProperties(layersCount);
+  vkEnumerateInstanceLayerProperties(&layersCount, layersProperties.data());
+
+  return layersProperties;
+}
+
+std::vector<VkExtensionProperties> enumerateExtensionsProperties() {
+  uint32_t extensionsCount{0};
+  vkEnumerateInstanceExtensionProperties(nullptr, &extensionsCount, nullptr);
+
+  std::vector<VkExtensionProperties> extensionsProperties(extensionsCount);
+  vkEnumerateInstanceExtensionProperties(nullptr, &extensionsCount, extensionsProperties.data());
+
+  return extensionsProperties;
+}
+
+std::vector<VkExtensionProperties> enumerateDeviceExtensionsProperties(VkPhysicalDevice device) {
+  uint32_t extensionsCount{0};
+  vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionsCount, nullptr);
+
+  std::vector<VkExtensionProperties> extensionsProperties(extensionsCount);
+  vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionsCount, extensionsProperties.data());
+
+  return extensionsProperties;
+}
+
+std::vector<VkPhysicalDevice> enumeratePhysicalDevices(VkInstance instance) {
+  uint32_t physicalDevicesCount{0};
+  vkEnumeratePhysicalDevices(instance, &physicalDevicesCount, nullptr);
+
+  std::vector<VkPhysicalDevice> physicalDevices(physicalDevicesCount);
+  vkEnumeratePhysicalDevices(instance, &physicalDevicesCount, physicalDevices.data());
+
+  return physicalDevices;
+}
+
+std::vector<VkQueueFamilyProperties> enumeratePhysicalDevicesQueueFamilyProperties(VkPhysicalDevice device) {
+  uint32_t physicalDeviceQueueFamilyPropertiesCount{0};
+  vkGetPhysicalDeviceQueueFamilyProperties(device, &physicalDeviceQueueFamilyPropertiesCount, nullptr);
+
+  std::vector<VkQueueFamilyProperties> queueFamiliesProperties(physicalDeviceQueueFamilyPropertiesCount);
+  vkGetPhysicalDeviceQueueFamilyProperties(device, &physicalDeviceQueueFamilyPropertiesCount,
+                                           queueFamiliesProperties.data());
+
+  return queueFamiliesProperties;
+}
+
+class PhysicalDevice {
+public:
+  explicit PhysicalDevice(VkPhysicalDevice device)
+      : m_device{device}, m_extensions{enumerateDeviceExtensionsProperties(device)},
+        m_queueFamilies{enumeratePhysicalDevicesQueueFamilyProperties(device)} {
+    vkGetPhysicalDeviceProperties(m_device, &m_properties);
+    vkGetPhysicalDeviceMemoryProperties(m_device, &m_memoryProperties);
+  }
+
+  [[nodiscard]] inline VkPhysicalDevice getPhysicalDevice() const noexcept { return m_device; }
+
+  [[nodiscard]] inline const VkPhysicalDeviceProperties& getProperties() const noexcept { return m_properties; }
+
+  [[nodiscard]] inline const VkPhysicalDeviceMemoryProperties& getMemoryProperties() const noexcept {
+    return m_memoryProperties;
+  }
+
+  [[nodiscard]] bool isExtensionSupported(std::string_view name) const {
+    return ranges::any_of(m_extensions,
+                          [name](const VkExtensionProperties& prop) { return name == prop.extensionName; });
+  }
+
+  [[nodiscard]] std::optional<uint32_t> findQueueFamily(VkQueueFlags flags) const {
+    const auto it = ranges::find_if(m_queueFamilies, [flags](const VkQueueFamilyProperties& family) {
+      return (family.queueFlags & flags) == flags;
+    });
+    if (it == std::end(m_queueFamilies))
+      return std::nullopt;
+
+    return static_cast<uint32_t>(std::distance(std::begin(m_queueFamilies), it));
+  }
+
+private:
+  VkPhysicalDevice m_device;
+  std::vector<VkExtensionProperties> m_extensions;
+  std::vector<VkQueueFamilyProperties> m_queueFamilies;
+  VkPhysicalDeviceProperties m_properties{};
+  VkPhysicalDeviceMemoryProperties m_memoryProperties{};
+};
+
+struct BufferAllocation {
+  VkBuffer buffer = VK_NULL_HANDLE;
+  VkDeviceMemory memory = VK_NULL_HANDLE;
+  VkDeviceSize size = 0;
+  // Persistently mapped when the memory is host visible.
+  void* mapped = nullptr;
+};
+
+struct ImageAllocation {
+  VkImage image = VK_NULL_HANDLE;
+  VkImageView view = VK_NULL_HANDLE;
+  VkDeviceMemory memory = VK_NULL_HANDLE;
+  VkExtent2D extent{};
+  VkFormat format = VK_FORMAT_UNDEFINED;
+  uint32_t mipLevels = 1;
+};
+
+void imageBarrier(VkCommandBuffer commandBuffer, VkImage image, VkImageAspectFlags aspect, VkImageLayout oldLayout,
+                  VkImageLayout newLayout, VkPipelineStageFlags2 srcStage, VkAccessFlags2 srcAccess,
+                  VkPipelineStageFlags2 dstStage, VkAccessFlags2 dstAccess) {
+  const VkImageMemoryBarrier2 barrier{.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+                                      .srcStageMask = srcStage,
+                                      .srcAccessMask = srcAccess,
+                                      .dstStageMask = dstStage,
+                                      .dstAccessMask = dstAccess,
+                                      .oldLayout = oldLayout,
+                                      .newLayout = newLayout,
+                                      .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                                      .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                                      .image = image,
+                                      .subresourceRange = {.aspectMask = aspect,
+                                                           .levelCount = VK_REMAINING_MIP_LEVELS,
+                                                           .layerCount = 1}};
+  const VkDependencyInfo dependency{.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+                                    .imageMemoryBarrierCount = 1,
+                                    .pImageMemoryBarriers = &barrier};
+  vkCmdPipelineBarrier2(commandBuffer, &dependency);
+}
+
+void memoryBarrier(VkCommandBuffer commandBuffer, VkPipelineStageFlags2 srcStage, VkAccessFlags2 srcAccess,
+                   VkPipelineStageFlags2 dstStage, VkAccessFlags2 dstAccess) {
+  const VkMemoryBarrier2 barrier{.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+                                 .srcStageMask = srcStage,
+                                 .srcAccessMask = srcAccess,
+                                 .dstStageMask = dstStage,
+                                 .dstAccessMask = dstAccess};
+  const VkDependencyInfo dependency{.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+                                    .memoryBarrierCount = 1,
+                                    .pMemoryBarriers = &barrier};
+  vkCmdPipelineBarrier2(commandBuffer, &dependency);
+}
+
+// Logical device with a single graphics and compute queue and the features GPU driven rendering relies on: indirect
+// draws with a count read from a buffer, and a first instance in the indirect commands.
+class Device {
+public:
+  static std::expected<Device, std::string> create(const PhysicalDevice& physicalDevice,
+                                                   std::vector<std::string> requestedDeviceExtensions) {
+    Device device{physicalDevice, std::move(requestedDeviceExtensions)};
+
+    if (device.init())
+      return device;
+    else
+      return std::unexpected(std::string{"Failed to create the vulkan device"});
+  }
+
+  ~Device() {
+    if (m_device == VK_NULL_HANDLE)
+      return;
+
+    vkDeviceWaitIdle(m_device);
+    vkDestroyFence(m_device, m_fence, nullptr);
+    vkDestroySemaphore(m_device, m_timeline, nullptr);
+    vkDestroyCommandPool(m_device, m_commandPool, nullptr);
+    vkDestroyDevice(m_device, nullptr);
+    m_device = VK_NULL_HANDLE;
+  }
+
+  Device& operator=(const Device&) = delete;
+
+  Device(const Device&) = delete;
+
+  Device(Device&& rhs) noexcept {
+    swap(rhs);
+    rhs.m_device = VK_NULL_HANDLE;
+  }
+
+  Device& operator=(Device&& rhs) noexcept {
+    Device tmp{std::move(rhs)};
+    swap(tmp);
+    return *this;
+  }
+
+  [[nodiscard]] inline VkDevice getDevice() const noexcept { return m_device; }
+
+  [[nodiscard]] inline float getTimestampPeriod() const noexcept { return m_timestampPeriod; }
+
+  [[nodiscard]] std::optional<uint32_t> findMemoryType(uint32_t typeBits, VkMemoryPropertyFlags required) const {
+    for (uint32_t index = 0; index < m_memoryProperties.memoryTypeCount; ++index) {
+      const auto flags = m_memoryProperties.memoryTypes[index].propertyFlags;
+      if ((typeBits & (1u << index)) && (flags & required) == required)
+        return index;
+    }
+    return std::nullopt;
+  }
+
+  BufferAllocation createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties) {
+    const VkBufferCreateInfo bufferInfo{.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+                                        .size = size,
+                                        .usage = usage,
+                                        .sharingMode = VK_SHARING_MODE_EXCLUSIVE};
+    BufferAllocation allocation{.size = size};
+    VK_CALL(vkCreateBuffer(m_device, &bufferInfo, nullptr, &allocation.buffer));
+
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements(m_device, allocation.buffer, &requirements);
+
+    const auto memoryTypeIndex = findMemoryType(requirements.memoryTypeBits, properties);
+    if (!memoryTypeIndex.has_value()) {
+      std::println("No memory type for a buffer of {} bytes", size);
+      std::exit(EXIT_FAILURE);
+    }
+
+    const VkMemoryAllocateInfo allocateInfo{.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+                                            .allocationSize = requirements.size,
+                                            .memoryTypeIndex = memoryTypeIndex.value()};
+    VK_CALL(vkAllocateMemory(m_device, &allocateInfo, nullptr, &allocation.memory));
+    VK_CALL(vkBindBufferMemory(m_device, allocation.buffer, allocation.memory, 0));
+
+    if (properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+      VK_CALL(vkMapMemory(m_device, allocation.memory, 0, VK_WHOLE_SIZE, 0, &allocation.mapped));
+    return allocation;
+  }
+
+  // A device local buffer filled through a staging buffer.
+  BufferAllocation createBuffer(std::span<const std::byte> contents, VkBufferUsageFlags usage) {
+    auto allocation =
+        createBuffer(contents.size(), usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    auto staging = createBuffer(contents.size(), VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    std::memcpy(staging.mapped, contents.data(), contents.size());
+
+    immediateSubmit([&](VkCommandBuffer commandBuffer) {
+      const VkBufferCopy region{.size = contents.size()};
+      vkCmdCopyBuffer(commandBuffer, staging.buffer, allocation.buffer, 1, &region);
+    });
+    destroyBuffer(staging);
+    return allocation;
+  }
+
+  void destroyBuffer(BufferAllocation& allocation) {
+    vkDestroyBuffer(m_device, allocation.buffer, nullptr);
+    vkFreeMemory(m_device, allocation.memory, nullptr);
+    allocation = BufferAllocation{};
+  }
+
+  ImageAllocation createImage(VkExtent2D extent, VkFormat format, VkImageUsageFlags usage, VkImageAspectFlags aspect,
+                              uint32_t mipLevels = 1) {
+    const VkImageCreateInfo imageInfo{.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+                                      .imageType = VK_IMAGE_TYPE_2D,
+                                      .format = format,
+                                      .extent = {extent.width, extent.height, 1},
+                                      .mipLevels = mipLevels,
+                                      .arrayLayers = 1,
+                                      .samples = VK_SAMPLE_COUNT_1_BIT,
+                                      .tiling = VK_IMAGE_TILING_OPTIMAL,
+                                      .usage = usage,
+                                      .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+                                      .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED};
+    ImageAllocation allocation{.extent = extent, .format = format, .mipLevels = mipLevels};
+    VK_CALL(vkCreateImage(m_device, &imageInfo, nullptr, &allocation.image));
+
+    VkMemoryRequirements requirements;
+    vkGetImageMemoryRequirements(m_device, allocation.image, &requirements);
+
+    const auto memoryTypeIndex = findMemoryType(requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    const VkMemoryAllocateInfo allocateInfo{.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+                                            .allocationSize = requirements.size,
+                                            .memoryTypeIndex = memoryTypeIndex.value_or(0)};
+    VK_CALL(vkAllocateMemory(m_device, &allocateInfo, nullptr, &allocation.memory));
+    VK_CALL(vkBindImageMemory(m_device, allocation.image, allocation.memory, 0));
+
+    allocation.view = createImageView(allocation.image, format, aspect, 0, mipLevels);
+    return allocation;
+  }
+
+  VkImageView createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspect, uint32_t baseMipLevel,
+                              uint32_t levelCount) {
+    const VkImageViewCreateInfo viewInfo{.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+                                         .image = image,
+                                         .viewType = VK_IMAGE_VIEW_TYPE_2D,
+                                         .format = format,
+                                         .subresourceRange = {.aspectMask = aspect,
+                                                              .baseMipLevel = baseMipLevel,
+                                                              .levelCount = levelCount,
+                                                              .layerCount = 1}};
+    VkImageView view = VK_NULL_HANDLE;
+    VK_CALL(vkCreateImageView(m_device, &viewInfo, nullptr, &view));
+    return view;
+  }
+
+  void destroyImage(ImageAllocation& allocation) {
+    vkDestroyImageView(m_device, allocation.view, nullptr);
+    vkDestroyImage(m_device, allocation.image, nullptr);
+    vkFreeMemory(m_device, allocation.memory, nullptr);
+    allocation = ImageAllocation{};
+  }
+
+  VkCommandBuffer allocateCommandBuffer() {
+    const VkCommandBufferAllocateInfo commandBufferInfo{.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+                                                        .commandPool = m_commandPool,
+                                                        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+                                                        .commandBufferCount = 1};
+    VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+    VK_CALL(vkAllocateCommandBuffers(m_device, &commandBufferInfo, &commandBuffer));
+    return commandBuffer;
+  }
+
+  template <typename Recorder>
+  void immediateSubmit(Recorder&& record) {
+    const auto commandBuffer = allocateCommandBuffer();
+
+    const VkCommandBufferBeginInfo beginInfo{.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+                                             .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT};
+    VK_CALL(vkBeginCommandBuffer(commandBuffer, &beginInfo));
+    record(commandBuffer);
+    VK_CALL(vkEndCommandBuffer(commandBuffer));
+
+    const VkSubmitInfo submitInfo{.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+                                  .commandBufferCount = 1,
+                                  .pCommandBuffers = &commandBuffer};
+    VK_CALL(vkQueueSubmit(m_queue, 1, &submitInfo, m_fence));
+    VK_CALL(vkWaitForFences(m_device, 1, &m_fence, VK_TRUE, UINT64_MAX));
+    VK_CALL(vkResetFences(m_device, 1, &m_fence));
+    vkFreeCommandBuffers(m_device, m_commandPool, 1, &commandBuffer);
+  }
+
+  // Returns the timeline value that is signaled once the command buffer has completed.
+  uint64_t submit(VkCommandBuffer commandBuffer) {
+    const auto signalValue = ++m_timelineValue;
+
+    const VkCommandBufferSubmitInfo commandBufferInfo{.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO,
+                                                      .commandBuffer = commandBuffer};
+    const VkSemaphoreSubmitInfo signalInfo{.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+                                           .semaphore = m_timeline,
+                                           .value = signalValue,
+                                           .stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT};
+    const VkSubmitInfo2 submitInfo{.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2,
+                                   .commandBufferInfoCount = 1,
+                                   .pCommandBufferInfos = &commandBufferInfo,
+                                   .signalSemaphoreInfoCount = 1,
+                                   .pSignalSemaphoreInfos = &signalInfo};
+    VK_CALL(vkQueueSubmit2(m_queue, 1, &submitInfo, VK_NULL_HANDLE));
+    return signalValue;
+  }
+
+  void waitTimeline(uint64_t value) const {
+    const VkSemaphoreWaitInfo waitInfo{.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+                                       .semaphoreCount = 1,
+                                       .pSemaphores = &m_timeline,
+                                       .pValues = &value};
+    VK_CALL(vkWaitSemaphores(m_device, &waitInfo, UINT64_MAX));
+  }
+
+private:
+  Device(const PhysicalDevice& physicalDevice, std::vector<std::string> requestedDeviceExtensions)
+      : m_physicalDevice{physicalDevice.getPhysicalDevice()},
+        m_memoryProperties{physicalDevice.getMemoryProperties()},
+        m_timestampPeriod{physicalDevice.getProperties().limits.timestampPeriod} {
+    // clang-format off
+    m_enabledExtensions = requestedDeviceExtensions
+      | views::filter([&physicalDevice](const std::string& name) {
+          return physicalDevice.isExtensionSupported(name);
+        })
+      | ranges::to<std::vector<std::string>>();
+    // clang-format on
+
+    if (const auto family = physicalDevice.findQueueFamily(VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))
+      m_queueFamilyIndex = family.value();
+  }
+
+  bool init() {
+    auto extensions = m_enabledExtensions | views::transform(std::mem_fn(&std::string::c_str)) |
+                      ranges::to<std::vector<const char*>>();
+
+    VkPhysicalDeviceVulkan13Features features13{.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES,
+                                                .synchronization2 = VK_TRUE,
+                                                .dynamicRendering = VK_TRUE};
+    VkPhysicalDeviceVulkan12Features features12{.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
+                                                .pNext = &features13,
+                                                .timelineSemaphore = VK_TRUE};
+    const VkPhysicalDeviceFeatures2 features{.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+                                             .pNext = &features12};
+
+    const float queuePriority = 1.0f;
+    const VkDeviceQueueCreateInfo queueInfo{.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
+                                            .queueFamilyIndex = m_queueFamilyIndex,
+                                            .queueCount = 1,
+                                            .pQueuePriorities = &queuePriority};
+
+    const VkDeviceCreateInfo deviceInfo{.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
+                                        .pNext = &features,
+                                        .queueCreateInfoCount = 1,
+                                        .pQueueCreateInfos = &queueInfo,
+                                        .enabledExtensionCount = static_cast<uint32_t>(extensions.size()),
+                                        .ppEnabledExtensionNames = extensions.data()};
+
+    if (vkCreateDevice(m_physicalDevice, &deviceInfo, nullptr, &m_device) != VK_SUCCESS)
+      return false;
+
+    vkGetDeviceQueue(m_device, m_queueFamilyIndex, 0, &m_queue);
+
+    const VkCommandPoolCreateInfo poolInfo{.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+                                           .flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+                                           .queueFamilyIndex = m_queueFamilyIndex};
+    VK_CALL(vkCreateCommandPool(m_device, &poolInfo, nullptr, &m_commandPool));
+
+    const VkFenceCreateInfo fenceInfo{.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
+    VK_CALL(vkCreateFence(m_device, &fenceInfo, nullptr, &m_fence));
+
+    const VkSemaphoreTypeCreateInfo timelineInfo{.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+                                                 .semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+                                                 .initialValue = 0};
+    const VkSemaphoreCreateInfo semaphoreInfo{.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+                                              .pNext = &timelineInfo};
+    VK_CALL(vkCreateSemaphore(m_device, &semaphoreInfo, nullptr, &m_timeline));
+
+    return true;
+  }
+
+  void swap(Device& rhs) {
+    std::swap(m_physicalDevice, rhs.m_physicalDevice);
+    std::swap(m_memoryProperties, rhs.m_memoryProperties);
+    std::swap(m_timestampPeriod, rhs.m_timestampPeriod);
+    std::swap(m_enabledExtensions, rhs.m_enabledExtensions);
+    std::swap(m_queueFamilyIndex, rhs.m_queueFamilyIndex);
+    std::swap(m_device, rhs.m_device);
+    std::swap(m_queue, rhs.m_queue);
+    std::swap(m_commandPool, rhs.m_commandPool);
+    std::swap(m_fence, rhs.m_fence);
+    std::swap(m_timeline, rhs.m_timeline);
+    std::swap(m_timelineValue, rhs.m_timelineValue);
+  }
+
+private:
+  VkPhysicalDevice m_physicalDevice = VK_NULL_HANDLE;
+  VkPhysicalDeviceMemoryProperties m_memoryProperties{};
+  float m_timestampPeriod = 1.0f;
+  std::vector<std::string> m_enabledExtensions;
+  uint32_t m_queueFamilyIndex = 0;
+  VkDevice m_device = VK_NULL_HANDLE;
+  VkQueue m_queue = VK_NULL_HANDLE;
+  VkCommandPool m_commandPool = VK_NULL_HANDLE;
+  VkFence m_fence = VK_NULL_HANDLE;
+  VkSemaphore m_timeline = VK_NULL_HANDLE;
+  uint64_t m_timelineValue = 0;
+};
+
+class ShaderCompiler {
+public:
+  ShaderCompiler() { glslang::InitializeProcess(); }
+
+  ShaderCompiler(const ShaderCompiler&) = delete;
+  ShaderCompiler& operator=(const ShaderCompiler&) = delete;
+
+  ~ShaderCompiler() { glslang::FinalizeProcess(); }
+
+  std::expected<std::vector<uint32_t>, std::string> compile(std::string_view source,
+                                                            VkShaderStageFlagBits stage) const {
+    const auto language = toLanguage(stage);
+
+    glslang::TShader shader{language};
+    const char* sources[] = {source.data()};
+    const int lengths[] = {static_cast<int>(source.size())};
+    shader.setStringsWithLengths(sources, lengths, 1);
+    shader.setEnvInput(glslang::EShSourceGlsl, language, glslang::EShClientVulkan, 100);
+    shader.setEnvClient(glslang::EShClientVulkan, glslang::EShTargetVulkan_1_3);
+    shader.setEnvTarget(glslang::EShTargetSpv, glslang::EShTargetSpv_1_6);
+
+    const auto messages = static_cast<EShMessages>(EShMsgSpvRules | EShMsgVulkanRules);
+    if (!shader.parse(GetDefaultResources(), 460, false, messages))
+      return std::unexpected(std::string{shader.getInfoLog()});
+
+    glslang::TProgram program;
+    program.addShader(&shader);
+    if (!program.link(messages))
+      return std::unexpected(std::string{program.getInfoLog()});
+
+    std::vector<uint32_t> spirv;
+    glslang::GlslangToSpv(*program.getIntermediate(language), spirv);
+    return spirv;
+  }
+
+private:
+  static EShLanguage toLanguage(VkShaderStageFlagBits stage) {
+    switch (stage) {
+    case VK_SHADER_STAGE_VERTEX_BIT:
+      return EShLangVertex;
+    case VK_SHADER_STAGE_FRAGMENT_BIT:
+      return EShLangFragment;
+    case VK_SHADER_STAGE_COMPUTE_BIT:
+      return EShLangCompute;
+    default:
+      return EShLangVertex;
+    }
+  }
+};
+
+VkShaderModule createShaderModule(VkDevice device, std::span<const uint32_t> spirv) {
+  const VkShaderModuleCreateInfo moduleInfo{.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+                                            .codeSize = spirv.size_bytes(),
+                                            .pCode = spirv.data()};
+  VkShaderModule module = VK_NULL_HANDLE;
+  VK_CALL(vkCreateShaderModule(device, &moduleInfo, nullptr, &module));
+  return module;
+}
+
+struct Vertex {
+  glm::vec3 position;
+  glm::vec3 normal;
+  glm::vec2 uv;
+};
+static_assert(sizeof(Vertex) == 32);
+
+struct MeshData {
+  std::vector<Vertex> vertices;
+  std::vector<uint32_t> indices;
+};
+
+// Half the size of Vertex. Positions are snorm16 relative to the bounds of the mesh, normals are snorm16 octahedral
+// and texture coordinates are half floats, all of which the vertex input unpacks for free.
+struct PackedVertex {
+  int16_t position[4];
+  int16_t normal[2];
+  uint16_t uv[2];
+};
+static_assert(sizeof(PackedVertex) == 16);
+
+struct MeshletBounds {
+  float center[3];
+  float radius;
+  int8_t coneAxis[3];
+  int8_t coneCutoff;
+};
+static_assert(sizeof(MeshletBounds) == 20);
+
+struct ProcessedMesh {
+  glm::vec3 center{0.0f};
+  float scale = 1.0f;
+  // The optimized vertices before quantization, in the same order as the packed ones.
+  std::vector<Vertex> vertices;
+  std::vector<PackedVertex> packedVertices;
+  std::vector<uint32_t> indices;
+  std::vector<meshopt_Meshlet> meshlets;
+  std::vector<uint32_t> meshletVertices;
+  std::vector<uint8_t> meshletTriangles;
+  std::vector<MeshletBounds> meshletBounds;
+};
+
+struct MeshStatistics {
+  meshopt_VertexCacheStatistics cacheBefore{};
+  meshopt_VertexCacheStatistics cacheAfter{};
+  meshopt_OverdrawStatistics overdrawBefore{};
+  meshopt_OverdrawStatistics overdrawAfter{};
+  meshopt_VertexFetchStatistics fetchBefore{};
+  meshopt_VertexFetchStatistics fetchAfter{};
+};
+
+glm::vec2 encodeOctahedral(glm::vec3 normal) {
+  normal /= std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+  if (normal.z >= 0.0f)
+    return glm::vec2{normal.x, normal.y};
+  // The lower hemisphere is folded over the diagonals.
+  return glm::vec2{(1.0f - std::abs(normal.y)) * (normal.x >= 0.0f ? 1.0f : -1.0f),
+                   (1.0f - std::abs(normal.x)) * (normal.y >= 0.0f ? 1.0f : -1.0f)};
+}
+
+glm::vec3 decodeOctahedral(glm::vec2 encoded) {
+  glm::vec3 normal{encoded.x, encoded.y, 1.0f - std::abs(encoded.x) - std::abs(encoded.y)};
+  const auto fold = std::max(-normal.z, 0.0f);
+  normal.x += normal.x >= 0.0f ? -fold : fold;
+  normal.y += normal.y >= 0.0f ? -fold : fold;
+  return glm::normalize(normal);
+}
+
+PackedVertex packVertex(const Vertex& vertex, glm::vec3 center, float scale) {
+  const auto position = (vertex.position - center) / scale;
+  const auto normal = encodeOctahedral(vertex.normal);
+  return PackedVertex{.position = {static_cast<int16_t>(meshopt_quantizeSnorm(position.x, 16)),
+                                   static_cast<int16_t>(meshopt_quantizeSnorm(position.y, 16)),
+                                   static_cast<int16_t>(meshopt_quantizeSnorm(position.z, 16)), 0},
+                      .normal = {static_cast<int16_t>(meshopt_quantizeSnorm(normal.x, 16)),
+                                 static_cast<int16_t>(meshopt_quantizeSnorm(normal.y, 16))},
+                      .uv = {meshopt_quantizeHalf(vertex.uv.x), meshopt_quantizeHalf(vertex.uv.y)}};
+}
+
+// What the vertex input does with the formats the packed pipeline declares.
+Vertex unpackVertex(const PackedVertex& vertex, glm::vec3 center, float scale) {
+  const auto snorm = [](int16_t value) { return std::max(static_cast<float>(value) / 32767.0f, -1.0f); };
+  const glm::vec3 position{snorm(vertex.position[0]), snorm(vertex.position[1]), snorm(vertex.position[2])};
+  return Vertex{.position = position * scale + center,
+                .normal = decodeOctahedral(glm::vec2{snorm(vertex.normal[0]), snorm(vertex.normal[1])}),
+                .uv = glm::vec2{glm::unpackHalf1x16(vertex.uv[0]), glm::unpackHalf1x16(vertex.uv[1])}};
+}
+
+// Welds duplicated vertices, reorders the triangles for the post transform cache and then for overdraw, reorders the
+// vertices in the order the triangles use them, splits the result into meshlets and finally quantizes the vertices.
+ProcessedMesh processMesh(const MeshData& mesh, MeshStatistics& statistics) {
+  constexpr size_t kMaxMeshletVertices = 64;
+  constexpr size_t kMaxMeshletTriangles = 124;
+  constexpr float kConeWeight = 0.25f;
+  constexpr unsigned int kCacheSize = 16;
+  // Allows the overdraw optimization to make the cache efficiency up to 5% worse.
+  constexpr float kOverdrawThreshold = 1.05f;
+
+  ProcessedMesh result;
+
+  std::vector<uint32_t> remap(mesh.vertices.size());
+  const auto vertexCount = meshopt_generateVertexRemap(remap.data(), mesh.indices.data(), mesh.indices.size(),
+                                                       mesh.vertices.data(), mesh.vertices.size(), sizeof(Vertex));
+  result.vertices.resize(vertexCount);
+  result.indices.resize(mesh.indices.size());
+  meshopt_remapVertexBuffer(result.vertices.data(), mesh.vertices.data(), mesh.vertices.size(), sizeof(Vertex),
+                            remap.data());
+  meshopt_remapIndexBuffer(result.indices.data(), mesh.indices.data(), mesh.indices.size(), remap.data());
+
+  auto& vertices = result.vertices;
+  auto& indices = result.indices;
+  const auto analyze = [&](meshopt_VertexCacheStatistics& cache, meshopt_OverdrawStatistics& overdraw,
+                           meshopt_VertexFetchStatistics& fetch) {
+    cache = meshopt_analyzeVertexCache(indices.data(), indices.size(), vertexCount, kCacheSize, 0, 0);
+    overdraw = meshopt_analyzeOverdraw(indices.data(), indices.size(), &vertices.front().position.x, vertexCount,
+                                       sizeof(Vertex));
+    fetch = meshopt_analyzeVertexFetch(indices.data(), indices.size(), vertexCount, sizeof(Vertex));
+  };
+
+  analyze(statistics.cacheBefore, statistics.overdrawBefore, statistics.fetchBefore);
+  meshopt_optimizeVertexCache(indices.data(), indices.data(), indices.size(), vertexCount);
+  meshopt_optimizeOverdraw(indices.data(), indices.data(), indices.size(), &vertices.front().position.x, vertexCount,
+                           sizeof(Vertex), kOverdrawThreshold);
+  meshopt_optimizeVertexFetch(vertices.data(), indices.data(), indices.size(), vertices.data(), vertexCount,
+                              sizeof(Vertex));
+  analyze(statistics.cacheAfter, statistics.overdrawAfter, statistics.fetchAfter);
+
+  const auto maxMeshlets = meshopt_buildMeshletsBound(indices.size(), kMaxMeshletVertices, kMaxMeshletTriangles);
+  result.meshlets.resize(maxMeshlets);
+  result.meshletVertices.resize(maxMeshlets * kMaxMeshletVertices);
+  result.meshletTriangles.resize(maxMeshlets * kMaxMeshletTriangles * 3);
+  const auto meshletCount = meshopt_buildMeshlets(
+      result.meshlets.data(), result.meshletVertices.data(), result.meshletTriangles.data(), indices.data(),
+      indices.size(), &vertices.front().position.x, vertexCount, sizeof(Vertex), kMaxMeshletVertices,
+      kMaxMeshletTriangles, kConeWeight);
+
+  // The bound is generous, trim to what the last meshlet uses. Triangles of a meshlet start 4 bytes aligned.
+  const auto last = result.meshlets[meshletCount - 1];
+  result.meshlets.resize(meshletCount);
+  result.meshletVertices.resize(last.vertex_offset + last.vertex_count);
+  result.meshletTriangles.resize(last.triangle_offset + ((last.triangle_count * 3 + 3) & ~3u));
+
+  // clang-format off
+  result.meshletBounds = result.meshlets
+    | views::transform([&](const meshopt_Meshlet& meshlet) {
+        const auto bounds = meshopt_computeMeshletBounds(
+            &result.meshletVertices[meshlet.vertex_offset], &result.meshletTriangles[meshlet.triangle_offset],
+            meshlet.triangle_count, &vertices.front().position.x, vertexCount, sizeof(Vertex));
+        return MeshletBounds{
+            .center = {bounds.center[0], bounds.center[1], bounds.center[2]},
+            .radius = bounds.radius,
+            .coneAxis = {bounds.cone_axis_s8[0], bounds.cone_axis_s8[1], bounds.cone_axis_s8[2]},
+            .coneCutoff = bounds.cone_cutoff_s8};
+      })
+    | ranges::to<std::vector<MeshletBounds>>();
+  // clang-format on
+
+  // A single scale for all axes keeps the quantization error isotropic.
+  auto minimum = vertices.front().position;
+  auto maximum = vertices.front().position;
+  for (const auto& vertex : vertices) {
+    minimum = glm::min(minimum, vertex.position);
+    maximum = glm::max(maximum, vertex.position);
+  }
+  result.center = (minimum + maximum) * 0.5f;
+  const auto halfExtent = (maximum - minimum) * 0.5f;
+  result.scale = std::max({halfExtent.x, halfExtent.y, halfExtent.z, std::numeric_limits<float>::min()});
+
+  // clang-format off
+  result.packedVertices = vertices
+    | views::transform([&result](const Vertex& vertex) { return packVertex(vertex, result.center, result.scale); })
+    | ranges::to<std::vector<PackedVertex>>();
+  // clang-format on
+  return result;
+}
+
+enum class MeshSection : uint32_t { Vertices, Indices, Meshlets, MeshletVertices, MeshletTriangles, MeshletBounds };
+constexpr size_t kMeshSectionCount = 6;
+
+struct MeshFileSection {
+  uint64_t offset;
+  uint64_t size;
+};
+
+// The file is a header followed by the sections in MeshSection order. Every section starts on a cache line so it
+// can be used from the mapping as is.
+struct MeshFileHeader {
+  static constexpr uint32_t kMagic = 0x4853454d; // "MESH"
+  static constexpr uint32_t kVersion = 1;
+  static constexpr uint64_t kSectionAlignment = 64;
+
+  uint32_t magic;
+  uint32_t version;
+  uint32_t vertexCount;
+  uint32_t indexCount;
+  // 2 when every index fits in 16 bits, 4 otherwise.
+  uint32_t indexSize;
+  uint32_t meshletCount;
+  float center[3];
+  float scale;
+  std::array<MeshFileSection, kMeshSectionCount> sections;
+};
+
+template <typename T>
+std::span<const std::byte> asBytes(const std::vector<T>& values) {
+  return std::as_bytes(std::span{values});
+}
+
+uint64_t alignUp(uint64_t value, uint64_t alignment) { return (value + alignment - 1) / alignment * alignment; }
+
+std::expected<void, std::string> writeMeshFile(const std::string& path, const ProcessedMesh& mesh) {
+  const auto vertexCount = static_cast<uint32_t>(mesh.packedVertices.size());
+  const auto indexSize = vertexCount <= std::numeric_limits<uint16_t>::max() ? 2u : 4u;
+  std::vector<uint16_t> shortIndices;
+  if (indexSize == 2)
+    shortIndices = mesh.indices | views::transform([](uint32_t index) { return static_cast<uint16_t>(index); }) |
+                   ranges::to<std::vector<uint16_t>>();
+
+  const std::array sections{asBytes(mesh.packedVertices),
+                            indexSize == 2 ? asBytes(shortIndices) : asBytes(mesh.indices),
+                            asBytes(mesh.meshlets),
+                            asBytes(mesh.meshletVertices),
+                            asBytes(mesh.meshletTriangles),
+                            asBytes(mesh.meshletBounds)};
+
+  MeshFileHeader header{.magic = MeshFileHeader::kMagic,
+                        .version = MeshFileHeader::kVersion,
+                        .vertexCount = vertexCount,
+                        .indexCount = static_cast<uint32_t>(mesh.indices.size()),
+                        .indexSize = indexSize,
+                        .meshletCount = static_cast<uint32_t>(mesh.meshlets.size()),
+                        .center = {mesh.center.x, mesh.center.y, mesh.center.z},
+                        .scale = mesh.scale};
+  auto offset = alignUp(sizeof(header), MeshFileHeader::kSectionAlignment);
+  for (size_t index = 0; index < kMeshSectionCount; ++index) {
+    header.sections[index] = MeshFileSection{.offset = offset, .size = sections[index].size()};
+    offset = alignUp(offset + sections[index].size(), MeshFileHeader::kSectionAlignment);
+  }
+
+  std::ofstream file{path, std::ios::binary | std::ios::trunc};
+  if (!file)
+    return std::unexpected(std::format("Unable to open {} for writing", path));
+
+  const std::array<char, MeshFileHeader::kSectionAlignment> padding{};
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  uint64_t written = sizeof(header);
+  for (size_t index = 0; index < kMeshSectionCount; ++index) {
+    file.write(padding.data(), static_cast<std::streamsize>(header.sections[index].offset - written));
+    file.write(reinterpret_cast<const char*>(sections[index].data()),
+               static_cast<std::streamsize>(sections[index].size()));
+    written = header.sections[index].offset + sections[index].size();
+  }
+
+  if (!file)
+    return std::unexpected(std::format("Unable to write {}", path));
+  return {};
+}
+
+// A read only mapping of a whole file. Pages are only read from disk when they are first touched.
+class MappedFile {
+public:
+  static std::expected<MappedFile, std::string> create(const std::string& path) {
+    MappedFile file;
+
+    if (file.init(path))
+      return file;
+    else
+      return std::unexpected(std::format("Unable to map {}", path));
+  }
+
+  ~MappedFile() {
+    if (m_data == nullptr)
+      return;
+
+#if defined(_WIN32)
+    UnmapViewOfFile(m_data);
+    CloseHandle(m_mapping);
+#else
+    ::munmap(m_data, m_size);
+#endif
+    m_data = nullptr;
+  }
+
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  MappedFile(const MappedFile&) = delete;
+
+  MappedFile(MappedFile&& rhs) noexcept {
+    swap(rhs);
+    rhs.m_data = nullptr;
+  }
+
+  MappedFile& operator=(MappedFile&& rhs) noexcept {
+    MappedFile tmp{std::move(rhs)};
+    swap(tmp);
+    return *this;
+  }
+
+  [[nodiscard]] inline std::span<const std::byte> getData() const noexcept {
+    return std::span{static_cast<const std::byte*>(m_data), m_size};
+  }
+
+private:
+  MappedFile() = default;
+
+  bool init(const std::string& path) {
+#if defined(_WIN32)
+    const auto file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                  FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+      return false;
+
+    LARGE_INTEGER size{};
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+      CloseHandle(file);
+      return false;
+    }
+
+    m_mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (m_mapping == nullptr)
+      return false;
+
+    m_data = MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+    if (m_data == nullptr) {
+      CloseHandle(m_mapping);
+      return false;
+    }
+    m_size = static_cast<size_t>(size.QuadPart);
+#else
+    const int file = ::open(path.c_str(), O_RDONLY);
+    if (file < 0)
+      return false;
+
+    struct stat status {};
+    if (::fstat(file, &status) != 0 || status.st_size == 0) {
+      ::close(file);
+      return false;
+    }
+
+    const auto size = static_cast<size_t>(status.st_size);
+    void* data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+    ::close(file);
+    if (data == MAP_FAILED)
+      return false;
+
+    // The whole file is uploaded right away, start reading it in.
+    ::madvise(data, size, MADV_WILLNEED);
+    m_data = data;
+    m_size = size;
+#endif
+    return true;
+  }
+
+  void swap(MappedFile& rhs) {
+    std::swap(m_data, rhs.m_data);
+    std::swap(m_size, rhs.m_size);
+#if defined(_WIN32)
+    std::swap(m_mapping, rhs.m_mapping);
+#endif
+  }
+
+private:
+  void* m_data = nullptr;
+  size_t m_size = 0;
+#if defined(_WIN32)
+  HANDLE m_mapping = nullptr;
+#endif
+};
+
+// Validates a mesh file in memory and hands out its sections without copying them.
+class MeshFileView {
+public:
+  static std::expected<MeshFileView, std::string> create(std::span<const std::byte> data) {
+    if (data.size() < sizeof(MeshFileHeader))
+      return std::unexpected(std::string{"The file is too small for a mesh header"});
+
+    MeshFileHeader header;
+    std::memcpy(&header, data.data(), sizeof(header));
+    if (header.magic != MeshFileHeader::kMagic || header.version != MeshFileHeader::kVersion)
+      return std::unexpected(std::format("Not a version {} mesh file", MeshFileHeader::kVersion));
+    if (header.indexSize != 2 && header.indexSize != 4)
+      return std::unexpected(std::format("Invalid index size {}", header.indexSize));
+
+    for (size_t index = 0; index < kMeshSectionCount; ++index) {
+      const auto& section = header.sections[index];
+      if (section.size == 0 || section.offset % MeshFileHeader::kSectionAlignment != 0 ||
+          section.offset > data.size() || section.size > data.size() - section.offset)
+        return std::unexpected(std::format("Section {} is empty, misaligned or out of bounds", index));
+    }
+
+    // uploadMesh copies everything from the first section to the end of the last one in one go, so the sections have
+    // to follow each other in order with nothing but the alignment padding in between.
+    auto expectedOffset = alignUp(sizeof(MeshFileHeader), MeshFileHeader::kSectionAlignment);
+    for (size_t index = 0; index < kMeshSectionCount; ++index) {
+      const auto& section = header.sections[index];
+      if (section.offset != expectedOffset)
+        return std::unexpected(std::format("Section {} does not follow the previous one", index));
+      expectedOffset = alignUp(section.offset + section.size, MeshFileHeader::kSectionAlignment);
+    }
+
+    const auto expectSize = [&header](MeshSection section, uint64_t size) {
+      return header.sections[static_cast<size_t>(section)].size == size;
+    };
+    if (!expectSize(MeshSection::Vertices, uint64_t{header.vertexCount} * sizeof(PackedVertex)) ||
+        !expectSize(MeshSection::Indices, uint64_t{header.indexCount} * header.indexSize) ||
+        !expectSize(MeshSection::Meshlets, uint64_t{header.meshletCount} * sizeof(meshopt_Meshlet)) ||
+        !expectSize(MeshSection::MeshletBounds, uint64_t{header.meshletCount} * sizeof(MeshletBounds)) ||
+        header.sections[static_cast<size_t>(MeshSection::MeshletVertices)].size % sizeof(uint32_t) != 0)
+      return std::unexpected(std::string{"The section sizes do not match the header"});
+
+    MeshFileView view{data, header};
+    if (auto valid = view.validateIndices(); !valid)
+      return std::unexpected(valid.error());
+    if (auto valid = view.validateMeshlets(); !valid)
+      return std::unexpected(valid.error());
+    return view;
+  }
+
+  [[nodiscard]] inline const MeshFileHeader& getHeader() const noexcept { return m_header; }
+
+  [[nodiscard]] inline VkIndexType getIndexType() const noexcept {
+    return m_header.indexSize == 2 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+  }
+
+  [[nodiscard]] std::span<const std::byte> getSection(MeshSection section) const {
+    const auto& range = m_header.sections[static_cast<size_t>(section)];
+    return m_data.subspan(range.offset, range.size);
+  }
+
+  // Sections are aligned within the file and mappings are page aligned.
+  template <typename T>
+  [[nodiscard]] std::span<const T> getSectionAs(MeshSection section) const {
+    const auto bytes = getSection(section);
+    return std::span{reinterpret_cast<const T*>(bytes.data()), bytes.size() / sizeof(T)};
+  }
+
+private:
+  MeshFileView(std::span<const std::byte> data, const MeshFileHeader& header) : m_data{data}, m_header{header} {}
+
+  // An index past the vertex buffer would make the GPU read out of bounds.
+  [[nodiscard]] std::expected<void, std::string> validateIndices() const {
+    const auto isInRange = [this](auto index) { return index < m_header.vertexCount; };
+    const auto valid = m_header.indexSize == 2
+                           ? ranges::all_of(getSectionAs<uint16_t>(MeshSection::Indices), isInRange)
+                           : ranges::all_of(getSectionAs<uint32_t>(MeshSection::Indices), isInRange);
+    if (!valid)
+      return std::unexpected(std::format("An index is past the {} vertices", m_header.vertexCount));
+    return {};
+  }
+
+  // Every meshlet has to reference a range inside the meshlet vertex and triangle sections, which in turn have to
+  // reference vertices of the mesh and of the meshlet.
+  [[nodiscard]] std::expected<void, std::string> validateMeshlets() const {
+    const auto meshletVertices = getSectionAs<uint32_t>(MeshSection::MeshletVertices);
+    const auto meshletTriangles = getSectionAs<uint8_t>(MeshSection::MeshletTriangles);
+    for (const auto [meshletIndex, meshlet] : views::enumerate(getSectionAs<meshopt_Meshlet>(MeshSection::Meshlets))) {
+      if (uint64_t{meshlet.vertex_offset} + meshlet.vertex_count > meshletVertices.size() ||
+          uint64_t{meshlet.triangle_offset} + uint64_t{meshlet.triangle_count} * 3 > meshletTriangles.size())
+        return std::unexpected(std::format("Meshlet {} is out of bounds", meshletIndex));
+
+      const auto vertices = meshletVertices.subspan(meshlet.vertex_offset, meshlet.vertex_count);
+      const auto triangles = meshletTriangles.subspan(meshlet.triangle_offset, meshlet.triangle_count * 3);
+      if (!ranges::all_of(vertices, [this](uint32_t vertex) { return vertex < m_header.vertexCount; }) ||
+          !ranges::all_of(triangles, [&meshlet](uint8_t vertex) { return vertex < meshlet.vertex_count; }))
+        return std::unexpected(std::format("Meshlet {} references a vertex it does not have", meshletIndex));
+    }
+    return {};
+  }
+
+private:
+  std::span<const std::byte> m_data;
+  MeshFileHeader m_header;
+};
+
+struct MeshBuffers {
+  std::array<BufferAllocation, kMeshSectionCount> sections;
+  uint32_t indexCount = 0;
+  VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+  // Center in xyz and scale in w, to turn the packed positions back into object space.
+  glm::vec4 dequantization{0.0f};
+
+  [[nodiscard]] inline const BufferAllocation& get(MeshSection section) const noexcept {
+    return sections[static_cast<size_t>(section)];
+  }
+};
+
+// The sections are laid out back to back in the file, so the upload is a single copy from the mapping into a staging
+// buffer followed by one buffer copy per section. Nothing is unpacked on the CPU.
+MeshBuffers uploadMesh(Device& device, const MeshFileView& file) {
+  constexpr std::array<VkBufferUsageFlags, kMeshSectionCount> kUsages{
+      VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,  VK_BUFFER_USAGE_INDEX_BUFFER_BIT,   VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT};
+
+  // MeshFileView::create only accepts sections that are in order and back to back.
+  const auto& header = file.getHeader();
+  const auto first = header.sections.front().offset;
+  const auto& last = header.sections.back();
+  const auto payload = file.getSection(MeshSection::Vertices).data();
+  const auto payloadSize = last.offset + last.size - first;
+
+  auto staging = device.createBuffer(payloadSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                     VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+  std::memcpy(staging.mapped, payload, payloadSize);
+
+  MeshBuffers buffers{.indexCount = header.indexCount,
+                      .indexType = file.getIndexType(),
+                      .dequantization = glm::vec4{header.center[0], header.center[1], header.center[2], header.scale}};
+  for (size_t index = 0; index < kMeshSectionCount; ++index)
+    buffers.sections[index] = device.createBuffer(header.sections[index].size,
+                                                  kUsages[index] | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+  device.immediateSubmit([&](VkCommandBuffer commandBuffer) {
+    for (size_t index = 0; index < kMeshSectionCount; ++index) {
+      const VkBufferCopy region{.srcOffset = header.sections[index].offset - first,
+                                .size = header.sections[index].size};
+      vkCmdCopyBuffer(commandBuffer, staging.buffer, buffers.sections[index].buffer, 1, &region);
+    }
+  });
+  device.destroyBuffer(staging);
+  return buffers;
+}
+
+void destroyMesh(Device& device, MeshBuffers& buffers) {
+  for (auto& buffer : buffers.sections)
+    device.destroyBuffer(buffer);
+}
+
+class Context {
+public:
+  static std::expected<Context, std::string> create(std::string_view applicationName,
+                                                    std::vector<std::string> requestedInstanceLayer,
+                                                    std::vector<std::string> requestedInstanceExtensions) {
+
+    Context context{applicationName, std::move(requestedInstanceLayer), std::move(requestedInstanceExtensions)};
+
+    if (context.init())
+      return context;
+    else
+      return std::unexpected(std::string{"Failed to init the vulkan context"});
+  }
+
+  ~Context() {
+    if (m_vulkanInstance == VK_NULL_HANDLE)
+      return;
+
+    vkDestroyInstance(m_vulkanInstance, nullptr);
+    m_vulkanInstance = VK_NULL_HANDLE;
+  }
+
+  Context& operator=(const Context&) = delete;
+
+  Context(const Context&) = delete;
+
+  Context(Context&& rhs) noexcept {
+    swap(rhs);
+    rhs.m_vulkanInstance = VK_NULL_HANDLE;
+  }
+
+  Context& operator=(Context&& rhs) noexcept {
+    Context tmp{std::move(rhs)};
+    swap(tmp);
+    return *this;
+  }
+
+  std::vector<PhysicalDevice> enumeratePhysicalDevices() {
+    // clang-format off
+    auto result = VulkanCore::enumeratePhysicalDevices(m_vulkanInstance)
+      | views::transform([](VkPhysicalDevice device) -> PhysicalDevice {
+         return PhysicalDevice{device};
+        })
+      | ranges::to<std::vector<PhysicalDevice>>();
+    // clang-format on
+    return result;
+  }
+
+private:
+  Context(std::string_view applicationName, std::vector<std::string> requestedInstanceLayer,
+          std::vector<std::string> requestedInstanceExtensions)
+      : m_applicationName{applicationName} {
+    auto allInstanceLayers = enumerateInstanceLayerProperties();
+    const auto isInstanceLayerRequired = [&requestedInstanceLayer](const VkLayerProperties& prop) {
+      auto name = std::string{prop.layerName};
+      return ranges::find(requestedInstanceLayer, name) != std::end(requestedInstanceLayer);
+    };
+    // clang-format off
+    m_layerProperties = allInstanceLayers
+      | views::filter(isInstanceLayerRequired)
+      | ranges::to<std::vector<VkLayerProperties>>();
+    // clang-format on
+
+    auto allExtensions = enumerateExtensionsProperties();
+    const auto isExtensionRequired = [&requestedInstanceExtensions](const VkExtensionProperties& prop) {
+      auto name = std::string{prop.extensionName};
+      return ranges::find(requestedInstanceExtensions, name) != std::end(requestedInstanceExtensions);
+    };
+    // clang-format off
+    m_layerExtensions = allExtensions
+      | views::filter(isExtensionRequired)
+      | ranges::to<std::vector<VkExtensionProperties>>();
+    // clang-format on
+  }
+
+  bool init() {
+    // clang-format off
+    auto layers = m_layerProperties
+      | views::transform([](const VkLayerProperties& prop) -> const char*
+        {
+          return prop.layerName;
+        })
+      | ranges::to<std::vector<const char*>>();
+
+      auto extensions = m_layerExtensions
+        | views::transform([](const VkExtensionProperties & prop) -> const char*
+          {
+            return prop.extensionName;
+          })
+        | ranges::to<std::vector<const char*>>();
+    // clang-format on
+
+    const VkApplicationInfo applicationInfo{.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO,
+                                            .pApplicationName = m_applicationName.data(),
+                                            .applicationVersion = VK_MAKE_VERSION(1, 0, 0),
+                                            .apiVersion = VK_API_VERSION_1_3};
+
+    const VkInstanceCreateInfo instanceCreateInfo{.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO,
+#if defined(VK_USE_PLATFORM_METAL_EXT)
+                                                  .flags = VK_INSTANCE_CREATE_ENUMERATE_PORTABILITY_BIT_KHR,
+#endif
+                                                  .pApplicationInfo = &applicationInfo,
+                                                  .enabledLayerCount = static_cast<uint32_t>(layers.size()),
+                                                  .ppEnabledLayerNames = layers.data(),
+                                                  .enabledExtensionCount = static_cast<uint32_t>(extensions.size()),
+                                                  .ppEnabledExtensionNames = extensions.data()};
+
+    const auto res = vkCreateInstance(&instanceCreateInfo, nullptr, &m_vulkanInstance);
+    return res == VK_SUCCESS;
+  }
+
+  void swap(Context& rhs) {
+    std::swap(m_applicationName, rhs.m_applicationName);
+    std::swap(m_layerProperties, rhs.m_layerProperties);
+    std::swap(m_layerExtensions, rhs.m_layerExtensions);
+    std::swap(m_vulkanInstance, rhs.m_vulkanInstance);
+  }
+
+private:
+  std::string m_applicationName;
+  std::vector<VkLayerProperties> m_layerProperties;
+  std::vector<VkExtensionProperties> m_layerExtensions;
+  VkInstance m_vulkanInstance = VK_NULL_HANDLE;
+};
+} // namespace VulkanCore
+
+constexpr std::string_view kFloatVertexShader = R"(
+#version 460
+
+layout(push_constant) uniform PushConstants {
+  mat4 viewProjection;
+  vec4 dequantization;
+  vec2 grid;
+} pushConstants;
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inNormal;
+layout(location = 2) in vec2 inUv;
+
+layout(location = 0) out vec3 outNormal;
+layout(location = 1) out vec2 outUv;
+
+void main() {
+  const uint columns = uint(pushConstants.grid.x);
+  const uint instance = gl_InstanceIndex;
+  const vec3 offset = vec3(instance % columns, (instance / columns) % columns, instance / (columns * columns));
+  gl_Position = pushConstants.viewProjection * vec4(inPosition + offset * pushConstants.grid.y, 1.0);
+  outNormal = inNormal;
+  outUv = inUv;
+}
+)";
+
+constexpr std::string_view kPackedVertexShader = R"(
+#version 460
+
+layout(push_constant) uniform PushConstants {
+  mat4 viewProjection;
+  vec4 dequantization;
+  vec2 grid;
+} pushConstants;
+
+// R16G16B16A16_SNORM, R16G16_SNORM and R16G16_SFLOAT, the vertex input has already turned them into floats.
+layout(location = 0) in vec4 inPosition;
+layout(location = 1) in vec2 inNormal;
+layout(location = 2) in vec2 inUv;
+
+layout(location = 0) out vec3 outNormal;
+layout(location = 1) out vec2 outUv;
+
+vec3 decodeOctahedral(vec2 encoded) {
+  vec3 normal = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+  const float fold = max(-normal.z, 0.0);
+  normal.x += normal.x >= 0.0 ? -fold : fold;
+  normal.y += normal.y >= 0.0 ? -fold : fold;
+  return normalize(normal);
+}
+
+void main() {
+  const uint columns = uint(pushConstants.grid.x);
+  const uint instance = gl_InstanceIndex;
+  const vec3 offset = vec3(instance % columns, (instance / columns) % columns, instance / (columns * columns));
+  const vec3 position = inPosition.xyz * pushConstants.dequantization.w + pushConstants.dequantization.xyz;
+  gl_Position = pushConstants.viewProjection * vec4(position + offset * pushConstants.grid.y, 1.0);
+  outNormal = decodeOctahedral(inNormal);
+  outUv = inUv;
+}
+)";
+
+constexpr std::string_view kFragmentShader = R"(
+#version 460
+
+layout(location = 0) in vec3 inNormal;
+layout(location = 1) in vec2 inUv;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+  const float light = 0.3 + 0.7 * max(dot(normalize(inNormal), normalize(vec3(0.4, 0.8, 0.3))), 0.0);
+  const float checker = mod(floor(inUv.x * 64.0) + floor(inUv.y * 8.0), 2.0);
+  outColor = vec4(mix(vec3(0.9, 0.5, 0.2), vec3(0.2, 0.5, 0.9), checker) * light, 1.0);
+}
+)";
+
+uint32_t parseArgument(std::span<char*> arguments, std::string_view name, uint32_t defaultValue) {
+  for (size_t index = 1; index + 1 < arguments.size(); ++index) {
+    if (std::string_view{arguments[index]} == name) {
+      const std::string_view value{arguments[index + 1]};
+      std::from_chars(value.data(), value.data() + value.size(), defaultValue);
+    }
+  }
+  return defaultValue;
+}
+
+std::string parseString(std::span<char*> arguments, std::string_view name, std::string defaultValue) {
+  for (size_t index = 1; index + 1 < arguments.size(); ++index) {
+    if (std::string_view{arguments[index]} == name)
+      defaultValue = arguments[index + 1];
+  }
+  return defaultValue;
+}
+
+bool hasArgument(std::span<char*> arguments, std::string_view name) {
+  return ranges::any_of(arguments | views::drop(1), [name](const char* argument) { return argument == name; });
+}
+
+// A (2, 3) torus knot tube. The triangles are shuffled the way a careless exporter would leave them, which is what
+// the optimizations have to recover from.
+VulkanCore::MeshData makeTorusKnot(uint32_t segments, uint32_t sides) {
+  constexpr float kTubeRadius = 0.4f;
+  constexpr float kTwoPi = 6.28318530718f;
+
+  const auto curve = [](float angle) {
+    const auto radius = 2.0f + std::cos(3.0f * angle);
+    return glm::vec3{radius * std::cos(2.0f * angle), radius * std::sin(2.0f * angle), -std::sin(3.0f * angle)};
+  };
+
+  VulkanCore::MeshData mesh;
+  for (uint32_t segment = 0; segment <= segments; ++segment) {
+    const auto u = static_cast<float>(segment) / static_cast<float>(segments);
+    const auto center = curve(u * kTwoPi);
+    const auto next = curve(u * kTwoPi + 0.01f);
+    const auto tangent = next - center;
+    const auto bitangent = glm::normalize(glm::cross(tangent, next + center));
+    const auto normal = glm::normalize(glm::cross(bitangent, tangent));
+
+    for (uint32_t side = 0; side <= sides; ++side) {
+      const auto v = static_cast<float>(side) / static_cast<float>(sides);
+      const auto direction = std::cos(v * kTwoPi) * normal + std::sin(v * kTwoPi) * bitangent;
+      mesh.vertices.push_back(VulkanCore::Vertex{.position = center + kTubeRadius * direction,
+                                                 .normal = direction,
+                                                 .uv = glm::vec2{u, v}});
+    }
+  }
+
+  std::vector<std::array<uint32_t, 3>> triangles;
+  for (uint32_t segment = 0; segment < segments; ++segment) {
+    for (uint32_t side = 0; side < sides; ++side) {
+      const auto a = segment * (sides + 1) + side;
+      const auto b = a + sides + 1;
+      triangles.push_back({a, b, a + 1});
+      triangles.push_back({b, b + 1, a + 1});
+    }
+  }
+  std::mt19937 generator{7};
+  ranges::shuffle(triangles, generator);
+  mesh.indices = triangles | views::join | ranges::to<std::vector<uint32_t>>();
+  return mesh;
+}
+
+// Compares what the GPU will see once the packed vertices are unpacked against the optimized float vertices.
+bool verifyQuantization(const VulkanCore::ProcessedMesh& processed, const VulkanCore::MeshFileView& file) {
+  const auto& header = file.getHeader();
+  const glm::vec3 center{header.center[0], header.center[1], header.center[2]};
+  const auto packed = file.getSectionAs<VulkanCore::PackedVertex>(VulkanCore::MeshSection::Vertices);
+
+  float positionError = 0.0f;
+  float normalError = 0.0f;
+  float uvError = 0.0f;
+  for (size_t index = 0; index < packed.size(); ++index) {
+    const auto unpacked = VulkanCore::unpackVertex(packed[index], center, header.scale);
+    const auto& original = processed.vertices[index];
+    positionError = std::max(positionError, glm::length(unpacked.position - original.position));
+    normalError = std::max(normalError, 1.0f - glm::dot(unpacked.normal, original.normal));
+    uvError = std::max(uvError, glm::length(unpacked.uv - original.uv));
+  }
+
+  // Rounding leaves half a step per axis.
+  const auto maxPositionError = std::sqrt(3.0f) * 0.5f * header.scale / 32767.0f * 1.01f;
+  std::println("Largest errors: position {:.6f} (allowed {:.6f}), normal 1 - cos {:.2e}, uv {:.2e}", positionError,
+               maxPositionError, normalError, uvError);
+  return positionError <= maxPositionError && normalError < 1e-6f && uvError < 1e-3f;
+}
+
+VkPipeline createMeshPipeline(VkDevice device, VkPipelineLayout layout, VkShaderModule vertexShader,
+                              VkShaderModule fragmentShader, uint32_t stride,
+                              std::span<const VkVertexInputAttributeDescription> attributes) {
+  const std::array stages{
+      VkPipelineShaderStageCreateInfo{.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+                                      .stage = VK_SHADER_STAGE_VERTEX_BIT,
+                                      .module = vertexShader,
+                                      .pName = "main"},
+      VkPipelineShaderStageCreateInfo{.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+                                      .stage = VK_SHADER_STAGE_FRAGMENT_BIT,
+                                      .module = fragmentShader,
+                                      .pName = "main"},
+  };
+
+  const VkVertexInputBindingDescription binding{.binding = 0,
+                                                .stride = stride,
+                                                .inputRate = VK_VERTEX_INPUT_RATE_VERTEX};
+  const VkPipelineVertexInputStateCreateInfo vertexInput{
+      .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+      .vertexBindingDescriptionCount = 1,
+      .pVertexBindingDescriptions = &binding,
+      .vertexAttributeDescriptionCount = static_cast<uint32_t>(attributes.size()),
+      .pVertexAttributeDescriptions = attributes.data()};
+  const VkPipelineInputAssemblyStateCreateInfo inputAssembly{
+      .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
+      .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST};
+  const VkPipelineViewportStateCreateInfo viewport{.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
+                                                   .viewportCount = 1,
+                                                   .scissorCount = 1};
+  const VkPipelineRasterizationStateCreateInfo rasterization{
+      .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
+      .polygonMode = VK_POLYGON_MODE_FILL,
+      .cullMode = VK_CULL_MODE_NONE,
+      .lineWidth = 1.0f};
+  const VkPipelineMultisampleStateCreateInfo multisample{
+      .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
+      .rasterizationSamples = VK_SAMPLE_COUNT_1_BIT};
+  const VkPipelineDepthStencilStateCreateInfo depthStencil{
+      .sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
+      .depthTestEnable = VK_TRUE,
+      .depthWriteEnable = VK_TRUE,
+      .depthCompareOp = VK_COMPARE_OP_LESS};
+  const VkPipelineColorBlendAttachmentState blendAttachment{
+      .colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT |
+                        VK_COLOR_COMPONENT_A_BIT};
+  const VkPipelineColorBlendStateCreateInfo colorBlend{
+      .sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
+      .attachmentCount = 1,
+      .pAttachments = &blendAttachment};
+  const std::array dynamicStates{VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+  const VkPipelineDynamicStateCreateInfo dynamicState{.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
+                                                      .dynamicStateCount = static_cast<uint32_t>(dynamicStates.size()),
+                                                      .pDynamicStates = dynamicStates.data()};
+
+  constexpr VkFormat kColorFormat = VK_FORMAT_R8G8B8A8_UNORM;
+  const VkPipelineRenderingCreateInfo renderingInfo{.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO,
+                                                    .colorAttachmentCount = 1,
+                                                    .pColorAttachmentFormats = &kColorFormat,
+                                                    .depthAttachmentFormat = VK_FORMAT_D32_SFLOAT};
+
+  const VkGraphicsPipelineCreateInfo pipelineInfo{.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+                                                  .pNext = &renderingInfo,
+                                                  .stageCount = static_cast<uint32_t>(stages.size()),
+                                                  .pStages = stages.data(),
+                                                  .pVertexInputState = &vertexInput,
+                                                  .pInputAssemblyState = &inputAssembly,
+                                                  .pViewportState = &viewport,
+                                                  .pRasterizationState = &rasterization,
+                                                  .pMultisampleState = &multisample,
+                                                  .pDepthStencilState = &depthStencil,
+                                                  .pColorBlendState = &colorBlend,
+                                                  .pDynamicState = &dynamicState,
+                                                  .layout = layout};
+
+  VkPipeline pipeline = VK_NULL_HANDLE;
+  VK_CALL(vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline));
+  return pipeline;
+}
+
+struct PushConstants {
+  glm::mat4 viewProjection;
+  glm::vec4 dequantization;
+  glm::vec2 grid;
+};
+
+double average(std::span<const double> values) {
+  if (values.empty())
+    return 0.0;
+  return std::reduce(std::begin(values), std::end(values)) / static_cast<double>(values.size());
+}
+
+// The offline half processes a generated mesh and writes it to --output, the online half maps that file, uploads it
+// without unpacking anything and draws a grid of instances once with float vertices and once with packed ones, timing
+// each pass on the GPU. --load-only skips the offline half and reads an existing file.
+int main(int argc, char* argv[]) {
+  constexpr VkExtent2D kExtent{1024, 1024};
+  constexpr VkFormat kColorFormat = VK_FORMAT_R8G8B8A8_UNORM;
+  constexpr VkFormat kDepthFormat = VK_FORMAT_D32_SFLOAT;
+  constexpr uint32_t kGridColumns = 4;
+
+  const auto arguments = std::span{argv, static_cast<size_t>(argc)};
+  const auto segments = std::max(3u, parseArgument(arguments, "--segments", 512));
+  const auto frameCount = parseArgument(arguments, "--frames", 50);
+  const auto path = parseString(arguments, "--output", "01_11_mesh.bin");
+  const auto loadOnly = hasArgument(arguments, "--load-only");
+
+  std::optional<VulkanCore::ProcessedMesh> processed;
+  if (!loadOnly) {
+    const auto start = std::chrono::steady_clock::now();
+    const auto mesh = makeTorusKnot(segments, 64);
+    VulkanCore::MeshStatistics statistics;
+    processed = VulkanCore::processMesh(mesh, statistics);
+    const auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    std::println("Processed {} triangles in {:.1f}ms into {} vertices and {} meshlets", mesh.indices.size() / 3,
+                 elapsed, processed->vertices.size(), processed->meshlets.size());
+    std::println("ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}", statistics.cacheBefore.acmr,
+                 statistics.cacheAfter.acmr, statistics.cacheBefore.atvr, statistics.cacheAfter.atvr);
+    std::println("Overdraw {:.3f} -> {:.3f}, vertex overfetch {:.3f} -> {:.3f}", statistics.overdrawBefore.overdraw,
+                 statistics.overdrawAfter.overdraw, statistics.fetchBefore.overfetch, statistics.fetchAfter.overfetch);
+
+    if (const auto written = VulkanCore::writeMeshFile(path, processed.value()); !written) {
+      std::println("Unable to write the mesh: {}", written.error());
+      return EXIT_FAILURE;
+    }
+  }
+
+  auto mappedFile = VulkanCore::MappedFile::create(path);
+  if (!mappedFile) {
+    std::println("Unable to read the mesh: {}", mappedFile.error());
+    return EXIT_FAILURE;
+  }
+  const auto meshFile = VulkanCore::MeshFileView::create(mappedFile->getData());
+  if (!meshFile) {
+    std::println("Unable to read the mesh: {}", meshFile.error());
+    return EXIT_FAILURE;
+  }
+
+  const auto& header = meshFile->getHeader();
+  const auto floatBytes = header.vertexCount * sizeof(VulkanCore::Vertex) + header.indexCount * sizeof(uint32_t);
+  const auto packedBytes = meshFile->getSection(VulkanCore::MeshSection::Vertices).size() +
+                           meshFile->getSection(VulkanCore::MeshSection::Indices).size();
+  std::println("{}: {} bytes, vertices and indices take {} bytes instead of {} ({:.1f}%)", path,
+               mappedFile->getData().size(), packedBytes, floatBytes,
+               100.0 * static_cast<double>(packedBytes) / static_cast<double>(floatBytes));
+
+  if (processed && !verifyQuantization(processed.value(), meshFile.value())) {
+    std::println("The quantization error is larger than expected");
+    return EXIT_FAILURE;
+  }
+
+  // The float baseline is what the packed vertices unpack to, which is all there is when only loading.
+  const glm::vec3 center{header.center[0], header.center[1], header.center[2]};
+  // clang-format off
+  const auto floatVertices = meshFile->getSectionAs<VulkanCore::PackedVertex>(VulkanCore::MeshSection::Vertices)
+    | views::transform([&](const VulkanCore::PackedVertex& vertex) {
+        return VulkanCore::unpackVertex(vertex, center, header.scale);
+      })
+    | ranges::to<std::vector<VulkanCore::Vertex>>();
+  // clang-format on
+
+  const std::string applicationName = "01-11 Mesh pipeline";
+
+  auto vulkanContext =
+      VulkanCore::Context::create(applicationName, getRequestedInstanceLayers(), getRequestedInstanceExtensions());
+
+  if (!vulkanContext) {
+    std::println("Unable to create the context: {}", vulkanContext.error());
+    return EXIT_FAILURE;
+  }
+
+  auto physicalDevices = vulkanContext.value().enumeratePhysicalDevices();
+  if (physicalDevices.empty()) {
+    std::println("No physical devices found");
+    return EXIT_FAILURE;
+  }
+
+  const auto& physicalDevice = physicalDevices.front();
+  auto device = VulkanCore::Device::create(physicalDevice, getRequestedDeviceExtensions());
+  if (!device) {
+    std::println("Unable to create the device: {}", device.error());
+    return EXIT_FAILURE;
+  }
+  const auto vkDevice = device->getDevice();
+
+  const auto uploadStart = std::chrono::steady_clock::now();
+  auto mesh = VulkanCore::uploadMesh(device.value(), meshFile.value());
+  const auto uploadTime =
+      std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - uploadStart).count();
+  std::println("Uploaded the mesh from the mapping in {:.2f}ms", uploadTime);
+  auto floatVertexBuffer = device->createBuffer(std::as_bytes(std::span{floatVertices}),
+                                                VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+
+  VulkanCore::ShaderCompiler compiler;
+  const auto compile = [&compiler, vkDevice](std::string_view source, VkShaderStageFlagBits stage) {
+    const auto spirv = compiler.compile(source, stage);
+    if (!spirv) {
+      std::println("Unable to compile a shader: {}", spirv.error());
+      std::exit(EXIT_FAILURE);
+    }
+    return VulkanCore::createShaderModule(vkDevice, spirv.value());
+  };
+  const auto floatVertexShader = compile(kFloatVertexShader, VK_SHADER_STAGE_VERTEX_BIT);
+  const auto packedVertexShader = compile(kPackedVertexShader, VK_SHADER_STAGE_VERTEX_BIT);
+  const auto fragmentShader = compile(kFragmentShader, VK_SHADER_STAGE_FRAGMENT_BIT);
+
+  const VkPushConstantRange pushConstantRange{.stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+                                              .size = sizeof(PushConstants)};
+  const VkPipelineLayoutCreateInfo layoutInfo{.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+                                              .pushConstantRangeCount = 1,
+                                              .pPushConstantRanges = &pushConstantRange};
+  VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+  VK_CALL(vkCreatePipelineLayout(vkDevice, &layoutInfo, nullptr, &pipelineLayout));
+
+  const std::array floatAttributes{
+      VkVertexInputAttributeDescription{.location = 0,
+                                        .format = VK_FORMAT_R32G32B32_SFLOAT,
+                                        .offset = offsetof(VulkanCore::Vertex, position)},
+      VkVertexInputAttributeDescription{.location = 1,
+                                        .format = VK_FORMAT_R32G32B32_SFLOAT,
+                                        .offset = offsetof(VulkanCore::Vertex, normal)},
+      VkVertexInputAttributeDescription{.location = 2,
+                                        .format = VK_FORMAT_R32G32_SFLOAT,
+                                        .offset = offsetof(VulkanCore::Vertex, uv)},
+  };
+  const std::array packedAttributes{
+      VkVertexInputAttributeDescription{.location = 0,
+                                        .format = VK_FORMAT_R16G16B16A16_SNORM,
+                                        .offset = offsetof(VulkanCore::PackedVertex, position)},
+      VkVertexInputAttributeDescription{.location = 1,
+                                        .format = VK_FORMAT_R16G16_SNORM,
+                                        .offset = offsetof(VulkanCore::PackedVertex, normal)},
+      VkVertexInputAttributeDescription{.location = 2,
+                                        .format = VK_FORMAT_R16G16_SFLOAT,
+                                        .offset = offsetof(VulkanCore::PackedVertex, uv)},
+  };
+  const auto floatPipeline = createMeshPipeline(vkDevice, pipelineLayout, floatVertexShader, fragmentShader,
+                                                sizeof(VulkanCore::Vertex), floatAttributes);
+  const auto packedPipeline = createMeshPipeline(vkDevice, pipelineLayout, packedVertexShader, fragmentShader,
+                                                 sizeof(VulkanCore::PackedVertex), packedAttributes);
+
+  auto color = device->createImage(kExtent, kColorFormat, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+                                   VK_IMAGE_ASPECT_COLOR_BIT);
+  auto depth = device->createImage(kExtent, kDepthFormat, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+                                   VK_IMAGE_ASPECT_DEPTH_BIT);
+
+  const VkQueryPoolCreateInfo queryPoolInfo{.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+                                            .queryType = VK_QUERY_TYPE_TIMESTAMP,
+                                            .queryCount = 3};
+  VkQueryPool queryPool = VK_NULL_HANDLE;
+  VK_CALL(vkCreateQueryPool(vkDevice, &queryPoolInfo, nullptr, &queryPool));
+
+  // The knot spans about 6 units, the grid of kGridColumns^3 knots is seen from a corner.
+  const auto spacing = 7.0f;
+  const auto gridCenter = glm::vec3{spacing * static_cast<float>(kGridColumns - 1) * 0.5f};
+  auto projection = glm::perspective(glm::radians(60.0f), 1.0f, 0.1f, 200.0f);
+  projection[1][1] *= -1.0f;
+  const auto view = glm::lookAt(gridCenter + glm::vec3{1.6f * spacing * static_cast<float>(kGridColumns)},
+                                gridCenter, glm::vec3{0.0f, 1.0f, 0.0f});
+  const PushConstants pushConstants{.viewProjection = projection * view,
+                                    .dequantization = mesh.dequantization,
+                                    .grid = glm::vec2{static_cast<float>(kGridColumns), spacing}};
+  constexpr uint32_t kInstanceCount = kGridColumns * kGridColumns * kGridColumns;
+
+  const auto renderPass = [&](VkCommandBuffer commandBuffer, VkPipeline pipeline, VkBuffer vertexBuffer) {
+    VulkanCore::imageBarrier(commandBuffer, color.image, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_UNDEFINED,
+                             VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+                             VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+                             VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT);
+    VulkanCore::imageBarrier(commandBuffer, depth.image, VK_IMAGE_ASPECT_DEPTH_BIT, VK_IMAGE_LAYOUT_UNDEFINED,
+                             VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+                             VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                             VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+                             VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT |
+                                 VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT);
+
+    const VkRenderingAttachmentInfo colorAttachment{.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
+                                                    .imageView = color.view,
+                                                    .imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                                                    .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+                                                    .storeOp = VK_ATTACHMENT_STORE_OP_STORE};
+    const VkRenderingAttachmentInfo depthAttachment{.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
+                                                    .imageView = depth.view,
+                                                    .imageLayout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
+                                                    .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+                                                    .storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+                                                    .clearValue = {.depthStencil = {.depth = 1.0f}}};
+    const VkRenderingInfo renderingInfo{.sType = VK_STRUCTURE_TYPE_RENDERING_INFO,
+                                        .renderArea = {.offset = {0, 0}, .extent = kExtent},
+                                        .layerCount = 1,
+                                        .colorAttachmentCount = 1,
+                                        .pColorAttachments = &colorAttachment,
+                                        .pDepthAttachment = &depthAttachment};
+    vkCmdBeginRendering(commandBuffer, &renderingInfo);
+
+    const VkViewport viewport{.width = static_cast<float>(kExtent.width),
+                              .height = static_cast<float>(kExtent.height),
+                              .maxDepth = 1.0f};
+    const VkRect2D scissor{.offset = {0, 0}, .extent = kExtent};
+    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+    const VkDeviceSize offset = 0;
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+    vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(pushConstants),
+                       &pushConstants);
+    vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertexBuffer, &offset);
+    vkCmdBindIndexBuffer(commandBuffer, mesh.get(VulkanCore::MeshSection::Indices).buffer, 0, mesh.indexType);
+    vkCmdDrawIndexed(commandBuffer, mesh.indexCount, kInstanceCount, 0, 0, 0);
+    vkCmdEndRendering(commandBuffer);
+  };
+
+  std::vector<double> floatTimes;
+  std::vector<double> packedTimes;
+  const auto commandBuffer = device->allocateCommandBuffer();
+  for (uint32_t frameIndex = 0; frameIndex < frameCount; ++frameIndex) {
+    VK_CALL(vkResetCommandBuffer(commandBuffer, 0));
+    const VkCommandBufferBeginInfo beginInfo{.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+                                             .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT};
+    VK_CALL(vkBeginCommandBuffer(commandBuffer, &beginInfo));
+    vkCmdResetQueryPool(commandBuffer, queryPool, 0, 3);
+    vkCmdWriteTimestamp2(commandBuffer, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, queryPool, 0);
+    renderPass(commandBuffer, floatPipeline, floatVertexBuffer.buffer);
+    vkCmdWriteTimestamp2(commandBuffer, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, queryPool, 1);
+    renderPass(commandBuffer, packedPipeline, mesh.get(VulkanCore::MeshSection::Vertices).buffer);
+    vkCmdWriteTimestamp2(commandBuffer, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, queryPool, 2);
+    VK_CALL(vkEndCommandBuffer(commandBuffer));
+    device->waitTimeline(device->submit(commandBuffer));
+
+    std::array<uint64_t, 3> timestamps{};
+    VK_CALL(vkGetQueryPoolResults(vkDevice, queryPool, 0, 3, sizeof(timestamps), timestamps.data(), sizeof(uint64_t),
+                                  VK_QUERY_RESULT_64_BIT));
+    const auto toMs = [&device](uint64_t begin, uint64_t end) {
+      return static_cast<double>(end - begin) * device->getTimestampPeriod() / 1e6;
+    };
+    floatTimes.push_back(toMs(timestamps[0], timestamps[1]));
+    packedTimes.push_back(toMs(timestamps[1], timestamps[2]));
+  }
+
+  std::println("{} instances of {} triangles over {} frames: float vertices {:.3f}ms, packed vertices {:.3f}ms",
+               kInstanceCount, mesh.indexCount / 3, frameCount, average(floatTimes), average(packedTimes));
+
+  vkDestroyQueryPool(vkDevice, queryPool, nullptr);
+  device->destroyImage(depth);
+  device->destroyImage(color);
+  vkDestroyPipeline(vkDevice, packedPipeline, nullptr);
+  vkDestroyPipeline(vkDevice, floatPipeline, nullptr);
+  vkDestroyPipelineLayout(vkDevice, pipelineLayout, nullptr);
+  vkDestroyShaderModule(vkDevice, fragmentShader, nullptr);
+  vkDestroyShaderModule(vkDevice, packedVertexShader, nullptr);
+  vkDestroyShaderModule(vkDevice, floatVertexShader, nullptr);
+  device->destroyBuffer(floatVertexBuffer);
+  VulkanCore::destroyMesh(device.value(), mesh);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,1566 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <deque>
+#include <expected>
+#include <format>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <optional>
+#include <print>
+#include <ranges>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include <glfw/glfw3.h>
+#include <glfw/glfw3native.h>
+
+#include <glslang/Public/ResourceLimits.h>
+#include <glslang/Public/ShaderLang.h>
+#include <glslang/SPIRV/GlslangToSpv.h>
+
+namespace ranges = std::ranges;
+namespace views = std::ranges::views;
+
+#define VK_CALL(vFun)                                                                                                  \
+  {                                                                                                                    \
+    const auto res = vFun;                                                                                             \
+    if (res != VK_SUCCESS) {                                                                                           \
+      std::println(#vFun " failed with error {}", static_cast<int>(res));                                              \
+      std::exit(res);                                                                                                  \
+    }                                                                                                                  \
+  }
+
+auto getRequestedInstanceLayers() -> std::vector<std::string> {
+  return std::vector<std::string>{"VK_LAYER_KHRONOS_validation"};
+}
+
+// glfw knows which window system surface extension it needs on this platform, call after glfwInit.
+auto getRequestedInstanceExtensions() -> std::vector<std::string> {
+  uint32_t glfwExtensionsCount{0};
+  const auto glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionsCount);
+
+  auto extensions = std::vector<std::string>{
+#if defined(VK_USE_PLATFORM_METAL_EXT)
+      VK_KHR_PORTABILITY_ENUMERATION_EXTENSION_NAME,
+#endif
+#if defined(VK_EXT_debug_utils)
+      VK_EXT_DEBUG_UTILS_EXTENSION_NAME,
+#endif
+  };
+  for (uint32_t index = 0; index < glfwExtensionsCount; ++index)
+    extensions.emplace_back(glfwExtensions[index]);
+  return extensions;
+}
+
+auto getRequestedDeviceExtensions() -> std::vector<std::string> {
+  return std::vector<std::string>{
+      VK_KHR_SWAPCHAIN_EXTENSION_NAME,
+      VK_KHR_PRESENT_ID_EXTENSION_NAME,
+      VK_KHR_PRESENT_WAIT_EXTENSION_NAME,
+  };
+}
+
+namespace VulkanCore {
+std::vector<VkLayerProperties> enumerateInstanceLayerProperties() {
+  uint32_t layersCount{0};
+  vkEnumerateInstanceLayerProperties(&layersCount, nullptr);
+
+  std::vector<VkLayerProperties> layersProperties(layersCount);
+  vkEnumerateInstanceLayerProperties(&layersCount, layersProperties.data());
+
+  return layersProperties;
+}
+
+std::vector<VkExtensionProperties> enumerateExtensionsProperties() {
+  uint32_t extensionsCount{0};
+  vkEnumerateInstanceExtensionProperties(nullptr, &extensionsCount, nullptr);
+
+  std::vector<VkExtensionProperties> extensionsProperties(extensionsCount);
+  vkEnumerateInstanceExtensionProperties(nullptr, &extensionsCount, extensionsProperties.data());
+
+  return extensionsProperties;
+}
+
+std::vector<VkExtensionProperties> enumerateDeviceExtensionsProperties(VkPhysicalDevice device) {
+  uint32_t extensionsCount{0};
+  vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionsCount, nullptr);
+
+  std::vector<VkExtensionProperties> extensionsProperties(extensionsCount);
+  vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionsCount, extensionsProperties.data());
+
+  return extensionsProperties;
+}
+
+std::optional<VkSurfaceKHR> createVulkanSurface(GLFWwindow* window, VkInstance vulkanInstance) {
+  VkSurfaceKHR surface;
+#if defined(VK_USE_PLATFORM_WIN32_KHR)
+  auto hwnd = glfwGetWin32Window(window);
+  const VkWin32SurfaceCreateInfoKHR surfaceInfo{.sType = VK_STRUCTURE_TYPE_WIN32_SURFACE_CREATE_INFO_KHR,
+                                                .hinstance = GetModuleHandleW(nullptr),
+                                                .hwnd = reinterpret_cast<HWND>(hwnd)};
+
+  const auto res = vkCreateWin32SurfaceKHR(vulkanInstance, &surfaceInfo, nullptr, &surface);
+#else
+  const auto res = glfwCreateWindowSurface(vulkanInstance, window, nullptr, &surface);
+#endif
+  if (res == VK_SUCCESS)
+    return surface;
+  else
+    return std::nullopt;
+}
+
+std::vector<VkPhysicalDevice> enumeratePhysicalDevices(VkInstance instance) {
+  uint32_t physicalDevicesCount{0};
+  vkEnumeratePhysicalDevices(instance, &physicalDevicesCount, nullptr);
+
+  std::vector<VkPhysicalDevice> physicalDevices(physicalDevicesCount);
+  vkEnumeratePhysicalDevices(instance, &physicalDevicesCount, physicalDevices.data());
+
+  return physicalDevices;
+}
+
+std::vector<VkQueueFamilyProperties> enumeratePhysicalDevicesQueueFamilyProperties(VkPhysicalDevice device) {
+  uint32_t physicalDeviceQueueFamilyPropertiesCount{0};
+  vkGetPhysicalDeviceQueueFamilyProperties(device, &physicalDeviceQueueFamilyPropertiesCount, nullptr);
+
+  std::vector<VkQueueFamilyProperties> queueFamiliesProperties(physicalDeviceQueueFamilyPropertiesCount);
+  vkGetPhysicalDeviceQueueFamilyProperties(device, &physicalDeviceQueueFamilyPropertiesCount,
+                                           queueFamiliesProperties.data());
+
+  return queueFamiliesProperties;
+}
+
+std::vector<VkSurfaceFormatKHR> enumerateSurfaceFormats(VkPhysicalDevice device, VkSurfaceKHR surface) {
+  uint32_t formatsCount{0};
+  vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &formatsCount, nullptr);
+
+  std::vector<VkSurfaceFormatKHR> formats(formatsCount);
+  vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &formatsCount, formats.data());
+
+  return formats;
+}
+
+class PhysicalDevice {
+public:
+  PhysicalDevice(VkPhysicalDevice device, VkSurfaceKHR surface)
+      : m_device{device}, m_extensions{enumerateDeviceExtensionsProperties(device)},
+        m_queueFamilies{enumeratePhysicalDevicesQueueFamilyProperties(device)}, m_surface{surface} {
+    vkGetPhysicalDeviceProperties(m_device, &m_properties);
+    vkGetPhysicalDeviceMemoryProperties(m_device, &m_memoryProperties);
+  }
+
+  [[nodiscard]] inline VkPhysicalDevice getPhysicalDevice() const noexcept { return m_device; }
+
+  [[nodiscard]] inline VkSurfaceKHR getSurface() const noexcept { return m_surface; }
+
+  [[nodiscard]] inline const VkPhysicalDeviceProperties& getProperties() const noexcept { return m_properties; }
+
+  [[nodiscard]] inline const VkPhysicalDeviceMemoryProperties& getMemoryProperties() const noexcept {
+    return m_memoryProperties;
+  }
+
+  [[nodiscard]] bool isExtensionSupported(std::string_view name) const {
+    return ranges::any_of(m_extensions,
+                          [name](const VkExtensionProperties& prop) { return name == prop.extensionName; });
+  }
+
+  // A family that can both render and present to the surface, which every desktop driver exposes.
+  [[nodiscard]] std::optional<uint32_t> findGraphicsPresentQueueFamily() const {
+    for (uint32_t index = 0; index < m_queueFamilies.size(); ++index) {
+      VkBool32 presentSupport = VK_FALSE;
+      vkGetPhysicalDeviceSurfaceSupportKHR(m_device, index, m_surface, &presentSupport);
+      if ((m_queueFamilies[index].queueFlags & VK_QUEUE_GRAPHICS_BIT) && presentSupport == VK_TRUE)
+        return index;
+    }
+    return std::nullopt;
+  }
+
+private:
+  VkPhysicalDevice m_device;
+  std::vector<VkExtensionProperties> m_extensions;
+  std::vector<VkQueueFamilyProperties> m_queueFamilies;
+  VkSurfaceKHR m_surface;
+  VkPhysicalDeviceProperties m_properties{};
+  VkPhysicalDeviceMemoryProperties m_memoryProperties{};
+};
+
+void imageBarrier(VkCommandBuffer commandBuffer, VkImage image, VkImageAspectFlags aspect, VkImageLayout oldLayout,
+                  VkImageLayout newLayout, VkPipelineStageFlags2 srcStage, VkAccessFlags2 srcAccess,
+                  VkPipelineStageFlags2 dstStage, VkAccessFlags2 dstAccess) {
+  const VkImageMemoryBarrier2 barrier{.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+                                      .srcStageMask = srcStage,
+                                      .srcAccessMask = srcAccess,
+                                      .dstStageMask = dstStage,
+                                      .dstAccessMask = dstAccess,
+                                      .oldLayout = oldLayout,
+                                      .newLayout = newLayout,
+                                      .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                                      .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                                      .image = image,
+                                      .subresourceRange = {.aspectMask = aspect, .levelCount = 1, .layerCount = 1}};
+  const VkDependencyInfo dependency{.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+                                    .imageMemoryBarrierCount = 1,
+                                    .pImageMemoryBarriers = &barrier};
+  vkCmdPipelineBarrier2(commandBuffer, &dependency);
+}
+
+struct ImageAllocation {
+  VkImage image = VK_NULL_HANDLE;
+  VkImageView view = VK_NULL_HANDLE;
+  VkDeviceMemory memory = VK_NULL_HANDLE;
+  VkExtent2D extent{};
+  VkFormat format = VK_FORMAT_UNDEFINED;
+};
+
+class Device {
+public:
+  static std::expected<Device, std::string> create(const PhysicalDevice& physicalDevice,
+                                                   std::vector<std::string> requestedDeviceExtensions) {
+    Device device{physicalDevice, std::move(requestedDeviceExtensions)};
+
+    if (device.init())
+      return device;
+    else
+      return std::unexpected(std::string{"Failed to create the vulkan device"});
+  }
+
+  ~Device() {
+    if (m_device == VK_NULL_HANDLE)
+      return;
+
+    vkDeviceWaitIdle(m_device);
+    vkDestroyCommandPool(m_device, m_commandPool, nullptr);
+    vkDestroyDevice(m_device, nullptr);
+    m_device = VK_NULL_HANDLE;
+  }
+
+  Device& operator=(const Device&) = delete;
+
+  Device(const Device&) = delete;
+
+  Device(Device&& rhs) noexcept {
+    swap(rhs);
+    rhs.m_device = VK_NULL_HANDLE;
+  }
+
+  Device& operator=(Device&& rhs) noexcept {
+    Device tmp{std::move(rhs)};
+    swap(tmp);
+    return *this;
+  }
+
+  [[nodiscard]] inline VkDevice getDevice() const noexcept { return m_device; }
+
+  [[nodiscard]] inline VkPhysicalDevice getPhysicalDevice() const noexcept { return m_physicalDevice; }
+
+  [[nodiscard]] inline VkQueue getQueue() const noexcept { return m_queue; }
+
+  [[nodiscard]] bool isExtensionEnabled(std::string_view name) const {
+    return ranges::find(m_enabledExtensions, name) != std::end(m_enabledExtensions);
+  }
+
+  // Nanoseconds per timestamp tick, 0 when the graphics queue cannot write timestamps.
+  [[nodiscard]] inline float getTimestampPeriod() const noexcept { return m_timestampPeriod; }
+
+  // Null unless both present id and present wait are enabled with their features.
+  [[nodiscard]] PFN_vkWaitForPresentKHR getWaitForPresentFunction() const noexcept { return m_waitForPresent; }
+
+  [[nodiscard]] std::optional<uint32_t> findMemoryType(uint32_t typeBits, VkMemoryPropertyFlags required) const {
+    for (uint32_t index = 0; index < m_memoryProperties.memoryTypeCount; ++index) {
+      const auto flags = m_memoryProperties.memoryTypes[index].propertyFlags;
+      if ((typeBits & (1u << index)) && (flags & required) == required)
+        return index;
+    }
+    return std::nullopt;
+  }
+
+  ImageAllocation createImage(VkExtent2D extent, VkFormat format, VkImageUsageFlags usage,
+                              VkImageAspectFlags aspect) {
+    const VkImageCreateInfo imageInfo{.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+                                      .imageType = VK_IMAGE_TYPE_2D,
+                                      .format = format,
+                                      .extent = {extent.width, extent.height, 1},
+                                      .mipLevels = 1,
+                                      .arrayLayers = 1,
+                                      .samples = VK_SAMPLE_COUNT_1_BIT,
+                                      .tiling = VK_IMAGE_TILING_OPTIMAL,
+                                      .usage = usage,
+                                      .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+                                      .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED};
+    ImageAllocation allocation{.extent = extent, .format = format};
+    VK_CALL(vkCreateImage(m_device, &imageInfo, nullptr, &allocation.image));
+
+    VkMemoryRequirements requirements;
+    vkGetImageMemoryRequirements(m_device, allocation.image, &requirements);
+
+    const auto memoryTypeIndex = findMemoryType(requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    const VkMemoryAllocateInfo allocateInfo{.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+                                            .allocationSize = requirements.size,
+                                            .memoryTypeIndex = memoryTypeIndex.value_or(0)};
+    VK_CALL(vkAllocateMemory(m_device, &allocateInfo, nullptr, &allocation.memory));
+    VK_CALL(vkBindImageMemory(m_device, allocation.image, allocation.memory, 0));
+
+    allocation.view = createImageView(allocation.image, format, aspect);
+    return allocation;
+  }
+
+  void destroyImage(ImageAllocation& allocation) {
+    vkDestroyImageView(m_device, allocation.view, nullptr);
+    vkDestroyImage(m_device, allocation.image, nullptr);
+    vkFreeMemory(m_device, allocation.memory, nullptr);
+    allocation = ImageAllocation{};
+  }
+
+  VkImageView createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspect) {
+    const VkImageViewCreateInfo viewInfo{.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+                                         .image = image,
+                                         .viewType = VK_IMAGE_VIEW_TYPE_2D,
+                                         .format = format,
+                                         .subresourceRange = {.aspectMask = aspect, .levelCount = 1, .layerCount = 1}};
+    VkImageView view = VK_NULL_HANDLE;
+    VK_CALL(vkCreateImageView(m_device, &viewInfo, nullptr, &view));
+    return view;
+  }
+
+  VkCommandBuffer allocateCommandBuffer() {
+    const VkCommandBufferAllocateInfo commandBufferInfo{.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+                                                        .commandPool = m_commandPool,
+                                                        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+                                                        .commandBufferCount = 1};
+    VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+    VK_CALL(vkAllocateCommandBuffers(m_device, &commandBufferInfo, &commandBuffer));
+    return commandBuffer;
+  }
+
+private:
+  Device(const PhysicalDevice& physicalDevice, std::vector<std::string> requestedDeviceExtensions)
+      : m_physicalDevice{physicalDevice.getPhysicalDevice()},
+        m_memoryProperties{physicalDevice.getMemoryProperties()} {
+    const auto& limits = physicalDevice.getProperties().limits;
+    if (limits.timestampComputeAndGraphics == VK_TRUE)
+      m_timestampPeriod = limits.timestampPeriod;
+
+    // clang-format off
+    m_enabledExtensions = requestedDeviceExtensions
+      | views::filter([&physicalDevice](const std::string& name) {
+          return physicalDevice.isExtensionSupported(name);
+        })
+      | ranges::to<std::vector<std::string>>();
+    // clang-format on
+
+    if (const auto family = physicalDevice.findGraphicsPresentQueueFamily())
+      m_queueFamilyIndex = family.value();
+  }
+
+  bool init() {
+    auto extensions = m_enabledExtensions | views::transform(std::mem_fn(&std::string::c_str)) |
+                      ranges::to<std::vector<const char*>>();
+
+    // Dynamic rendering, synchronization2 and the extended dynamic states are all core in Vulkan 1.3.
+    VkPhysicalDeviceVulkan13Features features13{.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES,
+                                                .synchronization2 = VK_TRUE,
+                                                .dynamicRendering = VK_TRUE};
+
+    // An extension can be there without its feature, both have to be checked before the feature is enabled.
+    VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR};
+    VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR, .pNext = &presentIdFeatures};
+    bool presentWait = false;
+    if (isExtensionEnabled(VK_KHR_PRESENT_ID_EXTENSION_NAME) &&
+        isExtensionEnabled(VK_KHR_PRESENT_WAIT_EXTENSION_NAME)) {
+      VkPhysicalDeviceFeatures2 supported{.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+                                          .pNext = &presentWaitFeatures};
+      vkGetPhysicalDeviceFeatures2(m_physicalDevice, &supported);
+      presentWait = presentIdFeatures.presentId == VK_TRUE && presentWaitFeatures.presentWait == VK_TRUE;
+      if (presentWait)
+        features13.pNext = &presentWaitFeatures;
+    }
+
+    const float queuePriority = 1.0f;
+    const VkDeviceQueueCreateInfo queueInfo{.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
+                                            .queueFamilyIndex = m_queueFamilyIndex,
+                                            .queueCount = 1,
+                                            .pQueuePriorities = &queuePriority};
+
+    const VkDeviceCreateInfo deviceInfo{.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
+                                        .pNext = &features13,
+                                        .queueCreateInfoCount = 1,
+                                        .pQueueCreateInfos = &queueInfo,
+                                        .enabledExtensionCount = static_cast<uint32_t>(extensions.size()),
+                                        .ppEnabledExtensionNames = extensions.data()};
+
+    if (vkCreateDevice(m_physicalDevice, &deviceInfo, nullptr, &m_device) != VK_SUCCESS)
+      return false;
+
+    vkGetDeviceQueue(m_device, m_queueFamilyIndex, 0, &m_queue);
+
+    if (presentWait)
+      m_waitForPresent =
+          reinterpret_cast<PFN_vkWaitForPresentKHR>(vkGetDeviceProcAddr(m_device, "vkWaitForPresentKHR"));
+
+    const VkCommandPoolCreateInfo poolInfo{.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+                                           .flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+                                           .queueFamilyIndex = m_queueFamilyIndex};
+    VK_CALL(vkCreateCommandPool(m_device, &poolInfo, nullptr, &m_commandPool));
+
+    return true;
+  }
+
+  void swap(Device& rhs) {
+    std::swap(m_physicalDevice, rhs.m_physicalDevice);
+    std::swap(m_memoryProperties, rhs.m_memoryProperties);
+    std::swap(m_enabledExtensions, rhs.m_enabledExtensions);
+    std::swap(m_timestampPeriod, rhs.m_timestampPeriod);
+    std::swap(m_queueFamilyIndex, rhs.m_queueFamilyIndex);
+    std::swap(m_device, rhs.m_device);
+    std::swap(m_queue, rhs.m_queue);
+    std::swap(m_commandPool, rhs.m_commandPool);
+    std::swap(m_waitForPresent, rhs.m_waitForPresent);
+  }
+
+private:
+  VkPhysicalDevice m_physicalDevice = VK_NULL_HANDLE;
+  VkPhysicalDeviceMemoryProperties m_memoryProperties{};
+  std::vector<std::string> m_enabledExtensions;
+  float m_timestampPeriod = 0.0f;
+  uint32_t m_queueFamilyIndex = 0;
+  VkDevice m_device = VK_NULL_HANDLE;
+  VkQueue m_queue = VK_NULL_HANDLE;
+  VkCommandPool m_commandPool = VK_NULL_HANDLE;
+  PFN_vkWaitForPresentKHR m_waitForPresent = nullptr;
+};
+
+// Swapchain images and views only: with dynamic rendering there are no framebuffers to rebuild on resize.
+class Swapchain {
+public:
+  Swapchain(Device& device, VkSurfaceKHR surface) : m_device{device}, m_surface{surface} {
+    const auto formats = enumerateSurfaceFormats(m_device.getPhysicalDevice(), m_surface);
+    const auto preferred = ranges::find_if(formats, [](const VkSurfaceFormatKHR& format) {
+      return format.format == VK_FORMAT_B8G8R8A8_SRGB && format.colorSpace == VK_COLOR_SPACE_SRGB_NONLINEAR_KHR;
+    });
+    m_surfaceFormat = preferred != std::end(formats) ? *preferred : formats.front();
+  }
+
+  Swapchain(const Swapchain&) = delete;
+  Swapchain& operator=(const Swapchain&) = delete;
+
+  ~Swapchain() {
+    destroyViews();
+    vkDestroySwapchainKHR(m_device.getDevice(), m_swapchain, nullptr);
+  }
+
+  void recreate(VkExtent2D framebufferExtent) {
+    VkSurfaceCapabilitiesKHR capabilities;
+    VK_CALL(vkGetPhysicalDeviceSurfaceCapabilitiesKHR(m_device.getPhysicalDevice(), m_surface, &capabilities));
+
+    m_extent = capabilities.currentExtent;
+    if (m_extent.width == UINT32_MAX) {
+      m_extent.width = std::clamp(framebufferExtent.width, capabilities.minImageExtent.width,
+                                  capabilities.maxImageExtent.width);
+      m_extent.height = std::clamp(framebufferExtent.height, capabilities.minImageExtent.height,
+                                   capabilities.maxImageExtent.height);
+    }
+
+    auto imageCount = capabilities.minImageCount + 1;
+    if (capabilities.maxImageCount != 0)
+      imageCount = std::min(imageCount, capabilities.maxImageCount);
+
+    const auto oldSwapchain = m_swapchain;
+    const VkSwapchainCreateInfoKHR swapchainInfo{.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR,
+                                                 .surface = m_surface,
+                                                 .minImageCount = imageCount,
+                                                 .imageFormat = m_surfaceFormat.format,
+                                                 .imageColorSpace = m_surfaceFormat.colorSpace,
+                                                 .imageExtent = m_extent,
+                                                 .imageArrayLayers = 1,
+                                                 .imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+                                                 .imageSharingMode = VK_SHARING_MODE_EXCLUSIVE,
+                                                 .preTransform = capabilities.currentTransform,
+                                                 .compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR,
+                                                 .presentMode = VK_PRESENT_MODE_FIFO_KHR,
+                                                 .clipped = VK_TRUE,
+                                                 .oldSwapchain = oldSwapchain};
+    VK_CALL(vkCreateSwapchainKHR(m_device.getDevice(), &swapchainInfo, nullptr, &m_swapchain));
+
+    destroyViews();
+    vkDestroySwapchainKHR(m_device.getDevice(), oldSwapchain, nullptr);
+
+    uint32_t swapchainImagesCount{0};
+    vkGetSwapchainImagesKHR(m_device.getDevice(), m_swapchain, &swapchainImagesCount, nullptr);
+    m_images.resize(swapchainImagesCount);
+    vkGetSwapchainImagesKHR(m_device.getDevice(), m_swapchain, &swapchainImagesCount, m_images.data());
+
+    m_views = m_images | views::transform([this](VkImage image) {
+                return m_device.createImageView(image, m_surfaceFormat.format, VK_IMAGE_ASPECT_COLOR_BIT);
+              }) |
+              ranges::to<std::vector<VkImageView>>();
+  }
+
+  [[nodiscard]] inline VkSwapchainKHR getSwapchain() const noexcept { return m_swapchain; }
+
+  [[nodiscard]] inline VkFormat getFormat() const noexcept { return m_surfaceFormat.format; }
+
+  [[nodiscard]] inline VkExtent2D getExtent() const noexcept { return m_extent; }
+
+  [[nodiscard]] inline VkImage getImage(uint32_t index) const { return m_images[index]; }
+
+  [[nodiscard]] inline VkImageView getImageView(uint32_t index) const { return m_views[index]; }
+
+  [[nodiscard]] inline uint32_t getImageCount() const noexcept { return static_cast<uint32_t>(m_images.size()); }
+
+private:
+  void destroyViews() {
+    for (auto view : m_views)
+      vkDestroyImageView(m_device.getDevice(), view, nullptr);
+    m_views.clear();
+  }
+
+private:
+  Device& m_device;
+  VkSurfaceKHR m_surface;
+  VkSurfaceFormatKHR m_surfaceFormat{};
+  VkExtent2D m_extent{};
+  VkSwapchainKHR m_swapchain = VK_NULL_HANDLE;
+  std::vector<VkImage> m_images;
+  std::vector<VkImageView> m_views;
+};
+
+class ShaderCompiler {
+public:
+  ShaderCompiler() { glslang::InitializeProcess(); }
+
+  ShaderCompiler(const ShaderCompiler&) = delete;
+  ShaderCompiler& operator=(const ShaderCompiler&) = delete;
+
+  ~ShaderCompiler() { glslang::FinalizeProcess(); }
+
+  std::expected<std::vector<uint32_t>, std::string> compile(std::string_view source,
+                                                            VkShaderStageFlagBits stage) const {
+    const auto language = toLanguage(stage);
+
+    glslang::TShader shader{language};
+    const char* sources[] = {source.data()};
+    const int lengths[] = {static_cast<int>(source.size())};
+    shader.setStringsWithLengths(sources, lengths, 1);
+    shader.setEnvInput(glslang::EShSourceGlsl, language, glslang::EShClientVulkan, 100);
+    shader.setEnvClient(glslang::EShClientVulkan, glslang::EShTargetVulkan_1_3);
+    shader.setEnvTarget(glslang::EShTargetSpv, glslang::EShTargetSpv_1_6);
+
+    const auto messages = static_cast<EShMessages>(EShMsgSpvRules | EShMsgVulkanRules);
+    if (!shader.parse(GetDefaultResources(), 460, false, messages))
+      return std::unexpected(std::string{shader.getInfoLog()});
+
+    glslang::TProgram program;
+    program.addShader(&shader);
+    if (!program.link(messages))
+      return std::unexpected(std::string{program.getInfoLog()});
+
+    std::vector<uint32_t> spirv;
+    glslang::GlslangToSpv(*program.getIntermediate(language), spirv);
+    return spirv;
+  }
+
+private:
+  static EShLanguage toLanguage(VkShaderStageFlagBits stage) {
+    switch (stage) {
+    case VK_SHADER_STAGE_VERTEX_BIT:
+      return EShLangVertex;
+    case VK_SHADER_STAGE_FRAGMENT_BIT:
+      return EShLangFragment;
+    case VK_SHADER_STAGE_COMPUTE_BIT:
+      return EShLangCompute;
+    default:
+      return EShLangVertex;
+    }
+  }
+};
+
+VkShaderModule createShaderModule(VkDevice device, std::span<const uint32_t> spirv) {
+  const VkShaderModuleCreateInfo moduleInfo{.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+                                            .codeSize = spirv.size_bytes(),
+                                            .pCode = spirv.data()};
+  VkShaderModule module = VK_NULL_HANDLE;
+  VK_CALL(vkCreateShaderModule(device, &moduleInfo, nullptr, &module));
+  return module;
+}
+
+// The only state baked into a pipeline besides the shaders: everything else is set while recording.
+struct AttachmentFormats {
+  static constexpr uint32_t kMaxColorAttachments = 4;
+
+  std::array<VkFormat, kMaxColorAttachments> colorFormats{};
+  uint32_t colorAttachmentCount = 0;
+  VkFormat depthFormat = VK_FORMAT_UNDEFINED;
+  VkFormat stencilFormat = VK_FORMAT_UNDEFINED;
+
+  bool operator==(const AttachmentFormats&) const = default;
+};
+
+struct AttachmentFormatsHash {
+  size_t operator()(const AttachmentFormats& formats) const noexcept {
+    size_t seed = formats.colorAttachmentCount;
+    const auto combine = [&seed](VkFormat format) {
+      seed ^= std::hash<uint32_t>{}(static_cast<uint32_t>(format)) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    };
+    ranges::for_each(formats.colorFormats | views::take(formats.colorAttachmentCount), combine);
+    combine(formats.depthFormat);
+    combine(formats.stencilFormat);
+    return seed;
+  }
+};
+
+constexpr std::array kDynamicStates{
+    VK_DYNAMIC_STATE_VIEWPORT_WITH_COUNT, VK_DYNAMIC_STATE_SCISSOR_WITH_COUNT, VK_DYNAMIC_STATE_CULL_MODE,
+    VK_DYNAMIC_STATE_FRONT_FACE,          VK_DYNAMIC_STATE_PRIMITIVE_TOPOLOGY, VK_DYNAMIC_STATE_DEPTH_TEST_ENABLE,
+    VK_DYNAMIC_STATE_DEPTH_WRITE_ENABLE,  VK_DYNAMIC_STATE_DEPTH_COMPARE_OP,
+};
+
+// One pipeline per set of attachment formats for a given vertex/fragment shader pair. A resize keeps the formats,
+// so it never creates a pipeline.
+class GraphicsPipelineCache {
+public:
+  GraphicsPipelineCache(Device& device, VkShaderModule vertexShader, VkShaderModule fragmentShader,
+                        VkPipelineLayout layout)
+      : m_device{device}, m_vertexShader{vertexShader}, m_fragmentShader{fragmentShader}, m_layout{layout} {
+    const VkPipelineCacheCreateInfo cacheInfo{.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO};
+    VK_CALL(vkCreatePipelineCache(m_device.getDevice(), &cacheInfo, nullptr, &m_pipelineCache));
+  }
+
+  GraphicsPipelineCache(const GraphicsPipelineCache&) = delete;
+  GraphicsPipelineCache& operator=(const GraphicsPipelineCache&) = delete;
+
+  ~GraphicsPipelineCache() {
+    for (const auto& [formats, pipeline] : m_pipelines)
+      vkDestroyPipeline(m_device.getDevice(), pipeline, nullptr);
+    vkDestroyPipelineCache(m_device.getDevice(), m_pipelineCache, nullptr);
+  }
+
+  VkPipeline get(const AttachmentFormats& formats) {
+    if (const auto it = m_pipelines.find(formats); it != std::end(m_pipelines))
+      return it->second;
+
+    const auto pipeline = create(formats);
+    m_pipelines.emplace(formats, pipeline);
+    return pipeline;
+  }
+
+  [[nodiscard]] size_t size() const noexcept { return m_pipelines.size(); }
+
+private:
+  VkPipeline create(const AttachmentFormats& formats) {
+    const std::array stages{
+        VkPipelineShaderStageCreateInfo{.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+                                        .stage = VK_SHADER_STAGE_VERTEX_BIT,
+                                        .module = m_vertexShader,
+                                        .pName = "main"},
+        VkPipelineShaderStageCreateInfo{.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+                                        .stage = VK_SHADER_STAGE_FRAGMENT_BIT,
+                                        .module = m_fragmentShader,
+                                        .pName = "main"},
+    };
+
+    const VkPipelineVertexInputStateCreateInfo vertexInput{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO};
+    const VkPipelineInputAssemblyStateCreateInfo inputAssembly{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
+        .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST};
+    const VkPipelineViewportStateCreateInfo viewport{.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO};
+    const VkPipelineRasterizationStateCreateInfo rasterization{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
+        .polygonMode = VK_POLYGON_MODE_FILL,
+        .lineWidth = 1.0f};
+    const VkPipelineMultisampleStateCreateInfo multisample{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
+        .rasterizationSamples = VK_SAMPLE_COUNT_1_BIT};
+    const VkPipelineDepthStencilStateCreateInfo depthStencil{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO};
+
+    std::array<VkPipelineColorBlendAttachmentState, AttachmentFormats::kMaxColorAttachments> blendAttachments{};
+    for (auto& attachment : blendAttachments)
+      attachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT |
+                                  VK_COLOR_COMPONENT_A_BIT;
+    const VkPipelineColorBlendStateCreateInfo colorBlend{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
+        .attachmentCount = formats.colorAttachmentCount,
+        .pAttachments = blendAttachments.data()};
+
+    const VkPipelineDynamicStateCreateInfo dynamicState{.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
+                                                        .dynamicStateCount =
+                                                            static_cast<uint32_t>(kDynamicStates.size()),
+                                                        .pDynamicStates = kDynamicStates.data()};
+
+    const VkPipelineRenderingCreateInfo renderingInfo{.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO,
+                                                      .colorAttachmentCount = formats.colorAttachmentCount,
+                                                      .pColorAttachmentFormats = formats.colorFormats.data(),
+                                                      .depthAttachmentFormat = formats.depthFormat,
+                                                      .stencilAttachmentFormat = formats.stencilFormat};
+
+    const VkGraphicsPipelineCreateInfo pipelineInfo{.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+                                                    .pNext = &renderingInfo,
+                                                    .stageCount = static_cast<uint32_t>(stages.size()),
+                                                    .pStages = stages.data(),
+                                                    .pVertexInputState = &vertexInput,
+                                                    .pInputAssemblyState = &inputAssembly,
+                                                    .pViewportState = &viewport,
+                                                    .pRasterizationState = &rasterization,
+                                                    .pMultisampleState = &multisample,
+                                                    .pDepthStencilState = &depthStencil,
+                                                    .pColorBlendState = &colorBlend,
+                                                    .pDynamicState = &dynamicState,
+                                                    .layout = m_layout,
+                                                    .renderPass = VK_NULL_HANDLE};
+
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    VK_CALL(vkCreateGraphicsPipelines(m_device.getDevice(), m_pipelineCache, 1, &pipelineInfo, nullptr, &pipeline));
+    return pipeline;
+  }
+
+private:
+  Device& m_device;
+  VkShaderModule m_vertexShader;
+  VkShaderModule m_fragmentShader;
+  VkPipelineLayout m_layout;
+  VkPipelineCache m_pipelineCache = VK_NULL_HANDLE;
+  std::unordered_map<AttachmentFormats, VkPipeline, AttachmentFormatsHash> m_pipelines;
+};
+
+class Context {
+public:
+  static std::expected<Context, std::string> create(GLFWwindow* window, std::string_view applicationName,
+                                                    std::vector<std::string> requestedInstanceLayer,
+                                                    std::vector<std::string> requestedInstanceExtensions) {
+
+    Context context{window, applicationName, std::move(requestedInstanceLayer), std::move(requestedInstanceExtensions)};
+
+    if (context.init())
+      return context;
+    else
+      return std::unexpected(std::string{"Failed to init the vulkan context"});
+  }
+
+  ~Context() {
+    if (m_vulkanInstance == VK_NULL_HANDLE)
+      return;
+
+    vkDestroySurfaceKHR(m_vulkanInstance, m_surface, nullptr);
+    vkDestroyInstance(m_vulkanInstance, nullptr);
+    m_vulkanInstance = VK_NULL_HANDLE;
+  }
+
+  Context& operator=(const Context&) = delete;
+
+  Context(const Context&) = delete;
+
+  Context(Context&& rhs) noexcept {
+    swap(rhs);
+    rhs.m_vulkanInstance = VK_NULL_HANDLE;
+    rhs.m_surface = VK_NULL_HANDLE;
+  }
+
+  Context& operator=(Context&& rhs) noexcept {
+    Context tmp{std::move(rhs)};
+    swap(tmp);
+    return *this;
+  }
+
+  std::vector<PhysicalDevice> enumeratePhysicalDevices() {
+    // clang-format off
+    auto result = VulkanCore::enumeratePhysicalDevices(m_vulkanInstance)
+      | views::transform([this](VkPhysicalDevice device) -> PhysicalDevice {
+         return PhysicalDevice{device, m_surface};
+        })
+      | ranges::to<std::vector<PhysicalDevice>>();
+    // clang-format on
+    return result;
+  }
+
+  [[nodiscard]] inline VkSurfaceKHR getSurface() const noexcept { return m_surface; }
+
+private:
+  Context(GLFWwindow* window, std::string_view applicationName, std::vector<std::string> requestedInstanceLayer,
+          std::vector<std::string> requestedInstanceExtensions)
+      : m_window{window}, m_applicationName{applicationName} {
+    auto allInstanceLayers = enumerateInstanceLayerProperties();
+    const auto isInstanceLayerRequired = [&requestedInstanceLayer](const VkLayerProperties& prop) {
+      auto name = std::string{prop.layerName};
+      return ranges::find(requestedInstanceLayer, name) != std::end(requestedInstanceLayer);
+    };
+    // clang-format off
+    m_layerProperties = allInstanceLayers
+      | views::filter(isInstanceLayerRequired)
+      | ranges::to<std::vector<VkLayerProperties>>();
+    // clang-format on
+
+    auto allExtensions = enumerateExtensionsProperties();
+    const auto isExtensionRequired = [&requestedInstanceExtensions](const VkExtensionProperties& prop) {
+      auto name = std::string{prop.extensionName};
+      return ranges::find(requestedInstanceExtensions, name) != std::end(requestedInstanceExtensions);
+    };
+    // clang-format off
+    m_layerExtensions = allExtensions
+      | views::filter(isExtensionRequired)
+      | ranges::to<std::vector<VkExtensionProperties>>();
+    // clang-format on
+  }
+
+  bool init() {
+    // clang-format off
+    auto layers = m_layerProperties
+      | views::transform([](const VkLayerProperties& prop) -> const char*
+        {
+          return prop.layerName;
+        })
+      | ranges::to<std::vector<const char*>>();
+
+      auto extensions = m_layerExtensions
+        | views::transform([](const VkExtensionProperties & prop) -> const char*
+          {
+            return prop.extensionName;
+          })
+        | ranges::to<std::vector<const char*>>();
+    // clang-format on
+
+    const VkApplicationInfo applicationInfo{.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO,
+                                            .pApplicationName = m_applicationName.data(),
+                                            .applicationVersion = VK_MAKE_VERSION(1, 0, 0),
+                                            .apiVersion = VK_API_VERSION_1_3};
+
+    const VkInstanceCreateInfo instanceCreateInfo{.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO,
+#if defined(VK_USE_PLATFORM_METAL_EXT)
+                                                  .flags = VK_INSTANCE_CREATE_ENUMERATE_PORTABILITY_BIT_KHR,
+#endif
+                                                  .pApplicationInfo = &applicationInfo,
+                                                  .enabledLayerCount = static_cast<uint32_t>(layers.size()),
+                                                  .ppEnabledLayerNames = layers.data(),
+                                                  .enabledExtensionCount = static_cast<uint32_t>(extensions.size()),
+                                                  .ppEnabledExtensionNames = extensions.data()};
+
+    const auto res = vkCreateInstance(&instanceCreateInfo, nullptr, &m_vulkanInstance);
+    if (res != VK_SUCCESS)
+      return false;
+
+    auto surface = createVulkanSurface(m_window, m_vulkanInstance);
+    if (!surface.has_value())
+      return false;
+
+    m_surface = surface.value();
+    return true;
+  }
+
+  void swap(Context& rhs) {
+    std::swap(m_window, rhs.m_window);
+    std::swap(m_applicationName, rhs.m_applicationName);
+    std::swap(m_layerProperties, rhs.m_layerProperties);
+    std::swap(m_layerExtensions, rhs.m_layerExtensions);
+    std::swap(m_vulkanInstance, rhs.m_vulkanInstance);
+    std::swap(m_surface, rhs.m_surface);
+  }
+
+private:
+  GLFWwindow* m_window = nullptr;
+  std::string m_applicationName;
+  std::vector<VkLayerProperties> m_layerProperties;
+  std::vector<VkExtensionProperties> m_layerExtensions;
+  VkInstance m_vulkanInstance = VK_NULL_HANDLE;
+  VkSurfaceKHR m_surface = VK_NULL_HANDLE;
+};
+
+// Fixed 0.1ms buckets up to 100ms, slower samples land in the last bucket. A percentile is the upper edge of the
+// bucket holding that rank, so it is never more than a bucket width too high.
+class FrameTimeHistogram {
+public:
+  static constexpr double kBucketWidthMs = 0.1;
+  static constexpr size_t kBucketCount = 1000;
+
+  void record(double milliseconds) {
+    const auto bucket = std::min(static_cast<size_t>(std::max(milliseconds, 0.0) / kBucketWidthMs), kBucketCount - 1);
+    ++m_buckets[bucket];
+    ++m_count;
+    m_sum += milliseconds;
+    m_min = std::min(m_min, milliseconds);
+    m_max = std::max(m_max, milliseconds);
+  }
+
+  [[nodiscard]] inline uint64_t getCount() const noexcept { return m_count; }
+
+  [[nodiscard]] inline double getMean() const noexcept { return m_count == 0 ? 0.0 : m_sum / m_count; }
+
+  [[nodiscard]] inline double getMax() const noexcept { return m_max; }
+
+  [[nodiscard]] double getPercentile(double fraction) const {
+    if (m_count == 0)
+      return 0.0;
+
+    const auto rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(fraction * m_count)));
+    uint64_t seen = 0;
+    for (size_t index = 0; index < kBucketCount; ++index) {
+      seen += m_buckets[index];
+      if (seen >= rank)
+        return std::min((index + 1) * kBucketWidthMs, m_max);
+    }
+    return m_max;
+  }
+
+  // Only the non empty buckets, as [upper edge in ms, count] pairs.
+  [[nodiscard]] std::string toJson() const {
+    auto json = std::format(R"({{"count": {}, "mean": {:.3f}, "min": {:.3f}, "max": {:.3f}, )", m_count, getMean(),
+                            m_count == 0 ? 0.0 : m_min, m_max);
+    json += std::format(R"("p50": {:.3f}, "p90": {:.3f}, "p99": {:.3f}, "buckets": [)", getPercentile(0.5),
+                        getPercentile(0.9), getPercentile(0.99));
+    bool first = true;
+    for (size_t index = 0; index < kBucketCount; ++index) {
+      if (m_buckets[index] == 0)
+        continue;
+      json += std::format("{}[{:.1f}, {}]", first ? "" : ", ", (index + 1) * kBucketWidthMs, m_buckets[index]);
+      first = false;
+    }
+    return json + "]}";
+  }
+
+private:
+  std::array<uint64_t, kBucketCount> m_buckets{};
+  uint64_t m_count = 0;
+  double m_sum = 0.0;
+  double m_min = std::numeric_limits<double>::max();
+  double m_max = 0.0;
+};
+
+struct ApplicationSettings {
+  std::string title;
+  uint32_t width = 800;
+  uint32_t height = 600;
+  // Simulation steps per second, independent of how fast frames are rendered.
+  double updateRate = 60.0;
+  // 0 leaves the frame rate to the present mode.
+  double maxFrameRate = 0.0;
+  // Waits for the previous frame to reach the display before starting the next one, needs present wait.
+  bool lowLatency = false;
+  // Where the frame time histograms are written as JSON at exit, nothing is written when empty.
+  std::string statisticsPath;
+};
+
+struct FrameInfo {
+  VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+  AttachmentFormats formats;
+  VkExtent2D extent{};
+  // How far the frame is between the previous and the current simulation step, in [0, 1).
+  double alpha = 0.0;
+};
+
+// Owns the window, the device, the swapchain and the frame loop. The simulation advances in fixed steps however long
+// frames take, and every frame renders the state interpolated between the last two steps. A subclass only creates
+// its resources, steps its simulation and records its draws.
+class Application {
+public:
+  explicit Application(ApplicationSettings settings) : m_settings{std::move(settings)} {}
+
+  Application(const Application&) = delete;
+  Application& operator=(const Application&) = delete;
+
+  virtual ~Application() = default;
+
+  int run() {
+    if (const auto initialized = init(); !initialized) {
+      std::println("Unable to initialize the application: {}", initialized.error());
+      return EXIT_FAILURE;
+    }
+
+    const auto fixedStep = 1.0 / m_settings.updateRate;
+    double accumulator = 0.0;
+    auto previousFrameStart = std::chrono::steady_clock::now();
+    m_nextFrameStart = previousFrameStart;
+
+    while (!glfwWindowShouldClose(m_window)) {
+      waitForFrameSlot();
+      // After the limiter, so the frame sees the newest input.
+      glfwPollEvents();
+
+      const auto frameStart = std::chrono::steady_clock::now();
+      const auto frameTime = std::chrono::duration<double>(frameStart - previousFrameStart).count();
+      previousFrameStart = frameStart;
+      if (m_frameCount > 0)
+        m_frameTimes.record(frameTime * 1000.0);
+
+      // A long stall would otherwise leave more steps to simulate than fit into a frame and never catch up.
+      accumulator += std::min(frameTime, 0.25);
+      while (accumulator >= fixedStep) {
+        onUpdate(fixedStep);
+        accumulator -= fixedStep;
+        ++m_updateCount;
+      }
+      const auto updateTime = std::chrono::steady_clock::now() - frameStart;
+
+      if (const auto renderTime = renderFrame(accumulator / fixedStep)) {
+        m_cpuTimes.record(std::chrono::duration<double, std::milli>(updateTime + renderTime.value()).count());
+        ++m_frameCount;
+      }
+    }
+
+    vkDeviceWaitIdle(m_device->getDevice());
+    onDestroy(m_device.value());
+    destroy();
+
+    printStatistics();
+    if (!m_settings.statisticsPath.empty())
+      writeStatistics(m_settings.statisticsPath);
+
+    glfwTerminate();
+    return EXIT_SUCCESS;
+  }
+
+protected:
+  virtual std::expected<void, std::string> onInit(Device& device) = 0;
+
+  // Called at the fixed update rate with the step in seconds.
+  virtual void onUpdate(double step) = 0;
+
+  // Inside dynamic rendering to the swapchain image and a depth buffer.
+  virtual void onRender(const FrameInfo& frame) = 0;
+
+  virtual void onKey(int, int) {}
+
+  // The device is idle.
+  virtual void onDestroy(Device& device) = 0;
+
+private:
+  static constexpr uint32_t kFramesInFlight = 2;
+  static constexpr VkFormat kDepthFormat = VK_FORMAT_D32_SFLOAT;
+  static constexpr uint64_t kPresentTimeout = 100'000'000;
+
+  struct FrameData {
+    VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+    VkSemaphore imageAvailable = VK_NULL_HANDLE;
+    VkFence inFlight = VK_NULL_HANDLE;
+    bool timestampsWritten = false;
+  };
+
+  std::expected<void, std::string> init() {
+    glfwInit();
+    glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+    m_window = glfwCreateWindow(static_cast<int>(m_settings.width), static_cast<int>(m_settings.height),
+                                m_settings.title.c_str(), nullptr, nullptr);
+
+    glfwSetWindowUserPointer(m_window, this);
+    glfwSetKeyCallback(m_window, [](GLFWwindow* window, int key, int, int action, int) {
+      if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
+        glfwSetWindowShouldClose(window, GLFW_TRUE);
+      static_cast<Application*>(glfwGetWindowUserPointer(window))->onKey(key, action);
+    });
+    glfwSetFramebufferSizeCallback(m_window, [](GLFWwindow* window, int, int) {
+      static_cast<Application*>(glfwGetWindowUserPointer(window))->m_framebufferResized = true;
+    });
+
+    auto context = Context::create(m_window, m_settings.title, getRequestedInstanceLayers(),
+                                   getRequestedInstanceExtensions());
+    if (!context)
+      return std::unexpected(context.error());
+    m_context.emplace(std::move(context.value()));
+
+    auto physicalDevices = m_context->enumeratePhysicalDevices();
+    const auto physicalDevice = ranges::find_if(physicalDevices, [](const PhysicalDevice& device) {
+      return device.findGraphicsPresentQueueFamily().has_value() &&
+             device.isExtensionSupported(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+    });
+    if (physicalDevice == std::end(physicalDevices))
+      return std::unexpected(std::string{"No physical device can present to the window"});
+
+    auto device = Device::create(*physicalDevice, getRequestedDeviceExtensions());
+    if (!device)
+      return std::unexpected(device.error());
+    m_device.emplace(std::move(device.value()));
+    m_waitForPresent = m_device->getWaitForPresentFunction();
+    const auto vkDevice = m_device->getDevice();
+
+    if (m_settings.lowLatency && m_waitForPresent == nullptr)
+      std::println("Present wait is not supported, the frame limiter falls back to CPU timing");
+
+    m_swapchain.emplace(m_device.value(), m_context->getSurface());
+    recreateSwapchain();
+
+    for (auto& frame : m_frames) {
+      frame.commandBuffer = m_device->allocateCommandBuffer();
+      const VkSemaphoreCreateInfo semaphoreInfo{.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
+      VK_CALL(vkCreateSemaphore(vkDevice, &semaphoreInfo, nullptr, &frame.imageAvailable));
+      const VkFenceCreateInfo fenceInfo{.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+                                        .flags = VK_FENCE_CREATE_SIGNALED_BIT};
+      VK_CALL(vkCreateFence(vkDevice, &fenceInfo, nullptr, &frame.inFlight));
+    }
+
+    // A begin and an end timestamp per frame in flight.
+    if (m_device->getTimestampPeriod() > 0.0f) {
+      const VkQueryPoolCreateInfo queryPoolInfo{.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+                                                .queryType = VK_QUERY_TYPE_TIMESTAMP,
+                                                .queryCount = 2 * kFramesInFlight};
+      VK_CALL(vkCreateQueryPool(vkDevice, &queryPoolInfo, nullptr, &m_queryPool));
+    }
+
+    return onInit(m_device.value());
+  }
+
+  void destroy() {
+    const auto vkDevice = m_device->getDevice();
+    for (auto& frame : m_frames) {
+      vkDestroySemaphore(vkDevice, frame.imageAvailable, nullptr);
+      vkDestroyFence(vkDevice, frame.inFlight, nullptr);
+    }
+    for (auto semaphore : m_renderFinished)
+      vkDestroySemaphore(vkDevice, semaphore, nullptr);
+    if (m_depth.image != VK_NULL_HANDLE)
+      m_device->destroyImage(m_depth);
+    vkDestroyQueryPool(vkDevice, m_queryPool, nullptr);
+
+    m_swapchain.reset();
+    m_device.reset();
+    m_context.reset();
+  }
+
+  void recreateSwapchain() {
+    int width = 0, height = 0;
+    glfwGetFramebufferSize(m_window, &width, &height);
+    while ((width == 0 || height == 0) && !glfwWindowShouldClose(m_window)) {
+      glfwWaitEvents();
+      glfwGetFramebufferSize(m_window, &width, &height);
+    }
+
+    const auto vkDevice = m_device->getDevice();
+    vkDeviceWaitIdle(vkDevice);
+    // Present ids belong to the swapchain that is about to be destroyed.
+    m_pendingPresents.clear();
+    m_swapchain->recreate({static_cast<uint32_t>(width), static_cast<uint32_t>(height)});
+
+    if (m_depth.image != VK_NULL_HANDLE)
+      m_device->destroyImage(m_depth);
+    m_depth = m_device->createImage(m_swapchain->getExtent(), kDepthFormat,
+                                    VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_IMAGE_ASPECT_DEPTH_BIT);
+
+    // Presentation may still hold the semaphore of an image, so there is one per swapchain image.
+    for (auto semaphore : m_renderFinished)
+      vkDestroySemaphore(vkDevice, semaphore, nullptr);
+    m_renderFinished.resize(m_swapchain->getImageCount());
+    const VkSemaphoreCreateInfo semaphoreInfo{.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
+    for (auto& semaphore : m_renderFinished)
+      VK_CALL(vkCreateSemaphore(vkDevice, &semaphoreInfo, nullptr, &semaphore));
+  }
+
+  // The present latency is the time from vkQueuePresentKHR to the image reaching the display. Without waiting, a
+  // completion is only noticed at the start of a later frame, which makes the numbers an upper bound.
+  void collectPresentTimes(bool wait) {
+    while (!m_pendingPresents.empty()) {
+      const auto [presentId, presentTime] = m_pendingPresents.front();
+      const auto result = m_waitForPresent(m_device->getDevice(), m_swapchain->getSwapchain(), presentId,
+                                           wait ? kPresentTimeout : 0);
+      if (result == VK_TIMEOUT)
+        return;
+
+      m_pendingPresents.pop_front();
+      if (result == VK_SUCCESS || result == VK_SUBOPTIMAL_KHR)
+        m_presentLatencies.record(
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - presentTime).count());
+    }
+  }
+
+  // With present wait and low latency the next frame starts once the previous one is on screen, so input is sampled
+  // as late as possible and no frames queue up in the swapchain. The frame rate cap is applied on top of that.
+  void waitForFrameSlot() {
+    if (m_waitForPresent != nullptr)
+      collectPresentTimes(m_settings.lowLatency);
+
+    if (m_settings.maxFrameRate > 0.0) {
+      const auto interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+          std::chrono::duration<double>(1.0 / m_settings.maxFrameRate));
+      // After a stall the schedule restarts from now instead of rushing through the missed frames.
+      m_nextFrameStart = std::max(m_nextFrameStart + interval, std::chrono::steady_clock::now() - interval);
+      std::this_thread::sleep_until(m_nextFrameStart);
+    }
+  }
+
+  // The CPU time spent on the frame, excluding waits for the GPU and the swapchain. Empty when nothing was
+  // submitted.
+  std::optional<std::chrono::steady_clock::duration> renderFrame(double alpha) {
+    const auto vkDevice = m_device->getDevice();
+    const auto slot = static_cast<uint32_t>(m_frameIndex % kFramesInFlight);
+    auto& frame = m_frames[slot];
+    VK_CALL(vkWaitForFences(vkDevice, 1, &frame.inFlight, VK_TRUE, UINT64_MAX));
+
+    if (frame.timestampsWritten) {
+      std::array<uint64_t, 2> timestamps{};
+      if (vkGetQueryPoolResults(vkDevice, m_queryPool, 2 * slot, 2, sizeof(timestamps), timestamps.data(),
+                                sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS)
+        m_gpuTimes.record(static_cast<double>(timestamps[1] - timestamps[0]) * m_device->getTimestampPeriod() / 1e6);
+      frame.timestampsWritten = false;
+    }
+
+    uint32_t imageIndex = 0;
+    const auto acquired = vkAcquireNextImageKHR(vkDevice, m_swapchain->getSwapchain(), UINT64_MAX,
+                                                frame.imageAvailable, VK_NULL_HANDLE, &imageIndex);
+    if (acquired == VK_ERROR_OUT_OF_DATE_KHR) {
+      recreateSwapchain();
+      return std::nullopt;
+    }
+    if (acquired != VK_SUCCESS && acquired != VK_SUBOPTIMAL_KHR) {
+      std::println("vkAcquireNextImageKHR failed with error {}", static_cast<int>(acquired));
+      std::exit(acquired);
+    }
+    const auto recordStart = std::chrono::steady_clock::now();
+
+    VK_CALL(vkResetFences(vkDevice, 1, &frame.inFlight));
+    VK_CALL(vkResetCommandBuffer(frame.commandBuffer, 0));
+    recordFrame(frame, slot, imageIndex, alpha);
+
+    const VkSemaphoreSubmitInfo waitInfo{.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+                                         .semaphore = frame.imageAvailable,
+                                         .stageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT};
+    const VkSemaphoreSubmitInfo signalInfo{.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+                                           .semaphore = m_renderFinished[imageIndex],
+                                           .stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT};
+    const VkCommandBufferSubmitInfo commandBufferInfo{.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO,
+                                                      .commandBuffer = frame.commandBuffer};
+    const VkSubmitInfo2 submitInfo{.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2,
+                                   .waitSemaphoreInfoCount = 1,
+                                   .pWaitSemaphoreInfos = &waitInfo,
+                                   .commandBufferInfoCount = 1,
+                                   .pCommandBufferInfos = &commandBufferInfo,
+                                   .signalSemaphoreInfoCount = 1,
+                                   .pSignalSemaphoreInfos = &signalInfo};
+    VK_CALL(vkQueueSubmit2(m_device->getQueue(), 1, &submitInfo, frame.inFlight));
+
+    const auto presentId = ++m_presentId;
+    const VkPresentIdKHR presentIdInfo{.sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR,
+                                       .swapchainCount = 1,
+                                       .pPresentIds = &presentId};
+    const auto vkSwapchain = m_swapchain->getSwapchain();
+    const VkPresentInfoKHR presentInfo{.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
+                                       .pNext = m_waitForPresent != nullptr ? &presentIdInfo : nullptr,
+                                       .waitSemaphoreCount = 1,
+                                       .pWaitSemaphores = &m_renderFinished[imageIndex],
+                                       .swapchainCount = 1,
+                                       .pSwapchains = &vkSwapchain,
+                                       .pImageIndices = &imageIndex};
+    const auto presentTime = std::chrono::steady_clock::now();
+    const auto presented = vkQueuePresentKHR(m_device->getQueue(), &presentInfo);
+    const auto renderTime = std::chrono::steady_clock::now() - recordStart;
+    ++m_frameIndex;
+
+    if (presented == VK_SUCCESS || presented == VK_SUBOPTIMAL_KHR) {
+      if (m_waitForPresent != nullptr)
+        m_pendingPresents.emplace_back(presentId, presentTime);
+    } else if (presented != VK_ERROR_OUT_OF_DATE_KHR) {
+      std::println("vkQueuePresentKHR failed with error {}", static_cast<int>(presented));
+      std::exit(presented);
+    }
+    if (presented != VK_SUCCESS || m_framebufferResized) {
+      m_framebufferResized = false;
+      recreateSwapchain();
+    }
+
+    return renderTime;
+  }
+
+  void recordFrame(FrameData& frame, uint32_t slot, uint32_t imageIndex, double alpha) {
+    const auto commandBuffer = frame.commandBuffer;
+    const VkCommandBufferBeginInfo beginInfo{.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+                                             .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT};
+    VK_CALL(vkBeginCommandBuffer(commandBuffer, &beginInfo));
+
+    if (m_queryPool != VK_NULL_HANDLE) {
+      vkCmdResetQueryPool(commandBuffer, m_queryPool, 2 * slot, 2);
+      vkCmdWriteTimestamp2(commandBuffer, VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT, m_queryPool, 2 * slot);
+    }
+
+    const auto image = m_swapchain->getImage(imageIndex);
+    imageBarrier(commandBuffer, image, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_UNDEFINED,
+                 VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+                 VK_ACCESS_2_NONE, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+                 VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT);
+    imageBarrier(commandBuffer, m_depth.image, VK_IMAGE_ASPECT_DEPTH_BIT, VK_IMAGE_LAYOUT_UNDEFINED,
+                 VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
+                 VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+                 VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                 VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+                 VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT);
+
+    const VkRenderingAttachmentInfo colorAttachment{.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
+                                                    .imageView = m_swapchain->getImageView(imageIndex),
+                                                    .imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                                                    .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+                                                    .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+                                                    .clearValue = {.color = {.float32 = {0.1f, 0.1f, 0.1f, 1.0f}}}};
+    const VkRenderingAttachmentInfo depthAttachment{.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
+                                                    .imageView = m_depth.view,
+                                                    .imageLayout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
+                                                    .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+                                                    .storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+                                                    .clearValue = {.depthStencil = {.depth = 1.0f}}};
+
+    const auto extent = m_swapchain->getExtent();
+    const VkRenderingInfo renderingInfo{.sType = VK_STRUCTURE_TYPE_RENDERING_INFO,
+                                        .renderArea = {.offset = {0, 0}, .extent = extent},
+                                        .layerCount = 1,
+                                        .colorAttachmentCount = 1,
+                                        .pColorAttachments = &colorAttachment,
+                                        .pDepthAttachment = &depthAttachment};
+    vkCmdBeginRendering(commandBuffer, &renderingInfo);
+
+    onRender(FrameInfo{.commandBuffer = commandBuffer,
+                       .formats = {.colorFormats = {m_swapchain->getFormat()},
+                                   .colorAttachmentCount = 1,
+                                   .depthFormat = m_depth.format},
+                       .extent = extent,
+                       .alpha = alpha});
+
+    vkCmdEndRendering(commandBuffer);
+
+    imageBarrier(commandBuffer, image, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                 VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+                 VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT, VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE);
+
+    if (m_queryPool != VK_NULL_HANDLE) {
+      vkCmdWriteTimestamp2(commandBuffer, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, m_queryPool, 2 * slot + 1);
+      frame.timestampsWritten = true;
+    }
+
+    VK_CALL(vkEndCommandBuffer(commandBuffer));
+  }
+
+  void printStatistics() const {
+    std::println("{} frames, {} updates", m_frameCount, m_updateCount);
+    const auto printHistogram = [](std::string_view name, const FrameTimeHistogram& histogram) {
+      if (histogram.getCount() == 0) {
+        std::println("  {:<8} not measured", name);
+        return;
+      }
+      std::println("  {:<8} mean {:.2f}ms, p50 {:.2f}ms, p99 {:.2f}ms, max {:.2f}ms", name, histogram.getMean(),
+                   histogram.getPercentile(0.5), histogram.getPercentile(0.99), histogram.getMax());
+    };
+    printHistogram("frame", m_frameTimes);
+    printHistogram("cpu", m_cpuTimes);
+    printHistogram("gpu", m_gpuTimes);
+    printHistogram("present", m_presentLatencies);
+  }
+
+  // All times in milliseconds.
+  void writeStatistics(const std::string& path) const {
+    std::ofstream file{path};
+    if (!file) {
+      std::println("Unable to write the statistics to {}", path);
+      return;
+    }
+
+    file << std::format(R"({{"frames": {}, "updates": {}, "presentWait": {}, "histograms": {{)", m_frameCount,
+                        m_updateCount, m_waitForPresent != nullptr);
+    file << std::format(R"("frame": {}, "cpu": {}, "gpu": {}, "present": {}}}}})", m_frameTimes.toJson(),
+                        m_cpuTimes.toJson(), m_gpuTimes.toJson(), m_presentLatencies.toJson())
+         << '\n';
+    std::println("Statistics written to {}", path);
+  }
+
+private:
+  ApplicationSettings m_settings;
+  GLFWwindow* m_window = nullptr;
+  bool m_framebufferResized = false;
+
+  std::optional<Context> m_context;
+  std::optional<Device> m_device;
+  std::optional<Swapchain> m_swapchain;
+  ImageAllocation m_depth;
+  std::vector<VkSemaphore> m_renderFinished;
+  std::array<FrameData, kFramesInFlight> m_frames;
+  VkQueryPool m_queryPool = VK_NULL_HANDLE;
+  uint64_t m_frameIndex = 0;
+
+  PFN_vkWaitForPresentKHR m_waitForPresent = nullptr;
+  uint64_t m_presentId = 0;
+  std::deque<std::pair<uint64_t, std::chrono::steady_clock::time_point>> m_pendingPresents;
+  std::chrono::steady_clock::time_point m_nextFrameStart;
+
+  uint64_t m_frameCount = 0;
+  uint64_t m_updateCount = 0;
+  FrameTimeHistogram m_frameTimes;
+  FrameTimeHistogram m_cpuTimes;
+  FrameTimeHistogram m_gpuTimes;
+  FrameTimeHistogram m_presentLatencies;
+};
+} // namespace VulkanCore
+
+constexpr std::string_view kVertexShader = R"(
+#version 460
+
+layout(push_constant) uniform PushConstants {
+  vec2 offset;
+  float angle;
+} pushConstants;
+
+layout(location = 0) out vec3 outColor;
+
+const vec2 positions[3] = vec2[](vec2(0.0, -0.15), vec2(0.15, 0.15), vec2(-0.15, 0.15));
+const vec3 colors[3] = vec3[](vec3(1.0, 0.0, 0.0), vec3(0.0, 1.0, 0.0), vec3(0.0, 0.0, 1.0));
+
+void main() {
+  const float s = sin(pushConstants.angle);
+  const float c = cos(pushConstants.angle);
+  gl_Position = vec4(mat2(c, s, -s, c) * positions[gl_VertexIndex] + pushConstants.offset, 0.5, 1.0);
+  outColor = colors[gl_VertexIndex];
+}
+)";
+
+constexpr std::string_view kFragmentShader = R"(
+#version 460
+
+layout(location = 0) in vec3 inColor;
+layout(location = 0) out vec4 outColor;
+
+void main() {
+  outColor = vec4(inColor, 1.0);
+}
+)";
+
+struct PushConstants {
+  float offset[2];
+  float angle;
+};
+
+struct OrbitState {
+  double orbit = 0.0;
+  double spin = 0.0;
+};
+
+// A triangle on an orbit, simulated at a low rate on purpose. With interpolation it moves smoothly at any frame rate,
+// without it the steps of the simulation are plain to see. I toggles interpolation.
+class OrbitApplication final : public VulkanCore::Application {
+public:
+  OrbitApplication(VulkanCore::ApplicationSettings settings, bool interpolate)
+      : Application{std::move(settings)}, m_interpolate{interpolate} {}
+
+protected:
+  std::expected<void, std::string> onInit(VulkanCore::Device& device) override {
+    const auto vkDevice = device.getDevice();
+
+    VulkanCore::ShaderCompiler compiler;
+    const auto vertexSpirv = compiler.compile(kVertexShader, VK_SHADER_STAGE_VERTEX_BIT);
+    const auto fragmentSpirv = compiler.compile(kFragmentShader, VK_SHADER_STAGE_FRAGMENT_BIT);
+    if (!vertexSpirv || !fragmentSpirv)
+      return std::unexpected(!vertexSpirv ? vertexSpirv.error() : fragmentSpirv.error());
+    m_vertexShader = VulkanCore::createShaderModule(vkDevice, vertexSpirv.value());
+    m_fragmentShader = VulkanCore::createShaderModule(vkDevice, fragmentSpirv.value());
+
+    const VkPushConstantRange pushConstantRange{.stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+                                                .size = sizeof(PushConstants)};
+    const VkPipelineLayoutCreateInfo layoutInfo{.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+                                                .pushConstantRangeCount = 1,
+                                                .pPushConstantRanges = &pushConstantRange};
+    VK_CALL(vkCreatePipelineLayout(vkDevice, &layoutInfo, nullptr, &m_pipelineLayout));
+
+    m_pipelines.emplace(device, m_vertexShader, m_fragmentShader, m_pipelineLayout);
+    return {};
+  }
+
+  void onUpdate(double step) override {
+    m_previous = m_current;
+    m_current.orbit += 1.0 * step;
+    m_current.spin += 4.0 * step;
+  }
+
+  void onRender(const VulkanCore::FrameInfo& frame) override {
+    const auto alpha = m_interpolate ? frame.alpha : 1.0;
+    const auto orbit = std::lerp(m_previous.orbit, m_current.orbit, alpha);
+    const auto spin = std::lerp(m_previous.spin, m_current.spin, alpha);
+    const PushConstants pushConstants{.offset = {static_cast<float>(0.6 * std::cos(orbit)),
+                                                 static_cast<float>(0.6 * std::sin(orbit))},
+                                      .angle = static_cast<float>(spin)};
+
+    const auto commandBuffer = frame.commandBuffer;
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelines->get(frame.formats));
+
+    const VkViewport viewport{.width = static_cast<float>(frame.extent.width),
+                              .height = static_cast<float>(frame.extent.height),
+                              .maxDepth = 1.0f};
+    const VkRect2D scissor{.offset = {0, 0}, .extent = frame.extent};
+    vkCmdSetViewportWithCount(commandBuffer, 1, &viewport);
+    vkCmdSetScissorWithCount(commandBuffer, 1, &scissor);
+    vkCmdSetCullMode(commandBuffer, VK_CULL_MODE_NONE);
+    vkCmdSetFrontFace(commandBuffer, VK_FRONT_FACE_CLOCKWISE);
+    vkCmdSetPrimitiveTopology(commandBuffer, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);
+    vkCmdSetDepthTestEnable(commandBuffer, VK_TRUE);
+    vkCmdSetDepthWriteEnable(commandBuffer, VK_TRUE);
+    vkCmdSetDepthCompareOp(commandBuffer, VK_COMPARE_OP_LESS);
+
+    vkCmdPushConstants(commandBuffer, m_pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(pushConstants),
+                       &pushConstants);
+    vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+  }
+
+  void onKey(int key, int action) override {
+    if (key == GLFW_KEY_I && action == GLFW_PRESS) {
+      m_interpolate = !m_interpolate;
+      std::println("Interpolation {}", m_interpolate ? "on" : "off");
+    }
+  }
+
+  void onDestroy(VulkanCore::Device& device) override {
+    const auto vkDevice = device.getDevice();
+    m_pipelines.reset();
+    vkDestroyPipelineLayout(vkDevice, m_pipelineLayout, nullptr);
+    vkDestroyShaderModule(vkDevice, m_fragmentShader, nullptr);
+    vkDestroyShaderModule(vkDevice, m_vertexShader, nullptr);
+  }
+
+private:
+  bool m_interpolate;
+  OrbitState m_previous;
+  OrbitState m_current;
+  VkShaderModule m_vertexShader = VK_NULL_HANDLE;
+  VkShaderModule m_fragmentShader = VK_NULL_HANDLE;
+  VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE;
+  std::optional<VulkanCore::GraphicsPipelineCache> m_pipelines;
+};
+
+uint32_t parseArgument(std::span<char*> arguments, std::string_view name, uint32_t defaultValue) {
+  for (size_t index = 1; index + 1 < arguments.size(); ++index) {
+    if (std::string_view{arguments[index]} == name) {
+      const std::string_view value{arguments[index + 1]};
+      std::from_chars(value.data(), value.data() + value.size(), defaultValue);
+    }
+  }
+  return defaultValue;
+}
+
+std::string parseString(std::span<char*> arguments, std::string_view name, std::string defaultValue) {
+  for (size_t index = 1; index + 1 < arguments.size(); ++index) {
+    if (std::string_view{arguments[index]} == name)
+      defaultValue = arguments[index + 1];
+  }
+  return defaultValue;
+}
+
+bool hasArgument(std::span<char*> arguments, std::string_view name) {
+  return ranges::any_of(arguments | views::drop(1), [name](const char* argument) { return argument == name; });
+}
+
+// --update-rate sets the simulation steps per second, --max-fps caps the frame rate, --low-latency waits for each
+// frame to be displayed before starting the next and --stats writes the frame time histograms as JSON.
+int main(int argc, char* argv[]) {
+  const auto arguments = std::span{argv, static_cast<size_t>(argc)};
+
+  const auto updateRate = std::max(1u, parseArgument(arguments, "--update-rate", 10));
+  const auto maxFrameRate = parseArgument(arguments, "--max-fps", 0);
+
+  OrbitApplication application{VulkanCore::ApplicationSettings{.title = "01-13 Application framework",
+                                                               .updateRate = static_cast<double>(updateRate),
+                                                               .maxFrameRate = static_cast<double>(maxFrameRate),
+                                                               .lowLatency = hasArgument(arguments, "--low-latency"),
+                                                               .statisticsPath = parseString(arguments, "--stats", "")},
+                               !hasArgument(arguments, "--no-interpolation")};
+  return application.run();
+}
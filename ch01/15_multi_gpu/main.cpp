@@ -0,0 +1,1116 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <expected>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <print>
+#include <ranges>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include <glslang/Public/ResourceLimits.h>
+#include <glslang/Public/ShaderLang.h>
+#include <glslang/SPIRV/GlslangToSpv.h>
+
+#if defined(_WIN32)
+#include <malloc.h>
+#endif
+
+namespace ranges = std::ranges;
+namespace views = std::ranges::views;
+
+#define VK_CALL(vFun)                                                                                                  \
+  {                                                                                                                    \
+    const auto res = vFun;                                                                                             \
+    if (res != VK_SUCCESS) {                                                                                           \
+      std::println(#vFun " failed with error {}", static_cast<int>(res));                                              \
+      std::exit(res);                                                                                                  \
+    }                                                                                                                  \
+  }
+
+auto getRequestedInstanceLayers() -> std::vector<std::string> {
+  return std::vector<std::string>{"VK_LAYER_KHRONOS_validation"};
+}
+
+auto getRequestedInstanceExtensions() -> std::vector<std::string> {
+  return std::vector<std::string>{
+#if defined(VK_USE_PLATFORM_METAL_EXT)
+      VK_KHR_PORTABILITY_ENUMERATION_EXTENSION_NAME,
+#endif
+#if defined(VK_EXT_debug_utils)
+      VK_EXT_DEBUG_UTILS_EXTENSION_NAME,
+#endif
+  };
+}
+
+auto getRequestedDeviceExtensions() -> std::vector<std::string> {
+  return std::vector<std::string>{
+      VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME,
+  };
+}
+
+namespace VulkanCore {
+std::vector<VkLayerProperties> enumerateInstanceLayerProperties() {
+  uint32_t layersCount{0};
+  vkEnumerateInstanceLayerProperties(&layersCount, nullptr);
+
+  std::vector<VkLayerProperties> layersProperties(layersCount);
+  vkEnumerateInstanceLayerProperties(&layersCount, layersProperties.data());
+
+  return layersProperties;
+}
+
+std::vector<VkExtensionProperties> enumerateExtensionsProperties() {
+  uint32_t extensionsCount{0};
+  vkEnumerateInstanceExtensionProperties(nullptr, &extensionsCount, nullptr);
+
+  std::vector<VkExtensionProperties> extensionsProperties(extensionsCount);
+  vkEnumerateInstanceExtensionProperties(nullptr, &extensionsCount, extensionsProperties.data());
+
+  return extensionsProperties;
+}
+
+std::vector<VkExtensionProperties> enumerateDeviceExtensionsProperties(VkPhysicalDevice device) {
+  uint32_t extensionsCount{0};
+  vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionsCount, nullptr);
+
+  std::vector<VkExtensionProperties> extensionsProperties(extensionsCount);
+  vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionsCount, extensionsProperties.data());
+
+  return extensionsProperties;
+}
+
+std::vector<VkPhysicalDevice> enumeratePhysicalDevices(VkInstance instance) {
+  uint32_t physicalDevicesCount{0};
+  vkEnumeratePhysicalDevices(instance, &physicalDevicesCount, nullptr);
+
+  std::vector<VkPhysicalDevice> physicalDevices(physicalDevicesCount);
+  vkEnumeratePhysicalDevices(instance, &physicalDevicesCount, physicalDevices.data());
+
+  return physicalDevices;
+}
+
+std::vector<VkQueueFamilyProperties> enumeratePhysicalDevicesQueueFamilyProperties(VkPhysicalDevice device) {
+  uint32_t physicalDeviceQueueFamilyPropertiesCount{0};
+  vkGetPhysicalDeviceQueueFamilyProperties(device, &physicalDeviceQueueFamilyPropertiesCount, nullptr);
+
+  std::vector<VkQueueFamilyProperties> queueFamiliesProperties(physicalDeviceQueueFamilyPropertiesCount);
+  vkGetPhysicalDeviceQueueFamilyProperties(device, &physicalDeviceQueueFamilyPropertiesCount,
+                                           queueFamiliesProperties.data());
+
+  return queueFamiliesProperties;
+}
+
+std::vector<VkPhysicalDeviceGroupProperties> enumeratePhysicalDeviceGroups(VkInstance instance) {
+  uint32_t groupsCount{0};
+  vkEnumeratePhysicalDeviceGroups(instance, &groupsCount, nullptr);
+
+  std::vector<VkPhysicalDeviceGroupProperties> groups(
+      groupsCount, VkPhysicalDeviceGroupProperties{.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GROUP_PROPERTIES});
+  vkEnumeratePhysicalDeviceGroups(instance, &groupsCount, groups.data());
+
+  return groups;
+}
+
+class PhysicalDevice {
+public:
+  explicit PhysicalDevice(VkPhysicalDevice device)
+      : m_device{device}, m_extensions{enumerateDeviceExtensionsProperties(device)},
+        m_queueFamilies{enumeratePhysicalDevicesQueueFamilyProperties(device)} {
+    vkGetPhysicalDeviceProperties(m_device, &m_properties);
+    vkGetPhysicalDeviceMemoryProperties(m_device, &m_memoryProperties);
+  }
+
+  [[nodiscard]] inline VkPhysicalDevice getPhysicalDevice() const noexcept { return m_device; }
+
+  [[nodiscard]] inline const VkPhysicalDeviceProperties& getProperties() const noexcept { return m_properties; }
+
+  [[nodiscard]] inline const VkPhysicalDeviceMemoryProperties& getMemoryProperties() const noexcept {
+    return m_memoryProperties;
+  }
+
+  [[nodiscard]] bool isExtensionSupported(std::string_view name) const {
+    return ranges::any_of(m_extensions,
+                          [name](const VkExtensionProperties& prop) { return name == prop.extensionName; });
+  }
+
+  [[nodiscard]] std::optional<uint32_t> findQueueFamily(VkQueueFlags flags) const {
+    const auto it = ranges::find_if(m_queueFamilies, [flags](const VkQueueFamilyProperties& family) {
+      return (family.queueFlags & flags) == flags;
+    });
+    if (it == std::end(m_queueFamilies))
+      return std::nullopt;
+
+    return static_cast<uint32_t>(std::distance(std::begin(m_queueFamilies), it));
+  }
+
+  // Host pointers and sizes imported with VK_EXT_external_memory_host must be multiples of this, 0 without it.
+  [[nodiscard]] VkDeviceSize queryHostImportAlignment() const {
+    if (!isExtensionSupported(VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME))
+      return 0;
+
+    VkPhysicalDeviceExternalMemoryHostPropertiesEXT hostProperties{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTERNAL_MEMORY_HOST_PROPERTIES_EXT};
+    VkPhysicalDeviceProperties2 properties{.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+                                           .pNext = &hostProperties};
+    vkGetPhysicalDeviceProperties2(m_device, &properties);
+    return hostProperties.minImportedHostPointerAlignment;
+  }
+
+private:
+  VkPhysicalDevice m_device;
+  std::vector<VkExtensionProperties> m_extensions;
+  std::vector<VkQueueFamilyProperties> m_queueFamilies;
+  VkPhysicalDeviceProperties m_properties{};
+  VkPhysicalDeviceMemoryProperties m_memoryProperties{};
+};
+
+struct BufferAllocation {
+  VkBuffer buffer = VK_NULL_HANDLE;
+  VkDeviceMemory memory = VK_NULL_HANDLE;
+  VkDeviceSize size = 0;
+  // Persistently mapped when the memory is host visible, or the application's memory when it was imported.
+  void* mapped = nullptr;
+};
+
+void bufferBarrier(VkCommandBuffer commandBuffer, VkBuffer buffer, VkPipelineStageFlags2 srcStage,
+                   VkAccessFlags2 srcAccess, VkPipelineStageFlags2 dstStage, VkAccessFlags2 dstAccess) {
+  const VkBufferMemoryBarrier2 barrier{.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2,
+                                       .srcStageMask = srcStage,
+                                       .srcAccessMask = srcAccess,
+                                       .dstStageMask = dstStage,
+                                       .dstAccessMask = dstAccess,
+                                       .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                                       .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                                       .buffer = buffer,
+                                       .size = VK_WHOLE_SIZE};
+  const VkDependencyInfo dependency{.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+                                    .bufferMemoryBarrierCount = 1,
+                                    .pBufferMemoryBarriers = &barrier};
+  vkCmdPipelineBarrier2(commandBuffer, &dependency);
+}
+
+// Logical device over a single physical device, or over every physical device of a device group. A group device
+// executes each command on the devices in the current device mask. Every submission signals the next value of a
+// timeline semaphore, so a worker thread only ever waits for its own device.
+class Device {
+public:
+  static std::expected<Device, std::string> create(std::span<const PhysicalDevice> physicalDevices,
+                                                   std::vector<std::string> requestedDeviceExtensions) {
+    if (physicalDevices.empty())
+      return std::unexpected(std::string{"A device needs at least one physical device"});
+
+    Device device{physicalDevices, std::move(requestedDeviceExtensions)};
+
+    if (device.init())
+      return device;
+    else
+      return std::unexpected(std::string{"Failed to create the vulkan device"});
+  }
+
+  ~Device() {
+    if (m_device == VK_NULL_HANDLE)
+      return;
+
+    vkDeviceWaitIdle(m_device);
+    vkDestroySemaphore(m_device, m_timeline, nullptr);
+    vkDestroyCommandPool(m_device, m_commandPool, nullptr);
+    vkDestroyDevice(m_device, nullptr);
+    m_device = VK_NULL_HANDLE;
+  }
+
+  Device& operator=(const Device&) = delete;
+
+  Device(const Device&) = delete;
+
+  Device(Device&& rhs) noexcept {
+    swap(rhs);
+    rhs.m_device = VK_NULL_HANDLE;
+  }
+
+  Device& operator=(Device&& rhs) noexcept {
+    Device tmp{std::move(rhs)};
+    swap(tmp);
+    return *this;
+  }
+
+  [[nodiscard]] inline VkDevice getDevice() const noexcept { return m_device; }
+
+  // The number of physical devices behind this device, more than one for a device group.
+  [[nodiscard]] inline uint32_t getDeviceCount() const noexcept {
+    return static_cast<uint32_t>(m_physicalDevices.size());
+  }
+
+  [[nodiscard]] inline uint32_t getAllDevicesMask() const noexcept { return (1u << getDeviceCount()) - 1; }
+
+  [[nodiscard]] bool isExtensionEnabled(std::string_view name) const {
+    return ranges::find(m_enabledExtensions, name) != std::end(m_enabledExtensions);
+  }
+
+  [[nodiscard]] std::optional<uint32_t> findMemoryType(uint32_t typeBits, VkMemoryPropertyFlags required) const {
+    for (uint32_t index = 0; index < m_memoryProperties.memoryTypeCount; ++index) {
+      const auto flags = m_memoryProperties.memoryTypes[index].propertyFlags;
+      if ((typeBits & (1u << index)) && (flags & required) == required)
+        return index;
+    }
+    return std::nullopt;
+  }
+
+  BufferAllocation createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties) {
+    const VkBufferCreateInfo bufferInfo{.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+                                        .size = size,
+                                        .usage = usage,
+                                        .sharingMode = VK_SHARING_MODE_EXCLUSIVE};
+    BufferAllocation allocation{.size = size};
+    VK_CALL(vkCreateBuffer(m_device, &bufferInfo, nullptr, &allocation.buffer));
+
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements(m_device, allocation.buffer, &requirements);
+
+    const auto memoryTypeIndex = findMemoryType(requirements.memoryTypeBits, properties);
+    if (!memoryTypeIndex.has_value()) {
+      std::println("No memory type for a buffer of {} bytes", size);
+      std::exit(EXIT_FAILURE);
+    }
+
+    const VkMemoryAllocateInfo allocateInfo{.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+                                            .allocationSize = requirements.size,
+                                            .memoryTypeIndex = memoryTypeIndex.value()};
+    VK_CALL(vkAllocateMemory(m_device, &allocateInfo, nullptr, &allocation.memory));
+    VK_CALL(vkBindBufferMemory(m_device, allocation.buffer, allocation.memory, 0));
+
+    if (properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+      VK_CALL(vkMapMemory(m_device, allocation.memory, 0, VK_WHOLE_SIZE, 0, &allocation.mapped));
+    return allocation;
+  }
+
+  // Wraps application memory in a buffer, so the device writes straight into it. Empty when the extension is missing
+  // or the driver cannot import the range into coherent memory, the caller then has to copy.
+  std::optional<BufferAllocation> importHostMemory(std::span<std::byte> memory, VkBufferUsageFlags usage) {
+    if (m_getMemoryHostPointerProperties == nullptr)
+      return std::nullopt;
+
+    constexpr auto kHandleType = VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT;
+    VkMemoryHostPointerPropertiesEXT pointerProperties{.sType = VK_STRUCTURE_TYPE_MEMORY_HOST_POINTER_PROPERTIES_EXT};
+    if (m_getMemoryHostPointerProperties(m_device, kHandleType, memory.data(), &pointerProperties) != VK_SUCCESS)
+      return std::nullopt;
+
+    const VkExternalMemoryBufferCreateInfo externalInfo{.sType = VK_STRUCTURE_TYPE_EXTERNAL_MEMORY_BUFFER_CREATE_INFO,
+                                                        .handleTypes = kHandleType};
+    const VkBufferCreateInfo bufferInfo{.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+                                        .pNext = &externalInfo,
+                                        .size = memory.size(),
+                                        .usage = usage,
+                                        .sharingMode = VK_SHARING_MODE_EXCLUSIVE};
+    BufferAllocation allocation{.size = memory.size(), .mapped = memory.data()};
+    VK_CALL(vkCreateBuffer(m_device, &bufferInfo, nullptr, &allocation.buffer));
+
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements(m_device, allocation.buffer, &requirements);
+
+    // Imported memory cannot be mapped, so there is no way to invalidate it: only coherent types will do.
+    const auto memoryTypeIndex =
+        findMemoryType(requirements.memoryTypeBits & pointerProperties.memoryTypeBits,
+                       VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    if (!memoryTypeIndex.has_value() || requirements.size > memory.size()) {
+      vkDestroyBuffer(m_device, allocation.buffer, nullptr);
+      return std::nullopt;
+    }
+
+    const VkImportMemoryHostPointerInfoEXT importInfo{.sType = VK_STRUCTURE_TYPE_IMPORT_MEMORY_HOST_POINTER_INFO_EXT,
+                                                      .handleType = kHandleType,
+                                                      .pHostPointer = memory.data()};
+    const VkMemoryAllocateInfo allocateInfo{.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+                                            .pNext = &importInfo,
+                                            .allocationSize = memory.size(),
+                                            .memoryTypeIndex = memoryTypeIndex.value()};
+    if (vkAllocateMemory(m_device, &allocateInfo, nullptr, &allocation.memory) != VK_SUCCESS) {
+      vkDestroyBuffer(m_device, allocation.buffer, nullptr);
+      return std::nullopt;
+    }
+    VK_CALL(vkBindBufferMemory(m_device, allocation.buffer, allocation.memory, 0));
+    return allocation;
+  }
+
+  void destroyBuffer(BufferAllocation& allocation) {
+    vkDestroyBuffer(m_device, allocation.buffer, nullptr);
+    vkFreeMemory(m_device, allocation.memory, nullptr);
+    allocation = BufferAllocation{};
+  }
+
+  VkCommandBuffer allocateCommandBuffer() {
+    const VkCommandBufferAllocateInfo commandBufferInfo{.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+                                                        .commandPool = m_commandPool,
+                                                        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+                                                        .commandBufferCount = 1};
+    VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+    VK_CALL(vkAllocateCommandBuffers(m_device, &commandBufferInfo, &commandBuffer));
+    return commandBuffer;
+  }
+
+  // Begins a one time submit command buffer that every device of a group executes.
+  void beginCommandBuffer(VkCommandBuffer commandBuffer) const {
+    const VkDeviceGroupCommandBufferBeginInfo groupInfo{
+        .sType = VK_STRUCTURE_TYPE_DEVICE_GROUP_COMMAND_BUFFER_BEGIN_INFO, .deviceMask = getAllDevicesMask()};
+    const VkCommandBufferBeginInfo beginInfo{.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+                                             .pNext = getDeviceCount() > 1 ? &groupInfo : nullptr,
+                                             .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT};
+    VK_CALL(vkBeginCommandBuffer(commandBuffer, &beginInfo));
+  }
+
+  // Returns the timeline value that is signaled once the command buffer has completed on every device.
+  uint64_t submit(VkCommandBuffer commandBuffer) {
+    const auto signalValue = ++m_timelineValue;
+
+    const VkCommandBufferSubmitInfo commandBufferInfo{.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO,
+                                                      .commandBuffer = commandBuffer,
+                                                      .deviceMask = getDeviceCount() > 1 ? getAllDevicesMask() : 0};
+    const VkSemaphoreSubmitInfo signalInfo{.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+                                           .semaphore = m_timeline,
+                                           .value = signalValue,
+                                           .stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT};
+    const VkSubmitInfo2 submitInfo{.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2,
+                                   .commandBufferInfoCount = 1,
+                                   .pCommandBufferInfos = &commandBufferInfo,
+                                   .signalSemaphoreInfoCount = 1,
+                                   .pSignalSemaphoreInfos = &signalInfo};
+    VK_CALL(vkQueueSubmit2(m_queue, 1, &submitInfo, VK_NULL_HANDLE));
+    return signalValue;
+  }
+
+  void waitTimeline(uint64_t value) const {
+    const VkSemaphoreWaitInfo waitInfo{.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+                                       .semaphoreCount = 1,
+                                       .pSemaphores = &m_timeline,
+                                       .pValues = &value};
+    VK_CALL(vkWaitSemaphores(m_device, &waitInfo, UINT64_MAX));
+  }
+
+private:
+  Device(std::span<const PhysicalDevice> physicalDevices, std::vector<std::string> requestedDeviceExtensions)
+      : m_physicalDevices{physicalDevices | views::transform(&PhysicalDevice::getPhysicalDevice) |
+                          ranges::to<std::vector<VkPhysicalDevice>>()},
+        m_memoryProperties{physicalDevices.front().getMemoryProperties()} {
+    // The devices of a group run the same driver, checking the first one is enough.
+    const auto& physicalDevice = physicalDevices.front();
+    // clang-format off
+    m_enabledExtensions = requestedDeviceExtensions
+      | views::filter([&physicalDevice](const std::string& name) {
+          return physicalDevice.isExtensionSupported(name);
+        })
+      | ranges::to<std::vector<std::string>>();
+    // clang-format on
+
+    if (const auto family = physicalDevice.findQueueFamily(VK_QUEUE_COMPUTE_BIT))
+      m_queueFamilyIndex = family.value();
+  }
+
+  bool init() {
+    auto extensions = m_enabledExtensions | views::transform(std::mem_fn(&std::string::c_str)) |
+                      ranges::to<std::vector<const char*>>();
+
+    VkDeviceGroupDeviceCreateInfo groupInfo{.sType = VK_STRUCTURE_TYPE_DEVICE_GROUP_DEVICE_CREATE_INFO,
+                                                  .physicalDeviceCount = getDeviceCount(),
+                                                  .pPhysicalDevices = m_physicalDevices.data()};
+    VkPhysicalDeviceVulkan13Features features13{.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES,
+                                                .pNext = getDeviceCount() > 1 ? &groupInfo : nullptr,
+                                                .synchronization2 = VK_TRUE};
+    VkPhysicalDeviceVulkan12Features features12{.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
+                                                .pNext = &features13,
+                                                .timelineSemaphore = VK_TRUE};
+
+    const float queuePriority = 1.0f;
+    const VkDeviceQueueCreateInfo queueInfo{.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
+                                            .queueFamilyIndex = m_queueFamilyIndex,
+                                            .queueCount = 1,
+                                            .pQueuePriorities = &queuePriority};
+
+    const VkDeviceCreateInfo deviceInfo{.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
+                                        .pNext = &features12,
+                                        .queueCreateInfoCount = 1,
+                                        .pQueueCreateInfos = &queueInfo,
+                                        .enabledExtensionCount = static_cast<uint32_t>(extensions.size()),
+                                        .ppEnabledExtensionNames = extensions.data()};
+
+    if (vkCreateDevice(m_physicalDevices.front(), &deviceInfo, nullptr, &m_device) != VK_SUCCESS)
+      return false;
+
+    vkGetDeviceQueue(m_device, m_queueFamilyIndex, 0, &m_queue);
+
+    const VkCommandPoolCreateInfo poolInfo{.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+                                           .flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+                                           .queueFamilyIndex = m_queueFamilyIndex};
+    VK_CALL(vkCreateCommandPool(m_device, &poolInfo, nullptr, &m_commandPool));
+
+    const VkSemaphoreTypeCreateInfo timelineInfo{.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+                                                 .semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+                                                 .initialValue = 0};
+    const VkSemaphoreCreateInfo semaphoreInfo{.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+                                              .pNext = &timelineInfo};
+    VK_CALL(vkCreateSemaphore(m_device, &semaphoreInfo, nullptr, &m_timeline));
+
+    if (isExtensionEnabled(VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME))
+      m_getMemoryHostPointerProperties = reinterpret_cast<PFN_vkGetMemoryHostPointerPropertiesEXT>(
+          vkGetDeviceProcAddr(m_device, "vkGetMemoryHostPointerPropertiesEXT"));
+
+    return true;
+  }
+
+  void swap(Device& rhs) {
+    std::swap(m_physicalDevices, rhs.m_physicalDevices);
+    std::swap(m_memoryProperties, rhs.m_memoryProperties);
+    std::swap(m_enabledExtensions, rhs.m_enabledExtensions);
+    std::swap(m_queueFamilyIndex, rhs.m_queueFamilyIndex);
+    std::swap(m_device, rhs.m_device);
+    std::swap(m_queue, rhs.m_queue);
+    std::swap(m_commandPool, rhs.m_commandPool);
+    std::swap(m_timeline, rhs.m_timeline);
+    std::swap(m_timelineValue, rhs.m_timelineValue);
+    std::swap(m_getMemoryHostPointerProperties, rhs.m_getMemoryHostPointerProperties);
+  }
+
+private:
+  std::vector<VkPhysicalDevice> m_physicalDevices;
+  VkPhysicalDeviceMemoryProperties m_memoryProperties{};
+  std::vector<std::string> m_enabledExtensions;
+  uint32_t m_queueFamilyIndex = 0;
+  VkDevice m_device = VK_NULL_HANDLE;
+  VkQueue m_queue = VK_NULL_HANDLE;
+  VkCommandPool m_commandPool = VK_NULL_HANDLE;
+  VkSemaphore m_timeline = VK_NULL_HANDLE;
+  uint64_t m_timelineValue = 0;
+  PFN_vkGetMemoryHostPointerPropertiesEXT m_getMemoryHostPointerProperties = nullptr;
+};
+
+// Host memory aligned for VK_EXT_external_memory_host, the place every device's results are gathered in.
+class SharedHostBuffer {
+public:
+  SharedHostBuffer(size_t size, size_t alignment) : m_size{(size + alignment - 1) / alignment * alignment} {
+#if defined(_WIN32)
+    m_data = static_cast<std::byte*>(_aligned_malloc(m_size, alignment));
+#else
+    m_data = static_cast<std::byte*>(std::aligned_alloc(alignment, m_size));
+#endif
+  }
+
+  SharedHostBuffer(const SharedHostBuffer&) = delete;
+  SharedHostBuffer& operator=(const SharedHostBuffer&) = delete;
+
+  ~SharedHostBuffer() {
+#if defined(_WIN32)
+    _aligned_free(m_data);
+#else
+    std::free(m_data);
+#endif
+  }
+
+  [[nodiscard]] inline std::span<std::byte> data() const noexcept { return std::span{m_data, m_size}; }
+
+private:
+  size_t m_size;
+  std::byte* m_data = nullptr;
+};
+
+class ShaderCompiler {
+public:
+  ShaderCompiler() { glslang::InitializeProcess(); }
+
+  ShaderCompiler(const ShaderCompiler&) = delete;
+  ShaderCompiler& operator=(const ShaderCompiler&) = delete;
+
+  ~ShaderCompiler() { glslang::FinalizeProcess(); }
+
+  std::expected<std::vector<uint32_t>, std::string> compileCompute(std::string_view source) const {
+    glslang::TShader shader{EShLangCompute};
+    const char* sources[] = {source.data()};
+    const int lengths[] = {static_cast<int>(source.size())};
+    shader.setStringsWithLengths(sources, lengths, 1);
+    shader.setEnvInput(glslang::EShSourceGlsl, EShLangCompute, glslang::EShClientVulkan, 100);
+    shader.setEnvClient(glslang::EShClientVulkan, glslang::EShTargetVulkan_1_3);
+    shader.setEnvTarget(glslang::EShTargetSpv, glslang::EShTargetSpv_1_6);
+
+    const auto messages = static_cast<EShMessages>(EShMsgSpvRules | EShMsgVulkanRules);
+    if (!shader.parse(GetDefaultResources(), 460, false, messages))
+      return std::unexpected(std::string{shader.getInfoLog()});
+
+    glslang::TProgram program;
+    program.addShader(&shader);
+    if (!program.link(messages))
+      return std::unexpected(std::string{program.getInfoLog()});
+
+    std::vector<uint32_t> spirv;
+    glslang::GlslangToSpv(*program.getIntermediate(EShLangCompute), spirv);
+    return spirv;
+  }
+};
+
+class Context {
+public:
+  static std::expected<Context, std::string> create(std::string_view applicationName,
+                                                    std::vector<std::string> requestedInstanceLayer,
+                                                    std::vector<std::string> requestedInstanceExtensions) {
+
+    Context context{applicationName, std::move(requestedInstanceLayer), std::move(requestedInstanceExtensions)};
+
+    if (context.init())
+      return context;
+    else
+      return std::unexpected(std::string{"Failed to init the vulkan context"});
+  }
+
+  ~Context() {
+    if (m_vulkanInstance == VK_NULL_HANDLE)
+      return;
+
+    vkDestroyInstance(m_vulkanInstance, nullptr);
+    m_vulkanInstance = VK_NULL_HANDLE;
+  }
+
+  Context& operator=(const Context&) = delete;
+
+  Context(const Context&) = delete;
+
+  Context(Context&& rhs) noexcept {
+    swap(rhs);
+    rhs.m_vulkanInstance = VK_NULL_HANDLE;
+  }
+
+  Context& operator=(Context&& rhs) noexcept {
+    Context tmp{std::move(rhs)};
+    swap(tmp);
+    return *this;
+  }
+
+  std::vector<PhysicalDevice> enumeratePhysicalDevices() {
+    // clang-format off
+    auto result = VulkanCore::enumeratePhysicalDevices(m_vulkanInstance)
+      | views::transform([](VkPhysicalDevice device) -> PhysicalDevice {
+         return PhysicalDevice{device};
+        })
+      | ranges::to<std::vector<PhysicalDevice>>();
+    // clang-format on
+    return result;
+  }
+
+  // Every physical device is in exactly one group. Groups of more than one device are linked GPUs a single logical
+  // device can drive.
+  std::vector<std::vector<PhysicalDevice>> enumeratePhysicalDeviceGroups() {
+    // clang-format off
+    auto result = VulkanCore::enumeratePhysicalDeviceGroups(m_vulkanInstance)
+      | views::transform([](const VkPhysicalDeviceGroupProperties& group) {
+          return std::span{group.physicalDevices, group.physicalDeviceCount}
+            | views::transform([](VkPhysicalDevice device) { return PhysicalDevice{device}; })
+            | ranges::to<std::vector<PhysicalDevice>>();
+        })
+      | ranges::to<std::vector<std::vector<PhysicalDevice>>>();
+    // clang-format on
+    return result;
+  }
+
+private:
+  Context(std::string_view applicationName, std::vector<std::string> requestedInstanceLayer,
+          std::vector<std::string> requestedInstanceExtensions)
+      : m_applicationName{applicationName} {
+    auto allInstanceLayers = enumerateInstanceLayerProperties();
+    const auto isInstanceLayerRequired = [&requestedInstanceLayer](const VkLayerProperties& prop) {
+      auto name = std::string{prop.layerName};
+      return ranges::find(requestedInstanceLayer, name) != std::end(requestedInstanceLayer);
+    };
+    // clang-format off
+    m_layerProperties = allInstanceLayers
+      | views::filter(isInstanceLayerRequired)
+      | ranges::to<std::vector<VkLayerProperties>>();
+    // clang-format on
+
+    auto allExtensions = enumerateExtensionsProperties();
+    const auto isExtensionRequired = [&requestedInstanceExtensions](const VkExtensionProperties& prop) {
+      auto name = std::string{prop.extensionName};
+      return ranges::find(requestedInstanceExtensions, name) != std::end(requestedInstanceExtensions);
+    };
+    // clang-format off
+    m_layerExtensions = allExtensions
+      | views::filter(isExtensionRequired)
+      | ranges::to<std::vector<VkExtensionProperties>>();
+    // clang-format on
+  }
+
+  bool init() {
+    // clang-format off
+    auto layers = m_layerProperties
+      | views::transform([](const VkLayerProperties& prop) -> const char*
+        {
+          return prop.layerName;
+        })
+      | ranges::to<std::vector<const char*>>();
+
+      auto extensions = m_layerExtensions
+        | views::transform([](const VkExtensionProperties & prop) -> const char*
+          {
+            return prop.extensionName;
+          })
+        | ranges::to<std::vector<const char*>>();
+    // clang-format on
+
+    const VkApplicationInfo applicationInfo{.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO,
+                                            .pApplicationName = m_applicationName.data(),
+                                            .applicationVersion = VK_MAKE_VERSION(1, 0, 0),
+                                            .apiVersion = VK_API_VERSION_1_3};
+
+    const VkInstanceCreateInfo instanceCreateInfo{.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO,
+#if defined(VK_USE_PLATFORM_METAL_EXT)
+                                                  .flags = VK_INSTANCE_CREATE_ENUMERATE_PORTABILITY_BIT_KHR,
+#endif
+                                                  .pApplicationInfo = &applicationInfo,
+                                                  .enabledLayerCount = static_cast<uint32_t>(layers.size()),
+                                                  .ppEnabledLayerNames = layers.data(),
+                                                  .enabledExtensionCount = static_cast<uint32_t>(extensions.size()),
+                                                  .ppEnabledExtensionNames = extensions.data()};
+
+    const auto res = vkCreateInstance(&instanceCreateInfo, nullptr, &m_vulkanInstance);
+    return res == VK_SUCCESS;
+  }
+
+  void swap(Context& rhs) {
+    std::swap(m_applicationName, rhs.m_applicationName);
+    std::swap(m_layerProperties, rhs.m_layerProperties);
+    std::swap(m_layerExtensions, rhs.m_layerExtensions);
+    std::swap(m_vulkanInstance, rhs.m_vulkanInstance);
+  }
+
+private:
+  std::string m_applicationName;
+  std::vector<VkLayerProperties> m_layerProperties;
+  std::vector<VkExtensionProperties> m_layerExtensions;
+  VkInstance m_vulkanInstance = VK_NULL_HANDLE;
+};
+} // namespace VulkanCore
+
+// Every element is an independent, deliberately expensive integer hash of its index, so any split of the range is
+// valid and the CPU can check every single value.
+constexpr std::string_view kHashShader = R"(
+#version 460
+
+layout(local_size_x = 256) in;
+
+layout(set = 0, binding = 0) writeonly buffer Output {
+  uint values[];
+};
+
+layout(push_constant) uniform PushConstants {
+  uint begin;
+  uint end;
+  uint outputBase;
+  uint iterations;
+} pushConstants;
+
+void main() {
+  const uint index = pushConstants.begin + gl_GlobalInvocationID.x;
+  if (index >= pushConstants.end)
+    return;
+
+  uint x = index;
+  for (uint iteration = 0; iteration < pushConstants.iterations; ++iteration) {
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+  }
+  values[index - pushConstants.outputBase] = x;
+}
+)";
+
+constexpr uint32_t kWorkgroupSize = 256;
+
+uint32_t hashValue(uint32_t index, uint32_t iterations) {
+  auto x = index;
+  for (uint32_t iteration = 0; iteration < iterations; ++iteration) {
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+  }
+  return x;
+}
+
+// Elements [begin, end) are written to values[index - outputBase] of the bound buffer.
+struct HashParameters {
+  uint32_t begin = 0;
+  uint32_t end = 0;
+  uint32_t outputBase = 0;
+  uint32_t iterations = 0;
+};
+
+// The hash pipeline of one device, with a descriptor set per output buffer it writes to. Dispatches go through
+// vkCmdDispatchBase so a device group can give each device its own range of workgroups.
+class HashKernel {
+public:
+  HashKernel(VulkanCore::Device& device, std::span<const uint32_t> spirv,
+             std::span<const VulkanCore::BufferAllocation> outputs)
+      : m_device{device} {
+    const auto vkDevice = m_device.getDevice();
+
+    const VkDescriptorSetLayoutBinding binding{.binding = 0,
+                                               .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                               .descriptorCount = 1,
+                                               .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT};
+    const VkDescriptorSetLayoutCreateInfo setLayoutInfo{.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+                                                        .bindingCount = 1,
+                                                        .pBindings = &binding};
+    VK_CALL(vkCreateDescriptorSetLayout(vkDevice, &setLayoutInfo, nullptr, &m_setLayout));
+
+    const VkPushConstantRange pushConstantRange{.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+                                                .size = sizeof(HashParameters)};
+    const VkPipelineLayoutCreateInfo layoutInfo{.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+                                                .setLayoutCount = 1,
+                                                .pSetLayouts = &m_setLayout,
+                                                .pushConstantRangeCount = 1,
+                                                .pPushConstantRanges = &pushConstantRange};
+    VK_CALL(vkCreatePipelineLayout(vkDevice, &layoutInfo, nullptr, &m_layout));
+
+    const VkShaderModuleCreateInfo moduleInfo{.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+                                              .codeSize = spirv.size_bytes(),
+                                              .pCode = spirv.data()};
+    VkShaderModule shader = VK_NULL_HANDLE;
+    VK_CALL(vkCreateShaderModule(vkDevice, &moduleInfo, nullptr, &shader));
+    const VkComputePipelineCreateInfo pipelineInfo{
+        .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+        .flags = VK_PIPELINE_CREATE_DISPATCH_BASE_BIT,
+        .stage = {.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+                  .stage = VK_SHADER_STAGE_COMPUTE_BIT,
+                  .module = shader,
+                  .pName = "main"},
+        .layout = m_layout};
+    VK_CALL(vkCreateComputePipelines(vkDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_pipeline));
+    vkDestroyShaderModule(vkDevice, shader, nullptr);
+
+    const VkDescriptorPoolSize poolSize{.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                        .descriptorCount = static_cast<uint32_t>(outputs.size())};
+    const VkDescriptorPoolCreateInfo poolInfo{.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+                                              .maxSets = static_cast<uint32_t>(outputs.size()),
+                                              .poolSizeCount = 1,
+                                              .pPoolSizes = &poolSize};
+    VK_CALL(vkCreateDescriptorPool(vkDevice, &poolInfo, nullptr, &m_pool));
+
+    for (const auto& output : outputs) {
+      const VkDescriptorSetAllocateInfo allocateInfo{.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+                                                     .descriptorPool = m_pool,
+                                                     .descriptorSetCount = 1,
+                                                     .pSetLayouts = &m_setLayout};
+      VkDescriptorSet set = VK_NULL_HANDLE;
+      VK_CALL(vkAllocateDescriptorSets(vkDevice, &allocateInfo, &set));
+
+      const VkDescriptorBufferInfo bufferInfo{.buffer = output.buffer, .range = VK_WHOLE_SIZE};
+      const VkWriteDescriptorSet write{.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                                       .dstSet = set,
+                                       .dstBinding = 0,
+                                       .descriptorCount = 1,
+                                       .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                       .pBufferInfo = &bufferInfo};
+      vkUpdateDescriptorSets(vkDevice, 1, &write, 0, nullptr);
+      m_sets.push_back(set);
+    }
+  }
+
+  HashKernel(const HashKernel&) = delete;
+  HashKernel& operator=(const HashKernel&) = delete;
+
+  ~HashKernel() {
+    const auto vkDevice = m_device.getDevice();
+    vkDestroyDescriptorPool(vkDevice, m_pool, nullptr);
+    vkDestroyPipeline(vkDevice, m_pipeline, nullptr);
+    vkDestroyPipelineLayout(vkDevice, m_layout, nullptr);
+    vkDestroyDescriptorSetLayout(vkDevice, m_setLayout, nullptr);
+  }
+
+  // Covers [parameters.begin, parameters.end) starting at workgroup baseGroup, relative to parameters.begin.
+  void dispatch(VkCommandBuffer commandBuffer, uint32_t output, const HashParameters& parameters, uint32_t baseGroup,
+                uint32_t groupCount) const {
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_layout, 0, 1, &m_sets[output], 0,
+                            nullptr);
+    vkCmdPushConstants(commandBuffer, m_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(parameters), &parameters);
+    vkCmdDispatchBase(commandBuffer, baseGroup, 0, 0, groupCount, 1, 1);
+  }
+
+private:
+  VulkanCore::Device& m_device;
+  VkDescriptorSetLayout m_setLayout = VK_NULL_HANDLE;
+  VkPipelineLayout m_layout = VK_NULL_HANDLE;
+  VkPipeline m_pipeline = VK_NULL_HANDLE;
+  VkDescriptorPool m_pool = VK_NULL_HANDLE;
+  std::vector<VkDescriptorSet> m_sets;
+};
+
+uint32_t getGroupCount(uint32_t elements) { return (elements + kWorkgroupSize - 1) / kWorkgroupSize; }
+
+struct DeviceShare {
+  std::string name;
+  uint64_t batches = 0;
+  uint64_t elements = 0;
+};
+
+// One logical device over a whole device group. A single command buffer carries one dispatch per device, each
+// restricted to its device with vkCmdSetDeviceMask and offset with a dispatch base. Host visible memory is not
+// instanced per device, so all of them write into the same buffer.
+std::vector<DeviceShare> runDeviceGroup(std::span<const VulkanCore::PhysicalDevice> group,
+                                        std::span<const uint32_t> spirv, std::span<uint32_t> results,
+                                        uint32_t iterations) {
+  auto device = VulkanCore::Device::create(group, getRequestedDeviceExtensions());
+  if (!device) {
+    std::println("Unable to create the group device: {}", device.error());
+    std::exit(EXIT_FAILURE);
+  }
+
+  const auto elementCount = static_cast<uint32_t>(results.size());
+  auto output = device->createBuffer(results.size_bytes(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                     VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+  std::vector<DeviceShare> shares;
+  {
+    const HashKernel kernel{device.value(), spirv, std::span{&output, 1}};
+
+    const auto commandBuffer = device->allocateCommandBuffer();
+    device->beginCommandBuffer(commandBuffer);
+
+    const auto deviceCount = device->getDeviceCount();
+    const auto totalGroups = getGroupCount(elementCount);
+    const HashParameters parameters{.begin = 0, .end = elementCount, .outputBase = 0, .iterations = iterations};
+    for (uint32_t index = 0; index < deviceCount; ++index) {
+      const auto firstGroup = totalGroups * index / deviceCount;
+      const auto lastGroup = totalGroups * (index + 1) / deviceCount;
+      vkCmdSetDeviceMask(commandBuffer, 1u << index);
+      kernel.dispatch(commandBuffer, 0, parameters, firstGroup, lastGroup - firstGroup);
+
+      const auto firstElement = std::min(firstGroup * kWorkgroupSize, elementCount);
+      const auto lastElement = std::min(lastGroup * kWorkgroupSize, elementCount);
+      shares.push_back(DeviceShare{.name = group[index].getProperties().deviceName,
+                                   .batches = 1,
+                                   .elements = lastElement - firstElement});
+    }
+    vkCmdSetDeviceMask(commandBuffer, device->getAllDevicesMask());
+    VulkanCore::bufferBarrier(commandBuffer, output.buffer, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                              VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT, VK_PIPELINE_STAGE_2_HOST_BIT,
+                              VK_ACCESS_2_HOST_READ_BIT);
+    VK_CALL(vkEndCommandBuffer(commandBuffer));
+
+    device->waitTimeline(device->submit(commandBuffer));
+    std::memcpy(results.data(), output.mapped, results.size_bytes());
+  }
+  device->destroyBuffer(output);
+  return shares;
+}
+
+// One logical device per physical device, each driven by its own thread. The threads pull batches from a shared
+// counter, so a faster device simply ends up doing more of them. When a device can import host memory it writes
+// its batches straight into the shared results; otherwise it writes into a staging buffer the thread copies from.
+std::vector<DeviceShare> runPerDevice(std::span<const VulkanCore::PhysicalDevice> physicalDevices,
+                                      std::span<const uint32_t> spirv, VulkanCore::SharedHostBuffer& shared,
+                                      uint32_t elementCount, uint32_t batchSize, uint32_t iterations) {
+  constexpr uint32_t kBatchesInFlight = 2;
+
+  std::vector<VulkanCore::Device> devices;
+  for (const auto& physicalDevice : physicalDevices) {
+    auto device = VulkanCore::Device::create(std::span{&physicalDevice, 1}, getRequestedDeviceExtensions());
+    if (!device) {
+      std::println("Unable to create a device on {}: {}", physicalDevice.getProperties().deviceName, device.error());
+      std::exit(EXIT_FAILURE);
+    }
+    devices.push_back(std::move(device.value()));
+  }
+
+  const auto results = reinterpret_cast<uint32_t*>(shared.data().data());
+  const auto batchCount = (elementCount + batchSize - 1) / batchSize;
+  std::atomic<uint32_t> nextBatch{0};
+  std::vector<DeviceShare> shares(devices.size());
+
+  const auto work = [&](size_t deviceIndex) {
+    auto& device = devices[deviceIndex];
+    auto& share = shares[deviceIndex];
+    share.name = physicalDevices[deviceIndex].getProperties().deviceName;
+
+    // Either the imported shared buffer once, or one staging buffer per batch in flight.
+    std::vector<VulkanCore::BufferAllocation> outputs;
+    const auto imported = device.importHostMemory(shared.data(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+    if (imported.has_value()) {
+      outputs.push_back(imported.value());
+    } else {
+      for (uint32_t slot = 0; slot < kBatchesInFlight; ++slot)
+        outputs.push_back(device.createBuffer(VkDeviceSize{batchSize} * sizeof(uint32_t),
+                                              VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                              VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                                  VK_MEMORY_PROPERTY_HOST_COHERENT_BIT));
+    }
+
+    struct Slot {
+      VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+      uint64_t timelineValue = 0;
+      std::optional<HashParameters> batch;
+    };
+    std::array<Slot, kBatchesInFlight> slots;
+    for (auto& slot : slots)
+      slot.commandBuffer = device.allocateCommandBuffer();
+
+    {
+      const HashKernel kernel{device, spirv, outputs};
+
+      const auto complete = [&](uint32_t slotIndex) {
+        auto& slot = slots[slotIndex];
+        if (!slot.batch.has_value())
+          return;
+
+        device.waitTimeline(slot.timelineValue);
+        const auto count = slot.batch->end - slot.batch->begin;
+        if (!imported.has_value())
+          std::memcpy(results + slot.batch->begin, outputs[slotIndex].mapped, size_t{count} * sizeof(uint32_t));
+        ++share.batches;
+        share.elements += count;
+        slot.batch.reset();
+      };
+
+      for (uint32_t submitted = 0;; ++submitted) {
+        const auto batch = nextBatch.fetch_add(1);
+        if (batch >= batchCount)
+          break;
+
+        const auto slotIndex = submitted % kBatchesInFlight;
+        complete(slotIndex);
+        auto& slot = slots[slotIndex];
+
+        const auto begin = batch * batchSize;
+        const auto end = std::min(begin + batchSize, elementCount);
+        slot.batch = HashParameters{
+            .begin = begin, .end = end, .outputBase = imported.has_value() ? 0 : begin, .iterations = iterations};
+
+        const auto output = imported.has_value() ? 0 : slotIndex;
+        VK_CALL(vkResetCommandBuffer(slot.commandBuffer, 0));
+        device.beginCommandBuffer(slot.commandBuffer);
+        kernel.dispatch(slot.commandBuffer, output, slot.batch.value(), 0, getGroupCount(end - begin));
+        VulkanCore::bufferBarrier(slot.commandBuffer, outputs[output].buffer, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                                  VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT, VK_PIPELINE_STAGE_2_HOST_BIT,
+                                  VK_ACCESS_2_HOST_READ_BIT);
+        VK_CALL(vkEndCommandBuffer(slot.commandBuffer));
+        slot.timelineValue = device.submit(slot.commandBuffer);
+      }
+      for (uint32_t slotIndex = 0; slotIndex < kBatchesInFlight; ++slotIndex)
+        complete(slotIndex);
+    }
+
+    for (auto& output : outputs)
+      device.destroyBuffer(output);
+    if (imported.has_value())
+      std::println("{} wrote into the shared host memory directly", share.name);
+    else
+      std::println("{} cannot import host memory, its batches were copied", share.name);
+  };
+
+  {
+    std::vector<std::jthread> workers;
+    for (size_t index = 0; index < devices.size(); ++index)
+      workers.emplace_back(work, index);
+  }
+  return shares;
+}
+
+uint32_t parseArgument(std::span<char*> arguments, std::string_view name, uint32_t defaultValue) {
+  for (size_t index = 1; index + 1 < arguments.size(); ++index) {
+    if (std::string_view{arguments[index]} == name) {
+      const std::string_view value{arguments[index + 1]};
+      std::from_chars(value.data(), value.data() + value.size(), defaultValue);
+    }
+  }
+  return defaultValue;
+}
+
+bool hasArgument(std::span<char*> arguments, std::string_view name) {
+  return ranges::any_of(arguments | views::drop(1), [name](const char* argument) { return argument == name; });
+}
+
+// Spreads --elements hashes over every GPU. A device group is driven as one logical device, otherwise every physical
+// device gets its own device and worker thread. --replicate N drives the first physical device through N separate
+// devices instead, which exercises the whole distribution and gather path on a single GPU or on lavapipe.
+// --no-device-groups forces the per device path. Every value is checked against the CPU at the end.
+int main(int argc, char* argv[]) {
+  const std::string applicationName = "01-15 Multi GPU";
+  const auto arguments = std::span{argv, static_cast<size_t>(argc)};
+  const auto elementCount = std::max(1u, parseArgument(arguments, "--elements", 1u << 24));
+  const auto batchSize = std::max(kWorkgroupSize, parseArgument(arguments, "--batch", 1u << 18));
+  const auto iterations = parseArgument(arguments, "--iterations", 32);
+  const auto replicate = parseArgument(arguments, "--replicate", 0);
+  const auto useDeviceGroups = !hasArgument(arguments, "--no-device-groups") && replicate == 0;
+
+  auto vulkanContext =
+      VulkanCore::Context::create(applicationName, getRequestedInstanceLayers(), getRequestedInstanceExtensions());
+
+  if (!vulkanContext) {
+    std::println("Unable to create the context: {}", vulkanContext.error());
+    return EXIT_FAILURE;
+  }
+
+  auto physicalDevices = vulkanContext->enumeratePhysicalDevices();
+  if (physicalDevices.empty()) {
+    std::println("No physical devices found");
+    return EXIT_FAILURE;
+  }
+
+  const auto groups = vulkanContext->enumeratePhysicalDeviceGroups();
+  const auto linkedGroup = ranges::find_if(groups, [](const auto& group) { return group.size() > 1; });
+
+  VulkanCore::ShaderCompiler compiler;
+  const auto spirv = compiler.compileCompute(kHashShader);
+  if (!spirv) {
+    std::println("Unable to compile the shader: {}", spirv.error());
+    return EXIT_FAILURE;
+  }
+
+  // Aligned for the strictest importer, the devices then import the same pages.
+  VkDeviceSize alignment = 4096;
+  for (const auto& physicalDevice : physicalDevices)
+    alignment = std::max(alignment, physicalDevice.queryHostImportAlignment());
+  VulkanCore::SharedHostBuffer shared{size_t{elementCount} * sizeof(uint32_t), static_cast<size_t>(alignment)};
+  const auto results = std::span{reinterpret_cast<uint32_t*>(shared.data().data()), elementCount};
+  ranges::fill(results, 0u);
+
+  const auto start = std::chrono::steady_clock::now();
+  std::vector<DeviceShare> shares;
+  if (useDeviceGroups && linkedGroup != std::end(groups)) {
+    std::println("Using a device group of {} devices", linkedGroup->size());
+    shares = runDeviceGroup(*linkedGroup, spirv.value(), results, iterations);
+  } else {
+    if (replicate > 0)
+      physicalDevices = std::vector<VulkanCore::PhysicalDevice>(replicate, physicalDevices.front());
+    std::println("Using {} separate devices, {} batches of {} elements", physicalDevices.size(),
+                 (elementCount + batchSize - 1) / batchSize, batchSize);
+    shares = runPerDevice(physicalDevices, spirv.value(), shared, elementCount, batchSize, iterations);
+  }
+  const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  for (const auto& [index, share] : views::enumerate(shares))
+    std::println("  device {} ({}): {} batches, {} elements, {:.1f}%", index, share.name, share.batches,
+                 share.elements, 100.0 * static_cast<double>(share.elements) / elementCount);
+  std::println("{} elements x {} iterations in {:.3f}s, {:.1f} M elements/s", elementCount, iterations, elapsed,
+               elementCount / elapsed / 1e6);
+
+  uint32_t mismatches = 0;
+  for (uint32_t index = 0; index < elementCount; ++index) {
+    if (results[index] != hashValue(index, iterations) && mismatches++ < 8)
+      std::println("Mismatch at {}: {:#010x} instead of {:#010x}", index, results[index], hashValue(index, iterations));
+  }
+  std::println("{} of {} values verified", elementCount - mismatches, elementCount);
+
+  return mismatches == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,696 @@
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <cstdlib>
+#include <expected>
+#include <filesystem>
+#include <format>
+#include <functional>
+#include <iterator>
+#include <optional>
+#include <print>
+#include <ranges>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+namespace ranges = std::ranges;
+namespace views = std::ranges::views;
+
+#define VK_CALL(vFun)                                                                                                  \
+  {                                                                                                                    \
+    const auto res = vFun;                                                                                             \
+    if (res != VK_SUCCESS) {                                                                                           \
+      std::println(#vFun " failed with error {}", static_cast<int>(res));                                              \
+      std::exit(res);                                                                                                  \
+    }                                                                                                                  \
+  }
+
+// The mock driver has no validation layer behind it, and the point is to time the loader and driver alone.
+auto getRequestedInstanceLayers() -> std::vector<std::string> { return {}; }
+
+auto getRequestedInstanceExtensions() -> std::vector<std::string> {
+  return std::vector<std::string>{
+#if defined(VK_USE_PLATFORM_METAL_EXT)
+      VK_KHR_PORTABILITY_ENUMERATION_EXTENSION_NAME,
+#endif
+#if defined(VK_EXT_debug_utils)
+      VK_EXT_DEBUG_UTILS_EXTENSION_NAME,
+#endif
+  };
+}
+
+namespace VulkanCore {
+std::vector<VkLayerProperties> enumerateInstanceLayerProperties() {
+  uint32_t layersCount{0};
+  vkEnumerateInstanceLayerProperties(&layersCount, nullptr);
+
+  std::vector<VkLayerProperties> layersProperties(layersCount);
+  vkEnumerateInstanceLayerProperties(&layersCount, layersProperties.data());
+
+  return layersProperties;
+}
+
+std::vector<VkExtensionProperties> enumerateExtensionsProperties() {
+  uint32_t extensionsCount{0};
+  vkEnumerateInstanceExtensionProperties(nullptr, &extensionsCount, nullptr);
+
+  std::vector<VkExtensionProperties> extensionsProperties(extensionsCount);
+  vkEnumerateInstanceExtensionProperties(nullptr, &extensionsCount, extensionsProperties.data());
+
+  return extensionsProperties;
+}
+
+std::vector<VkExtensionProperties> enumerateDeviceExtensionsProperties(VkPhysicalDevice device) {
+  uint32_t extensionsCount{0};
+  vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionsCount, nullptr);
+
+  std::vector<VkExtensionProperties> extensionsProperties(extensionsCount);
+  vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionsCount, extensionsProperties.data());
+
+  return extensionsProperties;
+}
+
+std::vector<VkPhysicalDevice> enumeratePhysicalDevices(VkInstance instance) {
+  uint32_t physicalDevicesCount{0};
+  vkEnumeratePhysicalDevices(instance, &physicalDevicesCount, nullptr);
+
+  std::vector<VkPhysicalDevice> physicalDevices(physicalDevicesCount);
+  vkEnumeratePhysicalDevices(instance, &physicalDevicesCount, physicalDevices.data());
+
+  return physicalDevices;
+}
+
+std::vector<VkQueueFamilyProperties> enumeratePhysicalDevicesQueueFamilyProperties(VkPhysicalDevice device) {
+  uint32_t physicalDeviceQueueFamilyPropertiesCount{0};
+  vkGetPhysicalDeviceQueueFamilyProperties(device, &physicalDeviceQueueFamilyPropertiesCount, nullptr);
+
+  std::vector<VkQueueFamilyProperties> queueFamiliesProperties(physicalDeviceQueueFamilyPropertiesCount);
+  vkGetPhysicalDeviceQueueFamilyProperties(device, &physicalDeviceQueueFamilyPropertiesCount,
+                                           queueFamiliesProperties.data());
+
+  return queueFamiliesProperties;
+}
+
+class PhysicalDevice {
+public:
+  explicit PhysicalDevice(VkPhysicalDevice device)
+      : m_device{device}, m_extensions{enumerateDeviceExtensionsProperties(device)},
+        m_queueFamilies{enumeratePhysicalDevicesQueueFamilyProperties(device)} {
+    vkGetPhysicalDeviceProperties(m_device, &m_properties);
+    vkGetPhysicalDeviceMemoryProperties(m_device, &m_memoryProperties);
+  }
+
+  [[nodiscard]] inline VkPhysicalDevice getPhysicalDevice() const noexcept { return m_device; }
+
+  [[nodiscard]] inline const VkPhysicalDeviceProperties& getProperties() const noexcept { return m_properties; }
+
+  [[nodiscard]] inline const VkPhysicalDeviceMemoryProperties& getMemoryProperties() const noexcept {
+    return m_memoryProperties;
+  }
+
+  [[nodiscard]] bool isExtensionSupported(std::string_view name) const {
+    return ranges::any_of(m_extensions,
+                          [name](const VkExtensionProperties& prop) { return name == prop.extensionName; });
+  }
+
+  [[nodiscard]] std::optional<uint32_t> findQueueFamily(VkQueueFlags flags) const {
+    const auto it = ranges::find_if(m_queueFamilies, [flags](const VkQueueFamilyProperties& family) {
+      return (family.queueFlags & flags) == flags;
+    });
+    if (it == std::end(m_queueFamilies))
+      return std::nullopt;
+
+    return static_cast<uint32_t>(std::distance(std::begin(m_queueFamilies), it));
+  }
+
+  [[nodiscard]] VkDeviceSize getDeviceLocalMemorySize() const {
+    const auto heaps = std::span{m_memoryProperties.memoryHeaps, m_memoryProperties.memoryHeapCount};
+    VkDeviceSize size = 0;
+    for (const auto& heap : heaps) {
+      if (heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)
+        size += heap.size;
+    }
+    return size;
+  }
+
+private:
+  VkPhysicalDevice m_device;
+  std::vector<VkExtensionProperties> m_extensions;
+  std::vector<VkQueueFamilyProperties> m_queueFamilies;
+  VkPhysicalDeviceProperties m_properties{};
+  VkPhysicalDeviceMemoryProperties m_memoryProperties{};
+};
+
+// Discrete before integrated before virtual before CPU devices, then the one with the most device local memory.
+uint64_t scorePhysicalDevice(const PhysicalDevice& physicalDevice) {
+  uint64_t typeScore = 0;
+  switch (physicalDevice.getProperties().deviceType) {
+  case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+    typeScore = 4;
+    break;
+  case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+    typeScore = 3;
+    break;
+  case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+    typeScore = 2;
+    break;
+  case VK_PHYSICAL_DEVICE_TYPE_CPU:
+    typeScore = 1;
+    break;
+  default:
+    break;
+  }
+  return (typeScore << 48) + (physicalDevice.getDeviceLocalMemorySize() >> 20);
+}
+
+// The best scoring device with a queue family supporting all of queueFlags, the first one on a tie.
+std::optional<size_t> selectPhysicalDevice(std::span<const PhysicalDevice> physicalDevices, VkQueueFlags queueFlags) {
+  std::optional<size_t> selected;
+  uint64_t selectedScore = 0;
+  for (size_t index = 0; index < physicalDevices.size(); ++index) {
+    if (!physicalDevices[index].findQueueFamily(queueFlags).has_value())
+      continue;
+
+    const auto score = scorePhysicalDevice(physicalDevices[index]);
+    if (!selected.has_value() || score > selectedScore) {
+      selected = index;
+      selectedScore = score;
+    }
+  }
+  return selected;
+}
+
+// A device with one queue and one command buffer. Unlike the other recipes, submission failures are returned rather
+// than fatal, since a lost device is exactly what the caller wants to see.
+class Device {
+public:
+  static std::expected<Device, std::string> create(const PhysicalDevice& physicalDevice, uint32_t queueFamilyIndex) {
+    Device device{physicalDevice, queueFamilyIndex};
+
+    if (device.init())
+      return device;
+    else
+      return std::unexpected(std::string{"Failed to create the vulkan device"});
+  }
+
+  ~Device() {
+    if (m_device == VK_NULL_HANDLE)
+      return;
+
+    // Fails with VK_ERROR_DEVICE_LOST on a lost device, which is fine: destroying its objects is still valid.
+    vkDeviceWaitIdle(m_device);
+    vkDestroyFence(m_device, m_fence, nullptr);
+    vkDestroyCommandPool(m_device, m_commandPool, nullptr);
+    vkDestroyDevice(m_device, nullptr);
+    m_device = VK_NULL_HANDLE;
+  }
+
+  Device& operator=(const Device&) = delete;
+
+  Device(const Device&) = delete;
+
+  Device(Device&& rhs) noexcept {
+    swap(rhs);
+    rhs.m_device = VK_NULL_HANDLE;
+  }
+
+  Device& operator=(Device&& rhs) noexcept {
+    Device tmp{std::move(rhs)};
+    swap(tmp);
+    return *this;
+  }
+
+  [[nodiscard]] inline VkDevice getDevice() const noexcept { return m_device; }
+
+  // Records an empty command buffer, submits it and waits for it.
+  [[nodiscard]] VkResult submitAndWait() {
+    VK_CALL(vkResetFences(m_device, 1, &m_fence));
+    VK_CALL(vkResetCommandBuffer(m_commandBuffer, 0));
+    const VkCommandBufferBeginInfo beginInfo{.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+                                             .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT};
+    VK_CALL(vkBeginCommandBuffer(m_commandBuffer, &beginInfo));
+    VK_CALL(vkEndCommandBuffer(m_commandBuffer));
+
+    const VkCommandBufferSubmitInfo commandBufferInfo{.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO,
+                                                      .commandBuffer = m_commandBuffer};
+    const VkSubmitInfo2 submitInfo{.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2,
+                                   .commandBufferInfoCount = 1,
+                                   .pCommandBufferInfos = &commandBufferInfo};
+    if (const auto result = vkQueueSubmit2(m_queue, 1, &submitInfo, m_fence); result != VK_SUCCESS)
+      return result;
+    return vkWaitForFences(m_device, 1, &m_fence, VK_TRUE, UINT64_MAX);
+  }
+
+private:
+  Device(const PhysicalDevice& physicalDevice, uint32_t queueFamilyIndex)
+      : m_physicalDevice{physicalDevice.getPhysicalDevice()}, m_queueFamilyIndex{queueFamilyIndex} {}
+
+  bool init() {
+    VkPhysicalDeviceVulkan13Features features13{.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES,
+                                                .synchronization2 = VK_TRUE};
+
+    const float queuePriority = 1.0f;
+    const VkDeviceQueueCreateInfo queueInfo{.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
+                                            .queueFamilyIndex = m_queueFamilyIndex,
+                                            .queueCount = 1,
+                                            .pQueuePriorities = &queuePriority};
+
+    const VkDeviceCreateInfo deviceInfo{.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
+                                        .pNext = &features13,
+                                        .queueCreateInfoCount = 1,
+                                        .pQueueCreateInfos = &queueInfo};
+
+    if (vkCreateDevice(m_physicalDevice, &deviceInfo, nullptr, &m_device) != VK_SUCCESS)
+      return false;
+
+    vkGetDeviceQueue(m_device, m_queueFamilyIndex, 0, &m_queue);
+
+    const VkCommandPoolCreateInfo poolInfo{.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+                                           .flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+                                           .queueFamilyIndex = m_queueFamilyIndex};
+    VK_CALL(vkCreateCommandPool(m_device, &poolInfo, nullptr, &m_commandPool));
+
+    const VkCommandBufferAllocateInfo commandBufferInfo{.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+                                                        .commandPool = m_commandPool,
+                                                        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+                                                        .commandBufferCount = 1};
+    VK_CALL(vkAllocateCommandBuffers(m_device, &commandBufferInfo, &m_commandBuffer));
+
+    const VkFenceCreateInfo fenceInfo{.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
+    VK_CALL(vkCreateFence(m_device, &fenceInfo, nullptr, &m_fence));
+    return true;
+  }
+
+  void swap(Device& rhs) {
+    std::swap(m_physicalDevice, rhs.m_physicalDevice);
+    std::swap(m_queueFamilyIndex, rhs.m_queueFamilyIndex);
+    std::swap(m_device, rhs.m_device);
+    std::swap(m_queue, rhs.m_queue);
+    std::swap(m_commandPool, rhs.m_commandPool);
+    std::swap(m_commandBuffer, rhs.m_commandBuffer);
+    std::swap(m_fence, rhs.m_fence);
+  }
+
+private:
+  VkPhysicalDevice m_physicalDevice = VK_NULL_HANDLE;
+  uint32_t m_queueFamilyIndex = 0;
+  VkDevice m_device = VK_NULL_HANDLE;
+  VkQueue m_queue = VK_NULL_HANDLE;
+  VkCommandPool m_commandPool = VK_NULL_HANDLE;
+  VkCommandBuffer m_commandBuffer = VK_NULL_HANDLE;
+  VkFence m_fence = VK_NULL_HANDLE;
+};
+
+class Context {
+public:
+  static std::expected<Context, std::string> create(std::string_view applicationName,
+                                                    std::vector<std::string> requestedInstanceLayer,
+                                                    std::vector<std::string> requestedInstanceExtensions) {
+
+    Context context{applicationName, std::move(requestedInstanceLayer), std::move(requestedInstanceExtensions)};
+
+    if (context.init())
+      return context;
+    else
+      return std::unexpected(std::string{"Failed to init the vulkan context"});
+  }
+
+  ~Context() {
+    if (m_vulkanInstance == VK_NULL_HANDLE)
+      return;
+
+    vkDestroyInstance(m_vulkanInstance, nullptr);
+    m_vulkanInstance = VK_NULL_HANDLE;
+  }
+
+  Context& operator=(const Context&) = delete;
+
+  Context(const Context&) = delete;
+
+  Context(Context&& rhs) noexcept {
+    swap(rhs);
+    rhs.m_vulkanInstance = VK_NULL_HANDLE;
+  }
+
+  Context& operator=(Context&& rhs) noexcept {
+    Context tmp{std::move(rhs)};
+    swap(tmp);
+    return *this;
+  }
+
+  std::vector<PhysicalDevice> enumeratePhysicalDevices() {
+    // clang-format off
+    auto result = VulkanCore::enumeratePhysicalDevices(m_vulkanInstance)
+      | views::transform([](VkPhysicalDevice device) -> PhysicalDevice {
+         return PhysicalDevice{device};
+        })
+      | ranges::to<std::vector<PhysicalDevice>>();
+    // clang-format on
+    return result;
+  }
+
+private:
+  Context(std::string_view applicationName, std::vector<std::string> requestedInstanceLayer,
+          std::vector<std::string> requestedInstanceExtensions)
+      : m_applicationName{applicationName} {
+    auto allInstanceLayers = enumerateInstanceLayerProperties();
+    const auto isInstanceLayerRequired = [&requestedInstanceLayer](const VkLayerProperties& prop) {
+      auto name = std::string{prop.layerName};
+      return ranges::find(requestedInstanceLayer, name) != std::end(requestedInstanceLayer);
+    };
+    // clang-format off
+    m_layerProperties = allInstanceLayers
+      | views::filter(isInstanceLayerRequired)
+      | ranges::to<std::vector<VkLayerProperties>>();
+    // clang-format on
+
+    auto allExtensions = enumerateExtensionsProperties();
+    const auto isExtensionRequired = [&requestedInstanceExtensions](const VkExtensionProperties& prop) {
+      auto name = std::string{prop.extensionName};
+      return ranges::find(requestedInstanceExtensions, name) != std::end(requestedInstanceExtensions);
+    };
+    // clang-format off
+    m_layerExtensions = allExtensions
+      | views::filter(isExtensionRequired)
+      | ranges::to<std::vector<VkExtensionProperties>>();
+    // clang-format on
+  }
+
+  bool init() {
+    // clang-format off
+    auto layers = m_layerProperties
+      | views::transform([](const VkLayerProperties& prop) -> const char*
+        {
+          return prop.layerName;
+        })
+      | ranges::to<std::vector<const char*>>();
+
+      auto extensions = m_layerExtensions
+        | views::transform([](const VkExtensionProperties & prop) -> const char*
+          {
+            return prop.extensionName;
+          })
+        | ranges::to<std::vector<const char*>>();
+    // clang-format on
+
+    const VkApplicationInfo applicationInfo{.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO,
+                                            .pApplicationName = m_applicationName.data(),
+                                            .applicationVersion = VK_MAKE_VERSION(1, 0, 0),
+                                            .apiVersion = VK_API_VERSION_1_3};
+
+    const VkInstanceCreateInfo instanceCreateInfo{.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO,
+#if defined(VK_USE_PLATFORM_METAL_EXT)
+                                                  .flags = VK_INSTANCE_CREATE_ENUMERATE_PORTABILITY_BIT_KHR,
+#endif
+                                                  .pApplicationInfo = &applicationInfo,
+                                                  .enabledLayerCount = static_cast<uint32_t>(layers.size()),
+                                                  .ppEnabledLayerNames = layers.data(),
+                                                  .enabledExtensionCount = static_cast<uint32_t>(extensions.size()),
+                                                  .ppEnabledExtensionNames = extensions.data()};
+
+    const auto res = vkCreateInstance(&instanceCreateInfo, nullptr, &m_vulkanInstance);
+    return res == VK_SUCCESS;
+  }
+
+  void swap(Context& rhs) {
+    std::swap(m_applicationName, rhs.m_applicationName);
+    std::swap(m_layerProperties, rhs.m_layerProperties);
+    std::swap(m_layerExtensions, rhs.m_layerExtensions);
+    std::swap(m_vulkanInstance, rhs.m_vulkanInstance);
+  }
+
+private:
+  std::string m_applicationName;
+  std::vector<VkLayerProperties> m_layerProperties;
+  std::vector<VkExtensionProperties> m_layerExtensions;
+  VkInstance m_vulkanInstance = VK_NULL_HANDLE;
+};
+} // namespace VulkanCore
+
+void setEnvironment(const char* name, const std::string& value) {
+#if defined(_WIN32)
+  _putenv_s(name, value.c_str());
+#else
+  setenv(name, value.c_str(), 1);
+#endif
+}
+
+// The mock driver reads its shape from the environment on every vkCreateInstance.
+struct MockShape {
+  uint32_t deviceCount = 4;
+  std::string_view queueLayout = "mixed";
+  uint32_t enumerationDelayUs = 0;
+  uint32_t deviceLostAfter = 0;
+};
+
+std::expected<VulkanCore::Context, std::string> createMockContext(const MockShape& shape) {
+  setEnvironment("VK_MOCK_DEVICE_COUNT", std::to_string(shape.deviceCount));
+  setEnvironment("VK_MOCK_QUEUE_LAYOUT", std::string{shape.queueLayout});
+  setEnvironment("VK_MOCK_ENUMERATION_DELAY_US", std::to_string(shape.enumerationDelayUs));
+  setEnvironment("VK_MOCK_DEVICE_LOST_AFTER", std::to_string(shape.deviceLostAfter));
+  return VulkanCore::Context::create("01-16 Mock ICD", getRequestedInstanceLayers(), getRequestedInstanceExtensions());
+}
+
+using Microseconds = std::chrono::duration<double, std::micro>;
+
+template <typename Function>
+double measure(Function&& function) {
+  const auto start = std::chrono::steady_clock::now();
+  function();
+  return Microseconds(std::chrono::steady_clock::now() - start).count();
+}
+
+struct Timing {
+  double median = 0.0;
+  double min = 0.0;
+};
+
+Timing summarize(std::vector<double> samples) {
+  ranges::sort(samples);
+  return Timing{.median = samples[samples.size() / 2], .min = samples.front()};
+}
+
+std::string_view deviceTypeName(VkPhysicalDeviceType type) {
+  switch (type) {
+  case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+    return "discrete";
+  case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+    return "integrated";
+  case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+    return "virtual";
+  case VK_PHYSICAL_DEVICE_TYPE_CPU:
+    return "cpu";
+  default:
+    return "other";
+  }
+}
+
+// The device index the selection has to come up with, worked out from how the mock builds device i rather than from
+// what it reports: types cycle through discrete, integrated, virtual and cpu, discrete and virtual devices own
+// 1 + i % 8 GiB while the others share 16 GiB of system memory, and a mixed layout cycles through unified, split and
+// compute only families. The better type wins, then the larger memory, then the lower index.
+std::optional<uint32_t> expectedSelection(const MockShape& shape, bool needsGraphics) {
+  constexpr std::array kTypeRanks{4u, 3u, 2u, 1u};
+  constexpr std::array<std::string_view, 3> kMixedLayouts{"unified", "split", "compute"};
+
+  std::optional<uint32_t> expected;
+  std::pair<uint32_t, uint32_t> best;
+  for (uint32_t index = 0; index < shape.deviceCount; ++index) {
+    const auto layout = shape.queueLayout == "mixed" ? kMixedLayouts[index % kMixedLayouts.size()] : shape.queueLayout;
+    if (needsGraphics && layout == "compute")
+      continue;
+
+    const auto type = index % kTypeRanks.size();
+    const std::pair candidate{kTypeRanks[type], type == 0 || type == 2 ? 1 + index % 8 : 16u};
+    if (!expected.has_value() || candidate > best) {
+      expected = index;
+      best = candidate;
+    }
+  }
+  return expected;
+}
+
+// Times enumeration and selection for one shape and checks the selection against every enumerated device and against
+// expectedSelection. With a delay, enumeration must also have taken at least the time the mock spends probing.
+bool benchmarkSelection(const MockShape& shape, uint32_t repeat) {
+  auto context = createMockContext(shape);
+  if (!context) {
+    std::println("Unable to create the context: {}", context.error());
+    return false;
+  }
+
+  std::vector<VulkanCore::PhysicalDevice> physicalDevices;
+  std::vector<double> enumerationSamples;
+  for (uint32_t iteration = 0; iteration < repeat; ++iteration)
+    enumerationSamples.push_back(measure([&] { physicalDevices = context->enumeratePhysicalDevices(); }));
+
+  std::optional<size_t> graphics;
+  std::optional<size_t> compute;
+  std::vector<double> selectionSamples;
+  for (uint32_t iteration = 0; iteration < repeat; ++iteration) {
+    selectionSamples.push_back(measure([&] {
+      graphics = VulkanCore::selectPhysicalDevice(physicalDevices, VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT);
+      compute = VulkanCore::selectPhysicalDevice(physicalDevices, VK_QUEUE_COMPUTE_BIT);
+    }));
+  }
+
+  // Nothing the selection skipped may have been both eligible and better.
+  const auto isBest = [&](std::optional<size_t> selected, VkQueueFlags flags) {
+    const auto eligible = [flags](const VulkanCore::PhysicalDevice& device) {
+      return device.findQueueFamily(flags).has_value();
+    };
+    if (!selected.has_value())
+      return ranges::none_of(physicalDevices, eligible);
+
+    const auto score = VulkanCore::scorePhysicalDevice(physicalDevices[selected.value()]);
+    return eligible(physicalDevices[selected.value()]) &&
+           ranges::none_of(physicalDevices, [&](const VulkanCore::PhysicalDevice& device) {
+             return eligible(device) && VulkanCore::scorePhysicalDevice(device) > score;
+           });
+  };
+  // The mock reports its device index as the device id, which the loader leaves alone even if it reorders devices.
+  const auto deviceId = [&](std::optional<size_t> selected) -> std::optional<uint32_t> {
+    if (!selected.has_value())
+      return std::nullopt;
+    return physicalDevices[selected.value()].getProperties().deviceID;
+  };
+  const auto enumeration = summarize(enumerationSamples);
+  const auto selection = summarize(selectionSamples);
+  const double probingUs = static_cast<double>(shape.enumerationDelayUs) * shape.deviceCount;
+  const bool valid = physicalDevices.size() == shape.deviceCount &&
+                     isBest(graphics, VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT) &&
+                     isBest(compute, VK_QUEUE_COMPUTE_BIT) && deviceId(graphics) == expectedSelection(shape, true) &&
+                     deviceId(compute) == expectedSelection(shape, false) && enumeration.min >= probingUs;
+
+  const auto describe = [&](std::optional<size_t> selected) -> std::string {
+    if (!selected.has_value())
+      return "none";
+    const auto& properties = physicalDevices[selected.value()].getProperties();
+    return std::format("{} ({})", properties.deviceName, deviceTypeName(properties.deviceType));
+  };
+  std::println("{:>7} {:>8} {:>12.1f} {:>12.1f} {:>10.2f}  {:<28} {:<28} {}", shape.deviceCount, shape.queueLayout,
+               enumeration.median, enumeration.min, selection.median, describe(graphics), describe(compute),
+               valid ? "ok" : "FAILED");
+  return valid;
+}
+
+// Runs submissions on a device that is lost every shape.deviceLostAfter submissions. Every loss throws the device
+// away and creates a new one, then the failed submission is repeated.
+bool benchmarkRecovery(const MockShape& shape, uint32_t submissions) {
+  auto context = createMockContext(shape);
+  if (!context) {
+    std::println("Unable to create the context: {}", context.error());
+    return false;
+  }
+
+  const auto physicalDevices = context->enumeratePhysicalDevices();
+  const auto selected = VulkanCore::selectPhysicalDevice(physicalDevices, VK_QUEUE_COMPUTE_BIT);
+  if (!selected.has_value()) {
+    std::println("No device with a compute queue");
+    return false;
+  }
+  const auto& physicalDevice = physicalDevices[selected.value()];
+  const auto queueFamilyIndex = physicalDevice.findQueueFamily(VK_QUEUE_COMPUTE_BIT).value();
+
+  auto device = VulkanCore::Device::create(physicalDevice, queueFamilyIndex);
+  if (!device) {
+    std::println("Unable to create the device: {}", device.error());
+    return false;
+  }
+
+  uint32_t recoveries = 0;
+  std::vector<double> recoverySamples;
+  for (uint32_t completed = 0; completed < submissions;) {
+    const auto result = device->submitAndWait();
+    if (result == VK_SUCCESS) {
+      ++completed;
+      continue;
+    }
+    if (result != VK_ERROR_DEVICE_LOST) {
+      std::println("Submission failed with error {}", static_cast<int>(result));
+      return false;
+    }
+
+    ++recoveries;
+    recoverySamples.push_back(measure([&] {
+      // The lost device has to go before its replacement is created.
+      device = std::unexpected(std::string{"Device lost"});
+      device = VulkanCore::Device::create(physicalDevice, queueFamilyIndex);
+    }));
+    if (!device) {
+      std::println("Unable to recreate the device: {}", device.error());
+      return false;
+    }
+  }
+
+  // Each device completes deviceLostAfter submissions, the one after that is lost.
+  const auto expectedRecoveries = shape.deviceLostAfter == 0 ? 0 : (submissions - 1) / shape.deviceLostAfter;
+  const auto recovery = recoverySamples.empty() ? Timing{} : summarize(recoverySamples);
+  std::println("{} submissions, device lost every {}: {} recoveries (expected {}), median {:.1f} us, max {:.1f} us",
+               submissions, shape.deviceLostAfter, recoveries, expectedRecoveries, recovery.median,
+               recoverySamples.empty() ? 0.0 : ranges::max(recoverySamples));
+  return recoveries == expectedRecoveries;
+}
+
+uint32_t parseArgument(std::span<char*> arguments, std::string_view name, uint32_t defaultValue) {
+  for (size_t index = 1; index + 1 < arguments.size(); ++index) {
+    if (std::string_view{arguments[index]} == name) {
+      const std::string_view value{arguments[index + 1]};
+      std::from_chars(value.data(), value.data() + value.size(), defaultValue);
+    }
+  }
+  return defaultValue;
+}
+
+std::string parseString(std::span<char*> arguments, std::string_view name, std::string defaultValue) {
+  for (size_t index = 1; index + 1 < arguments.size(); ++index) {
+    if (std::string_view{arguments[index]} == name)
+      defaultValue = arguments[index + 1];
+  }
+  return defaultValue;
+}
+
+// Points the loader at the mock driver next to the executable (or at --icd) and then:
+// - times enumeratePhysicalDevices and device selection for 1 to --devices devices, over every queue family layout,
+//   then once more for --devices mixed devices with --delay-us of simulated probing per device,
+// - loses the device every --lost-after submissions over --submissions submissions and times each rebuild.
+// Every run is checked, the exit code is non zero if any of them went wrong.
+int main(int argc, char* argv[]) {
+  const auto arguments = std::span{argv, static_cast<size_t>(argc)};
+  const auto maxDevices = std::max(1u, parseArgument(arguments, "--devices", 64));
+  const auto enumerationDelayUs = parseArgument(arguments, "--delay-us", 100);
+  const auto repeat = std::max(1u, parseArgument(arguments, "--repeat", 20));
+  const auto deviceLostAfter = std::max(1u, parseArgument(arguments, "--lost-after", 5));
+  const auto submissions = std::max(1u, parseArgument(arguments, "--submissions", 100));
+
+  const auto defaultManifest = std::filesystem::absolute(arguments[0]).parent_path() / "mock_icd.json";
+  const auto manifest = parseString(arguments, "--icd", defaultManifest.string());
+  if (!std::filesystem::exists(manifest)) {
+    std::println("Mock driver manifest {} not found", manifest);
+    return EXIT_FAILURE;
+  }
+  // VK_DRIVER_FILES replaces the system drivers, VK_ICD_FILENAMES is the name older loaders know it by.
+  setEnvironment("VK_DRIVER_FILES", manifest);
+  setEnvironment("VK_ICD_FILENAMES", manifest);
+
+  bool passed = true;
+  std::println("{:>7} {:>8} {:>12} {:>12} {:>10}  {:<28} {:<28}", "devices", "layout", "enum med us", "enum min us",
+               "select us", "graphics + compute", "compute");
+  for (uint32_t deviceCount = 1; deviceCount <= maxDevices; deviceCount *= 4) {
+    for (const std::string_view layout : {"unified", "split", "compute", "mixed"}) {
+      passed &= benchmarkSelection(MockShape{.deviceCount = deviceCount, .queueLayout = layout}, repeat);
+    }
+  }
+  passed &= benchmarkSelection(
+      MockShape{.deviceCount = maxDevices, .queueLayout = "mixed", .enumerationDelayUs = enumerationDelayUs}, repeat);
+  passed &= benchmarkRecovery(MockShape{.deviceLostAfter = deviceLostAfter}, submissions);
+
+  std::println("{}", passed ? "All checks passed" : "Some checks failed");
+  return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
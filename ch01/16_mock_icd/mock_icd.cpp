@@ -0,0 +1,952 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <format>
+#include <memory>
+#include <ranges>
+#include <span>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#define VK_NO_PROTOTYPES
+#include <vulkan/vk_icd.h>
+#include <vulkan/vulkan.h>
+
+#if defined(_WIN32)
+#define MOCK_ICD_EXPORT extern "C" __declspec(dllexport)
+#else
+#define MOCK_ICD_EXPORT extern "C" __attribute__((visibility("default")))
+#endif
+
+// A deterministic stand-in for a Vulkan driver. It has no GPU behind it: commands are recorded into nothing and
+// every submission completes immediately. What it does model is what the loader and the application see:
+//   VK_MOCK_DEVICE_COUNT          number of physical devices, 4 by default
+//   VK_MOCK_ENUMERATION_DELAY_US  time each device takes to probe while counting devices, 0 by default
+//   VK_MOCK_QUEUE_LAYOUT          unified, split, compute or mixed (the default, cycles through the other three)
+//   VK_MOCK_DEVICE_LOST_AFTER     submissions a device accepts before it is lost, 0 (never) by default
+//   VK_MOCK_PIPELINE_COMPILE_US   time a pipeline takes to compile unless its shader is in the pipeline cache
+// The variables are read on every vkCreateInstance, so one process can create instances of different shapes.
+// Device i always gets the same type, name, memory and queue families, which makes selection results reproducible.
+namespace {
+
+enum class QueueLayout { Unified, Split, Compute, Mixed };
+
+struct MockConfiguration {
+  uint32_t deviceCount = 4;
+  std::chrono::microseconds enumerationDelay{0};
+  QueueLayout queueLayout = QueueLayout::Mixed;
+  uint32_t deviceLostAfter = 0;
+  std::chrono::microseconds pipelineCompileTime{0};
+};
+
+uint32_t readEnvironment(const char* name, uint32_t defaultValue) {
+  const char* value = std::getenv(name);
+  return value != nullptr ? static_cast<uint32_t>(std::strtoul(value, nullptr, 10)) : defaultValue;
+}
+
+MockConfiguration readConfiguration() {
+  MockConfiguration configuration{
+      .deviceCount = readEnvironment("VK_MOCK_DEVICE_COUNT", 4),
+      .enumerationDelay = std::chrono::microseconds{readEnvironment("VK_MOCK_ENUMERATION_DELAY_US", 0)},
+      .deviceLostAfter = readEnvironment("VK_MOCK_DEVICE_LOST_AFTER", 0),
+      .pipelineCompileTime = std::chrono::microseconds{readEnvironment("VK_MOCK_PIPELINE_COMPILE_US", 0)}};
+
+  if (const char* layout = std::getenv("VK_MOCK_QUEUE_LAYOUT")) {
+    const std::string_view name{layout};
+    if (name == "unified")
+      configuration.queueLayout = QueueLayout::Unified;
+    else if (name == "split")
+      configuration.queueLayout = QueueLayout::Split;
+    else if (name == "compute")
+      configuration.queueLayout = QueueLayout::Compute;
+  }
+  return configuration;
+}
+
+// Every dispatchable handle starts with the slot the loader writes its dispatch table into.
+struct MockInstance;
+struct MockDevice;
+
+struct MockPhysicalDevice {
+  VK_LOADER_DATA loaderData;
+  MockInstance* instance = nullptr;
+  VkPhysicalDeviceProperties properties{};
+  VkPhysicalDeviceMemoryProperties memoryProperties{};
+  std::vector<VkQueueFamilyProperties> queueFamilies;
+  std::array<uint8_t, VK_UUID_SIZE> uuid{};
+};
+
+struct MockInstance {
+  VK_LOADER_DATA loaderData;
+  MockConfiguration configuration;
+  std::vector<std::unique_ptr<MockPhysicalDevice>> physicalDevices;
+};
+
+struct MockQueue {
+  VK_LOADER_DATA loaderData;
+  MockDevice* device = nullptr;
+  uint32_t familyIndex = 0;
+  uint32_t index = 0;
+};
+
+struct MockDevice {
+  VK_LOADER_DATA loaderData;
+  MockPhysicalDevice* physicalDevice = nullptr;
+  uint32_t deviceLostAfter = 0;
+  std::atomic<uint32_t> submissions{0};
+  std::atomic<bool> lost{false};
+  std::vector<std::unique_ptr<MockQueue>> queues;
+};
+
+struct MockCommandBuffer {
+  VK_LOADER_DATA loaderData;
+  MockDevice* device = nullptr;
+};
+
+struct MockCommandPool {
+  std::vector<std::unique_ptr<MockCommandBuffer>> commandBuffers;
+};
+
+struct MockFence {
+  std::atomic<bool> signaled{false};
+};
+
+struct MockSemaphore {
+  std::atomic<uint64_t> value{0};
+};
+
+struct MockMemory {
+  std::unique_ptr<std::byte[]> data;
+};
+
+struct MockBuffer {
+  VkDeviceSize size = 0;
+};
+
+// Shader modules, layouts and pipelines only need a handle.
+struct MockObject {};
+
+struct MockShaderModule {
+  uint64_t hash = 0;
+};
+
+// Serialized as the standard header followed by the hash of every shader compiled with the cache.
+struct MockPipelineCache {
+  std::vector<uint64_t> shaders;
+};
+
+struct MockDescriptorPool {
+  std::vector<std::unique_ptr<MockObject>> sets;
+};
+
+template <typename Handle, typename Object>
+Handle toHandle(Object* object) {
+  if constexpr (std::is_pointer_v<Handle>)
+    return reinterpret_cast<Handle>(object);
+  else
+    return static_cast<Handle>(reinterpret_cast<uintptr_t>(object));
+}
+
+template <typename Object, typename Handle>
+Object* fromHandle(Handle handle) {
+  if constexpr (std::is_pointer_v<Handle>)
+    return reinterpret_cast<Object*>(handle);
+  else
+    return reinterpret_cast<Object*>(static_cast<uintptr_t>(handle));
+}
+
+template <typename Object, typename... Args>
+Object* createDispatchable(Args&&... args) {
+  auto* object = new Object{std::forward<Args>(args)...};
+  set_loader_magic_value(object);
+  return object;
+}
+
+// Copies a driver side array out with the usual two call protocol.
+template <typename T>
+VkResult fillArray(std::span<const T> source, uint32_t* count, T* destination) {
+  if (destination == nullptr) {
+    *count = static_cast<uint32_t>(source.size());
+    return VK_SUCCESS;
+  }
+  const auto copied = std::min<size_t>(*count, source.size());
+  std::copy_n(source.begin(), copied, destination);
+  *count = static_cast<uint32_t>(copied);
+  return copied < source.size() ? VK_INCOMPLETE : VK_SUCCESS;
+}
+
+std::vector<VkQueueFamilyProperties> makeQueueFamilies(QueueLayout layout, uint32_t deviceIndex) {
+  constexpr auto kAll = VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT | VK_QUEUE_TRANSFER_BIT;
+  constexpr auto kAsyncCompute = VK_QUEUE_COMPUTE_BIT | VK_QUEUE_TRANSFER_BIT;
+  const auto family = [](VkQueueFlags flags, uint32_t count) {
+    return VkQueueFamilyProperties{
+        .queueFlags = flags, .queueCount = count, .timestampValidBits = 64, .minImageTransferGranularity = {1, 1, 1}};
+  };
+
+  if (layout == QueueLayout::Mixed)
+    layout = std::array{QueueLayout::Unified, QueueLayout::Split, QueueLayout::Compute}[deviceIndex % 3];
+
+  switch (layout) {
+  case QueueLayout::Unified:
+    return {family(kAll, 4)};
+  case QueueLayout::Split:
+    return {family(kAll, 1), family(kAsyncCompute, 2), family(VK_QUEUE_TRANSFER_BIT, 2)};
+  default:
+    return {family(kAsyncCompute, 4), family(VK_QUEUE_TRANSFER_BIT, 1)};
+  }
+}
+
+std::unique_ptr<MockPhysicalDevice> makePhysicalDevice(MockInstance* instance, uint32_t deviceIndex) {
+  constexpr std::array kTypes{VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU, VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU,
+                              VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU, VK_PHYSICAL_DEVICE_TYPE_CPU};
+  constexpr VkDeviceSize kGiB = VkDeviceSize{1} << 30;
+
+  std::unique_ptr<MockPhysicalDevice> device{createDispatchable<MockPhysicalDevice>()};
+  device->instance = instance;
+
+  auto& properties = device->properties;
+  properties.apiVersion = VK_API_VERSION_1_3;
+  properties.driverVersion = VK_MAKE_API_VERSION(0, 1, 0, 0);
+  properties.vendorID = 0x10000 + deviceIndex % 4;
+  properties.deviceID = deviceIndex;
+  properties.deviceType = kTypes[deviceIndex % kTypes.size()];
+  std::format_to_n(properties.deviceName, VK_MAX_PHYSICAL_DEVICE_NAME_SIZE - 1, "Mock device {:02}", deviceIndex);
+  properties.limits.maxComputeWorkGroupCount[0] = 65535;
+  properties.limits.maxComputeWorkGroupCount[1] = 65535;
+  properties.limits.maxComputeWorkGroupCount[2] = 65535;
+  properties.limits.maxComputeWorkGroupInvocations = 1024;
+  properties.limits.maxComputeWorkGroupSize[0] = 1024;
+  properties.limits.maxComputeWorkGroupSize[1] = 1024;
+  properties.limits.maxComputeWorkGroupSize[2] = 64;
+  properties.limits.maxPushConstantsSize = 128;
+  properties.limits.maxBoundDescriptorSets = 8;
+  properties.limits.maxMemoryAllocationCount = 4096;
+  properties.limits.timestampComputeAndGraphics = VK_TRUE;
+  properties.limits.timestampPeriod = 1.0f;
+  properties.limits.nonCoherentAtomSize = 64;
+  properties.limits.minStorageBufferOffsetAlignment = 64;
+  properties.limits.minUniformBufferOffsetAlignment = 64;
+
+  // Discrete and virtual devices get their own heap of 1 to 8 GiB, the others only share system memory.
+  auto& memory = device->memoryProperties;
+  const bool dedicatedMemory = properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU ||
+                               properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU;
+  const uint32_t hostHeap = dedicatedMemory ? 1 : 0;
+  if (dedicatedMemory)
+    memory.memoryHeaps[0] = {.size = (1 + deviceIndex % 8) * kGiB, .flags = VK_MEMORY_HEAP_DEVICE_LOCAL_BIT};
+  memory.memoryHeaps[hostHeap] = {.size = 16 * kGiB, .flags = dedicatedMemory ? 0u : VK_MEMORY_HEAP_DEVICE_LOCAL_BIT};
+  memory.memoryHeapCount = hostHeap + 1;
+  memory.memoryTypes[0] = {.propertyFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, .heapIndex = 0};
+  memory.memoryTypes[1] = {.propertyFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                           .heapIndex = hostHeap};
+  memory.memoryTypes[2] = {.propertyFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT |
+                                            VK_MEMORY_PROPERTY_HOST_CACHED_BIT,
+                           .heapIndex = hostHeap};
+  memory.memoryTypeCount = 3;
+  if (!dedicatedMemory) {
+    memory.memoryTypes[1].propertyFlags |= VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    memory.memoryTypes[2].propertyFlags |= VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+  }
+
+  device->queueFamilies = makeQueueFamilies(instance->configuration.queueLayout, deviceIndex);
+  std::memcpy(device->uuid.data(), &deviceIndex, sizeof(deviceIndex));
+  std::ranges::copy(device->uuid, properties.pipelineCacheUUID);
+  return device;
+}
+
+// Submissions count towards the point a device is lost at. Once lost, it stays lost until it is destroyed.
+VkResult recordSubmission(MockDevice* device) {
+  if (device->lost)
+    return VK_ERROR_DEVICE_LOST;
+
+  const auto submissions = ++device->submissions;
+  if (device->deviceLostAfter != 0 && submissions > device->deviceLostAfter) {
+    device->lost = true;
+    return VK_ERROR_DEVICE_LOST;
+  }
+  return VK_SUCCESS;
+}
+
+void signalFence(VkFence fence) {
+  if (fence != VK_NULL_HANDLE)
+    fromHandle<MockFence>(fence)->signaled = true;
+}
+
+void signalSemaphore(VkSemaphore semaphore, uint64_t value) {
+  auto* mockSemaphore = fromHandle<MockSemaphore>(semaphore);
+  // Binary semaphores are signaled with 0, waiting on them never blocks here anyway.
+  auto current = mockSemaphore->value.load();
+  while (current < value && !mockSemaphore->value.compare_exchange_weak(current, value)) {
+  }
+}
+
+// Instance level
+
+VKAPI_ATTR VkResult VKAPI_CALL EnumerateInstanceExtensionProperties(const char*, uint32_t* pPropertyCount,
+                                                                   VkExtensionProperties*) {
+  *pPropertyCount = 0;
+  return VK_SUCCESS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL EnumerateInstanceVersion(uint32_t* pApiVersion) {
+  *pApiVersion = VK_API_VERSION_1_3;
+  return VK_SUCCESS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL CreateInstance(const VkInstanceCreateInfo*, const VkAllocationCallbacks*,
+                                              VkInstance* pInstance) {
+  auto* instance = createDispatchable<MockInstance>();
+  instance->configuration = readConfiguration();
+  for (uint32_t index = 0; index < instance->configuration.deviceCount; ++index)
+    instance->physicalDevices.push_back(makePhysicalDevice(instance, index));
+
+  *pInstance = reinterpret_cast<VkInstance>(instance);
+  return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL DestroyInstance(VkInstance instance, const VkAllocationCallbacks*) {
+  delete reinterpret_cast<MockInstance*>(instance);
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL EnumeratePhysicalDevices(VkInstance instance, uint32_t* pPhysicalDeviceCount,
+                                                        VkPhysicalDevice* pPhysicalDevices) {
+  auto* mockInstance = reinterpret_cast<MockInstance*>(instance);
+  if (pPhysicalDevices == nullptr)
+    std::this_thread::sleep_for(mockInstance->configuration.enumerationDelay * mockInstance->physicalDevices.size());
+
+  const auto handles = mockInstance->physicalDevices |
+                       std::views::transform([](const auto& device) {
+                         return reinterpret_cast<VkPhysicalDevice>(device.get());
+                       }) |
+                       std::ranges::to<std::vector<VkPhysicalDevice>>();
+  return fillArray(std::span<const VkPhysicalDevice>{handles}, pPhysicalDeviceCount, pPhysicalDevices);
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL EnumeratePhysicalDeviceGroups(VkInstance instance,
+                                                             uint32_t* pPhysicalDeviceGroupCount,
+                                                             VkPhysicalDeviceGroupProperties* pGroups) {
+  auto* mockInstance = reinterpret_cast<MockInstance*>(instance);
+  if (pGroups == nullptr) {
+    *pPhysicalDeviceGroupCount = static_cast<uint32_t>(mockInstance->physicalDevices.size());
+    return VK_SUCCESS;
+  }
+
+  const auto count = std::min<size_t>(*pPhysicalDeviceGroupCount, mockInstance->physicalDevices.size());
+  for (size_t index = 0; index < count; ++index) {
+    pGroups[index].physicalDeviceCount = 1;
+    pGroups[index].physicalDevices[0] = reinterpret_cast<VkPhysicalDevice>(mockInstance->physicalDevices[index].get());
+    pGroups[index].subsetAllocation = VK_FALSE;
+  }
+  *pPhysicalDeviceGroupCount = static_cast<uint32_t>(count);
+  return count < mockInstance->physicalDevices.size() ? VK_INCOMPLETE : VK_SUCCESS;
+}
+
+// Physical device level
+
+MockPhysicalDevice* toPhysicalDevice(VkPhysicalDevice physicalDevice) {
+  return reinterpret_cast<MockPhysicalDevice*>(physicalDevice);
+}
+
+VKAPI_ATTR void VKAPI_CALL GetPhysicalDeviceProperties(VkPhysicalDevice physicalDevice,
+                                                       VkPhysicalDeviceProperties* pProperties) {
+  *pProperties = toPhysicalDevice(physicalDevice)->properties;
+}
+
+VKAPI_ATTR void VKAPI_CALL GetPhysicalDeviceProperties2(VkPhysicalDevice physicalDevice,
+                                                        VkPhysicalDeviceProperties2* pProperties) {
+  const auto* device = toPhysicalDevice(physicalDevice);
+  pProperties->properties = device->properties;
+  for (auto* next = static_cast<VkBaseOutStructure*>(pProperties->pNext); next != nullptr; next = next->pNext) {
+    if (next->sType == VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES) {
+      auto* idProperties = reinterpret_cast<VkPhysicalDeviceIDProperties*>(next);
+      std::copy(device->uuid.begin(), device->uuid.end(), idProperties->deviceUUID);
+      std::copy(device->uuid.begin(), device->uuid.end(), idProperties->driverUUID);
+    }
+  }
+}
+
+VKAPI_ATTR void VKAPI_CALL GetPhysicalDeviceFeatures(VkPhysicalDevice, VkPhysicalDeviceFeatures* pFeatures) {
+  *pFeatures = VkPhysicalDeviceFeatures{.robustBufferAccess = VK_TRUE,
+                                        .multiDrawIndirect = VK_TRUE,
+                                        .drawIndirectFirstInstance = VK_TRUE,
+                                        .shaderInt64 = VK_TRUE};
+}
+
+// Reports the handful of newer features the recipes rely on, everything else stays unsupported.
+VKAPI_ATTR void VKAPI_CALL GetPhysicalDeviceFeatures2(VkPhysicalDevice physicalDevice,
+                                                      VkPhysicalDeviceFeatures2* pFeatures) {
+  GetPhysicalDeviceFeatures(physicalDevice, &pFeatures->features);
+  for (auto* next = static_cast<VkBaseOutStructure*>(pFeatures->pNext); next != nullptr; next = next->pNext) {
+    if (next->sType == VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES) {
+      reinterpret_cast<VkPhysicalDeviceVulkan12Features*>(next)->timelineSemaphore = VK_TRUE;
+    } else if (next->sType == VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES) {
+      auto* features13 = reinterpret_cast<VkPhysicalDeviceVulkan13Features*>(next);
+      features13->synchronization2 = VK_TRUE;
+      features13->dynamicRendering = VK_TRUE;
+    }
+  }
+}
+
+VKAPI_ATTR void VKAPI_CALL GetPhysicalDeviceMemoryProperties(VkPhysicalDevice physicalDevice,
+                                                             VkPhysicalDeviceMemoryProperties* pMemoryProperties) {
+  *pMemoryProperties = toPhysicalDevice(physicalDevice)->memoryProperties;
+}
+
+VKAPI_ATTR void VKAPI_CALL GetPhysicalDeviceMemoryProperties2(VkPhysicalDevice physicalDevice,
+                                                              VkPhysicalDeviceMemoryProperties2* pMemoryProperties) {
+  pMemoryProperties->memoryProperties = toPhysicalDevice(physicalDevice)->memoryProperties;
+}
+
+VKAPI_ATTR void VKAPI_CALL GetPhysicalDeviceQueueFamilyProperties(VkPhysicalDevice physicalDevice,
+                                                                  uint32_t* pQueueFamilyPropertyCount,
+                                                                  VkQueueFamilyProperties* pQueueFamilyProperties) {
+  fillArray(std::span<const VkQueueFamilyProperties>{toPhysicalDevice(physicalDevice)->queueFamilies},
+            pQueueFamilyPropertyCount, pQueueFamilyProperties);
+}
+
+VKAPI_ATTR void VKAPI_CALL GetPhysicalDeviceQueueFamilyProperties2(VkPhysicalDevice physicalDevice,
+                                                                   uint32_t* pQueueFamilyPropertyCount,
+                                                                   VkQueueFamilyProperties2* pQueueFamilyProperties) {
+  const auto& families = toPhysicalDevice(physicalDevice)->queueFamilies;
+  if (pQueueFamilyProperties == nullptr) {
+    *pQueueFamilyPropertyCount = static_cast<uint32_t>(families.size());
+    return;
+  }
+  *pQueueFamilyPropertyCount = std::min<uint32_t>(*pQueueFamilyPropertyCount, static_cast<uint32_t>(families.size()));
+  for (uint32_t index = 0; index < *pQueueFamilyPropertyCount; ++index)
+    pQueueFamilyProperties[index].queueFamilyProperties = families[index];
+}
+
+VKAPI_ATTR void VKAPI_CALL GetPhysicalDeviceFormatProperties(VkPhysicalDevice, VkFormat,
+                                                             VkFormatProperties* pFormatProperties) {
+  constexpr VkFormatFeatureFlags kFeatures = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT |
+                                             VK_FORMAT_FEATURE_TRANSFER_SRC_BIT | VK_FORMAT_FEATURE_TRANSFER_DST_BIT;
+  *pFormatProperties = VkFormatProperties{.optimalTilingFeatures = kFeatures, .bufferFeatures = kFeatures};
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL EnumerateDeviceExtensionProperties(VkPhysicalDevice, const char*,
+                                                                 uint32_t* pPropertyCount, VkExtensionProperties*) {
+  *pPropertyCount = 0;
+  return VK_SUCCESS;
+}
+
+// Device level
+
+MockDevice* toDevice(VkDevice device) { return reinterpret_cast<MockDevice*>(device); }
+
+VKAPI_ATTR VkResult VKAPI_CALL CreateDevice(VkPhysicalDevice physicalDevice, const VkDeviceCreateInfo* pCreateInfo,
+                                            const VkAllocationCallbacks*, VkDevice* pDevice) {
+  auto* mockPhysicalDevice = toPhysicalDevice(physicalDevice);
+  const auto& families = mockPhysicalDevice->queueFamilies;
+
+  std::unique_ptr<MockDevice> device{createDispatchable<MockDevice>()};
+  device->physicalDevice = mockPhysicalDevice;
+  device->deviceLostAfter = mockPhysicalDevice->instance->configuration.deviceLostAfter;
+  for (const auto& queueInfo : std::span{pCreateInfo->pQueueCreateInfos, pCreateInfo->queueCreateInfoCount}) {
+    if (queueInfo.queueFamilyIndex >= families.size() ||
+        queueInfo.queueCount > families[queueInfo.queueFamilyIndex].queueCount)
+      return VK_ERROR_INITIALIZATION_FAILED;
+
+    for (uint32_t index = 0; index < queueInfo.queueCount; ++index) {
+      auto* queue = createDispatchable<MockQueue>();
+      queue->device = device.get();
+      queue->familyIndex = queueInfo.queueFamilyIndex;
+      queue->index = index;
+      device->queues.emplace_back(queue);
+    }
+  }
+
+  *pDevice = reinterpret_cast<VkDevice>(device.release());
+  return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL DestroyDevice(VkDevice device, const VkAllocationCallbacks*) { delete toDevice(device); }
+
+VKAPI_ATTR void VKAPI_CALL GetDeviceQueue(VkDevice device, uint32_t queueFamilyIndex, uint32_t queueIndex,
+                                          VkQueue* pQueue) {
+  const auto& queues = toDevice(device)->queues;
+  const auto it = std::ranges::find_if(queues, [&](const auto& queue) {
+    return queue->familyIndex == queueFamilyIndex && queue->index == queueIndex;
+  });
+  *pQueue = it != queues.end() ? reinterpret_cast<VkQueue>(it->get()) : VK_NULL_HANDLE;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL DeviceWaitIdle(VkDevice device) {
+  return toDevice(device)->lost ? VK_ERROR_DEVICE_LOST : VK_SUCCESS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL QueueWaitIdle(VkQueue queue) {
+  return reinterpret_cast<MockQueue*>(queue)->device->lost ? VK_ERROR_DEVICE_LOST : VK_SUCCESS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL QueueSubmit(VkQueue queue, uint32_t submitCount, const VkSubmitInfo* pSubmits,
+                                           VkFence fence) {
+  if (const auto result = recordSubmission(reinterpret_cast<MockQueue*>(queue)->device); result != VK_SUCCESS)
+    return result;
+
+  for (const auto& submit : std::span{pSubmits, submitCount}) {
+    const VkTimelineSemaphoreSubmitInfo* timelineInfo = nullptr;
+    for (auto* next = static_cast<const VkBaseInStructure*>(submit.pNext); next != nullptr; next = next->pNext) {
+      if (next->sType == VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO)
+        timelineInfo = reinterpret_cast<const VkTimelineSemaphoreSubmitInfo*>(next);
+    }
+    for (uint32_t index = 0; index < submit.signalSemaphoreCount; ++index) {
+      const bool hasValue = timelineInfo != nullptr && index < timelineInfo->signalSemaphoreValueCount;
+      signalSemaphore(submit.pSignalSemaphores[index], hasValue ? timelineInfo->pSignalSemaphoreValues[index] : 0);
+    }
+  }
+  signalFence(fence);
+  return VK_SUCCESS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL QueueSubmit2(VkQueue queue, uint32_t submitCount, const VkSubmitInfo2* pSubmits,
+                                            VkFence fence) {
+  if (const auto result = recordSubmission(reinterpret_cast<MockQueue*>(queue)->device); result != VK_SUCCESS)
+    return result;
+
+  for (const auto& submit : std::span{pSubmits, submitCount}) {
+    for (const auto& signal : std::span{submit.pSignalSemaphoreInfos, submit.signalSemaphoreInfoCount})
+      signalSemaphore(signal.semaphore, signal.value);
+  }
+  signalFence(fence);
+  return VK_SUCCESS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL CreateFence(VkDevice, const VkFenceCreateInfo* pCreateInfo,
+                                           const VkAllocationCallbacks*, VkFence* pFence) {
+  auto* fence = new MockFence;
+  fence->signaled = (pCreateInfo->flags & VK_FENCE_CREATE_SIGNALED_BIT) != 0;
+  *pFence = toHandle<VkFence>(fence);
+  return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL DestroyFence(VkDevice, VkFence fence, const VkAllocationCallbacks*) {
+  delete fromHandle<MockFence>(fence);
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL ResetFences(VkDevice, uint32_t fenceCount, const VkFence* pFences) {
+  for (const auto fence : std::span{pFences, fenceCount})
+    fromHandle<MockFence>(fence)->signaled = false;
+  return VK_SUCCESS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL GetFenceStatus(VkDevice device, VkFence fence) {
+  if (toDevice(device)->lost)
+    return VK_ERROR_DEVICE_LOST;
+  return fromHandle<MockFence>(fence)->signaled ? VK_SUCCESS : VK_NOT_READY;
+}
+
+// Work completes at submission, so an unsignaled fence is one that was never submitted: report the timeout right away.
+VKAPI_ATTR VkResult VKAPI_CALL WaitForFences(VkDevice device, uint32_t fenceCount, const VkFence* pFences,
+                                             VkBool32 waitAll, uint64_t) {
+  if (toDevice(device)->lost)
+    return VK_ERROR_DEVICE_LOST;
+
+  const auto isSignaled = [](VkFence fence) { return fromHandle<MockFence>(fence)->signaled.load(); };
+  const auto fences = std::span{pFences, fenceCount};
+  const bool done = waitAll ? std::ranges::all_of(fences, isSignaled) : std::ranges::any_of(fences, isSignaled);
+  return done ? VK_SUCCESS : VK_TIMEOUT;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL CreateSemaphore(VkDevice, const VkSemaphoreCreateInfo* pCreateInfo,
+                                               const VkAllocationCallbacks*, VkSemaphore* pSemaphore) {
+  auto* semaphore = new MockSemaphore;
+  for (auto* next = static_cast<const VkBaseInStructure*>(pCreateInfo->pNext); next != nullptr; next = next->pNext) {
+    if (next->sType == VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO)
+      semaphore->value = reinterpret_cast<const VkSemaphoreTypeCreateInfo*>(next)->initialValue;
+  }
+  *pSemaphore = toHandle<VkSemaphore>(semaphore);
+  return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL DestroySemaphore(VkDevice, VkSemaphore semaphore, const VkAllocationCallbacks*) {
+  delete fromHandle<MockSemaphore>(semaphore);
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL GetSemaphoreCounterValue(VkDevice device, VkSemaphore semaphore, uint64_t* pValue) {
+  if (toDevice(device)->lost)
+    return VK_ERROR_DEVICE_LOST;
+  *pValue = fromHandle<MockSemaphore>(semaphore)->value;
+  return VK_SUCCESS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL SignalSemaphore(VkDevice, const VkSemaphoreSignalInfo* pSignalInfo) {
+  signalSemaphore(pSignalInfo->semaphore, pSignalInfo->value);
+  return VK_SUCCESS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL WaitSemaphores(VkDevice device, const VkSemaphoreWaitInfo* pWaitInfo, uint64_t) {
+  if (toDevice(device)->lost)
+    return VK_ERROR_DEVICE_LOST;
+
+  const auto semaphores = std::span{pWaitInfo->pSemaphores, pWaitInfo->semaphoreCount};
+  const auto values = std::span{pWaitInfo->pValues, pWaitInfo->semaphoreCount};
+  bool anyReached = false;
+  bool allReached = true;
+  for (size_t index = 0; index < semaphores.size(); ++index) {
+    const bool reached = fromHandle<MockSemaphore>(semaphores[index])->value >= values[index];
+    anyReached |= reached;
+    allReached &= reached;
+  }
+  const bool waitAny = (pWaitInfo->flags & VK_SEMAPHORE_WAIT_ANY_BIT) != 0;
+  return (waitAny ? anyReached : allReached) ? VK_SUCCESS : VK_TIMEOUT;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL CreateCommandPool(VkDevice, const VkCommandPoolCreateInfo*,
+                                                 const VkAllocationCallbacks*, VkCommandPool* pCommandPool) {
+  *pCommandPool = toHandle<VkCommandPool>(new MockCommandPool);
+  return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL DestroyCommandPool(VkDevice, VkCommandPool commandPool, const VkAllocationCallbacks*) {
+  delete fromHandle<MockCommandPool>(commandPool);
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL ResetCommandPool(VkDevice, VkCommandPool, VkCommandPoolResetFlags) {
+  return VK_SUCCESS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL AllocateCommandBuffers(VkDevice device, const VkCommandBufferAllocateInfo* pAllocateInfo,
+                                                      VkCommandBuffer* pCommandBuffers) {
+  auto* pool = fromHandle<MockCommandPool>(pAllocateInfo->commandPool);
+  for (uint32_t index = 0; index < pAllocateInfo->commandBufferCount; ++index) {
+    auto* commandBuffer = createDispatchable<MockCommandBuffer>();
+    commandBuffer->device = toDevice(device);
+    pool->commandBuffers.emplace_back(commandBuffer);
+    pCommandBuffers[index] = reinterpret_cast<VkCommandBuffer>(commandBuffer);
+  }
+  return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL FreeCommandBuffers(VkDevice, VkCommandPool commandPool, uint32_t commandBufferCount,
+                                              const VkCommandBuffer* pCommandBuffers) {
+  auto& commandBuffers = fromHandle<MockCommandPool>(commandPool)->commandBuffers;
+  for (const auto commandBuffer : std::span{pCommandBuffers, commandBufferCount}) {
+    std::erase_if(commandBuffers, [commandBuffer](const auto& allocated) {
+      return reinterpret_cast<VkCommandBuffer>(allocated.get()) == commandBuffer;
+    });
+  }
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL BeginCommandBuffer(VkCommandBuffer, const VkCommandBufferBeginInfo*) {
+  return VK_SUCCESS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL EndCommandBuffer(VkCommandBuffer) { return VK_SUCCESS; }
+
+VKAPI_ATTR VkResult VKAPI_CALL ResetCommandBuffer(VkCommandBuffer, VkCommandBufferResetFlags) { return VK_SUCCESS; }
+
+VKAPI_ATTR void VKAPI_CALL CmdFillBuffer(VkCommandBuffer, VkBuffer, VkDeviceSize, VkDeviceSize, uint32_t) {}
+
+VKAPI_ATTR void VKAPI_CALL CmdPipelineBarrier2(VkCommandBuffer, const VkDependencyInfo*) {}
+
+// Memory is plain host memory, so every type can be mapped.
+VKAPI_ATTR VkResult VKAPI_CALL AllocateMemory(VkDevice, const VkMemoryAllocateInfo* pAllocateInfo,
+                                              const VkAllocationCallbacks*, VkDeviceMemory* pMemory) {
+  auto* memory = new MockMemory{std::make_unique<std::byte[]>(pAllocateInfo->allocationSize)};
+  *pMemory = toHandle<VkDeviceMemory>(memory);
+  return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL FreeMemory(VkDevice, VkDeviceMemory memory, const VkAllocationCallbacks*) {
+  delete fromHandle<MockMemory>(memory);
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL MapMemory(VkDevice, VkDeviceMemory memory, VkDeviceSize offset, VkDeviceSize,
+                                         VkMemoryMapFlags, void** ppData) {
+  *ppData = fromHandle<MockMemory>(memory)->data.get() + offset;
+  return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL UnmapMemory(VkDevice, VkDeviceMemory) {}
+
+VKAPI_ATTR VkResult VKAPI_CALL CreateBuffer(VkDevice, const VkBufferCreateInfo* pCreateInfo,
+                                            const VkAllocationCallbacks*, VkBuffer* pBuffer) {
+  *pBuffer = toHandle<VkBuffer>(new MockBuffer{.size = pCreateInfo->size});
+  return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL DestroyBuffer(VkDevice, VkBuffer buffer, const VkAllocationCallbacks*) {
+  delete fromHandle<MockBuffer>(buffer);
+}
+
+VKAPI_ATTR void VKAPI_CALL GetBufferMemoryRequirements(VkDevice, VkBuffer buffer,
+                                                       VkMemoryRequirements* pMemoryRequirements) {
+  *pMemoryRequirements = VkMemoryRequirements{
+      .size = (fromHandle<MockBuffer>(buffer)->size + 255) / 256 * 256, .alignment = 256, .memoryTypeBits = 0b111};
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL BindBufferMemory(VkDevice, VkBuffer, VkDeviceMemory, VkDeviceSize) {
+  return VK_SUCCESS;
+}
+
+template <typename Handle>
+VkResult createObject(Handle* pHandle) {
+  *pHandle = toHandle<Handle>(new MockObject);
+  return VK_SUCCESS;
+}
+
+template <typename Handle>
+void destroyObject(Handle handle) {
+  delete fromHandle<MockObject>(handle);
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL CreateShaderModule(VkDevice, const VkShaderModuleCreateInfo* pCreateInfo,
+                                                  const VkAllocationCallbacks*, VkShaderModule* pShaderModule) {
+  // FNV-1a over the code, so the same SPIR-V always hits the same pipeline cache entry.
+  uint64_t hash = 0xcbf29ce484222325ull;
+  for (const auto byte : std::span{reinterpret_cast<const uint8_t*>(pCreateInfo->pCode), pCreateInfo->codeSize})
+    hash = (hash ^ byte) * 0x100000001b3ull;
+  *pShaderModule = toHandle<VkShaderModule>(new MockShaderModule{.hash = hash});
+  return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL DestroyShaderModule(VkDevice, VkShaderModule shaderModule, const VkAllocationCallbacks*) {
+  delete fromHandle<MockShaderModule>(shaderModule);
+}
+
+// Like a real driver, initial data from another device is silently ignored.
+VKAPI_ATTR VkResult VKAPI_CALL CreatePipelineCache(VkDevice device, const VkPipelineCacheCreateInfo* pCreateInfo,
+                                                   const VkAllocationCallbacks*, VkPipelineCache* pPipelineCache) {
+  auto* cache = new MockPipelineCache;
+  const auto data = std::span{static_cast<const std::byte*>(pCreateInfo->pInitialData), pCreateInfo->initialDataSize};
+  VkPipelineCacheHeaderVersionOne header{};
+  if (data.size() >= sizeof(header)) {
+    std::memcpy(&header, data.data(), sizeof(header));
+    const auto& uuid = toDevice(device)->physicalDevice->uuid;
+    if (header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+        std::ranges::equal(uuid, header.pipelineCacheUUID)) {
+      cache->shaders.resize((data.size() - sizeof(header)) / sizeof(uint64_t));
+      std::memcpy(cache->shaders.data(), data.data() + sizeof(header), cache->shaders.size() * sizeof(uint64_t));
+    }
+  }
+  *pPipelineCache = toHandle<VkPipelineCache>(cache);
+  return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL DestroyPipelineCache(VkDevice, VkPipelineCache pipelineCache,
+                                                const VkAllocationCallbacks*) {
+  delete fromHandle<MockPipelineCache>(pipelineCache);
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL GetPipelineCacheData(VkDevice device, VkPipelineCache pipelineCache, size_t* pDataSize,
+                                                    void* pData) {
+  const auto& shaders = fromHandle<MockPipelineCache>(pipelineCache)->shaders;
+  const auto* physicalDevice = toDevice(device)->physicalDevice;
+  VkPipelineCacheHeaderVersionOne header{.headerSize = sizeof(VkPipelineCacheHeaderVersionOne),
+                                         .headerVersion = VK_PIPELINE_CACHE_HEADER_VERSION_ONE,
+                                         .vendorID = physicalDevice->properties.vendorID,
+                                         .deviceID = physicalDevice->properties.deviceID};
+  std::ranges::copy(physicalDevice->uuid, header.pipelineCacheUUID);
+
+  const auto size = sizeof(header) + shaders.size() * sizeof(uint64_t);
+  if (pData == nullptr) {
+    *pDataSize = size;
+    return VK_SUCCESS;
+  }
+  if (*pDataSize < size) {
+    *pDataSize = 0;
+    return VK_INCOMPLETE;
+  }
+  std::memcpy(pData, &header, sizeof(header));
+  std::memcpy(static_cast<std::byte*>(pData) + sizeof(header), shaders.data(), shaders.size() * sizeof(uint64_t));
+  *pDataSize = size;
+  return VK_SUCCESS;
+}
+
+// Compiling costs VK_MOCK_PIPELINE_COMPILE_US, unless the cache has seen the shader before.
+VKAPI_ATTR VkResult VKAPI_CALL CreateComputePipelines(VkDevice device, VkPipelineCache pipelineCache,
+                                                      uint32_t createInfoCount,
+                                                      const VkComputePipelineCreateInfo* pCreateInfos,
+                                                      const VkAllocationCallbacks*, VkPipeline* pPipelines) {
+  auto* cache = pipelineCache != VK_NULL_HANDLE ? fromHandle<MockPipelineCache>(pipelineCache) : nullptr;
+  const auto compileTime = toDevice(device)->physicalDevice->instance->configuration.pipelineCompileTime;
+  for (uint32_t index = 0; index < createInfoCount; ++index) {
+    const auto hash = fromHandle<MockShaderModule>(pCreateInfos[index].stage.module)->hash;
+    if (cache == nullptr || std::ranges::find(cache->shaders, hash) == cache->shaders.end()) {
+      std::this_thread::sleep_for(compileTime);
+      if (cache != nullptr)
+        cache->shaders.push_back(hash);
+    }
+    createObject(&pPipelines[index]);
+  }
+  return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL DestroyPipeline(VkDevice, VkPipeline pipeline, const VkAllocationCallbacks*) {
+  destroyObject(pipeline);
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL CreatePipelineLayout(VkDevice, const VkPipelineLayoutCreateInfo*,
+                                                    const VkAllocationCallbacks*, VkPipelineLayout* pPipelineLayout) {
+  return createObject(pPipelineLayout);
+}
+
+VKAPI_ATTR void VKAPI_CALL DestroyPipelineLayout(VkDevice, VkPipelineLayout pipelineLayout,
+                                                 const VkAllocationCallbacks*) {
+  destroyObject(pipelineLayout);
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL CreateDescriptorSetLayout(VkDevice, const VkDescriptorSetLayoutCreateInfo*,
+                                                         const VkAllocationCallbacks*,
+                                                         VkDescriptorSetLayout* pSetLayout) {
+  return createObject(pSetLayout);
+}
+
+VKAPI_ATTR void VKAPI_CALL DestroyDescriptorSetLayout(VkDevice, VkDescriptorSetLayout setLayout,
+                                                      const VkAllocationCallbacks*) {
+  destroyObject(setLayout);
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL CreateDescriptorPool(VkDevice, const VkDescriptorPoolCreateInfo*,
+                                                    const VkAllocationCallbacks*, VkDescriptorPool* pDescriptorPool) {
+  *pDescriptorPool = toHandle<VkDescriptorPool>(new MockDescriptorPool);
+  return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL DestroyDescriptorPool(VkDevice, VkDescriptorPool descriptorPool,
+                                                 const VkAllocationCallbacks*) {
+  delete fromHandle<MockDescriptorPool>(descriptorPool);
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL AllocateDescriptorSets(VkDevice, const VkDescriptorSetAllocateInfo* pAllocateInfo,
+                                                      VkDescriptorSet* pDescriptorSets) {
+  auto& sets = fromHandle<MockDescriptorPool>(pAllocateInfo->descriptorPool)->sets;
+  for (uint32_t index = 0; index < pAllocateInfo->descriptorSetCount; ++index) {
+    sets.push_back(std::make_unique<MockObject>());
+    pDescriptorSets[index] = toHandle<VkDescriptorSet>(sets.back().get());
+  }
+  return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL UpdateDescriptorSets(VkDevice, uint32_t, const VkWriteDescriptorSet*, uint32_t,
+                                                const VkCopyDescriptorSet*) {}
+
+VKAPI_ATTR void VKAPI_CALL CmdBindPipeline(VkCommandBuffer, VkPipelineBindPoint, VkPipeline) {}
+
+VKAPI_ATTR void VKAPI_CALL CmdBindDescriptorSets(VkCommandBuffer, VkPipelineBindPoint, VkPipelineLayout, uint32_t,
+                                                 uint32_t, const VkDescriptorSet*, uint32_t, const uint32_t*) {}
+
+VKAPI_ATTR void VKAPI_CALL CmdPushConstants(VkCommandBuffer, VkPipelineLayout, VkShaderStageFlags, uint32_t, uint32_t,
+                                            const void*) {}
+
+VKAPI_ATTR void VKAPI_CALL CmdDispatch(VkCommandBuffer, uint32_t, uint32_t, uint32_t) {}
+
+PFN_vkVoidFunction getProcAddr(std::string_view name);
+
+VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL GetInstanceProcAddr(VkInstance, const char* pName) {
+  return getProcAddr(pName);
+}
+
+VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL GetDeviceProcAddr(VkDevice, const char* pName) { return getProcAddr(pName); }
+
+struct ProcEntry {
+  std::string_view name;
+  PFN_vkVoidFunction function;
+};
+
+#define MOCK_ENTRY(name) ProcEntry{"vk" #name, reinterpret_cast<PFN_vkVoidFunction>(&name)}
+
+// Anything missing from this table is reported as unsupported, the loader then fails calls to it cleanly.
+PFN_vkVoidFunction getProcAddr(std::string_view name) {
+  static const std::array kEntries{
+      MOCK_ENTRY(GetInstanceProcAddr),
+      MOCK_ENTRY(GetDeviceProcAddr),
+      MOCK_ENTRY(EnumerateInstanceExtensionProperties),
+      MOCK_ENTRY(EnumerateInstanceVersion),
+      MOCK_ENTRY(CreateInstance),
+      MOCK_ENTRY(DestroyInstance),
+      MOCK_ENTRY(EnumeratePhysicalDevices),
+      MOCK_ENTRY(EnumeratePhysicalDeviceGroups),
+      MOCK_ENTRY(GetPhysicalDeviceProperties),
+      MOCK_ENTRY(GetPhysicalDeviceProperties2),
+      MOCK_ENTRY(GetPhysicalDeviceFeatures),
+      MOCK_ENTRY(GetPhysicalDeviceFeatures2),
+      MOCK_ENTRY(GetPhysicalDeviceMemoryProperties),
+      MOCK_ENTRY(GetPhysicalDeviceMemoryProperties2),
+      MOCK_ENTRY(GetPhysicalDeviceQueueFamilyProperties),
+      MOCK_ENTRY(GetPhysicalDeviceQueueFamilyProperties2),
+      MOCK_ENTRY(GetPhysicalDeviceFormatProperties),
+      MOCK_ENTRY(EnumerateDeviceExtensionProperties),
+      MOCK_ENTRY(CreateDevice),
+      MOCK_ENTRY(DestroyDevice),
+      MOCK_ENTRY(GetDeviceQueue),
+      MOCK_ENTRY(DeviceWaitIdle),
+      MOCK_ENTRY(QueueWaitIdle),
+      MOCK_ENTRY(QueueSubmit),
+      MOCK_ENTRY(QueueSubmit2),
+      MOCK_ENTRY(CreateFence),
+      MOCK_ENTRY(DestroyFence),
+      MOCK_ENTRY(ResetFences),
+      MOCK_ENTRY(GetFenceStatus),
+      MOCK_ENTRY(WaitForFences),
+      MOCK_ENTRY(CreateSemaphore),
+      MOCK_ENTRY(DestroySemaphore),
+      MOCK_ENTRY(GetSemaphoreCounterValue),
+      MOCK_ENTRY(SignalSemaphore),
+      MOCK_ENTRY(WaitSemaphores),
+      MOCK_ENTRY(CreateCommandPool),
+      MOCK_ENTRY(DestroyCommandPool),
+      MOCK_ENTRY(ResetCommandPool),
+      MOCK_ENTRY(AllocateCommandBuffers),
+      MOCK_ENTRY(FreeCommandBuffers),
+      MOCK_ENTRY(BeginCommandBuffer),
+      MOCK_ENTRY(EndCommandBuffer),
+      MOCK_ENTRY(ResetCommandBuffer),
+      MOCK_ENTRY(CmdFillBuffer),
+      MOCK_ENTRY(CmdPipelineBarrier2),
+      MOCK_ENTRY(AllocateMemory),
+      MOCK_ENTRY(FreeMemory),
+      MOCK_ENTRY(MapMemory),
+      MOCK_ENTRY(UnmapMemory),
+      MOCK_ENTRY(CreateBuffer),
+      MOCK_ENTRY(DestroyBuffer),
+      MOCK_ENTRY(GetBufferMemoryRequirements),
+      MOCK_ENTRY(BindBufferMemory),
+      MOCK_ENTRY(CreateShaderModule),
+      MOCK_ENTRY(DestroyShaderModule),
+      MOCK_ENTRY(CreatePipelineCache),
+      MOCK_ENTRY(DestroyPipelineCache),
+      MOCK_ENTRY(GetPipelineCacheData),
+      MOCK_ENTRY(CreateComputePipelines),
+      MOCK_ENTRY(DestroyPipeline),
+      MOCK_ENTRY(CreatePipelineLayout),
+      MOCK_ENTRY(DestroyPipelineLayout),
+      MOCK_ENTRY(CreateDescriptorSetLayout),
+      MOCK_ENTRY(DestroyDescriptorSetLayout),
+      MOCK_ENTRY(CreateDescriptorPool),
+      MOCK_ENTRY(DestroyDescriptorPool),
+      MOCK_ENTRY(AllocateDescriptorSets),
+      MOCK_ENTRY(UpdateDescriptorSets),
+      MOCK_ENTRY(CmdBindPipeline),
+      MOCK_ENTRY(CmdBindDescriptorSets),
+      MOCK_ENTRY(CmdPushConstants),
+      MOCK_ENTRY(CmdDispatch),
+  };
+
+  const auto it = std::ranges::find(kEntries, name, &ProcEntry::name);
+  return it != kEntries.end() ? it->function : nullptr;
+}
+
+#undef MOCK_ENTRY
+
+} // namespace
+
+// The loader finds everything else through vk_icdGetInstanceProcAddr.
+
+MOCK_ICD_EXPORT VKAPI_ATTR VkResult VKAPI_CALL vk_icdNegotiateLoaderICDInterfaceVersion(uint32_t* pSupportedVersion) {
+  *pSupportedVersion = std::min(*pSupportedVersion, 5u);
+  return VK_SUCCESS;
+}
+
+MOCK_ICD_EXPORT VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL vk_icdGetInstanceProcAddr(VkInstance instance,
+                                                                                    const char* pName) {
+  return GetInstanceProcAddr(instance, pName);
+}
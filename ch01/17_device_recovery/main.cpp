@@ -0,0 +1,1213 @@
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <expected>
+#include <filesystem>
+#include <format>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <numeric>
+#include <optional>
+#include <print>
+#include <ranges>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include <glslang/Public/ResourceLimits.h>
+#include <glslang/Public/ShaderLang.h>
+#include <glslang/SPIRV/GlslangToSpv.h>
+
+namespace ranges = std::ranges;
+namespace views = std::ranges::views;
+
+#define VK_CALL(vFun)                                                                                                  \
+  {                                                                                                                    \
+    const auto res = vFun;                                                                                             \
+    if (res != VK_SUCCESS) {                                                                                           \
+      std::println(#vFun " failed with error {}", static_cast<int>(res));                                              \
+      std::exit(res);                                                                                                  \
+    }                                                                                                                  \
+  }
+
+auto getRequestedInstanceLayers() -> std::vector<std::string> {
+  return std::vector<std::string>{"VK_LAYER_KHRONOS_validation"};
+}
+
+auto getRequestedInstanceExtensions() -> std::vector<std::string> {
+  return std::vector<std::string>{
+#if defined(VK_USE_PLATFORM_METAL_EXT)
+      VK_KHR_PORTABILITY_ENUMERATION_EXTENSION_NAME,
+#endif
+#if defined(VK_EXT_debug_utils)
+      VK_EXT_DEBUG_UTILS_EXTENSION_NAME,
+#endif
+  };
+}
+
+namespace VulkanCore {
+std::vector<VkLayerProperties> enumerateInstanceLayerProperties() {
+  uint32_t layersCount{0};
+  vkEnumerateInstanceLayerProperties(&layersCount, nullptr);
+
+  std::vector<VkLayerProperties> layersProperties(layersCount);
+  vkEnumerateInstanceLayerProperties(&layersCount, layersProperties.data());
+
+  return layersProperties;
+}
+
+std::vector<VkExtensionProperties> enumerateExtensionsProperties() {
+  uint32_t extensionsCount{0};
+  vkEnumerateInstanceExtensionProperties(nullptr, &extensionsCount, nullptr);
+
+  std::vector<VkExtensionProperties> extensionsProperties(extensionsCount);
+  vkEnumerateInstanceExtensionProperties(nullptr, &extensionsCount, extensionsProperties.data());
+
+  return extensionsProperties;
+}
+
+std::vector<VkExtensionProperties> enumerateDeviceExtensionsProperties(VkPhysicalDevice device) {
+  uint32_t extensionsCount{0};
+  vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionsCount, nullptr);
+
+  std::vector<VkExtensionProperties> extensionsProperties(extensionsCount);
+  vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionsCount, extensionsProperties.data());
+
+  return extensionsProperties;
+}
+
+std::vector<VkPhysicalDevice> enumeratePhysicalDevices(VkInstance instance) {
+  uint32_t physicalDevicesCount{0};
+  vkEnumeratePhysicalDevices(instance, &physicalDevicesCount, nullptr);
+
+  std::vector<VkPhysicalDevice> physicalDevices(physicalDevicesCount);
+  vkEnumeratePhysicalDevices(instance, &physicalDevicesCount, physicalDevices.data());
+
+  return physicalDevices;
+}
+
+std::vector<VkQueueFamilyProperties> enumeratePhysicalDevicesQueueFamilyProperties(VkPhysicalDevice device) {
+  uint32_t physicalDeviceQueueFamilyPropertiesCount{0};
+  vkGetPhysicalDeviceQueueFamilyProperties(device, &physicalDeviceQueueFamilyPropertiesCount, nullptr);
+
+  std::vector<VkQueueFamilyProperties> queueFamiliesProperties(physicalDeviceQueueFamilyPropertiesCount);
+  vkGetPhysicalDeviceQueueFamilyProperties(device, &physicalDeviceQueueFamilyPropertiesCount,
+                                           queueFamiliesProperties.data());
+
+  return queueFamiliesProperties;
+}
+
+class PhysicalDevice {
+public:
+  explicit PhysicalDevice(VkPhysicalDevice device)
+      : m_device{device}, m_extensions{enumerateDeviceExtensionsProperties(device)},
+        m_queueFamilies{enumeratePhysicalDevicesQueueFamilyProperties(device)} {
+    vkGetPhysicalDeviceProperties(m_device, &m_properties);
+    vkGetPhysicalDeviceMemoryProperties(m_device, &m_memoryProperties);
+  }
+
+  [[nodiscard]] inline VkPhysicalDevice getPhysicalDevice() const noexcept { return m_device; }
+
+  [[nodiscard]] inline const VkPhysicalDeviceProperties& getProperties() const noexcept { return m_properties; }
+
+  [[nodiscard]] inline const VkPhysicalDeviceMemoryProperties& getMemoryProperties() const noexcept {
+    return m_memoryProperties;
+  }
+
+  [[nodiscard]] bool isExtensionSupported(std::string_view name) const {
+    return ranges::any_of(m_extensions,
+                          [name](const VkExtensionProperties& prop) { return name == prop.extensionName; });
+  }
+
+  [[nodiscard]] std::optional<uint32_t> findQueueFamily(VkQueueFlags flags) const {
+    const auto it = ranges::find_if(m_queueFamilies, [flags](const VkQueueFamilyProperties& family) {
+      return (family.queueFlags & flags) == flags;
+    });
+    if (it == std::end(m_queueFamilies))
+      return std::nullopt;
+
+    return static_cast<uint32_t>(std::distance(std::begin(m_queueFamilies), it));
+  }
+
+  // Handles may change when a device is rebuilt, the UUID does not.
+  [[nodiscard]] VkPhysicalDeviceIDProperties queryIdProperties() const {
+    VkPhysicalDeviceIDProperties idProperties{.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES};
+    VkPhysicalDeviceProperties2 properties{.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+                                           .pNext = &idProperties};
+    vkGetPhysicalDeviceProperties2(m_device, &properties);
+    return idProperties;
+  }
+
+  [[nodiscard]] VkDeviceSize getDeviceLocalMemorySize() const {
+    const auto heaps = std::span{m_memoryProperties.memoryHeaps, m_memoryProperties.memoryHeapCount};
+    VkDeviceSize size = 0;
+    for (const auto& heap : heaps) {
+      if (heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)
+        size += heap.size;
+    }
+    return size;
+  }
+
+private:
+  VkPhysicalDevice m_device;
+  std::vector<VkExtensionProperties> m_extensions;
+  std::vector<VkQueueFamilyProperties> m_queueFamilies;
+  VkPhysicalDeviceProperties m_properties{};
+  VkPhysicalDeviceMemoryProperties m_memoryProperties{};
+};
+
+// Discrete before integrated before virtual before CPU devices, then the one with the most device local memory.
+uint64_t scorePhysicalDevice(const PhysicalDevice& physicalDevice) {
+  uint64_t typeScore = 0;
+  switch (physicalDevice.getProperties().deviceType) {
+  case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+    typeScore = 4;
+    break;
+  case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+    typeScore = 3;
+    break;
+  case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+    typeScore = 2;
+    break;
+  case VK_PHYSICAL_DEVICE_TYPE_CPU:
+    typeScore = 1;
+    break;
+  default:
+    break;
+  }
+  return (typeScore << 48) + (physicalDevice.getDeviceLocalMemorySize() >> 20);
+}
+
+// The best scoring device with a queue family supporting all of queueFlags, the first one on a tie.
+std::optional<size_t> selectPhysicalDevice(std::span<const PhysicalDevice> physicalDevices, VkQueueFlags queueFlags) {
+  std::optional<size_t> selected;
+  uint64_t selectedScore = 0;
+  for (size_t index = 0; index < physicalDevices.size(); ++index) {
+    if (!physicalDevices[index].findQueueFamily(queueFlags).has_value())
+      continue;
+
+    const auto score = scorePhysicalDevice(physicalDevices[index]);
+    if (!selected.has_value() || score > selectedScore) {
+      selected = index;
+      selectedScore = score;
+    }
+  }
+  return selected;
+}
+
+void bufferBarrier(VkCommandBuffer commandBuffer, VkBuffer buffer, VkPipelineStageFlags2 srcStage,
+                   VkAccessFlags2 srcAccess, VkPipelineStageFlags2 dstStage, VkAccessFlags2 dstAccess) {
+  const VkBufferMemoryBarrier2 barrier{.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2,
+                                       .srcStageMask = srcStage,
+                                       .srcAccessMask = srcAccess,
+                                       .dstStageMask = dstStage,
+                                       .dstAccessMask = dstAccess,
+                                       .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                                       .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                                       .buffer = buffer,
+                                       .size = VK_WHOLE_SIZE};
+  const VkDependencyInfo dependency{.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+                                    .bufferMemoryBarrierCount = 1,
+                                    .pBufferMemoryBarriers = &barrier};
+  vkCmdPipelineBarrier2(commandBuffer, &dependency);
+}
+
+struct BufferAllocation {
+  VkBuffer buffer = VK_NULL_HANDLE;
+  VkDeviceMemory memory = VK_NULL_HANDLE;
+  VkDeviceSize size = 0;
+  void* mapped = nullptr;
+};
+
+// The message VK_CALL prints, for the calls that hand their failure to the caller instead of exiting.
+std::string vkError(std::string_view call, VkResult result) {
+  return std::format("{} failed with error {}", call, static_cast<int>(result));
+}
+
+// A device with one compute queue. Creation and submission report failures instead of exiting, VK_ERROR_DEVICE_LOST is
+// something the caller recovers from and a device may be lost again while it is being rebuilt.
+class Device {
+public:
+  static std::expected<Device, std::string> create(const PhysicalDevice& physicalDevice, uint32_t queueFamilyIndex) {
+    Device device{physicalDevice, queueFamilyIndex};
+
+    if (device.init())
+      return device;
+    else
+      return std::unexpected(std::string{"Failed to create the vulkan device"});
+  }
+
+  ~Device() {
+    if (m_device == VK_NULL_HANDLE)
+      return;
+
+    // Fails with VK_ERROR_DEVICE_LOST on a lost device, which is fine: destroying its objects is still valid.
+    vkDeviceWaitIdle(m_device);
+    vkDestroyFence(m_device, m_fence, nullptr);
+    vkDestroyCommandPool(m_device, m_commandPool, nullptr);
+    vkDestroyDevice(m_device, nullptr);
+    m_device = VK_NULL_HANDLE;
+  }
+
+  Device& operator=(const Device&) = delete;
+
+  Device(const Device&) = delete;
+
+  Device(Device&& rhs) noexcept {
+    swap(rhs);
+    rhs.m_device = VK_NULL_HANDLE;
+  }
+
+  Device& operator=(Device&& rhs) noexcept {
+    Device tmp{std::move(rhs)};
+    swap(tmp);
+    return *this;
+  }
+
+  [[nodiscard]] inline VkDevice getDevice() const noexcept { return m_device; }
+
+  [[nodiscard]] std::optional<uint32_t> findMemoryType(uint32_t typeBits, VkMemoryPropertyFlags required) const {
+    for (uint32_t index = 0; index < m_memoryProperties.memoryTypeCount; ++index) {
+      const auto flags = m_memoryProperties.memoryTypes[index].propertyFlags;
+      if ((typeBits & (1u << index)) && (flags & required) == required)
+        return index;
+    }
+    return std::nullopt;
+  }
+
+  std::expected<BufferAllocation, std::string> createBuffer(VkDeviceSize size, VkBufferUsageFlags usage,
+                                                           VkMemoryPropertyFlags properties) {
+    const VkBufferCreateInfo bufferInfo{.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+                                        .size = size,
+                                        .usage = usage,
+                                        .sharingMode = VK_SHARING_MODE_EXCLUSIVE};
+    BufferAllocation allocation{.size = size};
+    const auto fail = [&](std::string error) {
+      destroyBuffer(allocation);
+      return std::unexpected(std::move(error));
+    };
+
+    if (const auto res = vkCreateBuffer(m_device, &bufferInfo, nullptr, &allocation.buffer); res != VK_SUCCESS)
+      return fail(vkError("vkCreateBuffer", res));
+
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements(m_device, allocation.buffer, &requirements);
+
+    const auto memoryTypeIndex = findMemoryType(requirements.memoryTypeBits, properties);
+    if (!memoryTypeIndex.has_value())
+      return fail(std::format("No memory type for a buffer of {} bytes", size));
+
+    const VkMemoryAllocateInfo allocateInfo{.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+                                            .allocationSize = requirements.size,
+                                            .memoryTypeIndex = memoryTypeIndex.value()};
+    if (const auto res = vkAllocateMemory(m_device, &allocateInfo, nullptr, &allocation.memory); res != VK_SUCCESS)
+      return fail(vkError("vkAllocateMemory", res));
+    if (const auto res = vkBindBufferMemory(m_device, allocation.buffer, allocation.memory, 0); res != VK_SUCCESS)
+      return fail(vkError("vkBindBufferMemory", res));
+
+    if (properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+      if (const auto res = vkMapMemory(m_device, allocation.memory, 0, VK_WHOLE_SIZE, 0, &allocation.mapped);
+          res != VK_SUCCESS)
+        return fail(vkError("vkMapMemory", res));
+    }
+    return allocation;
+  }
+
+  void destroyBuffer(BufferAllocation& allocation) {
+    vkDestroyBuffer(m_device, allocation.buffer, nullptr);
+    vkFreeMemory(m_device, allocation.memory, nullptr);
+    allocation = BufferAllocation{};
+  }
+
+  std::expected<VkCommandBuffer, std::string> allocateCommandBuffer() {
+    const VkCommandBufferAllocateInfo commandBufferInfo{.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+                                                        .commandPool = m_commandPool,
+                                                        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+                                                        .commandBufferCount = 1};
+    VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+    if (const auto res = vkAllocateCommandBuffers(m_device, &commandBufferInfo, &commandBuffer); res != VK_SUCCESS)
+      return std::unexpected(vkError("vkAllocateCommandBuffers", res));
+    return commandBuffer;
+  }
+
+  // Submits a recorded command buffer and waits for it.
+  [[nodiscard]] VkResult submitAndWait(VkCommandBuffer commandBuffer) {
+    if (const auto result = vkResetFences(m_device, 1, &m_fence); result != VK_SUCCESS)
+      return result;
+
+    const VkCommandBufferSubmitInfo commandBufferInfo{.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO,
+                                                      .commandBuffer = commandBuffer};
+    const VkSubmitInfo2 submitInfo{.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2,
+                                   .commandBufferInfoCount = 1,
+                                   .pCommandBufferInfos = &commandBufferInfo};
+    if (const auto result = vkQueueSubmit2(m_queue, 1, &submitInfo, m_fence); result != VK_SUCCESS)
+      return result;
+    return vkWaitForFences(m_device, 1, &m_fence, VK_TRUE, UINT64_MAX);
+  }
+
+private:
+  Device(const PhysicalDevice& physicalDevice, uint32_t queueFamilyIndex)
+      : m_physicalDevice{physicalDevice.getPhysicalDevice()},
+        m_memoryProperties{physicalDevice.getMemoryProperties()}, m_queueFamilyIndex{queueFamilyIndex} {}
+
+  bool init() {
+    VkPhysicalDeviceVulkan13Features features13{.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES,
+                                                .synchronization2 = VK_TRUE};
+
+    const float queuePriority = 1.0f;
+    const VkDeviceQueueCreateInfo queueInfo{.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
+                                            .queueFamilyIndex = m_queueFamilyIndex,
+                                            .queueCount = 1,
+                                            .pQueuePriorities = &queuePriority};
+
+    const VkDeviceCreateInfo deviceInfo{.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
+                                        .pNext = &features13,
+                                        .queueCreateInfoCount = 1,
+                                        .pQueueCreateInfos = &queueInfo};
+
+    if (vkCreateDevice(m_physicalDevice, &deviceInfo, nullptr, &m_device) != VK_SUCCESS)
+      return false;
+
+    vkGetDeviceQueue(m_device, m_queueFamilyIndex, 0, &m_queue);
+
+    const VkCommandPoolCreateInfo poolInfo{.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+                                           .flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+                                           .queueFamilyIndex = m_queueFamilyIndex};
+    if (vkCreateCommandPool(m_device, &poolInfo, nullptr, &m_commandPool) != VK_SUCCESS)
+      return false;
+
+    const VkFenceCreateInfo fenceInfo{.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
+    return vkCreateFence(m_device, &fenceInfo, nullptr, &m_fence) == VK_SUCCESS;
+  }
+
+  void swap(Device& rhs) {
+    std::swap(m_physicalDevice, rhs.m_physicalDevice);
+    std::swap(m_memoryProperties, rhs.m_memoryProperties);
+    std::swap(m_queueFamilyIndex, rhs.m_queueFamilyIndex);
+    std::swap(m_device, rhs.m_device);
+    std::swap(m_queue, rhs.m_queue);
+    std::swap(m_commandPool, rhs.m_commandPool);
+    std::swap(m_fence, rhs.m_fence);
+  }
+
+private:
+  VkPhysicalDevice m_physicalDevice = VK_NULL_HANDLE;
+  VkPhysicalDeviceMemoryProperties m_memoryProperties{};
+  uint32_t m_queueFamilyIndex = 0;
+  VkDevice m_device = VK_NULL_HANDLE;
+  VkQueue m_queue = VK_NULL_HANDLE;
+  VkCommandPool m_commandPool = VK_NULL_HANDLE;
+  VkFence m_fence = VK_NULL_HANDLE;
+};
+
+class ShaderCompiler {
+public:
+  ShaderCompiler() { glslang::InitializeProcess(); }
+
+  ShaderCompiler(const ShaderCompiler&) = delete;
+  ShaderCompiler& operator=(const ShaderCompiler&) = delete;
+
+  ~ShaderCompiler() { glslang::FinalizeProcess(); }
+
+  std::expected<std::vector<uint32_t>, std::string> compileCompute(std::string_view source) const {
+    glslang::TShader shader{EShLangCompute};
+    const char* sources[] = {source.data()};
+    const int lengths[] = {static_cast<int>(source.size())};
+    shader.setStringsWithLengths(sources, lengths, 1);
+    shader.setEnvInput(glslang::EShSourceGlsl, EShLangCompute, glslang::EShClientVulkan, 100);
+    shader.setEnvClient(glslang::EShClientVulkan, glslang::EShTargetVulkan_1_3);
+    shader.setEnvTarget(glslang::EShTargetSpv, glslang::EShTargetSpv_1_6);
+
+    const auto messages = static_cast<EShMessages>(EShMsgSpvRules | EShMsgVulkanRules);
+    if (!shader.parse(GetDefaultResources(), 460, false, messages))
+      return std::unexpected(std::string{shader.getInfoLog()});
+
+    glslang::TProgram program;
+    program.addShader(&shader);
+    if (!program.link(messages))
+      return std::unexpected(std::string{program.getInfoLog()});
+
+    std::vector<uint32_t> spirv;
+    glslang::GlslangToSpv(*program.getIntermediate(EShLangCompute), spirv);
+    return spirv;
+  }
+};
+
+class Context {
+public:
+  static std::expected<Context, std::string> create(std::string_view applicationName,
+                                                    std::vector<std::string> requestedInstanceLayer,
+                                                    std::vector<std::string> requestedInstanceExtensions) {
+
+    Context context{applicationName, std::move(requestedInstanceLayer), std::move(requestedInstanceExtensions)};
+
+    if (context.init())
+      return context;
+    else
+      return std::unexpected(std::string{"Failed to init the vulkan context"});
+  }
+
+  ~Context() {
+    if (m_vulkanInstance == VK_NULL_HANDLE)
+      return;
+
+    vkDestroyInstance(m_vulkanInstance, nullptr);
+    m_vulkanInstance = VK_NULL_HANDLE;
+  }
+
+  Context& operator=(const Context&) = delete;
+
+  Context(const Context&) = delete;
+
+  Context(Context&& rhs) noexcept {
+    swap(rhs);
+    rhs.m_vulkanInstance = VK_NULL_HANDLE;
+  }
+
+  Context& operator=(Context&& rhs) noexcept {
+    Context tmp{std::move(rhs)};
+    swap(tmp);
+    return *this;
+  }
+
+  std::vector<PhysicalDevice> enumeratePhysicalDevices() {
+    // clang-format off
+    auto result = VulkanCore::enumeratePhysicalDevices(m_vulkanInstance)
+      | views::transform([](VkPhysicalDevice device) -> PhysicalDevice {
+         return PhysicalDevice{device};
+        })
+      | ranges::to<std::vector<PhysicalDevice>>();
+    // clang-format on
+    return result;
+  }
+
+private:
+  Context(std::string_view applicationName, std::vector<std::string> requestedInstanceLayer,
+          std::vector<std::string> requestedInstanceExtensions)
+      : m_applicationName{applicationName} {
+    auto allInstanceLayers = enumerateInstanceLayerProperties();
+    const auto isInstanceLayerRequired = [&requestedInstanceLayer](const VkLayerProperties& prop) {
+      auto name = std::string{prop.layerName};
+      return ranges::find(requestedInstanceLayer, name) != std::end(requestedInstanceLayer);
+    };
+    // clang-format off
+    m_layerProperties = allInstanceLayers
+      | views::filter(isInstanceLayerRequired)
+      | ranges::to<std::vector<VkLayerProperties>>();
+    // clang-format on
+
+    auto allExtensions = enumerateExtensionsProperties();
+    const auto isExtensionRequired = [&requestedInstanceExtensions](const VkExtensionProperties& prop) {
+      auto name = std::string{prop.extensionName};
+      return ranges::find(requestedInstanceExtensions, name) != std::end(requestedInstanceExtensions);
+    };
+    // clang-format off
+    m_layerExtensions = allExtensions
+      | views::filter(isExtensionRequired)
+      | ranges::to<std::vector<VkExtensionProperties>>();
+    // clang-format on
+  }
+
+  bool init() {
+    // clang-format off
+    auto layers = m_layerProperties
+      | views::transform([](const VkLayerProperties& prop) -> const char*
+        {
+          return prop.layerName;
+        })
+      | ranges::to<std::vector<const char*>>();
+
+      auto extensions = m_layerExtensions
+        | views::transform([](const VkExtensionProperties & prop) -> const char*
+          {
+            return prop.extensionName;
+          })
+        | ranges::to<std::vector<const char*>>();
+    // clang-format on
+
+    const VkApplicationInfo applicationInfo{.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO,
+                                            .pApplicationName = m_applicationName.data(),
+                                            .applicationVersion = VK_MAKE_VERSION(1, 0, 0),
+                                            .apiVersion = VK_API_VERSION_1_3};
+
+    const VkInstanceCreateInfo instanceCreateInfo{.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO,
+#if defined(VK_USE_PLATFORM_METAL_EXT)
+                                                  .flags = VK_INSTANCE_CREATE_ENUMERATE_PORTABILITY_BIT_KHR,
+#endif
+                                                  .pApplicationInfo = &applicationInfo,
+                                                  .enabledLayerCount = static_cast<uint32_t>(layers.size()),
+                                                  .ppEnabledLayerNames = layers.data(),
+                                                  .enabledExtensionCount = static_cast<uint32_t>(extensions.size()),
+                                                  .ppEnabledExtensionNames = extensions.data()};
+
+    const auto res = vkCreateInstance(&instanceCreateInfo, nullptr, &m_vulkanInstance);
+    return res == VK_SUCCESS;
+  }
+
+  void swap(Context& rhs) {
+    std::swap(m_applicationName, rhs.m_applicationName);
+    std::swap(m_layerProperties, rhs.m_layerProperties);
+    std::swap(m_layerExtensions, rhs.m_layerExtensions);
+    std::swap(m_vulkanInstance, rhs.m_vulkanInstance);
+  }
+
+private:
+  std::string m_applicationName;
+  std::vector<VkLayerProperties> m_layerProperties;
+  std::vector<VkExtensionProperties> m_layerExtensions;
+  VkInstance m_vulkanInstance = VK_NULL_HANDLE;
+};
+
+// What a buffer is made from. contents is uploaded whenever the buffer is created, so it doubles as the checkpoint
+// a rebuilt device resumes from.
+struct BufferDescription {
+  std::string name;
+  VkBufferUsageFlags usage = 0;
+  std::vector<std::byte> contents;
+};
+
+struct BufferHandle {
+  uint32_t index = 0;
+};
+
+// A compute pipeline with one storage buffer binding per entry of buffers, in order, and push constants.
+struct ComputePipelineDescription {
+  std::string name;
+  std::vector<uint32_t> spirv;
+  std::vector<BufferHandle> buffers;
+  uint32_t pushConstantSize = 0;
+};
+
+struct PipelineHandle {
+  uint32_t index = 0;
+};
+
+struct RecoveryPolicy {
+  // Recovery gives up once rebuilding has taken this long.
+  std::chrono::milliseconds timeout{2000};
+  // Device creation usually fails for a while during a driver reset, this is the wait between attempts.
+  std::chrono::milliseconds retryInterval{50};
+};
+
+struct RecoveryStatistics {
+  uint32_t recoveries = 0;
+  uint32_t attempts = 0;
+  std::chrono::duration<double, std::milli> lastRecovery{0};
+  std::chrono::duration<double, std::milli> longestRecovery{0};
+  std::chrono::duration<double, std::milli> initialPipelineTime{0};
+  std::chrono::duration<double, std::milli> lastPipelineTime{0};
+};
+
+enum class SubmitStatus {
+  Completed,
+  // The device was lost and rebuilt, nothing of the submission survived.
+  Recovered,
+};
+
+// A device whose objects are all created from descriptions kept on the CPU. When a submission reports
+// VK_ERROR_DEVICE_LOST the whole device is thrown away and built again from those descriptions, reusing the pipeline
+// cache of the lost device, and the caller continues from its last checkpoint instead of restarting the process.
+// Handles stay valid across a rebuild, the Vulkan objects behind them do not.
+class RecoverableDevice {
+public:
+  static std::expected<RecoverableDevice, std::string> create(Context& context, VkQueueFlags queueFlags,
+                                                              RecoveryPolicy policy) {
+    RecoverableDevice device{context, queueFlags, policy};
+
+    if (auto generation = device.build(); generation) {
+      device.m_generation = std::move(generation.value());
+      return device;
+    } else {
+      return std::unexpected(generation.error());
+    }
+  }
+
+  RecoverableDevice(const RecoverableDevice&) = delete;
+  RecoverableDevice& operator=(const RecoverableDevice&) = delete;
+  RecoverableDevice(RecoverableDevice&&) noexcept = default;
+  RecoverableDevice& operator=(RecoverableDevice&&) noexcept = default;
+
+  [[nodiscard]] inline const RecoveryStatistics& statistics() const noexcept { return m_statistics; }
+
+  [[nodiscard]] inline const PhysicalDevice& getPhysicalDevice() const noexcept { return m_generation->physicalDevice; }
+
+  // Buffers are host visible and coherent. Add them before the pipelines that bind them.
+  std::expected<BufferHandle, std::string> addBuffer(BufferDescription description) {
+    auto buffer = createBuffer(*m_generation, description);
+    if (!buffer)
+      return std::unexpected(buffer.error());
+
+    m_buffers.push_back(std::move(description));
+    m_generation->buffers.push_back(buffer.value());
+    return BufferHandle{static_cast<uint32_t>(m_buffers.size() - 1)};
+  }
+
+  std::expected<PipelineHandle, std::string> addComputePipeline(ComputePipelineDescription description) {
+    const auto start = std::chrono::steady_clock::now();
+    auto pipeline = createPipeline(*m_generation, description);
+    if (!pipeline)
+      return std::unexpected(pipeline.error());
+    m_statistics.initialPipelineTime += std::chrono::steady_clock::now() - start;
+
+    m_pipelines.push_back(std::move(description));
+    m_generation->pipelines.push_back(pipeline.value());
+    if (auto saved = savePipelineCache(*m_generation); !saved)
+      return std::unexpected(saved.error());
+    return PipelineHandle{static_cast<uint32_t>(m_pipelines.size() - 1)};
+  }
+
+  // The buffer's memory on the current device, only valid until the next recovery.
+  [[nodiscard]] std::span<std::byte> map(BufferHandle handle) const {
+    const auto& buffer = m_generation->buffers[handle.index];
+    return std::span{static_cast<std::byte*>(buffer.mapped), m_buffers[handle.index].contents.size()};
+  }
+
+  // Copies the buffer back into its description, a rebuilt device starts from this copy.
+  void checkpoint(BufferHandle handle) {
+    const auto memory = map(handle);
+    ranges::copy(memory, std::begin(m_buffers[handle.index].contents));
+  }
+
+  void dispatch(VkCommandBuffer commandBuffer, PipelineHandle handle, std::span<const std::byte> pushConstants,
+                uint32_t groupCount) const {
+    const auto& pipeline = m_generation->pipelines[handle.index];
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline.pipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline.layout, 0, 1, &pipeline.set, 0,
+                            nullptr);
+    if (!pushConstants.empty())
+      vkCmdPushConstants(commandBuffer, pipeline.layout, VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                         static_cast<uint32_t>(pushConstants.size()), pushConstants.data());
+    vkCmdDispatch(commandBuffer, groupCount, 1, 1);
+  }
+
+  [[nodiscard]] VkBuffer getBuffer(BufferHandle handle) const { return m_generation->buffers[handle.index].buffer; }
+
+  // Records with record and waits for the result. A lost device is rebuilt before this returns, an error means it
+  // could not be rebuilt within the policy's timeout.
+  std::expected<SubmitStatus, std::string> submit(const std::function<void(VkCommandBuffer)>& record) {
+    const auto commandBuffer = m_generation->commandBuffer;
+    VK_CALL(vkResetCommandBuffer(commandBuffer, 0));
+    const VkCommandBufferBeginInfo beginInfo{.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+                                             .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT};
+    VK_CALL(vkBeginCommandBuffer(commandBuffer, &beginInfo));
+    record(commandBuffer);
+    VK_CALL(vkEndCommandBuffer(commandBuffer));
+
+    const auto result = m_generation->device.submitAndWait(commandBuffer);
+    if (result == VK_SUCCESS)
+      return SubmitStatus::Completed;
+    if (result != VK_ERROR_DEVICE_LOST)
+      return std::unexpected(std::format("Submission failed with error {}", static_cast<int>(result)));
+
+    if (auto recovered = recover(); !recovered)
+      return std::unexpected(recovered.error());
+    return SubmitStatus::Recovered;
+  }
+
+private:
+  struct ComputePipeline {
+    VkDescriptorSetLayout setLayout = VK_NULL_HANDLE;
+    VkPipelineLayout layout = VK_NULL_HANDLE;
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    VkDescriptorPool pool = VK_NULL_HANDLE;
+    VkDescriptorSet set = VK_NULL_HANDLE;
+  };
+
+  // Everything that lives on one VkDevice and dies with it.
+  struct Generation {
+    Generation(PhysicalDevice physicalDevice, Device device)
+        : physicalDevice{std::move(physicalDevice)}, device{std::move(device)} {}
+
+    Generation(const Generation&) = delete;
+    Generation& operator=(const Generation&) = delete;
+
+    ~Generation() {
+      const auto vkDevice = device.getDevice();
+      for (const auto& pipeline : pipelines)
+        destroyPipeline(vkDevice, pipeline);
+      for (auto& buffer : buffers)
+        device.destroyBuffer(buffer);
+      vkDestroyPipelineCache(vkDevice, pipelineCache, nullptr);
+    }
+
+    PhysicalDevice physicalDevice;
+    Device device;
+    VkPipelineCache pipelineCache = VK_NULL_HANDLE;
+    VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+    std::vector<BufferAllocation> buffers;
+    std::vector<ComputePipeline> pipelines;
+  };
+
+  RecoverableDevice(Context& context, VkQueueFlags queueFlags, RecoveryPolicy policy)
+      : m_context{&context}, m_queueFlags{queueFlags}, m_policy{policy} {}
+
+  // Also cleans up a pipeline that failed half way, destroying null handles is a no-op.
+  static void destroyPipeline(VkDevice vkDevice, const ComputePipeline& pipeline) {
+    vkDestroyDescriptorPool(vkDevice, pipeline.pool, nullptr);
+    vkDestroyPipeline(vkDevice, pipeline.pipeline, nullptr);
+    vkDestroyPipelineLayout(vkDevice, pipeline.layout, nullptr);
+    vkDestroyDescriptorSetLayout(vkDevice, pipeline.setLayout, nullptr);
+  }
+
+  // Prefers the device used so far, found again by its UUID since the handles may change after a reset, and falls
+  // back to the best remaining device if it is gone. Any failure is returned so recover() can try again, the new
+  // device may be lost as well while the driver is still resetting.
+  std::expected<std::unique_ptr<Generation>, std::string> build() {
+    const auto physicalDevices = m_context->enumeratePhysicalDevices();
+    auto selected = ranges::find_if(physicalDevices, [this](const PhysicalDevice& physicalDevice) {
+      const auto idProperties = physicalDevice.queryIdProperties();
+      return m_deviceUuid.has_value() && physicalDevice.findQueueFamily(m_queueFlags).has_value() &&
+             ranges::equal(idProperties.deviceUUID, m_deviceUuid.value());
+    });
+    if (selected == std::end(physicalDevices)) {
+      const auto best = selectPhysicalDevice(physicalDevices, m_queueFlags);
+      if (!best.has_value())
+        return std::unexpected(std::string{"No device with the required queue family"});
+      selected = std::begin(physicalDevices) + static_cast<std::ptrdiff_t>(best.value());
+    }
+
+    auto device = Device::create(*selected, selected->findQueueFamily(m_queueFlags).value());
+    if (!device)
+      return std::unexpected(device.error());
+
+    auto generation = std::make_unique<Generation>(*selected, std::move(device.value()));
+    const auto idProperties = selected->queryIdProperties();
+    m_deviceUuid.emplace();
+    ranges::copy(idProperties.deviceUUID, std::begin(m_deviceUuid.value()));
+
+    // The driver checks the cache header and silently starts empty if the device or driver changed meanwhile.
+    const VkPipelineCacheCreateInfo cacheInfo{.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+                                              .initialDataSize = m_pipelineCacheData.size(),
+                                              .pInitialData = m_pipelineCacheData.data()};
+    if (const auto res = vkCreatePipelineCache(generation->device.getDevice(), &cacheInfo, nullptr,
+                                               &generation->pipelineCache);
+        res != VK_SUCCESS)
+      return std::unexpected(vkError("vkCreatePipelineCache", res));
+
+    auto commandBuffer = generation->device.allocateCommandBuffer();
+    if (!commandBuffer)
+      return std::unexpected(commandBuffer.error());
+    generation->commandBuffer = commandBuffer.value();
+
+    // Whatever was created before a failure is destroyed together with the generation.
+    for (const auto& description : m_buffers) {
+      auto buffer = createBuffer(*generation, description);
+      if (!buffer)
+        return std::unexpected(buffer.error());
+      generation->buffers.push_back(buffer.value());
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    for (const auto& description : m_pipelines) {
+      auto pipeline = createPipeline(*generation, description);
+      if (!pipeline)
+        return std::unexpected(pipeline.error());
+      generation->pipelines.push_back(pipeline.value());
+    }
+    m_statistics.lastPipelineTime = std::chrono::steady_clock::now() - start;
+
+    if (!m_pipelines.empty()) {
+      if (auto saved = savePipelineCache(*generation); !saved)
+        return std::unexpected(saved.error());
+    }
+    return generation;
+  }
+
+  std::expected<void, std::string> recover() {
+    const auto start = std::chrono::steady_clock::now();
+    const auto deadline = start + m_policy.timeout;
+    // The lost device goes first, a driver may refuse a new device while the old one still exists.
+    m_generation.reset();
+
+    std::string lastError;
+    while (true) {
+      ++m_statistics.attempts;
+      auto generation = build();
+      // A rebuild that only completes past the deadline counts as a failure too, the timeout is a bound on the whole
+      // recovery and not just on when the last attempt starts.
+      if (std::chrono::steady_clock::now() > deadline)
+        return std::unexpected(std::format("Device not recovered within {} ms: {}", m_policy.timeout.count(),
+                                           generation ? std::string{"the last rebuild took too long"}
+                                                      : generation.error()));
+      if (generation) {
+        m_generation = std::move(generation.value());
+        break;
+      }
+      lastError = generation.error();
+
+      if (std::chrono::steady_clock::now() + m_policy.retryInterval > deadline)
+        return std::unexpected(std::format("Device not recovered within {} ms: {}", m_policy.timeout.count(),
+                                           lastError));
+      std::this_thread::sleep_for(m_policy.retryInterval);
+    }
+
+    ++m_statistics.recoveries;
+    m_statistics.lastRecovery = std::chrono::steady_clock::now() - start;
+    m_statistics.longestRecovery = std::max(m_statistics.longestRecovery, m_statistics.lastRecovery);
+    return {};
+  }
+
+  std::expected<BufferAllocation, std::string> createBuffer(Generation& generation,
+                                                           const BufferDescription& description) {
+    auto buffer = generation.device.createBuffer(
+        description.contents.size(), description.usage,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    if (!buffer)
+      return std::unexpected(std::format("Buffer {}: {}", description.name, buffer.error()));
+    ranges::copy(description.contents, static_cast<std::byte*>(buffer->mapped));
+    return buffer;
+  }
+
+  std::expected<ComputePipeline, std::string> createPipeline(Generation& generation,
+                                                             const ComputePipelineDescription& description) {
+    const auto vkDevice = generation.device.getDevice();
+    const auto bindingCount = static_cast<uint32_t>(description.buffers.size());
+    ComputePipeline pipeline;
+    const auto fail = [&](std::string_view call, VkResult result) {
+      destroyPipeline(vkDevice, pipeline);
+      return std::unexpected(std::format("Pipeline {}: {}", description.name, vkError(call, result)));
+    };
+
+    // clang-format off
+    const auto bindings = views::iota(0u, bindingCount)
+      | views::transform([](uint32_t binding) {
+          return VkDescriptorSetLayoutBinding{.binding = binding,
+                                              .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                              .descriptorCount = 1,
+                                              .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT};
+        })
+      | ranges::to<std::vector<VkDescriptorSetLayoutBinding>>();
+    // clang-format on
+    const VkDescriptorSetLayoutCreateInfo setLayoutInfo{.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+                                                        .bindingCount = bindingCount,
+                                                        .pBindings = bindings.data()};
+    if (const auto res = vkCreateDescriptorSetLayout(vkDevice, &setLayoutInfo, nullptr, &pipeline.setLayout);
+        res != VK_SUCCESS)
+      return fail("vkCreateDescriptorSetLayout", res);
+
+    const VkPushConstantRange pushConstantRange{.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+                                                .size = description.pushConstantSize};
+    const VkPipelineLayoutCreateInfo layoutInfo{.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+                                                .setLayoutCount = 1,
+                                                .pSetLayouts = &pipeline.setLayout,
+                                                .pushConstantRangeCount = description.pushConstantSize > 0 ? 1u : 0u,
+                                                .pPushConstantRanges = &pushConstantRange};
+    if (const auto res = vkCreatePipelineLayout(vkDevice, &layoutInfo, nullptr, &pipeline.layout); res != VK_SUCCESS)
+      return fail("vkCreatePipelineLayout", res);
+
+    const VkShaderModuleCreateInfo moduleInfo{.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+                                              .codeSize = description.spirv.size() * sizeof(uint32_t),
+                                              .pCode = description.spirv.data()};
+    VkShaderModule shader = VK_NULL_HANDLE;
+    if (const auto res = vkCreateShaderModule(vkDevice, &moduleInfo, nullptr, &shader); res != VK_SUCCESS)
+      return fail("vkCreateShaderModule", res);
+    const VkComputePipelineCreateInfo pipelineInfo{
+        .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+        .stage = {.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+                  .stage = VK_SHADER_STAGE_COMPUTE_BIT,
+                  .module = shader,
+                  .pName = "main"},
+        .layout = pipeline.layout};
+    const auto created =
+        vkCreateComputePipelines(vkDevice, generation.pipelineCache, 1, &pipelineInfo, nullptr, &pipeline.pipeline);
+    vkDestroyShaderModule(vkDevice, shader, nullptr);
+    if (created != VK_SUCCESS)
+      return fail("vkCreateComputePipelines", created);
+
+    const VkDescriptorPoolSize poolSize{.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                        .descriptorCount = std::max(1u, bindingCount)};
+    const VkDescriptorPoolCreateInfo poolInfo{.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+                                              .maxSets = 1,
+                                              .poolSizeCount = 1,
+                                              .pPoolSizes = &poolSize};
+    if (const auto res = vkCreateDescriptorPool(vkDevice, &poolInfo, nullptr, &pipeline.pool); res != VK_SUCCESS)
+      return fail("vkCreateDescriptorPool", res);
+    const VkDescriptorSetAllocateInfo allocateInfo{.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+                                                   .descriptorPool = pipeline.pool,
+                                                   .descriptorSetCount = 1,
+                                                   .pSetLayouts = &pipeline.setLayout};
+    if (const auto res = vkAllocateDescriptorSets(vkDevice, &allocateInfo, &pipeline.set); res != VK_SUCCESS)
+      return fail("vkAllocateDescriptorSets", res);
+
+    // clang-format off
+    const auto bufferInfos = description.buffers
+      | views::transform([&generation](BufferHandle handle) {
+          return VkDescriptorBufferInfo{.buffer = generation.buffers[handle.index].buffer, .range = VK_WHOLE_SIZE};
+        })
+      | ranges::to<std::vector<VkDescriptorBufferInfo>>();
+    // clang-format on
+    std::vector<VkWriteDescriptorSet> writes;
+    for (uint32_t binding = 0; binding < bindingCount; ++binding)
+      writes.push_back(VkWriteDescriptorSet{.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                                            .dstSet = pipeline.set,
+                                            .dstBinding = binding,
+                                            .descriptorCount = 1,
+                                            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                            .pBufferInfo = &bufferInfos[binding]});
+    vkUpdateDescriptorSets(vkDevice, bindingCount, writes.data(), 0, nullptr);
+    return pipeline;
+  }
+
+  // Saved while the device is healthy: the cache of a lost device cannot be read reliably.
+  std::expected<void, std::string> savePipelineCache(const Generation& generation) {
+    const auto vkDevice = generation.device.getDevice();
+    size_t cacheSize = 0;
+    if (const auto res = vkGetPipelineCacheData(vkDevice, generation.pipelineCache, &cacheSize, nullptr);
+        res != VK_SUCCESS)
+      return std::unexpected(vkError("vkGetPipelineCacheData", res));
+
+    std::vector<std::byte> data(cacheSize);
+    if (const auto res = vkGetPipelineCacheData(vkDevice, generation.pipelineCache, &cacheSize, data.data());
+        res != VK_SUCCESS && res != VK_INCOMPLETE)
+      return std::unexpected(vkError("vkGetPipelineCacheData", res));
+    data.resize(cacheSize);
+    m_pipelineCacheData = std::move(data);
+    return {};
+  }
+
+private:
+  Context* m_context;
+  VkQueueFlags m_queueFlags;
+  RecoveryPolicy m_policy;
+  std::optional<std::array<uint8_t, VK_UUID_SIZE>> m_deviceUuid;
+  std::vector<BufferDescription> m_buffers;
+  std::vector<ComputePipelineDescription> m_pipelines;
+  std::vector<std::byte> m_pipelineCacheData;
+  RecoveryStatistics m_statistics;
+  std::unique_ptr<Generation> m_generation;
+};
+} // namespace VulkanCore
+
+void setEnvironment(const char* name, const std::string& value) {
+#if defined(_WIN32)
+  _putenv_s(name, value.c_str());
+#else
+  setenv(name, value.c_str(), 1);
+#endif
+}
+
+// Every step rehashes each value with the step number, so the final state depends on every step running exactly once
+// and in order.
+constexpr std::string_view kStepShader = R"(
+#version 460
+
+layout(local_size_x = 256) in;
+
+layout(set = 0, binding = 0) buffer State {
+  uint values[];
+};
+
+layout(push_constant) uniform PushConstants {
+  uint step;
+  uint count;
+} pushConstants;
+
+void main() {
+  const uint index = gl_GlobalInvocationID.x;
+  if (index >= pushConstants.count)
+    return;
+
+  uint x = values[index] ^ pushConstants.step;
+  x ^= x >> 16;
+  x *= 0x7feb352du;
+  x ^= x >> 15;
+  x *= 0x846ca68bu;
+  x ^= x >> 16;
+  values[index] = x;
+}
+)";
+
+constexpr uint32_t kWorkgroupSize = 256;
+
+struct StepParameters {
+  uint32_t step = 0;
+  uint32_t count = 0;
+};
+
+uint32_t stepValue(uint32_t value, uint32_t step) {
+  auto x = value ^ step;
+  x ^= x >> 16;
+  x *= 0x7feb352du;
+  x ^= x >> 15;
+  x *= 0x846ca68bu;
+  x ^= x >> 16;
+  return x;
+}
+
+uint32_t parseArgument(std::span<char*> arguments, std::string_view name, uint32_t defaultValue) {
+  for (size_t index = 1; index + 1 < arguments.size(); ++index) {
+    if (std::string_view{arguments[index]} == name) {
+      const std::string_view value{arguments[index + 1]};
+      std::from_chars(value.data(), value.data() + value.size(), defaultValue);
+    }
+  }
+  return defaultValue;
+}
+
+bool hasArgument(std::span<char*> arguments, std::string_view name) {
+  return ranges::any_of(arguments | views::drop(1), [name](const char* argument) { return argument == name; });
+}
+
+// Runs --steps compute steps over --elements values, one submission per step, and checkpoints the values every
+// --checkpoint steps. When the device is lost it is rebuilt in place and the run resumes from the last checkpoint,
+// --recovery-timeout-ms bounds each rebuild.
+// --mock runs on the mock driver of recipe 01_16, which loses the device every --lost-after submissions and takes
+// --compile-us to compile a pipeline that is not in the pipeline cache. The mock does not run shaders, so the values
+// are only compared against the CPU on a real device; on the mock the run checks the number of recoveries, their
+// time and that the rebuilt pipelines came from the cache instead.
+int main(int argc, char* argv[]) {
+  const std::string applicationName = "01-17 Device recovery";
+  const auto arguments = std::span{argv, static_cast<size_t>(argc)};
+  const auto elementCount = std::max(1u, parseArgument(arguments, "--elements", 1u << 20));
+  const auto steps = parseArgument(arguments, "--steps", 200);
+  auto checkpointInterval = std::max(1u, parseArgument(arguments, "--checkpoint", 10));
+  const auto recoveryTimeout = std::chrono::milliseconds{parseArgument(arguments, "--recovery-timeout-ms", 2000)};
+  const auto useMock = hasArgument(arguments, "--mock");
+  const auto lostAfter = parseArgument(arguments, "--lost-after", 25);
+  const auto compileTime = std::chrono::microseconds{parseArgument(arguments, "--compile-us", 50000)};
+
+  if (useMock) {
+    const auto manifest = std::filesystem::absolute(arguments[0]).parent_path() / "mock_icd.json";
+    setEnvironment("VK_DRIVER_FILES", manifest.string());
+    setEnvironment("VK_ICD_FILENAMES", manifest.string());
+    setEnvironment("VK_MOCK_DEVICE_LOST_AFTER", std::to_string(lostAfter));
+    setEnvironment("VK_MOCK_PIPELINE_COMPILE_US", std::to_string(compileTime.count()));
+  }
+
+  auto vulkanContext = VulkanCore::Context::create(
+      applicationName, useMock ? std::vector<std::string>{} : getRequestedInstanceLayers(),
+      getRequestedInstanceExtensions());
+
+  if (!vulkanContext) {
+    std::println("Unable to create the context: {}", vulkanContext.error());
+    return EXIT_FAILURE;
+  }
+
+  VulkanCore::ShaderCompiler compiler;
+  const auto spirv = compiler.compileCompute(kStepShader);
+  if (!spirv) {
+    std::println("Unable to compile the shader: {}", spirv.error());
+    return EXIT_FAILURE;
+  }
+
+  auto device = VulkanCore::RecoverableDevice::create(vulkanContext.value(), VK_QUEUE_COMPUTE_BIT,
+                                                      VulkanCore::RecoveryPolicy{.timeout = recoveryTimeout});
+  if (!device) {
+    std::println("Unable to create the device: {}", device.error());
+    return EXIT_FAILURE;
+  }
+  std::println("Running on {}", device->getPhysicalDevice().getProperties().deviceName);
+
+  std::vector<uint32_t> initialValues(elementCount);
+  std::iota(std::begin(initialValues), std::end(initialValues), 0u);
+  const auto initialBytes = std::as_bytes(std::span{initialValues});
+
+  const auto stateBuffer = device->addBuffer(VulkanCore::BufferDescription{
+      .name = "state",
+      .usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+      .contents = std::vector<std::byte>(std::begin(initialBytes), std::end(initialBytes))});
+  if (!stateBuffer) {
+    std::println("Unable to create the state buffer: {}", stateBuffer.error());
+    return EXIT_FAILURE;
+  }
+  const auto state = stateBuffer.value();
+
+  const auto stepPipeline = device->addComputePipeline(VulkanCore::ComputePipelineDescription{
+      .name = "step", .spirv = spirv.value(), .buffers = {state}, .pushConstantSize = sizeof(StepParameters)});
+  if (!stepPipeline) {
+    std::println("Unable to create the step pipeline: {}", stepPipeline.error());
+    return EXIT_FAILURE;
+  }
+  const auto pipeline = stepPipeline.value();
+
+  const auto start = std::chrono::steady_clock::now();
+  uint32_t submissions = 0;
+  uint32_t lostSteps = 0;
+  uint32_t checkpointStep = 0;
+  for (uint32_t step = 0; step < steps;) {
+    const StepParameters parameters{.step = step, .count = elementCount};
+    const auto status = device->submit([&](VkCommandBuffer commandBuffer) {
+      device->dispatch(commandBuffer, pipeline, std::as_bytes(std::span{&parameters, 1}),
+                       (elementCount + kWorkgroupSize - 1) / kWorkgroupSize);
+      VulkanCore::bufferBarrier(commandBuffer, device->getBuffer(state), VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                                VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT, VK_PIPELINE_STAGE_2_HOST_BIT,
+                                VK_ACCESS_2_HOST_READ_BIT);
+    });
+    ++submissions;
+
+    if (!status) {
+      std::println("{}", status.error());
+      return EXIT_FAILURE;
+    }
+
+    if (status.value() == VulkanCore::SubmitStatus::Recovered) {
+      const auto& statistics = device->statistics();
+      std::println("Device lost at step {}, rebuilt in {:.1f} ms (pipelines {:.1f} ms), resuming at step {}", step,
+                   statistics.lastRecovery.count(), statistics.lastPipelineTime.count(), checkpointStep);
+      lostSteps += step - checkpointStep;
+      step = checkpointStep;
+      // Checkpoint more often while the device keeps getting lost, so every device gets some work done.
+      checkpointInterval = std::max(1u, checkpointInterval / 2);
+      continue;
+    }
+
+    ++step;
+    if (step - checkpointStep >= checkpointInterval || step == steps) {
+      device->checkpoint(state);
+      checkpointStep = step;
+    }
+  }
+  const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  const auto& statistics = device->statistics();
+  std::println("{} steps in {} submissions and {:.3f}s, {} steps redone after {} recoveries", steps, submissions,
+               elapsed, lostSteps, statistics.recoveries);
+  std::println("Initial pipeline build {:.1f} ms, longest recovery {:.1f} ms of the {} ms allowed",
+               statistics.initialPipelineTime.count(), statistics.longestRecovery.count(), recoveryTimeout.count());
+
+  if (useMock) {
+    // Every mock device accepts lostAfter submissions and fails the next one, so the number of recoveries follows
+    // from the submissions. A rebuild that compiled again instead of hitting the cache of the lost device would take
+    // the whole compile time, the initial build always does.
+    const auto expectedRecoveries = lostAfter == 0 ? 0u : submissions / (lostAfter + 1);
+    const auto recoveriesMatch = statistics.recoveries == expectedRecoveries;
+    const auto withinTimeout = statistics.longestRecovery <= recoveryTimeout;
+    const auto cacheHit = statistics.recoveries == 0 || compileTime.count() == 0 ||
+                          statistics.lastPipelineTime < statistics.initialPipelineTime / 2;
+    if (!recoveriesMatch)
+      std::println("Expected {} recoveries, got {}", expectedRecoveries, statistics.recoveries);
+    if (!withinTimeout)
+      std::println("The longest recovery took longer than the {} ms allowed", recoveryTimeout.count());
+    if (!cacheHit)
+      std::println("Rebuilding the pipelines took {:.1f} ms, the pipeline cache was not reused",
+                   statistics.lastPipelineTime.count());
+    std::println("The mock driver does not run shaders, the values were not compared");
+    return recoveriesMatch && withinTimeout && cacheHit ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+
+  const auto values = device->map(state);
+  uint32_t mismatches = 0;
+  for (uint32_t index = 0; index < elementCount; ++index) {
+    auto expected = initialValues[index];
+    for (uint32_t step = 0; step < steps; ++step)
+      expected = stepValue(expected, step);
+
+    uint32_t value = 0;
+    std::memcpy(&value, values.data() + index * sizeof(uint32_t), sizeof(value));
+    if (value != expected && mismatches++ < 8)
+      std::println("Mismatch at {}: {:#010x} instead of {:#010x}", index, value, expected);
+  }
+  std::println("{} of {} values verified", elementCount - mismatches, elementCount);
+
+  return mismatches == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,2040 @@
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <expected>
+#include <format>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <numeric>
+#include <optional>
+#include <print>
+#include <ranges>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <glslang/Public/ResourceLimits.h>
+#include <glslang/Public/ShaderLang.h>
+#include <glslang/SPIRV/GlslangToSpv.h>
+
+namespace ranges = std::ranges;
+namespace views = std::ranges::views;
+
+#define VK_CALL(vFun)                                                                                                  \
+  {                                                                                                                    \
+    const auto res = vFun;                                                                                             \
+    if (res != VK_SUCCESS) {                                                                                           \
+      std::println(#vFun " failed with error {}", static_cast<int>(res));                                              \
+      std::exit(res);                                                                                                  \
+    }                                                                                                                  \
+  }
+
+auto getRequestedInstanceLayers() -> std::vector<std::string> {
+  return std::vector<std::string>{"VK_LAYER_KHRONOS_validation"};
+}
+
+auto getRequestedInstanceExtensions() -> std::vector<std::string> {
+  return std::vector<std::string>{
+#if defined(VK_USE_PLATFORM_METAL_EXT)
+      VK_KHR_PORTABILITY_ENUMERATION_EXTENSION_NAME,
+#endif
+#if defined(VK_EXT_debug_utils)
+      VK_EXT_DEBUG_UTILS_EXTENSION_NAME,
+#endif
+  };
+}
+
+namespace VulkanCore {
+std::vector<VkLayerProperties> enumerateInstanceLayerProperties() {
+  uint32_t layersCount{0};
+  vkEnumerateInstanceLayerProperties(&layersCount, nullptr);
+
+  std::vector<VkLayerProperties> layersProperties(layersCount);
+  vkEnumerateInstanceLayerProperties(&layersCount, layersProperties.data());
+
+  return layersProperties;
+}
+
+std::vector<VkExtensionProperties> enumerateExtensionsProperties() {
+  uint32_t extensionsCount{0};
+  vkEnumerateInstanceExtensionProperties(nullptr, &extensionsCount, nullptr);
+
+  std::vector<VkExtensionProperties> extensionsProperties(extensionsCount);
+  vkEnumerateInstanceExtensionProperties(nullptr, &extensionsCount, extensionsProperties.data());
+
+  return extensionsProperties;
+}
+
+std::vector<VkExtensionProperties> enumerateDeviceExtensionsProperties(VkPhysicalDevice device) {
+  uint32_t extensionsCount{0};
+  vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionsCount, nullptr);
+
+  std::vector<VkExtensionProperties> extensionsProperties(extensionsCount);
+  vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionsCount, extensionsProperties.data());
+
+  return extensionsProperties;
+}
+
+std::vector<VkPhysicalDevice> enumeratePhysicalDevices(VkInstance instance) {
+  uint32_t physicalDevicesCount{0};
+  vkEnumeratePhysicalDevices(instance, &physicalDevicesCount, nullptr);
+
+  std::vector<VkPhysicalDevice> physicalDevices(physicalDevicesCount);
+  vkEnumeratePhysicalDevices(instance, &physicalDevicesCount, physicalDevices.data());
+
+  return physicalDevices;
+}
+
+std::vector<VkQueueFamilyProperties> enumeratePhysicalDevicesQueueFamilyProperties(VkPhysicalDevice device) {
+  uint32_t physicalDeviceQueueFamilyPropertiesCount{0};
+  vkGetPhysicalDeviceQueueFamilyProperties(device, &physicalDeviceQueueFamilyPropertiesCount, nullptr);
+
+  std::vector<VkQueueFamilyProperties> queueFamiliesProperties(physicalDeviceQueueFamilyPropertiesCount);
+  vkGetPhysicalDeviceQueueFamilyProperties(device, &physicalDeviceQueueFamilyPropertiesCount,
+                                           queueFamiliesProperties.data());
+
+  return queueFamiliesProperties;
+}
+
+class PhysicalDevice {
+public:
+  explicit PhysicalDevice(VkPhysicalDevice device)
+      : m_device{device}, m_extensions{enumerateDeviceExtensionsProperties(device)},
+        m_queueFamilies{enumeratePhysicalDevicesQueueFamilyProperties(device)} {
+    vkGetPhysicalDeviceProperties(m_device, &m_properties);
+    vkGetPhysicalDeviceMemoryProperties(m_device, &m_memoryProperties);
+    vkGetPhysicalDeviceFeatures(m_device, &m_features);
+  }
+
+  [[nodiscard]] inline VkPhysicalDevice getPhysicalDevice() const noexcept { return m_device; }
+
+  [[nodiscard]] inline const VkPhysicalDeviceProperties& getProperties() const noexcept { return m_properties; }
+
+  [[nodiscard]] inline const VkPhysicalDeviceMemoryProperties& getMemoryProperties() const noexcept {
+    return m_memoryProperties;
+  }
+
+  [[nodiscard]] inline const VkPhysicalDeviceFeatures& getFeatures() const noexcept { return m_features; }
+
+  [[nodiscard]] bool isExtensionSupported(std::string_view name) const {
+    return ranges::any_of(m_extensions,
+                          [name](const VkExtensionProperties& prop) { return name == prop.extensionName; });
+  }
+
+  [[nodiscard]] std::optional<uint32_t> findQueueFamily(VkQueueFlags flags) const {
+    const auto it = ranges::find_if(m_queueFamilies, [flags](const VkQueueFamilyProperties& family) {
+      return (family.queueFlags & flags) == flags;
+    });
+    if (it == std::end(m_queueFamilies))
+      return std::nullopt;
+
+    return static_cast<uint32_t>(std::distance(std::begin(m_queueFamilies), it));
+  }
+
+  [[nodiscard]] bool isFormatSupported(VkFormat format, VkFormatFeatureFlags features) const {
+    VkFormatProperties properties;
+    vkGetPhysicalDeviceFormatProperties(m_device, format, &properties);
+    return (properties.optimalTilingFeatures & features) == features;
+  }
+
+  [[nodiscard]] VkDeviceSize getDeviceLocalMemorySize() const {
+    const auto heaps = std::span{m_memoryProperties.memoryHeaps, m_memoryProperties.memoryHeapCount};
+    VkDeviceSize size = 0;
+    for (const auto& heap : heaps) {
+      if (heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)
+        size += heap.size;
+    }
+    return size;
+  }
+
+private:
+  VkPhysicalDevice m_device;
+  std::vector<VkExtensionProperties> m_extensions;
+  std::vector<VkQueueFamilyProperties> m_queueFamilies;
+  VkPhysicalDeviceProperties m_properties{};
+  VkPhysicalDeviceMemoryProperties m_memoryProperties{};
+  VkPhysicalDeviceFeatures m_features{};
+};
+
+// Discrete before integrated before virtual before CPU devices, then the one with the most device local memory.
+uint64_t scorePhysicalDevice(const PhysicalDevice& physicalDevice) {
+  uint64_t typeScore = 0;
+  switch (physicalDevice.getProperties().deviceType) {
+  case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+    typeScore = 4;
+    break;
+  case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+    typeScore = 3;
+    break;
+  case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+    typeScore = 2;
+    break;
+  case VK_PHYSICAL_DEVICE_TYPE_CPU:
+    typeScore = 1;
+    break;
+  default:
+    break;
+  }
+  return (typeScore << 48) + (physicalDevice.getDeviceLocalMemorySize() >> 20);
+}
+
+// The best scoring device with a queue family supporting all of queueFlags, the first one on a tie.
+std::optional<size_t> selectPhysicalDevice(std::span<const PhysicalDevice> physicalDevices, VkQueueFlags queueFlags) {
+  std::optional<size_t> selected;
+  uint64_t selectedScore = 0;
+  for (size_t index = 0; index < physicalDevices.size(); ++index) {
+    if (!physicalDevices[index].findQueueFamily(queueFlags).has_value())
+      continue;
+
+    const auto score = scorePhysicalDevice(physicalDevices[index]);
+    if (!selected.has_value() || score > selectedScore) {
+      selected = index;
+      selectedScore = score;
+    }
+  }
+  return selected;
+}
+
+void bufferBarrier(VkCommandBuffer commandBuffer, VkBuffer buffer, VkPipelineStageFlags2 srcStage,
+                   VkAccessFlags2 srcAccess, VkPipelineStageFlags2 dstStage, VkAccessFlags2 dstAccess) {
+  const VkBufferMemoryBarrier2 barrier{.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2,
+                                       .srcStageMask = srcStage,
+                                       .srcAccessMask = srcAccess,
+                                       .dstStageMask = dstStage,
+                                       .dstAccessMask = dstAccess,
+                                       .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                                       .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                                       .buffer = buffer,
+                                       .size = VK_WHOLE_SIZE};
+  const VkDependencyInfo dependency{.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+                                    .bufferMemoryBarrierCount = 1,
+                                    .pBufferMemoryBarriers = &barrier};
+  vkCmdPipelineBarrier2(commandBuffer, &dependency);
+}
+
+void imageBarrier(VkCommandBuffer commandBuffer, VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout,
+                  VkPipelineStageFlags2 srcStage, VkAccessFlags2 srcAccess, VkPipelineStageFlags2 dstStage,
+                  VkAccessFlags2 dstAccess) {
+  const VkImageMemoryBarrier2 barrier{.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+                                      .srcStageMask = srcStage,
+                                      .srcAccessMask = srcAccess,
+                                      .dstStageMask = dstStage,
+                                      .dstAccessMask = dstAccess,
+                                      .oldLayout = oldLayout,
+                                      .newLayout = newLayout,
+                                      .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                                      .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                                      .image = image,
+                                      .subresourceRange = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                                                           .levelCount = VK_REMAINING_MIP_LEVELS,
+                                                           .layerCount = 1}};
+  const VkDependencyInfo dependency{.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+                                    .imageMemoryBarrierCount = 1,
+                                    .pImageMemoryBarriers = &barrier};
+  vkCmdPipelineBarrier2(commandBuffer, &dependency);
+}
+
+struct BufferAllocation {
+  VkBuffer buffer = VK_NULL_HANDLE;
+  VkDeviceMemory memory = VK_NULL_HANDLE;
+  VkDeviceSize size = 0;
+  // Persistently mapped when the memory is host visible.
+  void* mapped = nullptr;
+};
+
+struct ImageAllocation {
+  VkImage image = VK_NULL_HANDLE;
+  VkDeviceMemory memory = VK_NULL_HANDLE;
+  VkExtent2D extent{};
+  VkFormat format = VK_FORMAT_UNDEFINED;
+  uint32_t mipLevels = 1;
+};
+
+// Logical device with a single compute queue, which can also copy. Block compressed formats are enabled whenever the
+// device has them, the caller checks isTextureCompressionBcEnabled before creating such images.
+class Device {
+public:
+  static std::expected<Device, std::string> create(const PhysicalDevice& physicalDevice, uint32_t queueFamilyIndex) {
+    Device device{physicalDevice, queueFamilyIndex};
+
+    if (device.init())
+      return device;
+    else
+      return std::unexpected(std::string{"Failed to create the vulkan device"});
+  }
+
+  ~Device() {
+    if (m_device == VK_NULL_HANDLE)
+      return;
+
+    vkDeviceWaitIdle(m_device);
+    vkDestroyFence(m_device, m_fence, nullptr);
+    vkDestroySemaphore(m_device, m_timeline, nullptr);
+    vkDestroyCommandPool(m_device, m_commandPool, nullptr);
+    vkDestroyDevice(m_device, nullptr);
+    m_device = VK_NULL_HANDLE;
+  }
+
+  Device& operator=(const Device&) = delete;
+
+  Device(const Device&) = delete;
+
+  Device(Device&& rhs) noexcept {
+    swap(rhs);
+    rhs.m_device = VK_NULL_HANDLE;
+  }
+
+  Device& operator=(Device&& rhs) noexcept {
+    Device tmp{std::move(rhs)};
+    swap(tmp);
+    return *this;
+  }
+
+  [[nodiscard]] inline VkDevice getDevice() const noexcept { return m_device; }
+
+  [[nodiscard]] inline bool isTextureCompressionBcEnabled() const noexcept { return m_textureCompressionBc; }
+
+  [[nodiscard]] std::optional<uint32_t> findMemoryType(uint32_t typeBits, VkMemoryPropertyFlags required) const {
+    for (uint32_t index = 0; index < m_memoryProperties.memoryTypeCount; ++index) {
+      const auto flags = m_memoryProperties.memoryTypes[index].propertyFlags;
+      if ((typeBits & (1u << index)) && (flags & required) == required)
+        return index;
+    }
+    return std::nullopt;
+  }
+
+  BufferAllocation createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties) {
+    const VkBufferCreateInfo bufferInfo{.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+                                        .size = size,
+                                        .usage = usage,
+                                        .sharingMode = VK_SHARING_MODE_EXCLUSIVE};
+    BufferAllocation allocation{.size = size};
+    VK_CALL(vkCreateBuffer(m_device, &bufferInfo, nullptr, &allocation.buffer));
+
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements(m_device, allocation.buffer, &requirements);
+
+    const auto memoryTypeIndex = findMemoryType(requirements.memoryTypeBits, properties);
+    if (!memoryTypeIndex.has_value()) {
+      std::println("No memory type for a buffer of {} bytes", size);
+      std::exit(EXIT_FAILURE);
+    }
+
+    const VkMemoryAllocateInfo allocateInfo{.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+                                            .allocationSize = requirements.size,
+                                            .memoryTypeIndex = memoryTypeIndex.value()};
+    VK_CALL(vkAllocateMemory(m_device, &allocateInfo, nullptr, &allocation.memory));
+    VK_CALL(vkBindBufferMemory(m_device, allocation.buffer, allocation.memory, 0));
+
+    if (properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+      VK_CALL(vkMapMemory(m_device, allocation.memory, 0, VK_WHOLE_SIZE, 0, &allocation.mapped));
+    return allocation;
+  }
+
+  void destroyBuffer(BufferAllocation& allocation) {
+    vkDestroyBuffer(m_device, allocation.buffer, nullptr);
+    vkFreeMemory(m_device, allocation.memory, nullptr);
+    allocation = BufferAllocation{};
+  }
+
+  ImageAllocation createImage(VkExtent2D extent, VkFormat format, VkImageUsageFlags usage, uint32_t mipLevels) {
+    const VkImageCreateInfo imageInfo{.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+                                      .imageType = VK_IMAGE_TYPE_2D,
+                                      .format = format,
+                                      .extent = {extent.width, extent.height, 1},
+                                      .mipLevels = mipLevels,
+                                      .arrayLayers = 1,
+                                      .samples = VK_SAMPLE_COUNT_1_BIT,
+                                      .tiling = VK_IMAGE_TILING_OPTIMAL,
+                                      .usage = usage,
+                                      .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+                                      .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED};
+    ImageAllocation allocation{.extent = extent, .format = format, .mipLevels = mipLevels};
+    VK_CALL(vkCreateImage(m_device, &imageInfo, nullptr, &allocation.image));
+
+    VkMemoryRequirements requirements;
+    vkGetImageMemoryRequirements(m_device, allocation.image, &requirements);
+
+    const auto memoryTypeIndex = findMemoryType(requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    if (!memoryTypeIndex.has_value()) {
+      std::println("No memory type for a {}x{} image", extent.width, extent.height);
+      std::exit(EXIT_FAILURE);
+    }
+
+    const VkMemoryAllocateInfo allocateInfo{.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+                                            .allocationSize = requirements.size,
+                                            .memoryTypeIndex = memoryTypeIndex.value()};
+    VK_CALL(vkAllocateMemory(m_device, &allocateInfo, nullptr, &allocation.memory));
+    VK_CALL(vkBindImageMemory(m_device, allocation.image, allocation.memory, 0));
+    return allocation;
+  }
+
+  void destroyImage(ImageAllocation& allocation) {
+    vkDestroyImage(m_device, allocation.image, nullptr);
+    vkFreeMemory(m_device, allocation.memory, nullptr);
+    allocation = ImageAllocation{};
+  }
+
+  VkCommandBuffer allocateCommandBuffer() {
+    const VkCommandBufferAllocateInfo commandBufferInfo{.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+                                                        .commandPool = m_commandPool,
+                                                        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+                                                        .commandBufferCount = 1};
+    VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+    VK_CALL(vkAllocateCommandBuffers(m_device, &commandBufferInfo, &commandBuffer));
+    return commandBuffer;
+  }
+
+  template <typename Recorder>
+  void immediateSubmit(Recorder&& record) {
+    const auto commandBuffer = allocateCommandBuffer();
+
+    const VkCommandBufferBeginInfo beginInfo{.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+                                             .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT};
+    VK_CALL(vkBeginCommandBuffer(commandBuffer, &beginInfo));
+    record(commandBuffer);
+    VK_CALL(vkEndCommandBuffer(commandBuffer));
+
+    const VkSubmitInfo submitInfo{.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+                                  .commandBufferCount = 1,
+                                  .pCommandBuffers = &commandBuffer};
+    VK_CALL(vkQueueSubmit(m_queue, 1, &submitInfo, m_fence));
+    VK_CALL(vkWaitForFences(m_device, 1, &m_fence, VK_TRUE, UINT64_MAX));
+    VK_CALL(vkResetFences(m_device, 1, &m_fence));
+    vkFreeCommandBuffers(m_device, m_commandPool, 1, &commandBuffer);
+  }
+
+  // Returns the timeline value that is signaled once the command buffer has completed.
+  uint64_t submit(VkCommandBuffer commandBuffer) {
+    const auto signalValue = ++m_timelineValue;
+
+    const VkCommandBufferSubmitInfo commandBufferInfo{.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO,
+                                                      .commandBuffer = commandBuffer};
+    const VkSemaphoreSubmitInfo signalInfo{.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+                                           .semaphore = m_timeline,
+                                           .value = signalValue,
+                                           .stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT};
+    const VkSubmitInfo2 submitInfo{.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2,
+                                   .commandBufferInfoCount = 1,
+                                   .pCommandBufferInfos = &commandBufferInfo,
+                                   .signalSemaphoreInfoCount = 1,
+                                   .pSignalSemaphoreInfos = &signalInfo};
+    VK_CALL(vkQueueSubmit2(m_queue, 1, &submitInfo, VK_NULL_HANDLE));
+    return signalValue;
+  }
+
+  [[nodiscard]] uint64_t getCompletedTimelineValue() const {
+    uint64_t value = 0;
+    VK_CALL(vkGetSemaphoreCounterValue(m_device, m_timeline, &value));
+    return value;
+  }
+
+  void waitTimeline(uint64_t value) const {
+    const VkSemaphoreWaitInfo waitInfo{.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+                                       .semaphoreCount = 1,
+                                       .pSemaphores = &m_timeline,
+                                       .pValues = &value};
+    VK_CALL(vkWaitSemaphores(m_device, &waitInfo, UINT64_MAX));
+  }
+
+private:
+  Device(const PhysicalDevice& physicalDevice, uint32_t queueFamilyIndex)
+      : m_physicalDevice{physicalDevice.getPhysicalDevice()},
+        m_memoryProperties{physicalDevice.getMemoryProperties()}, m_queueFamilyIndex{queueFamilyIndex},
+        m_textureCompressionBc{physicalDevice.getFeatures().textureCompressionBC == VK_TRUE} {}
+
+  bool init() {
+    VkPhysicalDeviceVulkan13Features features13{.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES,
+                                                .synchronization2 = VK_TRUE};
+    VkPhysicalDeviceVulkan12Features features12{.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
+                                                .pNext = &features13,
+                                                .timelineSemaphore = VK_TRUE};
+    const VkPhysicalDeviceFeatures2 features{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+        .pNext = &features12,
+        .features = {.textureCompressionBC = m_textureCompressionBc ? VK_TRUE : VK_FALSE}};
+
+    const float queuePriority = 1.0f;
+    const VkDeviceQueueCreateInfo queueInfo{.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
+                                            .queueFamilyIndex = m_queueFamilyIndex,
+                                            .queueCount = 1,
+                                            .pQueuePriorities = &queuePriority};
+
+    const VkDeviceCreateInfo deviceInfo{.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
+                                        .pNext = &features,
+                                        .queueCreateInfoCount = 1,
+                                        .pQueueCreateInfos = &queueInfo};
+
+    if (vkCreateDevice(m_physicalDevice, &deviceInfo, nullptr, &m_device) != VK_SUCCESS)
+      return false;
+
+    vkGetDeviceQueue(m_device, m_queueFamilyIndex, 0, &m_queue);
+
+    const VkCommandPoolCreateInfo poolInfo{.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+                                           .flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+                                           .queueFamilyIndex = m_queueFamilyIndex};
+    VK_CALL(vkCreateCommandPool(m_device, &poolInfo, nullptr, &m_commandPool));
+
+    const VkFenceCreateInfo fenceInfo{.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
+    VK_CALL(vkCreateFence(m_device, &fenceInfo, nullptr, &m_fence));
+
+    const VkSemaphoreTypeCreateInfo timelineInfo{.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+                                                 .semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+                                                 .initialValue = 0};
+    const VkSemaphoreCreateInfo semaphoreInfo{.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+                                              .pNext = &timelineInfo};
+    VK_CALL(vkCreateSemaphore(m_device, &semaphoreInfo, nullptr, &m_timeline));
+
+    return true;
+  }
+
+  void swap(Device& rhs) {
+    std::swap(m_physicalDevice, rhs.m_physicalDevice);
+    std::swap(m_memoryProperties, rhs.m_memoryProperties);
+    std::swap(m_queueFamilyIndex, rhs.m_queueFamilyIndex);
+    std::swap(m_textureCompressionBc, rhs.m_textureCompressionBc);
+    std::swap(m_device, rhs.m_device);
+    std::swap(m_queue, rhs.m_queue);
+    std::swap(m_commandPool, rhs.m_commandPool);
+    std::swap(m_fence, rhs.m_fence);
+    std::swap(m_timeline, rhs.m_timeline);
+    std::swap(m_timelineValue, rhs.m_timelineValue);
+  }
+
+private:
+  VkPhysicalDevice m_physicalDevice = VK_NULL_HANDLE;
+  VkPhysicalDeviceMemoryProperties m_memoryProperties{};
+  uint32_t m_queueFamilyIndex = 0;
+  bool m_textureCompressionBc = false;
+  VkDevice m_device = VK_NULL_HANDLE;
+  VkQueue m_queue = VK_NULL_HANDLE;
+  VkCommandPool m_commandPool = VK_NULL_HANDLE;
+  VkFence m_fence = VK_NULL_HANDLE;
+  VkSemaphore m_timeline = VK_NULL_HANDLE;
+  uint64_t m_timelineValue = 0;
+};
+
+class ShaderCompiler {
+public:
+  ShaderCompiler() { glslang::InitializeProcess(); }
+
+  ShaderCompiler(const ShaderCompiler&) = delete;
+  ShaderCompiler& operator=(const ShaderCompiler&) = delete;
+
+  ~ShaderCompiler() { glslang::FinalizeProcess(); }
+
+  std::expected<std::vector<uint32_t>, std::string> compileCompute(std::string_view source) const {
+    glslang::TShader shader{EShLangCompute};
+    const char* sources[] = {source.data()};
+    const int lengths[] = {static_cast<int>(source.size())};
+    shader.setStringsWithLengths(sources, lengths, 1);
+    shader.setEnvInput(glslang::EShSourceGlsl, EShLangCompute, glslang::EShClientVulkan, 100);
+    shader.setEnvClient(glslang::EShClientVulkan, glslang::EShTargetVulkan_1_3);
+    shader.setEnvTarget(glslang::EShTargetSpv, glslang::EShTargetSpv_1_6);
+
+    const auto messages = static_cast<EShMessages>(EShMsgSpvRules | EShMsgVulkanRules);
+    if (!shader.parse(GetDefaultResources(), 460, false, messages))
+      return std::unexpected(std::string{shader.getInfoLog()});
+
+    glslang::TProgram program;
+    program.addShader(&shader);
+    if (!program.link(messages))
+      return std::unexpected(std::string{program.getInfoLog()});
+
+    std::vector<uint32_t> spirv;
+    glslang::GlslangToSpv(*program.getIntermediate(EShLangCompute), spirv);
+    return spirv;
+  }
+};
+
+class Context {
+public:
+  static std::expected<Context, std::string> create(std::string_view applicationName,
+                                                    std::vector<std::string> requestedInstanceLayer,
+                                                    std::vector<std::string> requestedInstanceExtensions) {
+
+    Context context{applicationName, std::move(requestedInstanceLayer), std::move(requestedInstanceExtensions)};
+
+    if (context.init())
+      return context;
+    else
+      return std::unexpected(std::string{"Failed to init the vulkan context"});
+  }
+
+  ~Context() {
+    if (m_vulkanInstance == VK_NULL_HANDLE)
+      return;
+
+    vkDestroyInstance(m_vulkanInstance, nullptr);
+    m_vulkanInstance = VK_NULL_HANDLE;
+  }
+
+  Context& operator=(const Context&) = delete;
+
+  Context(const Context&) = delete;
+
+  Context(Context&& rhs) noexcept {
+    swap(rhs);
+    rhs.m_vulkanInstance = VK_NULL_HANDLE;
+  }
+
+  Context& operator=(Context&& rhs) noexcept {
+    Context tmp{std::move(rhs)};
+    swap(tmp);
+    return *this;
+  }
+
+  std::vector<PhysicalDevice> enumeratePhysicalDevices() {
+    // clang-format off
+    auto result = VulkanCore::enumeratePhysicalDevices(m_vulkanInstance)
+      | views::transform([](VkPhysicalDevice device) -> PhysicalDevice {
+         return PhysicalDevice{device};
+        })
+      | ranges::to<std::vector<PhysicalDevice>>();
+    // clang-format on
+    return result;
+  }
+
+private:
+  Context(std::string_view applicationName, std::vector<std::string> requestedInstanceLayer,
+          std::vector<std::string> requestedInstanceExtensions)
+      : m_applicationName{applicationName} {
+    auto allInstanceLayers = enumerateInstanceLayerProperties();
+    const auto isInstanceLayerRequired = [&requestedInstanceLayer](const VkLayerProperties& prop) {
+      auto name = std::string{prop.layerName};
+      return ranges::find(requestedInstanceLayer, name) != std::end(requestedInstanceLayer);
+    };
+    // clang-format off
+    m_layerProperties = allInstanceLayers
+      | views::filter(isInstanceLayerRequired)
+      | ranges::to<std::vector<VkLayerProperties>>();
+    // clang-format on
+
+    auto allExtensions = enumerateExtensionsProperties();
+    const auto isExtensionRequired = [&requestedInstanceExtensions](const VkExtensionProperties& prop) {
+      auto name = std::string{prop.extensionName};
+      return ranges::find(requestedInstanceExtensions, name) != std::end(requestedInstanceExtensions);
+    };
+    // clang-format off
+    m_layerExtensions = allExtensions
+      | views::filter(isExtensionRequired)
+      | ranges::to<std::vector<VkExtensionProperties>>();
+    // clang-format on
+  }
+
+  bool init() {
+    // clang-format off
+    auto layers = m_layerProperties
+      | views::transform([](const VkLayerProperties& prop) -> const char*
+        {
+          return prop.layerName;
+        })
+      | ranges::to<std::vector<const char*>>();
+
+      auto extensions = m_layerExtensions
+        | views::transform([](const VkExtensionProperties & prop) -> const char*
+          {
+            return prop.extensionName;
+          })
+        | ranges::to<std::vector<const char*>>();
+    // clang-format on
+
+    const VkApplicationInfo applicationInfo{.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO,
+                                            .pApplicationName = m_applicationName.data(),
+                                            .applicationVersion = VK_MAKE_VERSION(1, 0, 0),
+                                            .apiVersion = VK_API_VERSION_1_3};
+
+    const VkInstanceCreateInfo instanceCreateInfo{.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO,
+#if defined(VK_USE_PLATFORM_METAL_EXT)
+                                                  .flags = VK_INSTANCE_CREATE_ENUMERATE_PORTABILITY_BIT_KHR,
+#endif
+                                                  .pApplicationInfo = &applicationInfo,
+                                                  .enabledLayerCount = static_cast<uint32_t>(layers.size()),
+                                                  .ppEnabledLayerNames = layers.data(),
+                                                  .enabledExtensionCount = static_cast<uint32_t>(extensions.size()),
+                                                  .ppEnabledExtensionNames = extensions.data()};
+
+    const auto res = vkCreateInstance(&instanceCreateInfo, nullptr, &m_vulkanInstance);
+    return res == VK_SUCCESS;
+  }
+
+  void swap(Context& rhs) {
+    std::swap(m_applicationName, rhs.m_applicationName);
+    std::swap(m_layerProperties, rhs.m_layerProperties);
+    std::swap(m_layerExtensions, rhs.m_layerExtensions);
+    std::swap(m_vulkanInstance, rhs.m_vulkanInstance);
+  }
+
+private:
+  std::string m_applicationName;
+  std::vector<VkLayerProperties> m_layerProperties;
+  std::vector<VkExtensionProperties> m_layerExtensions;
+  VkInstance m_vulkanInstance = VK_NULL_HANDLE;
+};
+
+// Texels are RGBA8 with red in the lowest byte, the memory layout of VK_FORMAT_R8G8B8A8_SRGB. Color is sRGB encoded,
+// alpha is linear.
+struct RgbaImage {
+  uint32_t width = 0;
+  uint32_t height = 0;
+  std::vector<uint32_t> texels;
+};
+
+uint32_t getMipLevelCount(uint32_t width, uint32_t height) {
+  return static_cast<uint32_t>(std::bit_width(std::max(width, height)));
+}
+
+VkExtent2D getMipExtent(VkExtent2D extent, uint32_t level) {
+  return VkExtent2D{std::max(1u, extent.width >> level), std::max(1u, extent.height >> level)};
+}
+
+uint32_t getChannel(uint32_t texel, uint32_t channel) { return (texel >> (8 * channel)) & 0xff; }
+
+uint32_t packTexel(uint32_t red, uint32_t green, uint32_t blue, uint32_t alpha) {
+  return red | (green << 8) | (blue << 16) | (alpha << 24);
+}
+
+// Channels in [0, 1], rounded the way packUnorm4x8 does.
+uint32_t packUnormTexel(float red, float green, float blue, float alpha) {
+  const auto quantize = [](float value) {
+    return static_cast<uint32_t>(std::lround(std::clamp(value, 0.0f, 1.0f) * 255.0f));
+  };
+  return packTexel(quantize(red), quantize(green), quantize(blue), quantize(alpha));
+}
+
+float srgbToLinear(float value) {
+  return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+}
+
+float linearToSrgb(float value) {
+  return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+}
+
+bool hasTransparency(const RgbaImage& image) {
+  return ranges::any_of(image.texels, [](uint32_t texel) { return getChannel(texel, 3) != 0xff; });
+}
+
+// Binary PPM (P6) with 8 bit channels, which every image tool can write and which needs no decoder library.
+std::expected<RgbaImage, std::string> loadPpm(const std::string& path) {
+  std::ifstream file{path, std::ios::binary};
+  if (!file)
+    return std::unexpected(std::format("Unable to open {}", path));
+
+  // Header fields are separated by whitespace, with # comments running to the end of the line.
+  const auto readField = [&file]() {
+    std::string field;
+    while (file && field.empty()) {
+      file >> std::ws;
+      if (file.peek() == '#') {
+        std::string comment;
+        std::getline(file, comment);
+        continue;
+      }
+      file >> field;
+    }
+    return field;
+  };
+  const auto readNumber = [&readField]() {
+    const auto field = readField();
+    uint32_t value = 0;
+    std::from_chars(field.data(), field.data() + field.size(), value);
+    return value;
+  };
+
+  if (readField() != "P6")
+    return std::unexpected(std::format("{} is not a binary PPM image", path));
+
+  RgbaImage image{.width = readNumber(), .height = readNumber()};
+  if (image.width == 0 || image.height == 0 || readNumber() != 255)
+    return std::unexpected(std::format("{} is empty or does not have 8 bit channels", path));
+  // A single whitespace character separates the header from the texels.
+  file.get();
+
+  std::vector<uint8_t> rgb(size_t{image.width} * image.height * 3);
+  file.read(reinterpret_cast<char*>(rgb.data()), static_cast<std::streamsize>(rgb.size()));
+  if (!file)
+    return std::unexpected(std::format("{} is truncated", path));
+
+  image.texels.resize(size_t{image.width} * image.height);
+  for (size_t index = 0; index < image.texels.size(); ++index)
+    image.texels[index] = packTexel(uint32_t{rgb[index * 3]}, uint32_t{rgb[index * 3 + 1]},
+                                    uint32_t{rgb[index * 3 + 2]}, 0xffu);
+  return image;
+}
+
+// Weights of the source texels at 2 * target + 0, 1 and 2 along one axis. An even size is a plain 2 tap box. An odd
+// size 2n + 1 shrinks to n texels that each cover (2n + 1) / n source texels, so the 3 taps overlap their neighbours
+// and the last row or column is folded in instead of dropped. kDownsampleShader uses the same weights.
+std::array<float, 3> getFilterWeights(uint32_t target, uint32_t sourceSize) {
+  if (sourceSize == 1)
+    return {1.0f, 0.0f, 0.0f};
+  if (sourceSize % 2 == 0)
+    return {0.5f, 0.5f, 0.0f};
+
+  const auto halfSize = static_cast<float>(sourceSize / 2);
+  const auto size = static_cast<float>(sourceSize);
+  return {(halfSize - static_cast<float>(target)) / size, halfSize / size, (static_cast<float>(target) + 1.0f) / size};
+}
+
+// The next level of the chain, each texel a weighted average of up to 3x3 texels above it with the color averaged in
+// linear space.
+RgbaImage downsample(const RgbaImage& source) {
+  RgbaImage target{.width = std::max(1u, source.width / 2), .height = std::max(1u, source.height / 2)};
+  target.texels.resize(size_t{target.width} * target.height);
+
+  for (uint32_t y = 0; y < target.height; ++y) {
+    const auto weightsY = getFilterWeights(y, source.height);
+    for (uint32_t x = 0; x < target.width; ++x) {
+      const auto weightsX = getFilterWeights(x, source.width);
+      std::array<float, 4> sum{};
+      for (uint32_t tapY = 0; tapY < 3; ++tapY) {
+        for (uint32_t tapX = 0; tapX < 3; ++tapX) {
+          const auto weight = weightsX[tapX] * weightsY[tapY];
+          if (weight == 0.0f)
+            continue;
+
+          const auto sourceX = std::min(x * 2 + tapX, source.width - 1);
+          const auto sourceY = std::min(y * 2 + tapY, source.height - 1);
+          const auto texel = source.texels[size_t{sourceY} * source.width + sourceX];
+          for (uint32_t channel = 0; channel < 3; ++channel)
+            sum[channel] += weight * srgbToLinear(static_cast<float>(getChannel(texel, channel)) / 255.0f);
+          sum[3] += weight * static_cast<float>(getChannel(texel, 3)) / 255.0f;
+        }
+      }
+      target.texels[size_t{y} * target.width + x] =
+          packUnormTexel(linearToSrgb(sum[0]), linearToSrgb(sum[1]), linearToSrgb(sum[2]), sum[3]);
+    }
+  }
+  return target;
+}
+
+// BC1 stores a 4x4 block in 8 bytes as two RGB565 endpoints and a 2 bit index per texel, BC3 adds an 8 byte alpha
+// block with two 8 bit endpoints and 3 bit indices. That is 8:1 and 4:1 against RGBA8.
+constexpr uint32_t kBlockExtent = 4;
+
+uint32_t getBlockSize(VkFormat format) { return format == VK_FORMAT_BC1_RGB_SRGB_BLOCK ? 8 : 16; }
+
+uint64_t getCompressedLevelSize(VkFormat format, VkExtent2D extent) {
+  const uint64_t blocksWide = (extent.width + kBlockExtent - 1) / kBlockExtent;
+  const uint64_t blocksHigh = (extent.height + kBlockExtent - 1) / kBlockExtent;
+  return blocksWide * blocksHigh * getBlockSize(format);
+}
+
+// The 16 texels of a block, edge texels are repeated where the block hangs over the border of the level.
+std::array<uint32_t, 16> loadBlock(const RgbaImage& image, uint32_t blockX, uint32_t blockY) {
+  std::array<uint32_t, 16> block{};
+  for (uint32_t y = 0; y < kBlockExtent; ++y) {
+    for (uint32_t x = 0; x < kBlockExtent; ++x) {
+      const auto imageX = std::min(blockX * kBlockExtent + x, image.width - 1);
+      const auto imageY = std::min(blockY * kBlockExtent + y, image.height - 1);
+      block[y * kBlockExtent + x] = image.texels[size_t{imageY} * image.width + imageX];
+    }
+  }
+  return block;
+}
+
+uint16_t packRgb565(const std::array<int, 3>& color) {
+  const auto red = static_cast<uint16_t>((color[0] * 31 + 127) / 255);
+  const auto green = static_cast<uint16_t>((color[1] * 63 + 127) / 255);
+  const auto blue = static_cast<uint16_t>((color[2] * 31 + 127) / 255);
+  return static_cast<uint16_t>((red << 11) | (green << 5) | blue);
+}
+
+std::array<int, 3> unpackRgb565(uint16_t color) {
+  const int red = color >> 11;
+  const int green = (color >> 5) & 0x3f;
+  const int blue = color & 0x1f;
+  return {(red << 3) | (red >> 2), (green << 2) | (green >> 4), (blue << 3) | (blue >> 2)};
+}
+
+// Endpoints from the bounding box of the block's colors, inset by 1/16 of its size. Channels that fall while the
+// widest one rises swap their ends, so the endpoints lie on the diagonal the colors actually follow.
+void encodeColorBlock(const std::array<uint32_t, 16>& block, std::byte* output) {
+  std::array<int, 3> low{255, 255, 255};
+  std::array<int, 3> high{0, 0, 0};
+  std::array<int, 3> sum{};
+  for (const auto texel : block) {
+    for (uint32_t channel = 0; channel < 3; ++channel) {
+      const auto value = static_cast<int>(getChannel(texel, channel));
+      low[channel] = std::min(low[channel], value);
+      high[channel] = std::max(high[channel], value);
+      sum[channel] += value;
+    }
+  }
+
+  uint32_t widest = 0;
+  for (uint32_t channel = 1; channel < 3; ++channel) {
+    if (high[channel] - low[channel] > high[widest] - low[widest])
+      widest = channel;
+  }
+  for (uint32_t channel = 0; channel < 3; ++channel) {
+    if (channel == widest)
+      continue;
+
+    int covariance = 0;
+    for (const auto texel : block)
+      covariance += (16 * static_cast<int>(getChannel(texel, widest)) - sum[widest]) *
+                    (16 * static_cast<int>(getChannel(texel, channel)) - sum[channel]);
+    if (covariance < 0)
+      std::swap(low[channel], high[channel]);
+  }
+
+  for (uint32_t channel = 0; channel < 3; ++channel) {
+    const auto inset = (high[channel] - low[channel]) / 16;
+    high[channel] -= inset;
+    low[channel] += inset;
+  }
+
+  auto color0 = packRgb565(high);
+  auto color1 = packRgb565(low);
+  // color0 > color1 selects the four color mode.
+  if (color0 < color1)
+    std::swap(color0, color1);
+
+  uint32_t indices = 0;
+  if (color0 != color1) {
+    const auto end0 = unpackRgb565(color0);
+    const auto end1 = unpackRgb565(color1);
+    std::array<std::array<int, 3>, 4> palette{end0, end1};
+    for (uint32_t channel = 0; channel < 3; ++channel) {
+      palette[2][channel] = (2 * end0[channel] + end1[channel]) / 3;
+      palette[3][channel] = (end0[channel] + 2 * end1[channel]) / 3;
+    }
+
+    for (uint32_t index = 0; index < block.size(); ++index) {
+      uint32_t best = 0;
+      int bestDistance = std::numeric_limits<int>::max();
+      for (uint32_t candidate = 0; candidate < palette.size(); ++candidate) {
+        int distance = 0;
+        for (uint32_t channel = 0; channel < 3; ++channel) {
+          const auto delta = static_cast<int>(getChannel(block[index], channel)) - palette[candidate][channel];
+          distance += delta * delta;
+        }
+        if (distance < bestDistance) {
+          best = candidate;
+          bestDistance = distance;
+        }
+      }
+      indices |= best << (2 * index);
+    }
+  }
+
+  std::memcpy(output, &color0, sizeof(color0));
+  std::memcpy(output + 2, &color1, sizeof(color1));
+  std::memcpy(output + 4, &indices, sizeof(indices));
+}
+
+// The largest and smallest alpha as endpoints, in the mode with six values evenly spaced between them.
+void encodeAlphaBlock(const std::array<uint32_t, 16>& block, std::byte* output) {
+  uint32_t low = 255;
+  uint32_t high = 0;
+  for (const auto texel : block) {
+    low = std::min(low, getChannel(texel, 3));
+    high = std::max(high, getChannel(texel, 3));
+  }
+
+  uint64_t indices = 0;
+  if (high != low) {
+    std::array<uint32_t, 8> palette{high, low};
+    for (uint32_t index = 2; index < palette.size(); ++index)
+      palette[index] = ((8 - index) * high + (index - 1) * low) / 7;
+
+    for (uint32_t index = 0; index < block.size(); ++index) {
+      const auto alpha = static_cast<int>(getChannel(block[index], 3));
+      const auto best = ranges::min(views::iota(0u, 8u), {}, [&](uint32_t candidate) {
+        return std::abs(alpha - static_cast<int>(palette[candidate]));
+      });
+      indices |= uint64_t{best} << (3 * index);
+    }
+  }
+
+  output[0] = static_cast<std::byte>(high);
+  output[1] = static_cast<std::byte>(low);
+  std::memcpy(output + 2, &indices, 6);
+}
+
+std::array<uint32_t, 16> decodeBlock(VkFormat format, const std::byte* input) {
+  const auto* colorBlock = format == VK_FORMAT_BC1_RGB_SRGB_BLOCK ? input : input + 8;
+  uint16_t color0 = 0;
+  uint16_t color1 = 0;
+  uint32_t colorIndices = 0;
+  std::memcpy(&color0, colorBlock, sizeof(color0));
+  std::memcpy(&color1, colorBlock + 2, sizeof(color1));
+  std::memcpy(&colorIndices, colorBlock + 4, sizeof(colorIndices));
+
+  const auto end0 = unpackRgb565(color0);
+  const auto end1 = unpackRgb565(color1);
+  std::array<std::array<int, 3>, 4> palette{end0, end1};
+  // BC3 always decodes its colors in the four color mode, BC1 switches to three colors and black when color0 is not
+  // larger than color1.
+  const auto fourColors = format != VK_FORMAT_BC1_RGB_SRGB_BLOCK || color0 > color1;
+  for (uint32_t channel = 0; channel < 3; ++channel) {
+    palette[2][channel] = fourColors ? (2 * end0[channel] + end1[channel]) / 3 : (end0[channel] + end1[channel]) / 2;
+    palette[3][channel] = fourColors ? (end0[channel] + 2 * end1[channel]) / 3 : 0;
+  }
+
+  std::array<uint32_t, 8> alphaPalette{};
+  uint64_t alphaIndices = 0;
+  if (format != VK_FORMAT_BC1_RGB_SRGB_BLOCK) {
+    const auto alpha0 = std::to_integer<uint32_t>(input[0]);
+    const auto alpha1 = std::to_integer<uint32_t>(input[1]);
+    alphaPalette = {alpha0, alpha1};
+    for (uint32_t index = 2; index < alphaPalette.size(); ++index) {
+      alphaPalette[index] = alpha0 > alpha1 ? ((8 - index) * alpha0 + (index - 1) * alpha1) / 7
+                            : index < 6     ? ((6 - index) * alpha0 + (index - 1) * alpha1) / 5
+                            : index == 6    ? 0
+                                            : 255;
+    }
+    std::memcpy(&alphaIndices, input + 2, 6);
+  }
+
+  std::array<uint32_t, 16> block{};
+  for (uint32_t index = 0; index < block.size(); ++index) {
+    const auto& color = palette[(colorIndices >> (2 * index)) & 0x3];
+    const auto alpha =
+        format == VK_FORMAT_BC1_RGB_SRGB_BLOCK ? 255u : alphaPalette[(alphaIndices >> (3 * index)) & 0x7];
+    block[index] = packTexel(static_cast<uint32_t>(color[0]), static_cast<uint32_t>(color[1]),
+                             static_cast<uint32_t>(color[2]), alpha);
+  }
+  return block;
+}
+
+// Block rows are independent, so they are spread over the hardware threads.
+template <typename ProcessRow>
+void forEachBlockRow(uint32_t blocksHigh, ProcessRow&& processRow) {
+  const auto workerCount = std::clamp(std::thread::hardware_concurrency(), 1u, blocksHigh);
+  std::vector<std::jthread> workers;
+  for (uint32_t worker = 0; worker < workerCount; ++worker) {
+    workers.emplace_back([&, worker]() {
+      for (auto row = worker; row < blocksHigh; row += workerCount)
+        processRow(row);
+    });
+  }
+}
+
+std::vector<std::byte> compressLevel(const RgbaImage& image, VkFormat format) {
+  const auto blocksWide = (image.width + kBlockExtent - 1) / kBlockExtent;
+  const auto blocksHigh = (image.height + kBlockExtent - 1) / kBlockExtent;
+  const auto blockSize = getBlockSize(format);
+  std::vector<std::byte> output(getCompressedLevelSize(format, {image.width, image.height}));
+
+  forEachBlockRow(blocksHigh, [&](uint32_t blockY) {
+    for (uint32_t blockX = 0; blockX < blocksWide; ++blockX) {
+      const auto block = loadBlock(image, blockX, blockY);
+      auto* destination = output.data() + (size_t{blockY} * blocksWide + blockX) * blockSize;
+      if (format == VK_FORMAT_BC3_SRGB_BLOCK) {
+        encodeAlphaBlock(block, destination);
+        destination += 8;
+      }
+      encodeColorBlock(block, destination);
+    }
+  });
+  return output;
+}
+
+RgbaImage decompressLevel(std::span<const std::byte> data, VkFormat format, VkExtent2D extent) {
+  const auto blocksWide = (extent.width + kBlockExtent - 1) / kBlockExtent;
+  const auto blocksHigh = (extent.height + kBlockExtent - 1) / kBlockExtent;
+  const auto blockSize = getBlockSize(format);
+  RgbaImage image{.width = extent.width, .height = extent.height};
+  image.texels.resize(size_t{extent.width} * extent.height);
+
+  forEachBlockRow(blocksHigh, [&](uint32_t blockY) {
+    for (uint32_t blockX = 0; blockX < blocksWide; ++blockX) {
+      const auto block = decodeBlock(format, data.data() + (size_t{blockY} * blocksWide + blockX) * blockSize);
+      for (uint32_t y = 0; y < kBlockExtent; ++y) {
+        for (uint32_t x = 0; x < kBlockExtent; ++x) {
+          const auto imageX = blockX * kBlockExtent + x;
+          const auto imageY = blockY * kBlockExtent + y;
+          if (imageX < extent.width && imageY < extent.height)
+            image.texels[size_t{imageY} * extent.width + imageX] = block[y * kBlockExtent + x];
+        }
+      }
+    }
+  });
+  return image;
+}
+
+// Peak signal to noise ratio over channels [firstChannel, lastChannel) of two images of the same size.
+double computePsnr(const RgbaImage& reference, const RgbaImage& image, uint32_t firstChannel, uint32_t lastChannel) {
+  double squaredError = 0.0;
+  for (size_t index = 0; index < reference.texels.size(); ++index) {
+    for (auto channel = firstChannel; channel < lastChannel; ++channel) {
+      const auto delta = static_cast<double>(getChannel(reference.texels[index], channel)) -
+                         static_cast<double>(getChannel(image.texels[index], channel));
+      squaredError += delta * delta;
+    }
+  }
+  const auto meanSquaredError =
+      squaredError / static_cast<double>(reference.texels.size() * (lastChannel - firstChannel));
+  return meanSquaredError == 0.0 ? std::numeric_limits<double>::infinity()
+                                 : 10.0 * std::log10(255.0 * 255.0 / meanSquaredError);
+}
+
+uint64_t alignUp(uint64_t value, uint64_t alignment) { return (value + alignment - 1) / alignment * alignment; }
+
+// The container is written and read field by field in the host's byte order, which KTX 2.0 requires to be little
+// endian.
+static_assert(std::endian::native == std::endian::little);
+
+template <typename T>
+void appendValue(std::vector<std::byte>& bytes, T value) {
+  const auto* begin = reinterpret_cast<const std::byte*>(&value);
+  bytes.insert(std::end(bytes), begin, begin + sizeof(T));
+}
+
+template <typename T>
+T readValue(std::span<const std::byte> bytes, size_t offset) {
+  T value;
+  std::memcpy(&value, bytes.data() + offset, sizeof(T));
+  return value;
+}
+
+// The subset of KTX 2.0 this recipe writes: a single 2D BC1 or BC3 image with its mip levels, a basic data format
+// descriptor and no key/value data or supercompression. Only the header fields the reader acts on are kept.
+struct Ktx2Header {
+  static constexpr std::array<uint8_t, 12> kIdentifier{0xab, 0x4b, 0x54, 0x58, 0x20, 0x32,
+                                                       0x30, 0xbb, 0x0d, 0x0a, 0x1a, 0x0a};
+  // Identifier, nine header fields, then the index: four 32 bit and two 64 bit fields.
+  static constexpr size_t kSize = 80;
+  // byteOffset, byteLength and uncompressedByteLength of each level.
+  static constexpr size_t kLevelIndexEntrySize = 24;
+
+  uint32_t vkFormat = VK_FORMAT_UNDEFINED;
+  uint32_t pixelWidth = 0;
+  uint32_t pixelHeight = 0;
+  uint32_t levelCount = 0;
+  uint32_t supercompressionScheme = 0;
+};
+
+// The basic descriptor block from the Khronos Data Format Specification: BC1A (128) or BC3 (130) color model, BT.709
+// primaries, sRGB transfer and 4x4 texel blocks. BC3 describes its alpha and color halves as separate samples.
+std::vector<std::byte> makeDataFormatDescriptor(VkFormat format) {
+  const auto isBc3 = format == VK_FORMAT_BC3_SRGB_BLOCK;
+  const auto sampleCount = isBc3 ? 2u : 1u;
+  const auto blockSize = 24 + 16 * sampleCount;
+
+  std::vector<std::byte> descriptor;
+  appendValue<uint32_t>(descriptor, 4 + blockSize);
+  appendValue<uint32_t>(descriptor, 0);
+  appendValue<uint32_t>(descriptor, 2 | (blockSize << 16));
+  appendValue<uint32_t>(descriptor, (isBc3 ? 130u : 128u) | (1u << 8) | (2u << 16));
+  appendValue<uint32_t>(descriptor, 3 | (3 << 8));
+  appendValue<uint32_t>(descriptor, getBlockSize(format));
+  appendValue<uint32_t>(descriptor, 0);
+
+  const auto appendSample = [&descriptor](uint32_t bitOffset, uint32_t channelType) {
+    appendValue<uint32_t>(descriptor, bitOffset | (63u << 16) | (channelType << 24));
+    appendValue<uint32_t>(descriptor, 0);
+    appendValue<uint32_t>(descriptor, 0);
+    appendValue<uint32_t>(descriptor, std::numeric_limits<uint32_t>::max());
+  };
+  // Alpha is channel 15 with the linear qualifier, it is not sRGB encoded.
+  if (isBc3)
+    appendSample(0, 15 | 0x10);
+  appendSample(isBc3 ? 64 : 0, 0);
+  return descriptor;
+}
+
+// Levels follow the header, level index and descriptor from the smallest to the largest, each aligned to a block,
+// so the largest level ends the file and every level can be copied from the mapping as is.
+std::expected<void, std::string> writeKtx2File(const std::string& path, VkFormat format, VkExtent2D extent,
+                                               std::span<const std::vector<std::byte>> levels) {
+  const auto levelCount = static_cast<uint32_t>(levels.size());
+  const auto descriptor = makeDataFormatDescriptor(format);
+  const auto descriptorOffset =
+      static_cast<uint32_t>(Ktx2Header::kSize + levelCount * Ktx2Header::kLevelIndexEntrySize);
+
+  std::vector<uint64_t> levelOffsets(levelCount);
+  auto offset = uint64_t{descriptorOffset + descriptor.size()};
+  for (auto level = levelCount; level-- > 0;) {
+    levelOffsets[level] = alignUp(offset, getBlockSize(format));
+    offset = levelOffsets[level] + levels[level].size();
+  }
+
+  std::vector<std::byte> header;
+  for (const auto byte : Ktx2Header::kIdentifier)
+    appendValue(header, byte);
+  // vkFormat, typeSize, pixelWidth, pixelHeight, pixelDepth, layerCount, faceCount, levelCount, supercompression.
+  for (const uint32_t value : {static_cast<uint32_t>(format), 1u, extent.width, extent.height, 0u, 0u, 1u, levelCount,
+                               0u})
+    appendValue(header, value);
+  // The descriptor, no key/value data and no supercompression global data.
+  for (const uint32_t value : {descriptorOffset, static_cast<uint32_t>(descriptor.size()), 0u, 0u})
+    appendValue(header, value);
+  appendValue<uint64_t>(header, 0);
+  appendValue<uint64_t>(header, 0);
+  for (uint32_t level = 0; level < levelCount; ++level) {
+    appendValue(header, levelOffsets[level]);
+    appendValue<uint64_t>(header, levels[level].size());
+    appendValue<uint64_t>(header, levels[level].size());
+  }
+  header.insert(std::end(header), std::begin(descriptor), std::end(descriptor));
+
+  std::ofstream file{path, std::ios::binary | std::ios::trunc};
+  if (!file)
+    return std::unexpected(std::format("Unable to open {} for writing", path));
+
+  const std::array<char, 16> padding{};
+  file.write(reinterpret_cast<const char*>(header.data()), static_cast<std::streamsize>(header.size()));
+  uint64_t written = header.size();
+  for (auto level = levelCount; level-- > 0;) {
+    file.write(padding.data(), static_cast<std::streamsize>(levelOffsets[level] - written));
+    file.write(reinterpret_cast<const char*>(levels[level].data()),
+               static_cast<std::streamsize>(levels[level].size()));
+    written = levelOffsets[level] + levels[level].size();
+  }
+
+  if (!file)
+    return std::unexpected(std::format("Unable to write {}", path));
+  return {};
+}
+
+// A read only mapping of a whole file. Pages are only read from disk when they are first touched.
+class MappedFile {
+public:
+  static std::expected<MappedFile, std::string> create(const std::string& path) {
+    MappedFile file;
+
+    if (file.init(path))
+      return file;
+    else
+      return std::unexpected(std::format("Unable to map {}", path));
+  }
+
+  ~MappedFile() {
+    if (m_data == nullptr)
+      return;
+
+#if defined(_WIN32)
+    UnmapViewOfFile(m_data);
+    CloseHandle(m_mapping);
+#else
+    ::munmap(m_data, m_size);
+#endif
+    m_data = nullptr;
+  }
+
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  MappedFile(const MappedFile&) = delete;
+
+  MappedFile(MappedFile&& rhs) noexcept {
+    swap(rhs);
+    rhs.m_data = nullptr;
+  }
+
+  MappedFile& operator=(MappedFile&& rhs) noexcept {
+    MappedFile tmp{std::move(rhs)};
+    swap(tmp);
+    return *this;
+  }
+
+  [[nodiscard]] inline std::span<const std::byte> getData() const noexcept {
+    return std::span{static_cast<const std::byte*>(m_data), m_size};
+  }
+
+private:
+  MappedFile() = default;
+
+  bool init(const std::string& path) {
+#if defined(_WIN32)
+    const auto file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                  FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+      return false;
+
+    LARGE_INTEGER size{};
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+      CloseHandle(file);
+      return false;
+    }
+
+    m_mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (m_mapping == nullptr)
+      return false;
+
+    m_data = MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+    if (m_data == nullptr) {
+      CloseHandle(m_mapping);
+      return false;
+    }
+    m_size = static_cast<size_t>(size.QuadPart);
+#else
+    const int file = ::open(path.c_str(), O_RDONLY);
+    if (file < 0)
+      return false;
+
+    struct stat status {};
+    if (::fstat(file, &status) != 0 || status.st_size == 0) {
+      ::close(file);
+      return false;
+    }
+
+    const auto size = static_cast<size_t>(status.st_size);
+    void* data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+    ::close(file);
+    if (data == MAP_FAILED)
+      return false;
+
+    // uploadTexture streams the levels in file order, front to back into the staging ring.
+    ::madvise(data, size, MADV_SEQUENTIAL);
+    m_data = data;
+    m_size = size;
+#endif
+    return true;
+  }
+
+  void swap(MappedFile& rhs) {
+    std::swap(m_data, rhs.m_data);
+    std::swap(m_size, rhs.m_size);
+#if defined(_WIN32)
+    std::swap(m_mapping, rhs.m_mapping);
+#endif
+  }
+
+private:
+  void* m_data = nullptr;
+  size_t m_size = 0;
+#if defined(_WIN32)
+  HANDLE m_mapping = nullptr;
+#endif
+};
+
+struct TextureLevel {
+  VkExtent2D extent{};
+  std::span<const std::byte> data;
+};
+
+// Validates a KTX 2.0 file in memory and hands out its levels without copying them.
+class Ktx2FileView {
+public:
+  static std::expected<Ktx2FileView, std::string> create(std::span<const std::byte> data) {
+    if (data.size() < Ktx2Header::kSize ||
+        std::memcmp(data.data(), Ktx2Header::kIdentifier.data(), Ktx2Header::kIdentifier.size()) != 0)
+      return std::unexpected(std::string{"Not a KTX 2.0 file"});
+
+    const Ktx2Header header{.vkFormat = readValue<uint32_t>(data, 12),
+                            .pixelWidth = readValue<uint32_t>(data, 20),
+                            .pixelHeight = readValue<uint32_t>(data, 24),
+                            .levelCount = readValue<uint32_t>(data, 40),
+                            .supercompressionScheme = readValue<uint32_t>(data, 44)};
+    const auto format = static_cast<VkFormat>(header.vkFormat);
+    if (format != VK_FORMAT_BC1_RGB_SRGB_BLOCK && format != VK_FORMAT_BC3_SRGB_BLOCK)
+      return std::unexpected(std::format("Unsupported format {}, only BC1 and BC3 sRGB are read", header.vkFormat));
+    if (header.supercompressionScheme != 0)
+      return std::unexpected(std::string{"Supercompressed files are not supported"});
+    // A pixelDepth, layerCount or faceCount other than 0, 0 and 1 is a volume, an array or a cube map.
+    if (readValue<uint32_t>(data, 28) != 0 || readValue<uint32_t>(data, 32) > 1 || readValue<uint32_t>(data, 36) != 1)
+      return std::unexpected(std::string{"Only single 2D images are supported"});
+
+    const VkExtent2D extent{header.pixelWidth, header.pixelHeight};
+    // A level count of 0 asks the loader to generate the mip chain, which is the offline tool's job here.
+    if (extent.width == 0 || extent.height == 0 || header.levelCount == 0 ||
+        header.levelCount > getMipLevelCount(extent.width, extent.height) ||
+        data.size() < Ktx2Header::kSize + uint64_t{header.levelCount} * Ktx2Header::kLevelIndexEntrySize)
+      return std::unexpected(std::string{"Invalid extent or level count"});
+
+    std::vector<TextureLevel> levels;
+    for (uint32_t level = 0; level < header.levelCount; ++level) {
+      const auto entry = Ktx2Header::kSize + level * Ktx2Header::kLevelIndexEntrySize;
+      const auto offset = readValue<uint64_t>(data, entry);
+      const auto size = readValue<uint64_t>(data, entry + 8);
+      const auto levelExtent = getMipExtent(extent, level);
+      if (size != getCompressedLevelSize(format, levelExtent) || offset % getBlockSize(format) != 0 ||
+          offset > data.size() || size > data.size() - offset)
+        return std::unexpected(std::format("Level {} has the wrong size, is misaligned or out of bounds", level));
+      levels.push_back(TextureLevel{.extent = levelExtent, .data = data.subspan(offset, size)});
+    }
+
+    return Ktx2FileView{format, extent, std::move(levels)};
+  }
+
+  [[nodiscard]] inline VkFormat getFormat() const noexcept { return m_format; }
+
+  [[nodiscard]] inline VkExtent2D getExtent() const noexcept { return m_extent; }
+
+  [[nodiscard]] inline std::span<const TextureLevel> getLevels() const noexcept { return m_levels; }
+
+private:
+  Ktx2FileView(VkFormat format, VkExtent2D extent, std::vector<TextureLevel> levels)
+      : m_format{format}, m_extent{extent}, m_levels{std::move(levels)} {}
+
+private:
+  VkFormat m_format;
+  VkExtent2D m_extent;
+  std::vector<TextureLevel> m_levels;
+};
+
+// Host visible staging memory split into segments, each with its own command buffer. Data is copied into the current
+// segment and its copies recorded until the next allocation does not fit; the segment is then submitted and the ring
+// moves on, waiting only when the GPU has not yet finished the copies that last used the next segment.
+class StagingRing {
+public:
+  struct Allocation {
+    VkDeviceSize offset = 0;
+    std::span<std::byte> data;
+  };
+
+  StagingRing(Device& device, VkDeviceSize segmentSize, uint32_t segmentCount)
+      : m_device{device}, m_segmentSize{alignUp(segmentSize, kAlignment)} {
+    m_buffer = m_device.createBuffer(m_segmentSize * segmentCount, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                     VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    for (uint32_t index = 0; index < segmentCount; ++index)
+      m_segments.push_back(Segment{.commandBuffer = m_device.allocateCommandBuffer()});
+    begin(m_segments.front());
+  }
+
+  StagingRing(const StagingRing&) = delete;
+  StagingRing& operator=(const StagingRing&) = delete;
+
+  ~StagingRing() {
+    for (const auto& segment : m_segments)
+      m_device.waitTimeline(segment.timelineValue);
+    m_device.destroyBuffer(m_buffer);
+  }
+
+  [[nodiscard]] inline VkBuffer getBuffer() const noexcept { return m_buffer.buffer; }
+
+  [[nodiscard]] inline VkDeviceSize getSegmentSize() const noexcept { return m_segmentSize; }
+
+  [[nodiscard]] inline uint32_t getSubmissionCount() const noexcept { return m_submissionCount; }
+
+  [[nodiscard]] inline uint32_t getStallCount() const noexcept { return m_stallCount; }
+
+  // Copies that read an allocation are recorded here, the command buffer changes whenever a segment is submitted.
+  [[nodiscard]] inline VkCommandBuffer getCommandBuffer() const noexcept {
+    return m_segments[m_current].commandBuffer;
+  }
+
+  [[nodiscard]] VkDeviceSize getAvailable(VkDeviceSize alignment) const {
+    const auto offset = alignUp(m_segments[m_current].used, alignment);
+    return offset < m_segmentSize ? m_segmentSize - offset : 0;
+  }
+
+  // size bytes at an offset into getBuffer() aligned to alignment, which must divide kAlignment.
+  Allocation allocate(VkDeviceSize size, VkDeviceSize alignment) {
+    if (size > m_segmentSize) {
+      std::println("A staging allocation of {} bytes does not fit in a {} byte segment", size, m_segmentSize);
+      std::exit(EXIT_FAILURE);
+    }
+
+    if (getAvailable(alignment) < size)
+      submit();
+
+    auto& segment = m_segments[m_current];
+    const auto offset = m_current * m_segmentSize + alignUp(segment.used, alignment);
+    segment.used = offset - m_current * m_segmentSize + size;
+    return Allocation{.offset = offset, .data = std::span{static_cast<std::byte*>(m_buffer.mapped) + offset, size}};
+  }
+
+  // Submits the current segment and returns the timeline value that is signaled once its copies are done.
+  uint64_t submit() {
+    auto& segment = m_segments[m_current];
+    VK_CALL(vkEndCommandBuffer(segment.commandBuffer));
+    segment.timelineValue = m_device.submit(segment.commandBuffer);
+    ++m_submissionCount;
+
+    m_current = (m_current + 1) % static_cast<uint32_t>(m_segments.size());
+    begin(m_segments[m_current]);
+    return segment.timelineValue;
+  }
+
+private:
+  static constexpr VkDeviceSize kAlignment = 256;
+
+  struct Segment {
+    VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+    uint64_t timelineValue = 0;
+    VkDeviceSize used = 0;
+  };
+
+  void begin(Segment& segment) {
+    if (m_device.getCompletedTimelineValue() < segment.timelineValue) {
+      ++m_stallCount;
+      m_device.waitTimeline(segment.timelineValue);
+    }
+
+    segment.used = 0;
+    VK_CALL(vkResetCommandBuffer(segment.commandBuffer, 0));
+    const VkCommandBufferBeginInfo beginInfo{.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+                                             .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT};
+    VK_CALL(vkBeginCommandBuffer(segment.commandBuffer, &beginInfo));
+  }
+
+private:
+  Device& m_device;
+  VkDeviceSize m_segmentSize = 0;
+  BufferAllocation m_buffer;
+  std::vector<Segment> m_segments;
+  uint32_t m_current = 0;
+  uint32_t m_submissionCount = 0;
+  uint32_t m_stallCount = 0;
+};
+
+struct UploadResult {
+  uint64_t timelineValue = 0;
+  uint64_t bytes = 0;
+  uint32_t copies = 0;
+};
+
+// Streams every level from the mapping through the staging ring into the image, one memcpy per copy and nothing
+// decoded on the way. Levels go smallest first, the order they have in the file, so the mapping is read front to back.
+// Levels that do not fit in what is left of a segment are split into rows of blocks. The image ends in
+// TRANSFER_SRC_OPTIMAL so it can be read back, a renderer would move it to SHADER_READ_ONLY_OPTIMAL instead.
+UploadResult uploadTexture(StagingRing& ring, const ImageAllocation& image, std::span<const TextureLevel> levels,
+                           uint32_t blockExtent, uint32_t blockSize) {
+  imageBarrier(ring.getCommandBuffer(), image.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+               VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE, VK_PIPELINE_STAGE_2_COPY_BIT,
+               VK_ACCESS_2_TRANSFER_WRITE_BIT);
+
+  UploadResult result;
+  for (auto level = static_cast<uint32_t>(levels.size()); level-- > 0;) {
+    const auto extent = levels[level].extent;
+    const auto blocksHigh = (extent.height + blockExtent - 1) / blockExtent;
+    const auto rowSize = uint64_t{(extent.width + blockExtent - 1) / blockExtent} * blockSize;
+    const auto fullSegmentRows = std::max(1u, static_cast<uint32_t>(ring.getSegmentSize() / rowSize));
+
+    for (uint32_t row = 0; row < blocksHigh;) {
+      const auto availableRows = static_cast<uint32_t>(ring.getAvailable(blockSize) / rowSize);
+      const auto rows = std::min(blocksHigh - row, availableRows > 0 ? availableRows : fullSegmentRows);
+      const auto allocation = ring.allocate(rows * rowSize, blockSize);
+      std::memcpy(allocation.data.data(), levels[level].data.data() + row * rowSize, allocation.data.size());
+
+      const auto y = row * blockExtent;
+      const VkBufferImageCopy region{
+          .bufferOffset = allocation.offset,
+          .imageSubresource = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .mipLevel = level, .layerCount = 1},
+          .imageOffset = {0, static_cast<int32_t>(y), 0},
+          .imageExtent = {extent.width, std::min(rows * blockExtent, extent.height - y), 1}};
+      vkCmdCopyBufferToImage(ring.getCommandBuffer(), ring.getBuffer(), image.image,
+                             VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+      row += rows;
+      result.bytes += allocation.data.size();
+      ++result.copies;
+    }
+  }
+
+  imageBarrier(ring.getCommandBuffer(), image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+               VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+               VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_READ_BIT);
+  result.timelineValue = ring.submit();
+  return result;
+}
+
+// Copies every level back and compares it byte for byte with what was uploaded. Returns the number of levels that
+// differ.
+uint32_t verifyTexture(Device& device, const ImageAllocation& image, std::span<const TextureLevel> levels) {
+  const auto totalSize = std::transform_reduce(std::begin(levels), std::end(levels), uint64_t{0}, std::plus{},
+                                               [](const TextureLevel& level) { return level.data.size(); });
+  auto readback = device.createBuffer(totalSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+  device.immediateSubmit([&](VkCommandBuffer commandBuffer) {
+    uint64_t offset = 0;
+    for (uint32_t level = 0; level < levels.size(); ++level) {
+      const VkBufferImageCopy region{
+          .bufferOffset = offset,
+          .imageSubresource = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .mipLevel = level, .layerCount = 1},
+          .imageExtent = {levels[level].extent.width, levels[level].extent.height, 1}};
+      vkCmdCopyImageToBuffer(commandBuffer, image.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readback.buffer, 1,
+                             &region);
+      offset += levels[level].data.size();
+    }
+    bufferBarrier(commandBuffer, readback.buffer, VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+                  VK_PIPELINE_STAGE_2_HOST_BIT, VK_ACCESS_2_HOST_READ_BIT);
+  });
+
+  uint32_t mismatches = 0;
+  const auto* data = static_cast<const std::byte*>(readback.mapped);
+  for (const auto& level : levels) {
+    if (std::memcmp(data, level.data.data(), level.data.size()) != 0)
+      ++mismatches;
+    data += level.data.size();
+  }
+  device.destroyBuffer(readback);
+  return mismatches;
+}
+
+} // namespace VulkanCore
+
+// One level of the chain from the level above it, both living in the same buffer, with the weights of
+// getFilterWeights. Color is averaged in linear space so the smaller levels do not darken, alpha is averaged as is.
+constexpr std::string_view kDownsampleShader = R"(
+#version 460
+
+layout(local_size_x = 8, local_size_y = 8) in;
+
+layout(set = 0, binding = 0) buffer Chain {
+  uint texels[];
+};
+
+layout(push_constant) uniform PushConstants {
+  uint sourceOffset;
+  uint sourceWidth;
+  uint sourceHeight;
+  uint targetOffset;
+  uint targetWidth;
+  uint targetHeight;
+} pushConstants;
+
+vec3 toLinear(vec3 color) {
+  return mix(color / 12.92, pow((color + 0.055) / 1.055, vec3(2.4)), greaterThan(color, vec3(0.04045)));
+}
+
+vec3 toSrgb(vec3 color) {
+  return mix(color * 12.92, 1.055 * pow(color, vec3(1.0 / 2.4)) - 0.055, greaterThan(color, vec3(0.0031308)));
+}
+
+vec4 loadTexel(uvec2 position) {
+  const uvec2 clamped = min(position, uvec2(pushConstants.sourceWidth, pushConstants.sourceHeight) - 1u);
+  const vec4 texel = unpackUnorm4x8(texels[pushConstants.sourceOffset + clamped.y * pushConstants.sourceWidth +
+                                           clamped.x]);
+  return vec4(toLinear(texel.rgb), texel.a);
+}
+
+vec3 filterWeights(uint target, uint sourceSize) {
+  if (sourceSize == 1u)
+    return vec3(1.0, 0.0, 0.0);
+  if ((sourceSize & 1u) == 0u)
+    return vec3(0.5, 0.5, 0.0);
+
+  const float halfSize = float(sourceSize / 2u);
+  return vec3(halfSize - float(target), halfSize, float(target) + 1.0) / float(sourceSize);
+}
+
+void main() {
+  const uvec2 target = gl_GlobalInvocationID.xy;
+  if (target.x >= pushConstants.targetWidth || target.y >= pushConstants.targetHeight)
+    return;
+
+  const uvec2 source = target * 2u;
+  const vec3 weightsX = filterWeights(target.x, pushConstants.sourceWidth);
+  const vec3 weightsY = filterWeights(target.y, pushConstants.sourceHeight);
+  vec4 average = vec4(0.0);
+  for (uint y = 0u; y < 3u; ++y) {
+    for (uint x = 0u; x < 3u; ++x) {
+      const float weight = weightsX[x] * weightsY[y];
+      if (weight > 0.0)
+        average += weight * loadTexel(source + uvec2(x, y));
+    }
+  }
+  texels[pushConstants.targetOffset + target.y * pushConstants.targetWidth + target.x] =
+      packUnorm4x8(vec4(toSrgb(average.rgb), average.a));
+}
+)";
+
+constexpr uint32_t kWorkgroupSize = 8;
+
+struct DownsampleParameters {
+  uint32_t sourceOffset = 0;
+  uint32_t sourceWidth = 0;
+  uint32_t sourceHeight = 0;
+  uint32_t targetOffset = 0;
+  uint32_t targetWidth = 0;
+  uint32_t targetHeight = 0;
+};
+
+// Builds a whole mip chain on the GPU in a single submission, one dispatch per level with a barrier in between. The
+// chain stays in host visible memory because the encoder reads all of it right back.
+class MipGenerator {
+public:
+  MipGenerator(VulkanCore::Device& device, std::span<const uint32_t> spirv) : m_device{device} {
+    const auto vkDevice = m_device.getDevice();
+
+    const VkDescriptorSetLayoutBinding binding{.binding = 0,
+                                               .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                               .descriptorCount = 1,
+                                               .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT};
+    const VkDescriptorSetLayoutCreateInfo setLayoutInfo{.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+                                                        .bindingCount = 1,
+                                                        .pBindings = &binding};
+    VK_CALL(vkCreateDescriptorSetLayout(vkDevice, &setLayoutInfo, nullptr, &m_setLayout));
+
+    const VkPushConstantRange pushConstantRange{.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+                                                .size = sizeof(DownsampleParameters)};
+    const VkPipelineLayoutCreateInfo layoutInfo{.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+                                                .setLayoutCount = 1,
+                                                .pSetLayouts = &m_setLayout,
+                                                .pushConstantRangeCount = 1,
+                                                .pPushConstantRanges = &pushConstantRange};
+    VK_CALL(vkCreatePipelineLayout(vkDevice, &layoutInfo, nullptr, &m_layout));
+
+    const VkShaderModuleCreateInfo moduleInfo{.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+                                              .codeSize = spirv.size_bytes(),
+                                              .pCode = spirv.data()};
+    VkShaderModule shader = VK_NULL_HANDLE;
+    VK_CALL(vkCreateShaderModule(vkDevice, &moduleInfo, nullptr, &shader));
+    const VkComputePipelineCreateInfo pipelineInfo{
+        .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+        .stage = {.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+                  .stage = VK_SHADER_STAGE_COMPUTE_BIT,
+                  .module = shader,
+                  .pName = "main"},
+        .layout = m_layout};
+    VK_CALL(vkCreateComputePipelines(vkDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_pipeline));
+    vkDestroyShaderModule(vkDevice, shader, nullptr);
+
+    const VkDescriptorPoolSize poolSize{.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, .descriptorCount = 1};
+    const VkDescriptorPoolCreateInfo poolInfo{.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+                                              .maxSets = 1,
+                                              .poolSizeCount = 1,
+                                              .pPoolSizes = &poolSize};
+    VK_CALL(vkCreateDescriptorPool(vkDevice, &poolInfo, nullptr, &m_pool));
+
+    const VkDescriptorSetAllocateInfo allocateInfo{.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+                                                   .descriptorPool = m_pool,
+                                                   .descriptorSetCount = 1,
+                                                   .pSetLayouts = &m_setLayout};
+    VK_CALL(vkAllocateDescriptorSets(vkDevice, &allocateInfo, &m_set));
+  }
+
+  MipGenerator(const MipGenerator&) = delete;
+  MipGenerator& operator=(const MipGenerator&) = delete;
+
+  ~MipGenerator() {
+    const auto vkDevice = m_device.getDevice();
+    vkDestroyDescriptorPool(vkDevice, m_pool, nullptr);
+    vkDestroyPipeline(vkDevice, m_pipeline, nullptr);
+    vkDestroyPipelineLayout(vkDevice, m_layout, nullptr);
+    vkDestroyDescriptorSetLayout(vkDevice, m_setLayout, nullptr);
+  }
+
+  // Every level of the chain, starting with a copy of source.
+  std::vector<VulkanCore::RgbaImage> generate(const VulkanCore::RgbaImage& source) {
+    const VkExtent2D extent{source.width, source.height};
+    const auto levelCount = VulkanCore::getMipLevelCount(extent.width, extent.height);
+
+    std::vector<uint32_t> offsets;
+    uint64_t texelCount = 0;
+    for (uint32_t level = 0; level < levelCount; ++level) {
+      const auto levelExtent = VulkanCore::getMipExtent(extent, level);
+      offsets.push_back(static_cast<uint32_t>(texelCount));
+      texelCount += uint64_t{levelExtent.width} * levelExtent.height;
+    }
+
+    auto chain = m_device.createBuffer(texelCount * sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                       VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    std::memcpy(chain.mapped, source.texels.data(), source.texels.size() * sizeof(uint32_t));
+
+    const VkDescriptorBufferInfo bufferInfo{.buffer = chain.buffer, .range = VK_WHOLE_SIZE};
+    const VkWriteDescriptorSet write{.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                                     .dstSet = m_set,
+                                     .dstBinding = 0,
+                                     .descriptorCount = 1,
+                                     .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                     .pBufferInfo = &bufferInfo};
+    vkUpdateDescriptorSets(m_device.getDevice(), 1, &write, 0, nullptr);
+
+    m_device.immediateSubmit([&](VkCommandBuffer commandBuffer) {
+      vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline);
+      vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_layout, 0, 1, &m_set, 0, nullptr);
+      for (uint32_t level = 1; level < levelCount; ++level) {
+        const auto sourceExtent = VulkanCore::getMipExtent(extent, level - 1);
+        const auto targetExtent = VulkanCore::getMipExtent(extent, level);
+        const DownsampleParameters parameters{.sourceOffset = offsets[level - 1],
+                                              .sourceWidth = sourceExtent.width,
+                                              .sourceHeight = sourceExtent.height,
+                                              .targetOffset = offsets[level],
+                                              .targetWidth = targetExtent.width,
+                                              .targetHeight = targetExtent.height};
+        vkCmdPushConstants(commandBuffer, m_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(parameters), &parameters);
+        vkCmdDispatch(commandBuffer, (targetExtent.width + kWorkgroupSize - 1) / kWorkgroupSize,
+                      (targetExtent.height + kWorkgroupSize - 1) / kWorkgroupSize, 1);
+
+        const auto lastLevel = level + 1 == levelCount;
+        VulkanCore::bufferBarrier(commandBuffer, chain.buffer, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                                  VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+                                  lastLevel ? VK_PIPELINE_STAGE_2_HOST_BIT : VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                                  lastLevel ? VK_ACCESS_2_HOST_READ_BIT : VK_ACCESS_2_SHADER_STORAGE_READ_BIT);
+      }
+    });
+
+    std::vector<VulkanCore::RgbaImage> levels;
+    const auto* texels = static_cast<const uint32_t*>(chain.mapped);
+    for (uint32_t level = 0; level < levelCount; ++level) {
+      const auto levelExtent = VulkanCore::getMipExtent(extent, level);
+      const auto* begin = texels + offsets[level];
+      levels.push_back(VulkanCore::RgbaImage{
+          .width = levelExtent.width,
+          .height = levelExtent.height,
+          .texels = std::vector<uint32_t>(begin, begin + size_t{levelExtent.width} * levelExtent.height)});
+    }
+    m_device.destroyBuffer(chain);
+    return levels;
+  }
+
+private:
+  VulkanCore::Device& m_device;
+  VkDescriptorSetLayout m_setLayout = VK_NULL_HANDLE;
+  VkPipelineLayout m_layout = VK_NULL_HANDLE;
+  VkPipeline m_pipeline = VK_NULL_HANDLE;
+  VkDescriptorPool m_pool = VK_NULL_HANDLE;
+  VkDescriptorSet m_set = VK_NULL_HANDLE;
+};
+
+// Gradients show the banding of the 565 endpoints, the checkerboard turns to gray down the chain and the soft edged
+// disc gives the alpha blocks something to do.
+VulkanCore::RgbaImage makeTestImage(uint32_t width, uint32_t height) {
+  VulkanCore::RgbaImage image{.width = width, .height = height};
+  image.texels.reserve(size_t{width} * height);
+  for (uint32_t y = 0; y < height; ++y) {
+    for (uint32_t x = 0; x < width; ++x) {
+      const auto u = (static_cast<float>(x) + 0.5f) / static_cast<float>(width);
+      const auto v = (static_cast<float>(y) + 0.5f) / static_cast<float>(height);
+      const auto checker = ((x / 16) + (y / 16)) % 2 == 0 ? 0.9f : 0.2f;
+      const auto alpha = std::clamp((0.45f - std::hypot(u - 0.5f, v - 0.5f)) * 20.0f, 0.0f, 1.0f);
+      image.texels.push_back(VulkanCore::packUnormTexel(u, v, checker, alpha));
+    }
+  }
+  return image;
+}
+
+// The largest difference of any channel of any texel, between two images of the same size.
+uint32_t maxDifference(const VulkanCore::RgbaImage& lhs, const VulkanCore::RgbaImage& rhs) {
+  uint32_t difference = 0;
+  for (size_t index = 0; index < lhs.texels.size(); ++index) {
+    for (uint32_t channel = 0; channel < 4; ++channel) {
+      const auto left = VulkanCore::getChannel(lhs.texels[index], channel);
+      const auto right = VulkanCore::getChannel(rhs.texels[index], channel);
+      difference = std::max(difference, left > right ? left - right : right - left);
+    }
+  }
+  return difference;
+}
+
+uint32_t parseArgument(std::span<char*> arguments, std::string_view name, uint32_t defaultValue) {
+  for (size_t index = 1; index + 1 < arguments.size(); ++index) {
+    if (std::string_view{arguments[index]} == name) {
+      const std::string_view value{arguments[index + 1]};
+      std::from_chars(value.data(), value.data() + value.size(), defaultValue);
+    }
+  }
+  return defaultValue;
+}
+
+std::string parseString(std::span<char*> arguments, std::string_view name, std::string defaultValue) {
+  for (size_t index = 1; index + 1 < arguments.size(); ++index) {
+    if (std::string_view{arguments[index]} == name)
+      defaultValue = arguments[index + 1];
+  }
+  return defaultValue;
+}
+
+bool hasArgument(std::span<char*> arguments, std::string_view name) {
+  return ranges::any_of(arguments | views::drop(1), [name](const char* argument) { return argument == name; });
+}
+
+double elapsedMilliseconds(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// The offline half loads --input, a binary PPM, or generates a --size test image, builds its mip chain on the GPU,
+// compresses every level to BC1 or BC3 (--format, auto picks BC3 when there is transparency) and writes a KTX 2.0
+// file to --output. The runtime half maps that file and streams its levels through a staging ring of two
+// --staging-kb segments into an image, then reads the image back to check it. Devices without BC support, or
+// --force-decode, get the levels decoded to RGBA8 on the CPU instead. --load-only skips the offline half.
+int main(int argc, char* argv[]) {
+  constexpr uint32_t kStagingSegments = 2;
+
+  const std::string applicationName = "01-18 Texture pipeline";
+  const auto arguments = std::span{argv, static_cast<size_t>(argc)};
+  const auto inputPath = parseString(arguments, "--input", "");
+  const auto size = std::max(1u, parseArgument(arguments, "--size", 2048));
+  const auto formatName = parseString(arguments, "--format", "auto");
+  const auto path = parseString(arguments, "--output", "01_18_texture.ktx2");
+  const auto segmentSize = VkDeviceSize{std::max(64u, parseArgument(arguments, "--staging-kb", 4096))} * 1024;
+  const auto loadOnly = hasArgument(arguments, "--load-only");
+  const auto forceDecode = hasArgument(arguments, "--force-decode");
+
+  if (formatName != "auto" && formatName != "bc1" && formatName != "bc3") {
+    std::println("Unknown format {}, use auto, bc1 or bc3", formatName);
+    return EXIT_FAILURE;
+  }
+
+  auto vulkanContext =
+      VulkanCore::Context::create(applicationName, getRequestedInstanceLayers(), getRequestedInstanceExtensions());
+
+  if (!vulkanContext) {
+    std::println("Unable to create the context: {}", vulkanContext.error());
+    return EXIT_FAILURE;
+  }
+
+  const auto physicalDevices = vulkanContext->enumeratePhysicalDevices();
+  const auto selected = VulkanCore::selectPhysicalDevice(physicalDevices, VK_QUEUE_COMPUTE_BIT);
+  if (!selected.has_value()) {
+    std::println("No device with a compute queue found");
+    return EXIT_FAILURE;
+  }
+
+  const auto& physicalDevice = physicalDevices[selected.value()];
+  auto device = VulkanCore::Device::create(physicalDevice,
+                                           physicalDevice.findQueueFamily(VK_QUEUE_COMPUTE_BIT).value());
+  if (!device) {
+    std::println("Unable to create the device: {}", device.error());
+    return EXIT_FAILURE;
+  }
+  std::println("Running on {}", physicalDevice.getProperties().deviceName);
+
+  if (!loadOnly) {
+    auto source = inputPath.empty() ? std::expected<VulkanCore::RgbaImage, std::string>{makeTestImage(size, size)}
+                                    : VulkanCore::loadPpm(inputPath);
+    if (!source) {
+      std::println("Unable to load the image: {}", source.error());
+      return EXIT_FAILURE;
+    }
+
+    VulkanCore::ShaderCompiler compiler;
+    const auto spirv = compiler.compileCompute(kDownsampleShader);
+    if (!spirv) {
+      std::println("Unable to compile the shader: {}", spirv.error());
+      return EXIT_FAILURE;
+    }
+
+    MipGenerator generator{device.value(), spirv.value()};
+    const auto mipStart = std::chrono::steady_clock::now();
+    const auto chain = generator.generate(source.value());
+    const auto mipTime = elapsedMilliseconds(mipStart);
+
+    // Each GPU level against the CPU filter applied to the GPU level above it, so errors do not add up. Rounding of
+    // pow on the GPU may move a channel by one.
+    uint32_t filterDifference = 0;
+    for (size_t level = 1; level < chain.size(); ++level)
+      filterDifference =
+          std::max(filterDifference, maxDifference(chain[level], VulkanCore::downsample(chain[level - 1])));
+    std::println("Generated {} levels from {}x{} on the GPU in {:.1f}ms, largest difference to the CPU filter {}",
+                 chain.size(), source->width, source->height, mipTime, filterDifference);
+    if (filterDifference > 1) {
+      std::println("The GPU mip chain does not match the CPU filter");
+      return EXIT_FAILURE;
+    }
+
+    auto format = VK_FORMAT_BC1_RGB_SRGB_BLOCK;
+    if (formatName == "bc3" || (formatName == "auto" && VulkanCore::hasTransparency(chain.front())))
+      format = VK_FORMAT_BC3_SRGB_BLOCK;
+    const auto compressStart = std::chrono::steady_clock::now();
+    // clang-format off
+    const auto levels = chain
+      | views::transform([format](const VulkanCore::RgbaImage& level) {
+          return VulkanCore::compressLevel(level, format);
+        })
+      | ranges::to<std::vector<std::vector<std::byte>>>();
+    // clang-format on
+    const auto compressTime = elapsedMilliseconds(compressStart);
+
+    const auto decoded = VulkanCore::decompressLevel(levels.front(), format, {source->width, source->height});
+    const auto colorPsnr = VulkanCore::computePsnr(chain.front(), decoded, 0, 3);
+    const auto hasAlpha = format == VK_FORMAT_BC3_SRGB_BLOCK;
+    const auto alphaPsnr = hasAlpha ? VulkanCore::computePsnr(chain.front(), decoded, 3, 4)
+                                    : std::numeric_limits<double>::infinity();
+    std::println("Compressed to {} in {:.1f}ms, level 0 PSNR {:.2f}dB color{}", hasAlpha ? "BC3" : "BC1",
+                 compressTime, colorPsnr, hasAlpha ? std::format(", {:.2f}dB alpha", alphaPsnr) : std::string{});
+
+    // The generated image is smooth gradients and block aligned edges, anything sane encodes it well above the floor.
+    // An arbitrary --input may legitimately be harder, so it is only reported.
+    constexpr double kMinimumPsnr = 30.0;
+    if (inputPath.empty() && (colorPsnr < kMinimumPsnr || alphaPsnr < kMinimumPsnr)) {
+      std::println("The encoder is below the {:.0f}dB floor on the test image", kMinimumPsnr);
+      return EXIT_FAILURE;
+    }
+
+    if (const auto written = VulkanCore::writeKtx2File(path, format, {source->width, source->height}, levels);
+        !written) {
+      std::println("Unable to write the texture: {}", written.error());
+      return EXIT_FAILURE;
+    }
+  }
+
+  auto mappedFile = VulkanCore::MappedFile::create(path);
+  if (!mappedFile) {
+    std::println("Unable to read the texture: {}", mappedFile.error());
+    return EXIT_FAILURE;
+  }
+  const auto textureFile = VulkanCore::Ktx2FileView::create(mappedFile->getData());
+  if (!textureFile) {
+    std::println("Unable to read the texture: {}", textureFile.error());
+    return EXIT_FAILURE;
+  }
+
+  const auto format = textureFile->getFormat();
+  const auto extent = textureFile->getExtent();
+  const auto fileLevels = textureFile->getLevels();
+  const auto levelCount = static_cast<uint32_t>(fileLevels.size());
+  const auto uncompressedSize =
+      std::transform_reduce(std::begin(fileLevels), std::end(fileLevels), uint64_t{0}, std::plus{},
+                            [](const VulkanCore::TextureLevel& level) {
+                              return uint64_t{level.extent.width} * level.extent.height * sizeof(uint32_t);
+                            });
+  std::println("{}: {}x{} with {} levels in {} bytes, {:.1f}x smaller than the {} bytes of RGBA8", path, extent.width,
+               extent.height, levelCount, mappedFile->getData().size(),
+               static_cast<double>(uncompressedSize) / static_cast<double>(mappedFile->getData().size()),
+               uncompressedSize);
+
+  const auto compressedUpload = !forceDecode && device->isTextureCompressionBcEnabled() &&
+                                physicalDevice.isFormatSupported(format, VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT |
+                                                                             VK_FORMAT_FEATURE_TRANSFER_SRC_BIT |
+                                                                             VK_FORMAT_FEATURE_TRANSFER_DST_BIT);
+
+  // The fallback decodes every level to RGBA8 up front, which costs the memory and bandwidth compression saves.
+  auto uploadFormat = format;
+  auto uploadLevels = std::vector<VulkanCore::TextureLevel>(std::begin(fileLevels), std::end(fileLevels));
+  std::vector<VulkanCore::RgbaImage> decodedLevels;
+  if (!compressedUpload) {
+    const auto decodeStart = std::chrono::steady_clock::now();
+    uploadFormat = VK_FORMAT_R8G8B8A8_SRGB;
+    for (const auto& level : fileLevels)
+      decodedLevels.push_back(VulkanCore::decompressLevel(level.data, format, level.extent));
+    for (uint32_t level = 0; level < levelCount; ++level)
+      uploadLevels[level].data = std::as_bytes(std::span{decodedLevels[level].texels});
+    std::println("No BC support, decoded to RGBA8 on the CPU in {:.1f}ms", elapsedMilliseconds(decodeStart));
+  }
+  const auto blockExtent = compressedUpload ? VulkanCore::kBlockExtent : 1u;
+  const auto blockSize = compressedUpload ? VulkanCore::getBlockSize(format) : static_cast<uint32_t>(sizeof(uint32_t));
+
+  auto image = device->createImage(extent, uploadFormat,
+                                   VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT |
+                                       VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+                                   levelCount);
+  {
+    VulkanCore::StagingRing ring{device.value(), segmentSize, kStagingSegments};
+    const auto uploadStart = std::chrono::steady_clock::now();
+    const auto upload = VulkanCore::uploadTexture(ring, image, uploadLevels, blockExtent, blockSize);
+    device->waitTimeline(upload.timelineValue);
+    const auto uploadTime = elapsedMilliseconds(uploadStart);
+
+    std::println("Uploaded {} bytes in {} copies over {} submissions in {:.2f}ms ({:.0f} MB/s), {} waits for a segment",
+                 upload.bytes, upload.copies, ring.getSubmissionCount(), uploadTime,
+                 static_cast<double>(upload.bytes) / 1e3 / uploadTime, ring.getStallCount());
+  }
+
+  const auto mismatches = VulkanCore::verifyTexture(device.value(), image, uploadLevels);
+  std::println("{} of {} levels read back as uploaded", levelCount - mismatches, levelCount);
+  device->destroyImage(image);
+
+  return mismatches == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
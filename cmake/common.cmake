@@ -4,7 +4,7 @@ project(the-vulkan-cookbook CXX)
 function (add_vulkan_executable)
   set(options "")
   set(oneValueArgs TARGET)
-  set(multiValueArgs SOURCES)
+  set(multiValueArgs SOURCES LIBRARIES)
   cmake_parse_arguments(ADD_VULKAN_EXECUTABLE "${options}" "${oneValueArgs}" "${multiValueArgs}" ${ARGN})
 
   add_executable(${ADD_VULKAN_EXECUTABLE_TARGET})
@@ -27,5 +27,6 @@ function (add_vulkan_executable)
       Vulkan::Loader
       vulkan-validationlayers::vulkan-validationlayers
       glfw
+      ${ADD_VULKAN_EXECUTABLE_LIBRARIES}
   )
 endfunction()
@@ -33,6 +33,9 @@ class the_vulkan_cookbookRecipe(ConanFile):
         self.requires("vulkan-loader/1.3.239.0")
         self.requires("vulkan-validationlayers/1.3.239.0")
         self.requires("glfw/3.4")
+        self.requires("glslang/1.3.239.0")
+        self.requires("glm/cci.20230113")
+        self.requires("meshoptimizer/0.20")
 
     def generate(self):
         deps = CMakeDeps(self)